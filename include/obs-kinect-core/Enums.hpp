@@ -38,6 +38,14 @@ enum EnabledSources
 
 using SourceFlags = std::uint32_t;
 
+enum class CaptureState
+{
+	Stopped,
+	Starting, //< device is being opened by its thread, no frame will be produced until it's running
+	Running,
+	Failed    //< device thread failed to open the device or to start its streams
+};
+
 enum class ExposureControl
 {
 	FullyAuto,
@@ -0,0 +1,115 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_KINECTDERIVEDDATACACHE
+#define OBS_KINECT_PLUGIN_KINECTDERIVEDDATACACHE
+
+#include <obs-kinect-core/Helper.hpp>
+#include <obs-kinect-core/KinectFrame.hpp>
+#include <obs-kinect-core/SoftwareDepthMapper.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+// Data derived from device frames which doesn't depend on the source using it (software depth mapping, dynamic depth/IR statistics)
+// Each device owns one, so sources sharing a device and settings compute it once per frame (results are keyed by frame index and parameters).
+// Results are immutable snapshots which can be kept and used from any thread.
+class OBSKINECT_API KinectDerivedDataCache
+{
+	public:
+		struct DynamicValues
+		{
+			double average;
+			double standardDeviation;
+		};
+
+		using MappedBodyIndex = std::shared_ptr<const std::vector<std::uint8_t>>;
+		using MappedDepth = std::shared_ptr<const std::vector<std::uint16_t>>;
+
+		KinectDerivedDataCache() = default;
+		KinectDerivedDataCache(const KinectDerivedDataCache&) = delete;
+		KinectDerivedDataCache(KinectDerivedDataCache&&) = delete;
+		~KinectDerivedDataCache() = default;
+
+		// Frame must have a depth (or infrared) frame
+		DynamicValues GetDepthDynamicValues(const KinectFrame& frame);
+		DynamicValues GetInfraredDynamicValues(const KinectFrame& frame);
+
+		// Color-sized and tightly packed (see SoftwareDepthMapper), frame must have color, depth and depth mapping frames (and body index for body mapping)
+		MappedBodyIndex GetMappedBodyIndex(const KinectFrame& frame, std::uint8_t maxDirtyDepth);
+		MappedDepth GetMappedDepth(const KinectFrame& frame, std::uint8_t maxDirtyDepth);
+
+		KinectDerivedDataCache& operator=(const KinectDerivedDataCache&) = delete;
+		KinectDerivedDataCache& operator=(KinectDerivedDataCache&&) = delete;
+
+		static DynamicValues ComputeDynamicValues(const std::uint16_t* values, std::size_t valueCount);
+
+		static constexpr std::uint64_t EvictionDelay = 60; //< frames without request after which a mapping is released
+
+	private:
+		static constexpr std::uint64_t InvalidFrameIndex = std::numeric_limits<std::uint64_t>::max();
+
+		// Mapper keeps its own state (dirty counters), one is needed for each maxDirtyDepth value and color size (accesses may get downscaled frames)
+		struct MapperKey
+		{
+			std::uint32_t colorWidth;
+			std::uint32_t colorHeight;
+			std::uint8_t maxDirtyDepth;
+
+			bool operator<(const MapperKey& other) const
+			{
+				return std::tie(colorWidth, colorHeight, maxDirtyDepth) < std::tie(other.colorWidth, other.colorHeight, other.maxDirtyDepth);
+			}
+		};
+
+		struct MapperEntry
+		{
+			SoftwareDepthMapper mapper;
+			std::shared_ptr<std::vector<std::uint8_t>> bodyIndex;
+			std::shared_ptr<std::vector<std::uint16_t>> depth;
+			std::uint64_t bodyIndexFrameIndex = InvalidFrameIndex;
+			std::uint64_t depthFrameIndex = InvalidFrameIndex;
+			std::uint64_t lastBodyIndexRequest = 0;
+			std::uint64_t lastDepthRequest = 0;
+		};
+
+		struct StatisticsEntry
+		{
+			DynamicValues values;
+			std::uint64_t frameIndex = InvalidFrameIndex;
+		};
+
+		void EvictUnusedMappings(std::uint64_t frameIndex);
+
+		template<typename T> static std::shared_ptr<std::vector<T>> UpdateSnapshot(std::shared_ptr<std::vector<T>> snapshot, const T* data, std::size_t size);
+
+		std::map<MapperKey, MapperEntry> m_mappers;
+		std::mutex m_mappingLock;
+		std::mutex m_statisticsLock;
+		StatisticsEntry m_depthStatistics;
+		StatisticsEntry m_infraredStatistics;
+};
+
+#endif
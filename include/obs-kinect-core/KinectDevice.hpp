@@ -31,16 +31,45 @@
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <utility>
 #include <variant>
 #include <vector>
 
+class KinectDerivedDataCache;
 class KinectDeviceAccess;
-
+class KinectFrameDownscaler;
+class KinectFrameSubscriber;
+class KinectNetworkSender;
+class KinectRecorder;
+class KinectReplayBuffer;
+class KinectSharedMemoryPublisher;
+
+// Devices are created when enumerated but should only open their hardware in OpenDevice, called when capture first
+// starts, and release it in CloseDevice, called once the device hasn't been used for the idle release delay
+// Once its last access is released, a device is kept alive for the keep-alive delay before stopping its capture: its thread
+// keeps running with no source enabled (so backends can stop their streams without closing the hardware)
+// Capture starts asynchronously: OpenDevice and ThreadFunc run on the device thread, which calls NotifyCaptureStarted
+// once its streams are started (exceptions thrown before that put the device in the Failed state)
 class OBSKINECT_API KinectDevice
 {
 	friend KinectDeviceAccess;
 
 	public:
+		struct OutputSize
+		{
+			std::uint32_t width = 0;
+			std::uint32_t height = 0;
+		};
+
+		// Device-wide services, they only run while the device has accesses
+		struct ServiceSettings
+		{
+			std::size_t replayBufferMemory = 0; //< 0 disables the replay buffer (see KinectReplayBuffer)
+			std::uint64_t replayBufferDuration = 0; //< in nanoseconds
+			std::uint16_t networkPort = 0; //< serves frames to remote receivers (see KinectNetworkSender), 0 disables it
+			bool shareFrames = false; //< publishes frames to other processes (see KinectSharedMemoryPublisher)
+		};
+
 		KinectDevice();
 		KinectDevice(const KinectDevice&) = delete;
 		KinectDevice(KinectDevice&&) = delete;
@@ -51,6 +80,8 @@ class OBSKINECT_API KinectDevice
 		virtual obs_properties_t* CreateProperties() const;
 
 		bool GetBoolParameterValue(const std::string& parameterName) const;
+		CaptureState GetCaptureState() const;
+		const std::shared_ptr<KinectDerivedDataCache>& GetDerivedDataCache() const;
 		double GetDoubleParameterValue(const std::string& parameterName) const;
 		long long GetIntParameterValue(const std::string& parameterName) const;
 		KinectFrameConstPtr GetLastFrame();
@@ -58,20 +89,34 @@ class OBSKINECT_API KinectDevice
 		SourceFlags GetSupportedSources() const;
 		const std::string& GetUniqueName() const;
 
+		bool HasReplayBuffer() const;
+
+		bool IsRecording() const;
+
+		bool SaveReplayBuffer(const std::string& filePath);
+
 		void SetDefaultValues(obs_data_t* settings) const;
+		void SetServiceSettings(const ServiceSettings& serviceSettings);
 
 		void StartCapture();
+		void StartRecording(const std::string& filePath);
 		void StopCapture();
+		void StopRecording();
 
 		KinectDevice& operator=(const KinectDevice&) = delete;
 		KinectDevice& operator=(KinectDevice&&) = delete;
 
+		static constexpr std::uint64_t DefaultIdleReleaseDelay = 10'000'000'000ULL; //< in nanoseconds
+		static constexpr std::uint64_t DefaultKeepAliveDelay = 5'000'000'000ULL; //< in nanoseconds
 		static constexpr std::uint64_t InvalidFrameIndex = std::numeric_limits<std::uint64_t>::max();
 
 	protected:
+		OutputSize GetOutputSize() const; //< largest color size accesses render at (0x0 if one needs native resolution)
 		std::optional<SourceFlags> GetSourceFlagsUpdate();
 
+		bool IsFrameNeeded(std::uint64_t timestamp); //< false if every access would decimate a frame captured at timestamp (see KinectFrame::timestamp), backends can skip processing it
 		bool IsRunning() const;
+		void NotifyCaptureStarted();
 		void RegisterBoolParameter(std::string parameterName, bool defaultValue, std::function<bool(bool, bool)> combinator);
 		void RegisterDoubleParameter(std::string parameterName, double defaultValue, double epsilon, std::function<double(double, double)> combinator);
 		void RegisterIntParameter(std::string parameterName, long long defaultValue, std::function<long long(long long, long long)> combinator);
@@ -80,10 +125,12 @@ class OBSKINECT_API KinectDevice
 		void TriggerSourceFlagsUpdate();
 		void UpdateFrame(KinectFramePtr kinectFrame);
 
+		virtual void CloseDevice();
 		virtual void HandleBoolParameterUpdate(const std::string& parameterName, bool value);
 		virtual void HandleDoubleParameterUpdate(const std::string& parameterName, double value);
 		virtual void HandleIntParameterUpdate(const std::string& parameterName, long long value);
-		virtual void ThreadFunc(std::condition_variable& cv, std::mutex& m, std::exception_ptr& exceptionPtr) = 0;
+		virtual void OpenDevice();
+		virtual void ThreadFunc() = 0;
 
 	private:
 		using ParameterValue = std::variant<bool, double, long long>;
@@ -92,6 +139,12 @@ class OBSKINECT_API KinectDevice
 		{
 			SourceFlags enabledSources;
 			std::unordered_map<std::string, ParameterValue> parameters;
+			KinectFrameConstPtr outputFrame; //< last frame given to this access, downscaled if needed (see GetLastOutputFrame)
+			OutputSize outputSize;
+			std::uint64_t idleReleaseDelay = DefaultIdleReleaseDelay;
+			std::uint64_t keepAliveDelay = DefaultKeepAliveDelay;
+			std::uint64_t nextFrameTime = 0;
+			std::uint32_t maxFrameRate = 0;
 		};
 
 		template<typename T>
@@ -112,26 +165,76 @@ class OBSKINECT_API KinectDevice
 
 		using ParameterData = std::variant<BoolParameter, DoubleParameter, IntegerParameter>;
 
+		enum class IdleReleaseStage
+		{
+			None,
+			KeepAlive, //< capture thread is running with no source enabled, waiting to be stopped
+			Release    //< capture is stopped, device is waiting to be closed
+		};
+
+		void CancelIdleRelease();
+		void CaptureThreadFunc();
+		KinectFrameConstPtr GetLastOutputFrame(const OutputSize& outputSize);
+		void IdleReleaseThreadFunc();
 		void RefreshParameters();
 		void ReleaseAccess(AccessData* access);
+		void ScheduleIdleRelease();
+		void StopCaptureThread();
+		template<typename T> void SwapFrameSubscriber(std::unique_ptr<T>& subscriber, std::unique_ptr<T>& newSubscriber);
 		void UpdateDeviceParameters(AccessData* access, obs_data_t* settings);
 		void UpdateEnabledSources();
+		void UpdateFrameSharing();
+		void UpdateIdleReleaseDelay();
+		void UpdateKeepAliveDelay();
+		void UpdateMaxFrameRate();
+		void UpdateNetworkSender();
+		void UpdateOutputSize();
 		void UpdateParameter(const std::string& parameterName);
+		void UpdateReplayBuffer();
+		void UpdateServices();
 
 		void SetEnabledSources(SourceFlags sourceFlags);
 
+		static bool AcceptFrame(std::uint64_t timestamp, std::uint32_t maxFrameRate, std::uint64_t& nextFrameTime);
+
 		SourceFlags m_deviceSources;
 		SourceFlags m_supportedSources;
+		OutputSize m_outputSize; //< protected by m_deviceSourceLock
+		std::vector<OutputSize> m_accessOutputSizes; //< protected by m_deviceSourceLock, frames are downscaled for them by the device thread
+		std::vector<std::pair<std::uint32_t, KinectFrameConstPtr>> m_lastDownscaledFrames; //< protected by m_lastFrameLock, last frame downscaled by each factor accesses need
+		ServiceSettings m_serviceSettings;
 		KinectFramePtr m_lastFrame;
+		std::atomic<CaptureState> m_captureState;
+		std::atomic_bool m_hasFrameSubscribers; //< lets IsFrameNeeded skip the subscriber lock
 		std::atomic_bool m_running;
-		std::mutex m_deviceSourceLock;
+		std::atomic_uint32_t m_maxFrameRate; //< 0 if an access needs every frame
+		std::condition_variable m_idleReleaseCv;
+		mutable std::mutex m_deviceSourceLock;
+		std::mutex m_idleReleaseLock;
 		std::mutex m_lastFrameLock;
+		mutable std::mutex m_frameSubscriberLock; //< protects subscribers and their list, taken once per frame
 		std::string m_uniqueName;
+		std::shared_ptr<KinectDerivedDataCache> m_derivedDataCache;
+		std::thread m_idleReleaseThread; //< started on first release, one per device
 		std::thread m_thread;
+		std::unique_ptr<KinectFrameDownscaler> m_frameDownscaler;
+		std::unique_ptr<KinectRecorder> m_recorder;
+		std::unique_ptr<KinectNetworkSender> m_sender;
+		std::unique_ptr<KinectReplayBuffer> m_replayBuffer;
+		std::unique_ptr<KinectSharedMemoryPublisher> m_publisher;
+		std::vector<KinectFrameSubscriber*> m_frameSubscribers; //< recorder, replay buffer, publisher and sender (when they exist)
 		std::unordered_map<std::string, ParameterData> m_parameters;
 		std::vector<std::unique_ptr<AccessData>> m_accesses;
 		std::uint64_t m_frameIndex;
+		std::uint64_t m_idleReleaseCloseDelay; //< protected by m_idleReleaseLock, idle release delay when the release was scheduled
+		std::uint64_t m_idleReleaseDeadline; //< protected by m_idleReleaseLock
+		std::uint64_t m_idleReleaseDelay;
+		std::uint64_t m_keepAliveDelay;
+		std::uint64_t m_nextFrameTime; //< only accessed by the device thread
+		bool m_deviceOpened; //< only accessed by the device thread, or by the idle release thread while it's not running
 		bool m_deviceSourceUpdated;
+		bool m_idleReleaseExit; //< protected by m_idleReleaseLock
+		IdleReleaseStage m_idleReleaseStage; //< protected by m_idleReleaseLock
 };
 
 #endif
@@ -34,12 +34,17 @@ class OBSKINECT_API KinectDeviceAccess
 		KinectDeviceAccess(KinectDeviceAccess&& access) noexcept;
 		~KinectDeviceAccess();
 
+		const std::shared_ptr<KinectDerivedDataCache>& GetDerivedDataCache() const;
 		const KinectDevice& GetDevice() const;
 		SourceFlags GetEnabledSourceFlags() const;
 
-		KinectFrameConstPtr GetLastFrame();
+		KinectFrameConstPtr GetLastFrame(); //< color space frames are downscaled (by the device, see KinectFrameDownscaler) if they're larger than needed for the output size, decimated frames aren't returned
 
 		void SetEnabledSourceFlags(SourceFlags enabledSources);
+		void SetIdleReleaseDelay(std::uint64_t delay); //< how long the device stays opened once it's no longer used, in nanoseconds
+		void SetMaxFrameRate(std::uint32_t frameRate); //< frames are decimated to not exceed it, 0 for every frame
+		void SetKeepAliveDelay(std::uint64_t delay); //< how long the device keeps its capture running (with no source enabled) once it's no longer used, in nanoseconds
+		void SetOutputSize(std::uint32_t width, std::uint32_t height); //< largest size color frames are rendered at, 0x0 for native resolution
 
 		void UpdateDeviceParameters(obs_data_t* settings);
 
@@ -87,7 +87,9 @@ struct KinectFrame
 	std::optional<DepthFrameData> depthFrame;
 	std::optional<DepthMappingFrameData> depthMappingFrame;
 	std::optional<InfraredFrameData> infraredFrame;
+	std::shared_ptr<const void> storage; //< keeps frame data alive when it doesn't live in FrameData::memory (e.g. recording mapping)
 	std::uint64_t frameIndex;
+	std::uint64_t timestamp = 0; //< capture time in nanoseconds (os_gettime_ns clock), set by UpdateFrame if the backend doesn't provide it
 };
 
 using KinectFramePtr = std::shared_ptr<KinectFrame>;
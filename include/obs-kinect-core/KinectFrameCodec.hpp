@@ -0,0 +1,69 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_KINECTFRAMECODEC
+#define OBS_KINECT_PLUGIN_KINECTFRAMECODEC
+
+#include <obs-kinect-core/Enums.hpp>
+#include <obs-kinect-core/Helper.hpp>
+#include <obs-kinect-core/KinectFrame.hpp>
+#include <obs-kinect-core/PlaneCodec.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class WorkerPool;
+
+// Serializes a whole KinectFrame to a single compact blob (used to send frames over the network)
+// - depth, infrared and color-mapped depth are coded losslessly with PlaneCodec RVL
+// - body index, color-mapped body and background removal are coded losslessly with PlaneCodec RLE
+// - RGBA/BGRA color is converted to 8bits YCbCr 4:2:0 (lossy, alpha is dropped), other color formats are sent as-is
+// - depth mapping is sent as-is
+// Every frame is coded independently so frames can be dropped anywhere between the encoder and the decoder.
+class OBSKINECT_API KinectFrameCodec
+{
+	public:
+		KinectFrameCodec(WorkerPool* workerPool = nullptr);
+		KinectFrameCodec(const KinectFrameCodec&) = delete;
+		KinectFrameCodec(KinectFrameCodec&&) noexcept = default;
+		~KinectFrameCodec() = default;
+
+		// Invalid input throws std::runtime_error
+		KinectFramePtr Decode(const std::uint8_t* input, std::size_t inputSize);
+
+		// Only streams in enabledSources are written, output is resized to the encoded size
+		void Encode(const KinectFrame& frame, SourceFlags enabledSources, std::vector<std::uint8_t>& output);
+
+		KinectFrameCodec& operator=(const KinectFrameCodec&) = delete;
+		KinectFrameCodec& operator=(KinectFrameCodec&&) noexcept = default;
+
+		// Size of the frame streams once decoded
+		static std::uint64_t ComputeRawSize(const KinectFrame& frame);
+
+	private:
+		void DecodeYuv420(const std::uint8_t* input, std::uint8_t* output, std::uint32_t outputPitch, std::uint32_t width, std::uint32_t height, bool bgra);
+		void EncodeYuv420(const std::uint8_t* input, std::uint32_t inputPitch, std::uint32_t width, std::uint32_t height, bool bgra, std::uint8_t* output);
+
+		std::vector<std::uint8_t> m_planeBuffer;
+		PlaneCodec m_planeCodec;
+		WorkerPool* m_workerPool;
+};
+
+#endif
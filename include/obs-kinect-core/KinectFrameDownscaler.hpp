@@ -0,0 +1,55 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_KINECTFRAMEDOWNSCALER
+#define OBS_KINECT_PLUGIN_KINECTFRAMEDOWNSCALER
+
+#include <obs-kinect-core/Helper.hpp>
+#include <obs-kinect-core/KinectFrame.hpp>
+#include <cstdint>
+#include <memory>
+
+class WorkerPool;
+
+// Downscales a frame color space (color, background removal, color-mapped depth/body and depth mapping frames) by an integer factor,
+// color and background removal frames are box filtered and others (which can't be averaged) are point sampled.
+// Depth space frames are shared with the source frame, which is kept alive through KinectFrame::storage.
+class OBSKINECT_API KinectFrameDownscaler
+{
+	public:
+		KinectFrameDownscaler(std::shared_ptr<WorkerPool> workerPool);
+		KinectFrameDownscaler(const KinectFrameDownscaler&) = delete;
+		KinectFrameDownscaler(KinectFrameDownscaler&&) noexcept = default;
+		~KinectFrameDownscaler() = default;
+
+		KinectFrameConstPtr Downscale(KinectFrameConstPtr frame, std::uint32_t factor) const; //< returns the frame itself if it can't be downscaled
+
+		KinectFrameDownscaler& operator=(const KinectFrameDownscaler&) = delete;
+		KinectFrameDownscaler& operator=(KinectFrameDownscaler&&) noexcept = default;
+
+		// Output size is a bounding box the frame is scaled to fit in, returns 1 if the frame doesn't need to (or can't) be downscaled for it
+		static std::uint32_t ComputeFactor(const KinectFrame& frame, std::uint32_t outputWidth, std::uint32_t outputHeight);
+
+		static constexpr std::uint32_t MaxFactor = 64; //< keeps box filter sums within 16 bits per row and exact fixed-point divisions
+
+	private:
+		std::shared_ptr<WorkerPool> m_workerPool;
+};
+
+#endif
@@ -0,0 +1,42 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_KINECTFRAMESUBSCRIBER
+#define OBS_KINECT_PLUGIN_KINECTFRAMESUBSCRIBER
+
+#include <obs-kinect-core/Helper.hpp>
+#include <obs-kinect-core/KinectFrame.hpp>
+
+// Device-wide consumer of every frame a device captures (recorder, replay buffer, shared memory and network publishers)
+// Devices call OnFrame on their thread, subscribers only keep a reference and process the frame on their own threads
+class OBSKINECT_API KinectFrameSubscriber
+{
+	public:
+		KinectFrameSubscriber() = default;
+		KinectFrameSubscriber(const KinectFrameSubscriber&) = delete;
+		KinectFrameSubscriber(KinectFrameSubscriber&&) = delete;
+		virtual ~KinectFrameSubscriber() = default;
+
+		virtual void OnFrame(const KinectFrameConstPtr& frame) = 0; //< must not block nor throw
+
+		KinectFrameSubscriber& operator=(const KinectFrameSubscriber&) = delete;
+		KinectFrameSubscriber& operator=(KinectFrameSubscriber&&) = delete;
+};
+
+#endif
@@ -0,0 +1,88 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_KINECTNETWORKFORMAT
+#define OBS_KINECT_PLUGIN_KINECTNETWORKFORMAT
+
+#include <obs-kinect-core/Enums.hpp>
+#include <cstdint>
+
+// obs-kinect network protocol (TCP), all integers are little endian
+// Every message is a MessageHeader followed by its content.
+// - the sender sends a Hello message as soon as a receiver connects
+// - the receiver answers with a Subscribe message (and sends another one each time it needs other streams)
+// - the sender then sends the last captured frame each time one is available, encoded with KinectFrameCodec (frames are dropped if the receiver is too slow)
+// - the receiver sends Ping messages from time to time, the sender answers them with a Pong message (used to estimate latency)
+namespace KinectNetworkFormat
+{
+	constexpr std::uint32_t Magic = 0x544E4B4F; //< "OKNT"
+	constexpr std::uint32_t Version = 1;
+	constexpr std::uint16_t DefaultPort = 27800;
+	constexpr std::uint32_t MaxMessageSize = 256 * 1024 * 1024;
+
+	enum class MessageType : std::uint32_t
+	{
+		Hello     = 0,
+		Subscribe = 1,
+		Frame     = 2,
+		Ping      = 3,
+		Pong      = 4
+	};
+
+	struct MessageHeader
+	{
+		MessageType type;
+		std::uint32_t size; //< content size, not including this header
+	};
+
+	struct HelloMessage
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint32_t supportedSources;
+		std::uint32_t reserved;
+		char deviceName[112];
+	};
+
+	struct SubscribeMessage
+	{
+		std::uint32_t enabledSources;
+		std::uint32_t reserved;
+	};
+
+	struct PingMessage
+	{
+		std::uint64_t clientTime; //< receiver os_gettime_ns
+	};
+
+	struct PongMessage
+	{
+		std::uint64_t clientTime; //< copied from the ping
+		std::uint64_t serverTime; //< sender os_gettime_ns when answering
+	};
+
+	static_assert(sizeof(MessageHeader) == 8);
+	static_assert(sizeof(HelloMessage) == 128);
+	static_assert(sizeof(SubscribeMessage) == 8);
+	static_assert(sizeof(PingMessage) == 8);
+	static_assert(sizeof(PongMessage) == 16);
+}
+
+#endif
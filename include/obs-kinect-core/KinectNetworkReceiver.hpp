@@ -0,0 +1,136 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_KINECTNETWORKRECEIVER
+#define OBS_KINECT_PLUGIN_KINECTNETWORKRECEIVER
+
+#include <obs-kinect-core/Enums.hpp>
+#include <obs-kinect-core/Helper.hpp>
+#include <obs-kinect-core/KinectFrame.hpp>
+#include <obs-kinect-core/KinectNetworkFormat.hpp>
+#include <obs-kinect-core/TcpSocket.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class WorkerPool;
+
+// Receives frames from a KinectNetworkSender (see KinectNetworkFormat), reconnecting as long as it lives
+// Frames are received, decoded and played out by different threads so network transfer and decoding overlap.
+// Decoded frames go through a jitter buffer: each frame is released jitterDelay after the earliest time it could have arrived
+// (sender timestamp + smallest observed transit time), which smooths out network jitter at the cost of some latency.
+class OBSKINECT_API KinectNetworkReceiver
+{
+	public:
+		struct ServerInfo
+		{
+			std::string deviceName;
+			SourceFlags supportedSources;
+		};
+
+		struct Stats
+		{
+			std::uint64_t decodeTime = 0;     //< total, in nanoseconds
+			std::uint64_t droppedFrames = 0;  //< by the receive queue or the jitter buffer
+			std::uint64_t latencySum = 0;     //< capture to playout, in nanoseconds (only frames received with a known clock offset)
+			std::uint64_t latencyCount = 0;
+			std::uint64_t maxLatency = 0;
+			std::uint64_t rawBytes = 0;       //< decoded stream size
+			std::uint64_t receivedBytes = 0;
+			std::uint64_t receivedFrames = 0;
+			std::uint64_t roundTripTime = 0;  //< best recent ping, in nanoseconds
+		};
+
+		KinectNetworkReceiver(std::string host, std::uint16_t port, std::uint64_t jitterDelay, WorkerPool* workerPool = nullptr); //< jitter delay in nanoseconds
+		KinectNetworkReceiver(const KinectNetworkReceiver&) = delete;
+		KinectNetworkReceiver(KinectNetworkReceiver&&) = delete;
+		~KinectNetworkReceiver();
+
+		bool IsConnected() const;
+
+		// Returns the stats accumulated since the last call
+		Stats PopStats();
+
+		void SetEnabledSources(SourceFlags enabledSources);
+		void SetJitterDelay(std::uint64_t jitterDelay); //< applies to the next received frames
+
+		// Returns nullptr if no frame was ready in time
+		KinectFramePtr WaitForFrame(std::uint32_t timeoutMs);
+
+		KinectNetworkReceiver& operator=(const KinectNetworkReceiver&) = delete;
+		KinectNetworkReceiver& operator=(KinectNetworkReceiver&&) = delete;
+
+		// Connects to a sender and reads its hello message, throws on failure
+		static ServerInfo Probe(const std::string& host, std::uint16_t port, std::uint32_t timeoutMs);
+
+		static constexpr std::uint32_t ConnectTimeout = 2000; //< ms
+		static constexpr std::size_t MaxBufferedFrames = 8;
+		static constexpr std::size_t MaxPendingFrames = 4;
+		static constexpr std::uint64_t PingInterval = 1'000'000'000; //< ns
+		static constexpr std::size_t TransitWindowSize = 128; //< frames
+
+	private:
+		struct BufferedFrame
+		{
+			KinectFramePtr frame;
+			std::uint64_t playoutTime;
+		};
+
+		struct PendingFrame
+		{
+			std::vector<std::uint8_t> data;
+			std::uint64_t arrivalTime;
+			std::uint64_t sessionId;
+		};
+
+		void DecodeFunc();
+		void HandlePong(const std::vector<std::uint8_t>& content);
+		void ReceiveFunc();
+		void ReceiveSession();
+		bool SendMessage(KinectNetworkFormat::MessageType type, const void* content, std::size_t size);
+
+		std::condition_variable m_bufferCv;
+		std::condition_variable m_pendingCv;
+		std::deque<BufferedFrame> m_buffer;
+		std::deque<PendingFrame> m_pendingFrames;
+		std::mutex m_lock;       //< protects m_buffer, m_pendingFrames and m_stats
+		std::mutex m_sendLock;   //< protects m_socket and writes to it
+		std::string m_host;
+		std::thread m_decodeThread;
+		std::thread m_receiveThread;
+		std::atomic<std::int64_t> m_clockOffset; //< sender clock - local clock
+		std::atomic<std::uint64_t> m_clockOffsetRoundTrip; //< round trip of the ping m_clockOffset comes from (0 if unknown)
+		std::atomic<std::uint64_t> m_clockOffsetTime;
+		std::atomic<SourceFlags> m_enabledSources;
+		std::atomic<std::uint64_t> m_jitterDelay;
+		std::atomic_bool m_connected;
+		std::atomic_bool m_running;
+		Stats m_stats;
+		TcpSocket m_socket;
+		WorkerPool* m_workerPool;
+		std::uint64_t m_sessionId;
+		std::uint16_t m_port;
+};
+
+#endif
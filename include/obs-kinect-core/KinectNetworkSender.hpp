@@ -0,0 +1,81 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_KINECTNETWORKSENDER
+#define OBS_KINECT_PLUGIN_KINECTNETWORKSENDER
+
+#include <obs-kinect-core/Enums.hpp>
+#include <obs-kinect-core/Helper.hpp>
+#include <obs-kinect-core/KinectFrame.hpp>
+#include <obs-kinect-core/KinectFrameSubscriber.hpp>
+#include <obs-kinect-core/TcpSocket.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class WorkerPool;
+
+// Serves the frames of a device to remote receivers (see KinectNetworkFormat and KinectNetworkReceiver)
+// Each receiver gets its own send thread which only sends the last published frame, encoded with the streams it subscribed to,
+// a slow receiver only drops frames and never blocks the device thread nor other receivers.
+class OBSKINECT_API KinectNetworkSender : public KinectFrameSubscriber
+{
+	public:
+		KinectNetworkSender(std::uint16_t port, std::string deviceName, SourceFlags supportedSources); //< throws if the port cannot be listened to
+		KinectNetworkSender(const KinectNetworkSender&) = delete;
+		KinectNetworkSender(KinectNetworkSender&&) = delete;
+		~KinectNetworkSender();
+
+		std::uint16_t GetPort() const;
+
+		void OnFrame(const KinectFrameConstPtr& frame) override; //< publishes it
+
+		// Frames are shared and never modified, only a reference is kept until they're sent
+		void Publish(KinectFrameConstPtr frame);
+
+		KinectNetworkSender& operator=(const KinectNetworkSender&) = delete;
+		KinectNetworkSender& operator=(KinectNetworkSender&&) = delete;
+
+		static constexpr std::uint32_t AcceptTimeout = 250; //< ms
+
+	private:
+		struct Client;
+
+		void AcceptFunc();
+		void ClientReceiveFunc(Client& client);
+		void ClientSendFunc(Client& client);
+		void StopClient(Client& client);
+
+		std::mutex m_clientLock;
+		std::shared_ptr<WorkerPool> m_workerPool;
+		std::string m_deviceName;
+		std::thread m_acceptThread;
+		std::vector<std::unique_ptr<Client>> m_clients;
+		std::atomic_bool m_running;
+		TcpSocket m_listenSocket;
+		SourceFlags m_supportedSources;
+		std::uint16_t m_port;
+};
+
+#endif
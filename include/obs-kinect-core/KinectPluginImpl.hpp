@@ -21,6 +21,7 @@
 #define OBS_KINECT_PLUGIN_KINECTPLUGINIMPL
 
 #include <obs-kinect-core/Helper.hpp>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -30,6 +31,8 @@ class KinectDevice;
 class OBSKINECT_API KinectPluginImpl
 {
 	public:
+		using HotplugCallback = std::function<void()>;
+
 		KinectPluginImpl() = default;
 		KinectPluginImpl(const KinectPluginImpl&) = delete;
 		KinectPluginImpl(KinectPluginImpl&&) = delete;
@@ -39,6 +42,9 @@ class OBSKINECT_API KinectPluginImpl
 
 		virtual std::vector<std::unique_ptr<KinectDevice>> Refresh() const = 0;
 
+		// Plugins able to detect devices being plugged/unplugged call this callback (from any thread) when it happens
+		virtual void SetHotplugCallback(HotplugCallback callback);
+
 		KinectPluginImpl& operator=(const KinectPluginImpl&) = delete;
 		KinectPluginImpl& operator=(KinectPluginImpl&&) = delete;
 };
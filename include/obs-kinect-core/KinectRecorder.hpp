@@ -0,0 +1,83 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_KINECTRECORDER
+#define OBS_KINECT_PLUGIN_KINECTRECORDER
+
+#include <obs-kinect-core/Enums.hpp>
+#include <obs-kinect-core/Helper.hpp>
+#include <obs-kinect-core/KinectFrame.hpp>
+#include <obs-kinect-core/KinectFrameSubscriber.hpp>
+#include <obs-kinect-core/KinectRecordingFormat.hpp>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes every stream of the frames it's given to a recording file (see KinectRecordingFormat), on its own thread
+class OBSKINECT_API KinectRecorder : public KinectFrameSubscriber
+{
+	public:
+		KinectRecorder(const std::string& filePath, const std::string& deviceName);
+		KinectRecorder(const KinectRecorder&) = delete;
+		KinectRecorder(KinectRecorder&&) = delete;
+		~KinectRecorder(); //< writes pending frames and the index
+
+		const std::string& GetFilePath() const;
+
+		void OnFrame(const KinectFrameConstPtr& frame) override; //< records it, dropping it if too many frames are pending
+
+		// Frames are shared and never modified, only a reference is kept until they're written
+		// When too many frames are pending the frame is dropped, unless waitIfFull is set (never set it from a device thread)
+		void Record(KinectFrameConstPtr frame, bool waitIfFull = false);
+
+		KinectRecorder& operator=(const KinectRecorder&) = delete;
+		KinectRecorder& operator=(KinectRecorder&&) = delete;
+
+		static std::string BuildFilePath(const std::string& deviceName);
+		static std::string GetRecordingDirectory();
+
+		static constexpr std::size_t MaxPendingFrames = 8;
+
+	private:
+		void Write(const void* data, std::size_t size);
+		void WriteFrame(const KinectFrame& frame);
+		void WriteIndex();
+		void WritePadding(std::uint64_t alignedOffset);
+		void WriterFunc();
+
+		std::condition_variable m_frameCv;
+		std::condition_variable m_spaceCv;
+		std::deque<KinectFrameConstPtr> m_pendingFrames;
+		std::mutex m_frameLock;
+		std::string m_filePath;
+		std::thread m_writerThread;
+		std::vector<KinectRecordingFormat::IndexEntry> m_index;
+		std::FILE* m_file;
+		std::uint64_t m_droppedFrameCount;
+		std::uint64_t m_fileOffset;
+		SourceFlags m_recordedSources;
+		bool m_running;
+		bool m_writeFailed;
+};
+
+#endif
@@ -0,0 +1,72 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_KINECTRECORDING
+#define OBS_KINECT_PLUGIN_KINECTRECORDING
+
+#include <obs-kinect-core/Enums.hpp>
+#include <obs-kinect-core/Helper.hpp>
+#include <obs-kinect-core/KinectFrame.hpp>
+#include <obs-kinect-core/KinectRecordingFormat.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Read-only memory mapping of a recording file (see KinectRecordingFormat)
+// Frames read from it don't copy anything, their data points directly into the mapping which they keep alive
+class OBSKINECT_API KinectRecording : public std::enable_shared_from_this<KinectRecording>
+{
+	public:
+		KinectRecording(const std::string& filePath); //< must be owned by a std::shared_ptr
+		KinectRecording(const KinectRecording&) = delete;
+		KinectRecording(KinectRecording&&) = delete;
+		~KinectRecording();
+
+		const std::string& GetDeviceName() const;
+		const std::string& GetFilePath() const;
+		std::size_t GetFrameCount() const;
+		std::uint64_t GetFrameTimestamp(std::size_t frameIndex) const;
+		SourceFlags GetSourceFlags() const;
+
+		KinectFramePtr ReadFrame(std::size_t frameIndex, SourceFlags enabledSources) const;
+
+		KinectRecording& operator=(const KinectRecording&) = delete;
+		KinectRecording& operator=(KinectRecording&&) = delete;
+
+	private:
+		void BuildIndex();
+		void Map();
+		template<typename T> T ReadStruct(std::uint64_t offset) const;
+		void Unmap();
+
+		std::string m_deviceName;
+		std::string m_filePath;
+		std::vector<KinectRecordingFormat::IndexEntry> m_index;
+		const std::uint8_t* m_data;
+		std::uint64_t m_fileSize;
+		SourceFlags m_sourceFlags;
+#ifdef _WIN32
+		void* m_fileHandle;
+		void* m_mappingHandle;
+#else
+		int m_fileDescriptor;
+#endif
+};
+
+#endif
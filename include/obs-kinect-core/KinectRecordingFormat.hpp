@@ -0,0 +1,131 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_KINECTRECORDINGFORMAT
+#define OBS_KINECT_PLUGIN_KINECTRECORDINGFORMAT
+
+#include <obs-kinect-core/Enums.hpp>
+#include <cstdint>
+
+// Kinect recording container (.kinectrec), all integers are little endian:
+// [FileHeader] [Chunk] ... [Chunk] [IndexEntry] ... [IndexEntry] [Footer]
+// Each chunk holds one frame: a ChunkHeader, its StreamHeaders and then the stream payloads.
+// Chunks are only appended, the index and footer are written when the recording ends (a recording without them can still be read by scanning its chunks).
+// Payloads are aligned so a memory mapping of the file can be used in place as frame data.
+namespace KinectRecordingFormat
+{
+	constexpr std::uint32_t FileMagic = 0x43524B4F;   //< "OKRC"
+	constexpr std::uint32_t ChunkMagic = 0x4D524646;  //< "FFRM"
+	constexpr std::uint32_t FooterMagic = 0x58444E49; //< "INDX"
+	constexpr std::uint32_t Version = 1;
+	constexpr std::uint64_t PayloadAlignment = 64;
+	constexpr const char* FileExtension = ".kinectrec";
+
+	enum class StreamType : std::uint32_t
+	{
+		BackgroundRemoval = 0,
+		BodyIndex         = 1,
+		Color             = 2,
+		ColorMappedBody   = 3,
+		ColorMappedDepth  = 4,
+		Depth             = 5,
+		DepthMapping      = 6,
+		Infrared          = 7,
+
+		Count
+	};
+
+	struct FileHeader
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint32_t sourceFlags; //< union of recorded streams, updated when the recording ends
+		std::uint32_t reserved;
+		std::uint64_t creationTime; //< UNIX time in seconds
+		char deviceName[104];
+	};
+
+	struct ChunkHeader
+	{
+		std::uint32_t magic;
+		std::uint32_t streamCount;
+		std::uint64_t chunkSize; //< including this header, stream headers and payloads
+		std::uint64_t frameIndex;
+		std::uint64_t timestamp;
+	};
+
+	struct StreamHeader
+	{
+		StreamType type;
+		std::uint32_t format; //< gs_color_format for color streams, unused otherwise
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint32_t pitch;
+		std::uint32_t reserved;
+		std::uint64_t payloadOffset; //< from the beginning of the file
+		std::uint64_t payloadSize;
+	};
+
+	struct IndexEntry
+	{
+		std::uint64_t chunkOffset;
+		std::uint64_t timestamp;
+	};
+
+	struct Footer
+	{
+		std::uint64_t indexOffset;
+		std::uint64_t entryCount;
+		std::uint32_t magic;
+		std::uint32_t version;
+	};
+
+	static_assert(sizeof(FileHeader) == 128);
+	static_assert(sizeof(ChunkHeader) == 32);
+	static_assert(sizeof(StreamHeader) == 40);
+	static_assert(sizeof(IndexEntry) == 16);
+	static_assert(sizeof(Footer) == 24);
+
+	constexpr SourceFlags ToSourceFlag(StreamType streamType)
+	{
+		switch (streamType)
+		{
+			case StreamType::BackgroundRemoval: return Source_BackgroundRemoval;
+			case StreamType::BodyIndex:         return Source_Body;
+			case StreamType::Color:             return Source_Color;
+			case StreamType::ColorMappedBody:   return Source_ColorMappedBody;
+			case StreamType::ColorMappedDepth:  return Source_ColorMappedDepth;
+			case StreamType::Depth:             return Source_Depth;
+			case StreamType::DepthMapping:      return Source_ColorToDepthMapping;
+			case StreamType::Infrared:          return Source_Infrared;
+
+			case StreamType::Count:
+				break;
+		}
+
+		return 0;
+	}
+
+	constexpr std::uint64_t AlignPayload(std::uint64_t offset)
+	{
+		return (offset + PayloadAlignment - 1) / PayloadAlignment * PayloadAlignment;
+	}
+}
+
+#endif
@@ -0,0 +1,124 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_KINECTREPLAYBUFFER
+#define OBS_KINECT_PLUGIN_KINECTREPLAYBUFFER
+
+#include <obs-kinect-core/Helper.hpp>
+#include <obs-kinect-core/KinectFrame.hpp>
+#include <obs-kinect-core/KinectFrameSubscriber.hpp>
+#include <obs-kinect-core/KinectRecordingFormat.hpp>
+#include <obs-kinect-core/PlaneCodec.hpp>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class KinectRecorder;
+
+// Keeps the last seconds of frames compressed in memory so they can be saved to a recording on demand (like OBS replay buffer)
+// Memory is allocated once as a ring of fixed-size arena chunks, the oldest frames are overwritten when the budget or the duration is exceeded.
+// Frames are compressed on a background thread (depth-like planes losslessly with PlaneCodec, others are copied) and saving happens on another one,
+// neither of them blocks the device thread.
+class OBSKINECT_API KinectReplayBuffer : public KinectFrameSubscriber
+{
+	public:
+		KinectReplayBuffer(std::size_t memoryBudget, std::uint64_t maxDuration); //< duration in nanoseconds
+		KinectReplayBuffer(const KinectReplayBuffer&) = delete;
+		KinectReplayBuffer(KinectReplayBuffer&&) = delete;
+		~KinectReplayBuffer(); //< waits for the running save (if any)
+
+		std::uint64_t GetMaxDuration() const;
+		std::size_t GetMemoryBudget() const;
+
+		bool IsSaving() const;
+
+		void OnFrame(const KinectFrameConstPtr& frame) override; //< pushes it
+
+		// Frames are shared and never modified, only a reference is kept until they're compressed
+		void Push(KinectFrameConstPtr frame);
+
+		// Writes the frames buffered at the time of the call to a recording (see KinectRecorder) on a background thread
+		// Returns false if a save is already running, throws if the file cannot be created
+		bool Save(const std::string& filePath, const std::string& deviceName);
+
+		KinectReplayBuffer& operator=(const KinectReplayBuffer&) = delete;
+		KinectReplayBuffer& operator=(KinectReplayBuffer&&) = delete;
+
+		static constexpr std::size_t ArenaChunkSize = 4 * 1024 * 1024;
+		static constexpr std::size_t MaxPendingFrames = 4;
+
+	private:
+		struct StreamRecord
+		{
+			KinectRecordingFormat::StreamType type;
+			std::uint32_t format;
+			std::uint32_t width;
+			std::uint32_t height;
+			std::uint32_t pitch;
+			std::uint64_t size;
+			bool compressed;
+		};
+
+		struct FrameRecord
+		{
+			std::array<StreamRecord, std::size_t(KinectRecordingFormat::StreamType::Count)> streams;
+			std::size_t streamCount;
+			std::uint64_t frameIndex;
+			std::uint64_t offset; //< position in the ring, only ever increases (physical offset is modulo the ring size)
+			std::uint64_t size;
+			std::uint64_t timestamp;
+		};
+
+		FrameRecord& GetRecord(std::uint64_t recordId);
+		void CompressFrame(const KinectFrame& frame);
+		void CompressorFunc();
+		KinectFramePtr DecompressFrame(const FrameRecord& record, std::vector<std::uint8_t>& buffer, PlaneCodec& codec) const;
+		void ReadRing(std::uint64_t offset, void* data, std::size_t size) const;
+		void SaverFunc(std::unique_ptr<KinectRecorder> recorder, std::uint64_t firstRecordId, std::uint64_t endRecordId);
+		void WriteRing(std::uint64_t offset, const void* data, std::size_t size);
+
+		std::array<std::vector<std::uint8_t>, std::size_t(KinectRecordingFormat::StreamType::Count)> m_encodedStreams;
+		std::condition_variable m_frameCv;
+		std::vector<FrameRecord> m_records; //< ring of m_recordCount records starting at m_recordHead, only grows when full
+		std::vector<KinectFrameConstPtr> m_pendingFrames;
+		mutable std::mutex m_lock;
+		std::thread m_compressorThread;
+		std::thread m_saverThread;
+		std::vector<std::unique_ptr<std::uint8_t[]>> m_chunks;
+		std::atomic_bool m_saving;
+		PlaneCodec m_codec;
+		std::size_t m_memoryBudget;
+		std::uint64_t m_droppedFrameCount;
+		std::size_t m_recordCount;
+		std::size_t m_recordHead;
+		std::uint64_t m_firstRecordId; //< id of the oldest record, ids only ever increase
+		std::uint64_t m_maxDuration;
+		std::uint64_t m_pinnedRecordId; //< records from this id can't be overwritten (being saved)
+		std::uint64_t m_ringSize;
+		std::uint64_t m_writeOffset;
+		bool m_running;
+};
+
+#endif
@@ -0,0 +1,85 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_KINECTSHAREDMEMORYFORMAT
+#define OBS_KINECT_PLUGIN_KINECTSHAREDMEMORYFORMAT
+
+#include <obs-kinect-core/KinectRecordingFormat.hpp>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Layout of the shared memory segments used to share a device frames with other processes (see KinectSharedMemoryPublisher):
+// [SegmentHeader] [Slot] ... [Slot], each slot being a SlotHeader followed by the stream payloads (same stream headers as recordings).
+// The publisher writes frames to the slots in turn, each slot is protected by a seqlock (its sequence is odd while it's being written),
+// readers copy the latest slot and retry if its sequence changed meanwhile, so a slow reader never blocks the publisher.
+// publishCount is incremented after each frame, readers can wait for it to change (futex on Linux, polling elsewhere).
+namespace KinectSharedMemoryFormat
+{
+	constexpr std::uint32_t Magic = 0x4D534B4F; //< "OKSM"
+	constexpr std::uint32_t Version = 1;
+	constexpr std::uint32_t MaxPublishers = 8; //< segments are named /obs-kinect-<index>
+	constexpr std::uint32_t SlotCount = 4;
+
+	enum class SegmentState : std::uint32_t
+	{
+		Active = 0,
+		Closed = 1 //< publisher stopped or moved to a bigger segment, readers should open it again
+	};
+
+	struct SegmentHeader
+	{
+		std::atomic<std::uint32_t> magic; //< written last
+		std::uint32_t version;
+		std::uint32_t slotCount;
+		std::uint32_t supportedSources;
+		std::uint64_t slotSize; //< including its header
+		std::uint64_t writerProcessId;
+		std::atomic<std::uint32_t> state;
+		std::atomic<std::uint32_t> publishCount;
+		std::atomic<std::uint32_t> waiterCount;
+		std::uint32_t reserved;
+		char deviceName[80];
+	};
+
+	struct SlotHeader
+	{
+		std::atomic<std::uint32_t> sequence;
+		std::uint32_t streamCount;
+		std::uint64_t frameIndex;
+		std::uint64_t timestamp;
+		KinectRecordingFormat::StreamHeader streams[std::size_t(KinectRecordingFormat::StreamType::Count)]; //< payload offsets are relative to the slot
+	};
+
+	static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "shared memory requires lock-free atomics");
+	static_assert(sizeof(SegmentHeader) == 128);
+
+	constexpr std::uint64_t SlotOffset(std::uint64_t slotSize, std::uint32_t slotIndex)
+	{
+		return KinectRecordingFormat::AlignPayload(sizeof(SegmentHeader)) + slotIndex * slotSize;
+	}
+
+	inline std::string GetSegmentName(std::uint32_t publisherIndex)
+	{
+		return "/obs-kinect-" + std::to_string(publisherIndex);
+	}
+}
+
+#endif
@@ -0,0 +1,64 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_KINECTSHAREDMEMORYPUBLISHER
+#define OBS_KINECT_PLUGIN_KINECTSHAREDMEMORYPUBLISHER
+
+#include <obs-kinect-core/Enums.hpp>
+#include <obs-kinect-core/Helper.hpp>
+#include <obs-kinect-core/KinectFrame.hpp>
+#include <obs-kinect-core/KinectFrameSubscriber.hpp>
+#include <obs-kinect-core/SharedMemorySegment.hpp>
+#include <atomic>
+#include <optional>
+#include <string>
+
+// Publishes the frames of a device to a shared memory segment (see KinectSharedMemoryFormat) so other local processes can read them
+// The first free segment name is claimed when the first frame is published, the segment is recreated if a frame doesn't fit in its slots.
+class OBSKINECT_API KinectSharedMemoryPublisher : public KinectFrameSubscriber
+{
+	public:
+		KinectSharedMemoryPublisher(std::string deviceName, SourceFlags supportedSources);
+		KinectSharedMemoryPublisher(const KinectSharedMemoryPublisher&) = delete;
+		KinectSharedMemoryPublisher(KinectSharedMemoryPublisher&&) = delete;
+		~KinectSharedMemoryPublisher();
+
+		bool HasFailed() const;
+
+		void OnFrame(const KinectFrameConstPtr& frame) override; //< publishes it, sharing stops on the first failure (see HasFailed)
+
+		// Copies frame data to the next slot, throws if no segment could be created
+		void Publish(const KinectFrame& frame);
+
+		KinectSharedMemoryPublisher& operator=(const KinectSharedMemoryPublisher&) = delete;
+		KinectSharedMemoryPublisher& operator=(KinectSharedMemoryPublisher&&) = delete;
+
+	private:
+		void CloseSegment();
+		void CreateSegment(std::uint64_t payloadSize);
+
+		std::optional<SharedMemorySegment> m_segment;
+		std::string m_deviceName;
+		std::uint64_t m_slotPayloadSize;
+		SourceFlags m_supportedSources;
+		std::atomic_bool m_failed;
+};
+
+#endif
@@ -0,0 +1,70 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_KINECTSTREAMPLANNER
+#define OBS_KINECT_PLUGIN_KINECTSTREAMPLANNER
+
+#include <obs-kinect-core/Enums.hpp>
+#include <obs-kinect-core/Helper.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Chooses which sources a device should stream from the sources its accesses requested over time
+// Streams never shrink while cameras run: sources that are no longer requested keep being streamed until a restart
+// is needed anyway (a new source is requested or the device configuration changed), sources that weren't requested
+// for the hysteresis delay are dropped at that point. When cameras start, they stream every source requested since
+// the last time they were dropped, so a filter added back after an idle period doesn't restart them again.
+class OBSKINECT_API KinectStreamPlanner
+{
+	public:
+		KinectStreamPlanner(std::string deviceName, SourceFlags supportedSources, std::uint64_t hysteresisDelay = DefaultHysteresisDelay);
+		KinectStreamPlanner(const KinectStreamPlanner&) = delete;
+		KinectStreamPlanner(KinectStreamPlanner&&) noexcept = default;
+		~KinectStreamPlanner() = default;
+
+		std::size_t GetRestartCount() const;
+		SourceFlags GetStreamSources() const;
+
+		void RegisterRestart(); //< to be called by the device before restarting running streams, drops stale sources
+		void RegisterRestart(std::uint64_t now);
+
+		bool Update(SourceFlags requestedSources); //< returns true if stream sources changed
+		bool Update(SourceFlags requestedSources, std::uint64_t now);
+
+		KinectStreamPlanner& operator=(const KinectStreamPlanner&) = delete;
+		KinectStreamPlanner& operator=(KinectStreamPlanner&&) noexcept = default;
+
+		static constexpr std::uint64_t DefaultHysteresisDelay = 30'000'000'000ULL; //< in nanoseconds
+
+	private:
+		SourceFlags GetRecentSources(std::uint64_t now) const;
+
+		std::array<std::uint64_t, sizeof(SourceFlags) * 8> m_lastRequestTimes; //< by source bit
+		std::string m_deviceName;
+		std::size_t m_restartCount;
+		std::uint64_t m_hysteresisDelay;
+		SourceFlags m_knownSources; //< requested at some point and not dropped since
+		SourceFlags m_requestedSources;
+		SourceFlags m_streamSources;
+		SourceFlags m_supportedSources;
+};
+
+#endif
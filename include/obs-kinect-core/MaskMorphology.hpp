@@ -0,0 +1,62 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_MASKMORPHOLOGY
+#define OBS_KINECT_PLUGIN_MASKMORPHOLOGY
+
+#include <obs-kinect-core/Helper.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class MorphologyOperation
+{
+	None = 0,
+	Erode = 1,  //< min over the structuring element, removes isolated foreground pixels
+	Dilate = 2, //< max over the structuring element, fills isolated holes
+	Open = 3,   //< erode then dilate
+	Close = 4   //< dilate then erode
+};
+
+// CPU morphology on R8 masks using a square structuring element of (2 * radius + 1) pixels
+// Based on van Herk/Gil-Werman running min/max, cost per pixel doesn't depend on radius
+class OBSKINECT_API MaskMorphology
+{
+	public:
+		MaskMorphology() = default;
+		MaskMorphology(const MaskMorphology&) = delete;
+		MaskMorphology(MaskMorphology&&) noexcept = default;
+		~MaskMorphology() = default;
+
+		// input and output may point to the same memory
+		void Apply(MorphologyOperation operation, std::size_t radius, const std::uint8_t* input, std::uint32_t inputPitch, std::uint8_t* output, std::uint32_t outputPitch, std::uint32_t width, std::uint32_t height);
+
+		MaskMorphology& operator=(const MaskMorphology&) = delete;
+		MaskMorphology& operator=(MaskMorphology&&) noexcept = default;
+
+	private:
+		template<bool Max> void Filter(std::size_t radius, const std::uint8_t* input, std::uint32_t inputPitch, std::uint8_t* output, std::uint32_t outputPitch, std::uint32_t width, std::uint32_t height);
+
+		std::vector<std::uint8_t> m_backwardBuffer;
+		std::vector<std::uint8_t> m_forwardBuffer;
+		std::vector<std::uint8_t> m_intermediateImage;
+		std::vector<std::uint8_t> m_paddedLine;
+};
+
+#endif
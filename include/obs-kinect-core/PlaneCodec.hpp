@@ -0,0 +1,83 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_PLANECODEC
+#define OBS_KINECT_PLUGIN_PLANECODEC
+
+#include <obs-kinect-core/Helper.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class WorkerPool;
+
+enum class PlaneCodecType : std::uint8_t
+{
+	Rvl16 = 1, //< 16bits planes (depth, infrared)
+	Rle8  = 2  //< 8bits planes (body index)
+};
+
+// Lossless codec for the sparse and smooth planes produced by depth sensors
+// - 16bits planes use RVL: zero runs and variable length coding of the difference between consecutive non-zero values
+// - 8bits planes use run-length coding
+// When a reference plane (usually the previous frame) is given, the difference with it is coded instead of the plane itself.
+// Planes are split in bands of rows coded independently, so they can be encoded and decoded in parallel.
+class OBSKINECT_API PlaneCodec
+{
+	public:
+		struct PlaneInfo
+		{
+			PlaneCodecType type;
+			std::uint32_t width;
+			std::uint32_t height;
+			bool temporal;
+		};
+
+		PlaneCodec(WorkerPool* workerPool = nullptr);
+		PlaneCodec(const PlaneCodec&) = delete;
+		PlaneCodec(PlaneCodec&&) noexcept = default;
+		~PlaneCodec() = default;
+
+		// Output (and reference) must hold the plane size given by ReadPlaneInfo, invalid input throws std::runtime_error
+		void DecodeBodyIndex(const std::uint8_t* input, std::size_t inputSize, std::uint8_t* output, std::uint32_t outputPitch, const std::uint8_t* reference = nullptr, std::uint32_t referencePitch = 0);
+		void DecodeDepth(const std::uint8_t* input, std::size_t inputSize, std::uint16_t* output, std::uint32_t outputPitch, const std::uint16_t* reference = nullptr, std::uint32_t referencePitch = 0);
+
+		// Pitches are in bytes, output is resized to the encoded size
+		void EncodeBodyIndex(const std::uint8_t* input, std::uint32_t inputPitch, std::uint32_t width, std::uint32_t height, std::vector<std::uint8_t>& output, const std::uint8_t* reference = nullptr, std::uint32_t referencePitch = 0);
+		void EncodeDepth(const std::uint16_t* input, std::uint32_t inputPitch, std::uint32_t width, std::uint32_t height, std::vector<std::uint8_t>& output, const std::uint16_t* reference = nullptr, std::uint32_t referencePitch = 0);
+
+		PlaneCodec& operator=(const PlaneCodec&) = delete;
+		PlaneCodec& operator=(PlaneCodec&&) noexcept = default;
+
+		static PlaneInfo ReadPlaneInfo(const std::uint8_t* input, std::size_t inputSize);
+
+		static constexpr std::uint32_t BandHeight = 32;
+
+	private:
+		template<typename T, typename EncodeFunc> void Encode(PlaneCodecType type, const T* input, std::uint32_t inputPitch, std::uint32_t width, std::uint32_t height, std::vector<std::uint8_t>& output, const T* reference, std::uint32_t referencePitch, EncodeFunc&& encodeBand);
+		template<typename T, typename DecodeFunc> void Decode(PlaneCodecType type, const std::uint8_t* input, std::size_t inputSize, T* output, std::uint32_t outputPitch, const T* reference, std::uint32_t referencePitch, DecodeFunc&& decodeBand);
+		void ForEachBand(std::uint32_t bandCount, const std::function<void(std::uint32_t band)>& func);
+
+		std::vector<std::vector<std::uint8_t>> m_bandBuffers;
+		std::vector<std::uint8_t> m_planeBuffer;
+		WorkerPool* m_workerPool;
+};
+
+#endif
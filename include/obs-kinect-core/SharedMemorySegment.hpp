@@ -0,0 +1,67 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_SHAREDMEMORYSEGMENT
+#define OBS_KINECT_PLUGIN_SHAREDMEMORYSEGMENT
+
+#include <obs-kinect-core/Helper.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Named POSIX shared memory mapping (shm_open), read-write
+class OBSKINECT_API SharedMemorySegment
+{
+	public:
+		SharedMemorySegment(const SharedMemorySegment&) = delete;
+		SharedMemorySegment(SharedMemorySegment&& segment) noexcept;
+		~SharedMemorySegment();
+
+		std::uint8_t* GetData() const;
+		const std::string& GetName() const;
+		std::size_t GetSize() const;
+
+		SharedMemorySegment& operator=(const SharedMemorySegment&) = delete;
+		SharedMemorySegment& operator=(SharedMemorySegment&& segment) noexcept;
+
+		// Returns an empty optional if a segment with this name already exists, throws on other errors
+		static std::optional<SharedMemorySegment> Create(const std::string& name, std::size_t size);
+		// Returns an empty optional if no segment with this name exists, throws on other errors
+		static std::optional<SharedMemorySegment> Open(const std::string& name);
+		static void Unlink(const std::string& name);
+
+		static bool IsProcessAlive(std::uint64_t processId);
+		static std::uint64_t GetCurrentProcessId();
+
+		// Cross-process wait for a shared word to change from value (may return early), and wake of every waiter
+		static void WaitForChange(const std::atomic<std::uint32_t>& word, std::uint32_t value, std::uint32_t timeoutMs);
+		static void WakeAll(std::atomic<std::uint32_t>& word);
+
+	private:
+		SharedMemorySegment(std::string name, std::uint8_t* data, std::size_t size);
+
+		std::string m_name;
+		std::uint8_t* m_data;
+		std::size_t m_size;
+};
+
+#endif
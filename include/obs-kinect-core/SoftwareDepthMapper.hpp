@@ -0,0 +1,58 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_SOFTWAREDEPTHMAPPER
+#define OBS_KINECT_PLUGIN_SOFTWAREDEPTHMAPPER
+
+#include <obs-kinect-core/KinectFrame.hpp>
+#include <cstdint>
+#include <vector>
+
+// Maps depth and body index frames to color space on the CPU, using a color-to-depth mapping frame
+// Pixels without a valid mapping keep their last value for up to maxDirtyDepth frames (which lowers flickering)
+class OBSKINECT_API SoftwareDepthMapper
+{
+	public:
+		SoftwareDepthMapper() = default;
+		SoftwareDepthMapper(const SoftwareDepthMapper&) = delete;
+		SoftwareDepthMapper(SoftwareDepthMapper&&) noexcept = default;
+		~SoftwareDepthMapper() = default;
+
+		// Returns a colorFrame-sized R8 body index frame (tightly packed)
+		const std::uint8_t* MapBodyIndex(const ColorFrameData& colorFrame, const DepthFrameData& depthFrame, const BodyIndexFrameData& bodyIndexFrame, const DepthMappingFrameData& depthMappingFrame, std::uint8_t maxDirtyDepth);
+		// Returns a colorFrame-sized R16 depth frame (tightly packed)
+		const std::uint16_t* MapDepth(const ColorFrameData& colorFrame, const DepthFrameData& depthFrame, const DepthMappingFrameData& depthMappingFrame, std::uint8_t maxDirtyDepth);
+
+		void ReleaseBodyIndexMapping();
+		void ReleaseDepthMapping();
+
+		SoftwareDepthMapper& operator=(const SoftwareDepthMapper&) = delete;
+		SoftwareDepthMapper& operator=(SoftwareDepthMapper&&) noexcept = default;
+
+		static constexpr std::uint8_t InvalidBodyIndexOutput = 255;
+		static constexpr std::uint16_t InvalidDepthOutput = 0;
+
+	private:
+		std::vector<std::uint8_t> m_bodyMappingMemory;
+		std::vector<std::uint8_t> m_bodyMappingDirtyCounter;
+		std::vector<std::uint8_t> m_depthMappingMemory;
+		std::vector<std::uint8_t> m_depthMappingDirtyCounter;
+};
+
+#endif
@@ -0,0 +1,50 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_SOFTWAREALPHAMASK
+#define OBS_KINECT_PLUGIN_SOFTWAREALPHAMASK
+
+#include <obs-kinect-core/SoftwareShaders/SoftwareTexture.hpp>
+#include <vector>
+
+class WorkerPool;
+
+// CPU version of AlphaMaskShader (alpha_mask.effect), output is a texture of the color size in GS_RGBA (default) or GS_BGRA format
+class OBSKINECT_API SoftwareAlphaMask
+{
+	public:
+		SoftwareAlphaMask(gs_color_format colorFormat = GS_RGBA, WorkerPool* workerPool = nullptr);
+		SoftwareAlphaMask(const SoftwareAlphaMask&) = delete;
+		SoftwareAlphaMask(SoftwareAlphaMask&&) noexcept = default;
+		~SoftwareAlphaMask() = default;
+
+		SoftwareTexture Filter(const SoftwareTexture& color, const SoftwareTexture& mask);
+
+		SoftwareAlphaMask& operator=(const SoftwareAlphaMask&) = delete;
+		SoftwareAlphaMask& operator=(SoftwareAlphaMask&&) noexcept = default;
+
+	private:
+		void FastFilter(const SoftwareTexture& color, const SoftwareTexture& mask, const SoftwareTexture& renderTarget);
+
+		gs_color_format m_colorFormat;
+		std::vector<std::uint8_t> m_workMemory;
+		WorkerPool* m_workerPool;
+};
+
+#endif
@@ -0,0 +1,54 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_SOFTWAREGAUSSIANBLUR
+#define OBS_KINECT_PLUGIN_SOFTWAREGAUSSIANBLUR
+
+#include <obs-kinect-core/SoftwareShaders/SoftwareTexture.hpp>
+#include <cstddef>
+#include <vector>
+
+class WorkerPool;
+
+// CPU version of GaussianBlurShader (gaussian_blur.effect), each pass is quantized to the render target format (GS_R8, GS_RGBA or GS_BGRA)
+class OBSKINECT_API SoftwareGaussianBlur
+{
+	public:
+		SoftwareGaussianBlur(gs_color_format colorFormat, WorkerPool* workerPool = nullptr);
+		SoftwareGaussianBlur(const SoftwareGaussianBlur&) = delete;
+		SoftwareGaussianBlur(SoftwareGaussianBlur&&) noexcept = default;
+		~SoftwareGaussianBlur() = default;
+
+		SoftwareTexture Blur(const SoftwareTexture& source, std::size_t count);
+
+		SoftwareGaussianBlur& operator=(const SoftwareGaussianBlur&) = delete;
+		SoftwareGaussianBlur& operator=(SoftwareGaussianBlur&&) noexcept = default;
+
+	private:
+		void BlurPass(const SoftwareTexture& source, std::vector<std::uint8_t>& targetMemory, float filterX, float filterY);
+		void FastBlurHorizontalPass(const SoftwareTexture& source, std::vector<std::uint8_t>& targetMemory);
+		void FastBlurVerticalPass(const SoftwareTexture& source, std::vector<std::uint8_t>& targetMemory);
+
+		gs_color_format m_colorFormat;
+		std::vector<std::uint8_t> m_workMemoryA;
+		std::vector<std::uint8_t> m_workMemoryB;
+		WorkerPool* m_workerPool;
+};
+
+#endif
@@ -0,0 +1,94 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_SOFTWAREGREENSCREENFILTER
+#define OBS_KINECT_PLUGIN_SOFTWAREGREENSCREENFILTER
+
+#include <obs-kinect-core/SoftwareShaders/SoftwareTexture.hpp>
+#include <cstdint>
+#include <vector>
+
+class WorkerPool;
+
+// CPU version of GreenScreenFilterShader (greenscreen_filter.effect), output is a GS_R8 texture
+// Textures are given as pointers (no colorToDepthTexture means the "WithoutDepthCorrection" technique)
+class OBSKINECT_API SoftwareGreenScreenFilter
+{
+	public:
+		struct BodyFilterParams;
+		struct DepthFilterParams;
+		struct BodyOrDepthFilterParams;
+		struct BodyWithinDepthFilterParams;
+
+		SoftwareGreenScreenFilter(WorkerPool* workerPool = nullptr);
+		SoftwareGreenScreenFilter(const SoftwareGreenScreenFilter&) = delete;
+		SoftwareGreenScreenFilter(SoftwareGreenScreenFilter&&) noexcept = default;
+		~SoftwareGreenScreenFilter() = default;
+
+		SoftwareTexture Filter(std::uint32_t width, std::uint32_t height, const BodyFilterParams& params);
+		SoftwareTexture Filter(std::uint32_t width, std::uint32_t height, const BodyOrDepthFilterParams& params);
+		SoftwareTexture Filter(std::uint32_t width, std::uint32_t height, const BodyWithinDepthFilterParams& params);
+		SoftwareTexture Filter(std::uint32_t width, std::uint32_t height, const DepthFilterParams& params);
+
+		SoftwareGreenScreenFilter& operator=(const SoftwareGreenScreenFilter&) = delete;
+		SoftwareGreenScreenFilter& operator=(SoftwareGreenScreenFilter&&) noexcept = default;
+
+		struct BodyFilterParams
+		{
+			const SoftwareTexture* bodyIndexTexture;
+			const SoftwareTexture* colorToDepthTexture;
+		};
+
+		struct DepthFilterParams
+		{
+			const SoftwareTexture* colorToDepthTexture;
+			const SoftwareTexture* depthTexture;
+			float progressiveDepth;
+			float maxDepth;
+			float minDepth;
+		};
+
+		struct BodyOrDepthFilterParams
+		{
+			const SoftwareTexture* bodyIndexTexture;
+			const SoftwareTexture* colorToDepthTexture;
+			const SoftwareTexture* depthTexture;
+			float progressiveDepth;
+			float maxDepth;
+			float minDepth;
+		};
+
+		struct BodyWithinDepthFilterParams
+		{
+			const SoftwareTexture* bodyIndexTexture;
+			const SoftwareTexture* colorToDepthTexture;
+			const SoftwareTexture* depthTexture;
+			float progressiveDepth;
+			float maxDepth;
+			float minDepth;
+		};
+
+	private:
+		template<typename F> SoftwareTexture Process(std::uint32_t width, std::uint32_t height, F&& func);
+
+		std::vector<std::uint8_t> m_workMemory;
+		WorkerPool* m_workerPool;
+};
+
+#endif
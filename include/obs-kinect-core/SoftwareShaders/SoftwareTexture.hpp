@@ -0,0 +1,39 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_SOFTWARETEXTURE
+#define OBS_KINECT_PLUGIN_SOFTWARETEXTURE
+
+#include <obs-kinect-core/Helper.hpp>
+#include <cstdint>
+
+// CPU-side counterpart of a gs_texture_t, used by software shaders
+// Supported formats are GS_R8, GS_R16, GS_RG32F, GS_RGBA, GS_BGRA and GS_BGRX
+struct SoftwareTexture
+{
+	const std::uint8_t* ptr = nullptr;
+	gs_color_format format = GS_UNKNOWN;
+	std::uint32_t width = 0;
+	std::uint32_t height = 0;
+	std::uint32_t pitch = 0;
+
+	explicit operator bool() const { return ptr != nullptr; }
+};
+
+#endif
@@ -0,0 +1,47 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_SOFTWAREVISIBILITYMASK
+#define OBS_KINECT_PLUGIN_SOFTWAREVISIBILITYMASK
+
+#include <obs-kinect-core/SoftwareShaders/SoftwareTexture.hpp>
+#include <vector>
+
+class WorkerPool;
+
+// CPU version of VisibilityMaskShader (visibility_mask.effect), output is a GS_R8 texture
+class OBSKINECT_API SoftwareVisibilityMask
+{
+	public:
+		SoftwareVisibilityMask(WorkerPool* workerPool = nullptr);
+		SoftwareVisibilityMask(const SoftwareVisibilityMask&) = delete;
+		SoftwareVisibilityMask(SoftwareVisibilityMask&&) noexcept = default;
+		~SoftwareVisibilityMask() = default;
+
+		SoftwareTexture Mask(const SoftwareTexture& filter, const SoftwareTexture& mask);
+
+		SoftwareVisibilityMask& operator=(const SoftwareVisibilityMask&) = delete;
+		SoftwareVisibilityMask& operator=(SoftwareVisibilityMask&&) noexcept = default;
+
+	private:
+		std::vector<std::uint8_t> m_workMemory;
+		WorkerPool* m_workerPool;
+};
+
+#endif
@@ -0,0 +1,69 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_TCPSOCKET
+#define OBS_KINECT_PLUGIN_TCPSOCKET
+
+#include <obs-kinect-core/Helper.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Minimal blocking TCP socket (BSD sockets / Winsock), errors throw std::runtime_error except for disconnections
+class OBSKINECT_API TcpSocket
+{
+	public:
+		TcpSocket();
+		TcpSocket(const TcpSocket&) = delete;
+		TcpSocket(TcpSocket&& socket) noexcept;
+		~TcpSocket();
+
+		// Returns an invalid socket if no connection came in time
+		TcpSocket Accept(std::uint32_t timeoutMs);
+
+		void Close();
+
+		std::uint16_t GetLocalPort() const;
+		std::string GetRemoteAddress() const; //< host:port of the peer
+
+		bool IsValid() const;
+
+		// Block until the whole buffer has been transferred, return false if the connection was closed (or the receive timeout expired)
+		bool Receive(void* data, std::size_t size);
+		bool Send(const void* data, std::size_t size);
+
+		void SetReceiveTimeout(std::uint32_t timeoutMs); //< 0 to wait indefinitely
+
+		// Makes pending and future operations fail, can be called from another thread
+		void Shutdown();
+
+		TcpSocket& operator=(const TcpSocket&) = delete;
+		TcpSocket& operator=(TcpSocket&& socket) noexcept;
+
+		static TcpSocket Connect(const std::string& host, std::uint16_t port, std::uint32_t timeoutMs);
+		static TcpSocket Listen(std::uint16_t port); //< 0 picks any free port
+
+	private:
+		explicit TcpSocket(std::intptr_t handle);
+
+		std::intptr_t m_handle;
+};
+
+#endif
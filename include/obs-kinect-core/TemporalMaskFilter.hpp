@@ -0,0 +1,58 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_TEMPORALMASKFILTER
+#define OBS_KINECT_PLUGIN_TEMPORALMASKFILTER
+
+#include <obs-kinect-core/Helper.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU counterpart of temporal_filter.effect, for R8 masks
+// Exponential moving average whose history weight decreases with the per-pixel difference, and resets past a threshold
+class OBSKINECT_API TemporalMaskFilter
+{
+	public:
+		TemporalMaskFilter();
+		TemporalMaskFilter(const TemporalMaskFilter&) = delete;
+		TemporalMaskFilter(TemporalMaskFilter&&) noexcept = default;
+		~TemporalMaskFilter() = default;
+
+		// historyFactor in [0, 1], resetThreshold in ]0, 1]
+		void Apply(float historyFactor, float resetThreshold, const std::uint8_t* input, std::uint32_t inputPitch, std::uint8_t* output, std::uint32_t outputPitch, std::uint32_t width, std::uint32_t height);
+
+		void Reset();
+
+		TemporalMaskFilter& operator=(const TemporalMaskFilter&) = delete;
+		TemporalMaskFilter& operator=(TemporalMaskFilter&&) noexcept = default;
+
+	private:
+		void UpdateWeights(float historyFactor, float resetThreshold);
+
+		std::array<std::uint16_t, 256> m_historyWeights; //< history weight (out of 256) by absolute difference
+		std::vector<std::uint8_t> m_history;
+		std::uint32_t m_historyHeight;
+		std::uint32_t m_historyWidth;
+		float m_historyFactor;
+		float m_resetThreshold;
+};
+
+#endif
@@ -0,0 +1,74 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_WORKERPOOL
+#define OBS_KINECT_PLUGIN_WORKERPOOL
+
+#include <obs-kinect-core/Helper.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads used to split CPU work in bands, the calling thread takes part in the work
+class OBSKINECT_API WorkerPool
+{
+	public:
+		using BandFunc = std::function<void(std::uint32_t begin, std::uint32_t end)>;
+
+		WorkerPool(std::size_t workerCount = 0); //< 0 means hardware concurrency - 1
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool(WorkerPool&&) = delete;
+		~WorkerPool();
+
+		std::size_t GetWorkerCount() const;
+
+		// Splits [0, count[ in contiguous bands and waits until all of them have been processed, calls made from a band of the same pool run inline
+		void ParallelFor(std::uint32_t count, const BandFunc& func);
+
+		WorkerPool& operator=(const WorkerPool&) = delete;
+		WorkerPool& operator=(WorkerPool&&) = delete;
+
+		static std::shared_ptr<WorkerPool> GetSharedPool();
+
+	private:
+		void ProcessBands();
+		void WorkerFunc();
+
+		std::condition_variable m_doneCv;
+		std::condition_variable m_workCv;
+		std::exception_ptr m_exception;
+		std::mutex m_dispatchMutex;
+		std::mutex m_mutex;
+		std::vector<std::thread> m_workers;
+		const BandFunc* m_func;
+		std::uint64_t m_generation;
+		std::uint32_t m_bandCount;
+		std::uint32_t m_bandSize;
+		std::uint32_t m_count;
+		std::uint32_t m_nextBand;
+		std::uint32_t m_pendingBands;
+		bool m_running;
+};
+
+#endif
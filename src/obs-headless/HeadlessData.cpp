@@ -0,0 +1,407 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace
+{
+	using DataValue = std::variant<bool, long long, double, std::string>;
+
+	struct DataItem
+	{
+		std::optional<DataValue> defaultValue;
+		std::optional<DataValue> value;
+
+		const DataValue* Get() const
+		{
+			if (value)
+				return &value.value();
+
+			if (defaultValue)
+				return &defaultValue.value();
+
+			return nullptr;
+		}
+	};
+
+	struct ListItem
+	{
+		std::string name;
+		std::variant<long long, std::string> value;
+		bool disabled = false;
+	};
+}
+
+struct obs_data
+{
+	std::atomic_long refCount = 1;
+	std::map<std::string, DataItem> items;
+};
+
+struct obs_properties
+{
+	std::vector<std::unique_ptr<obs_property_t>> properties;
+};
+
+struct obs_property
+{
+	std::string description;
+	std::string longDescription;
+	std::string name;
+	std::string suffix;
+	std::vector<ListItem> listItems;
+	obs_properties_t* group = nullptr;
+	obs_property_clicked_t clicked = nullptr;
+	obs_property_modified_t modified = nullptr;
+	bool visible = true;
+};
+
+namespace
+{
+	template<typename T>
+	T GetNumber(obs_data_t* data, const char* name)
+	{
+		if (!data || !name)
+			return T(0);
+
+		auto it = data->items.find(name);
+		if (it == data->items.end())
+			return T(0);
+
+		const DataValue* value = it->second.Get();
+		if (!value)
+			return T(0);
+
+		return std::visit([](auto&& arg) -> T
+		{
+			using V = std::decay_t<decltype(arg)>;
+			if constexpr (std::is_same_v<V, std::string>)
+				return T(0);
+			else
+				return static_cast<T>(arg);
+		}, *value);
+	}
+
+	obs_property_t* AddProperty(obs_properties_t* props, const char* name, const char* description)
+	{
+		if (!props || !name || obs_properties_get(props, name))
+			return nullptr;
+
+		auto& property = props->properties.emplace_back(std::make_unique<obs_property_t>());
+		property->name = name;
+		property->description = (description) ? description : "";
+
+		return property.get();
+	}
+
+	void SetDefault(obs_data_t* data, const char* name, DataValue value)
+	{
+		if (data && name)
+			data->items[name].defaultValue = std::move(value);
+	}
+
+	void SetValue(obs_data_t* data, const char* name, DataValue value)
+	{
+		if (data && name)
+			data->items[name].value = std::move(value);
+	}
+}
+
+extern "C"
+{
+	void obs_data_addref(obs_data_t* data)
+	{
+		if (data)
+			data->refCount++;
+	}
+
+	void obs_data_apply(obs_data_t* target, obs_data_t* apply_data)
+	{
+		if (!target || !apply_data || target == apply_data)
+			return;
+
+		for (auto&& [name, item] : apply_data->items)
+		{
+			if (item.value)
+				target->items[name].value = item.value;
+		}
+	}
+
+	obs_data_t* obs_data_create(void)
+	{
+		return new obs_data_t;
+	}
+
+	bool obs_data_get_bool(obs_data_t* data, const char* name)
+	{
+		return GetNumber<bool>(data, name);
+	}
+
+	double obs_data_get_double(obs_data_t* data, const char* name)
+	{
+		return GetNumber<double>(data, name);
+	}
+
+	long long obs_data_get_int(obs_data_t* data, const char* name)
+	{
+		return GetNumber<long long>(data, name);
+	}
+
+	const char* obs_data_get_string(obs_data_t* data, const char* name)
+	{
+		if (!data || !name)
+			return "";
+
+		auto it = data->items.find(name);
+		if (it == data->items.end())
+			return "";
+
+		const DataValue* value = it->second.Get();
+		if (!value)
+			return "";
+
+		if (const std::string* str = std::get_if<std::string>(value))
+			return str->c_str();
+
+		return "";
+	}
+
+	void obs_data_release(obs_data_t* data)
+	{
+		if (data && --data->refCount == 0)
+			delete data;
+	}
+
+	void obs_data_set_bool(obs_data_t* data, const char* name, bool val)
+	{
+		SetValue(data, name, val);
+	}
+
+	void obs_data_set_default_bool(obs_data_t* data, const char* name, bool val)
+	{
+		SetDefault(data, name, val);
+	}
+
+	void obs_data_set_default_double(obs_data_t* data, const char* name, double val)
+	{
+		SetDefault(data, name, val);
+	}
+
+	void obs_data_set_default_int(obs_data_t* data, const char* name, long long val)
+	{
+		SetDefault(data, name, val);
+	}
+
+	void obs_data_set_default_string(obs_data_t* data, const char* name, const char* val)
+	{
+		SetDefault(data, name, std::string((val) ? val : ""));
+	}
+
+	void obs_data_set_double(obs_data_t* data, const char* name, double val)
+	{
+		SetValue(data, name, val);
+	}
+
+	void obs_data_set_int(obs_data_t* data, const char* name, long long val)
+	{
+		SetValue(data, name, val);
+	}
+
+	void obs_data_set_string(obs_data_t* data, const char* name, const char* val)
+	{
+		SetValue(data, name, std::string((val) ? val : ""));
+	}
+
+	obs_property_t* obs_properties_add_bool(obs_properties_t* props, const char* name, const char* description)
+	{
+		return AddProperty(props, name, description);
+	}
+
+	obs_property_t* obs_properties_add_button(obs_properties_t* props, const char* name, const char* text, obs_property_clicked_t callback)
+	{
+		return obs_properties_add_button2(props, name, text, callback, nullptr);
+	}
+
+	obs_property_t* obs_properties_add_button2(obs_properties_t* props, const char* name, const char* text, obs_property_clicked_t callback, void* /*priv*/)
+	{
+		obs_property_t* property = AddProperty(props, name, text);
+		if (property)
+			property->clicked = callback;
+
+		return property;
+	}
+
+	obs_property_t* obs_properties_add_float(obs_properties_t* props, const char* name, const char* description, double /*min*/, double /*max*/, double /*step*/)
+	{
+		return AddProperty(props, name, description);
+	}
+
+	obs_property_t* obs_properties_add_float_slider(obs_properties_t* props, const char* name, const char* description, double /*min*/, double /*max*/, double /*step*/)
+	{
+		return AddProperty(props, name, description);
+	}
+
+	obs_property_t* obs_properties_add_group(obs_properties_t* props, const char* name, const char* description, enum obs_group_type /*type*/, obs_properties_t* group)
+	{
+		if (!group)
+			return nullptr;
+
+		obs_property_t* property = AddProperty(props, name, description);
+		if (property)
+			property->group = group;
+
+		return property;
+	}
+
+	obs_property_t* obs_properties_add_int(obs_properties_t* props, const char* name, const char* description, int /*min*/, int /*max*/, int /*step*/)
+	{
+		return AddProperty(props, name, description);
+	}
+
+	obs_property_t* obs_properties_add_int_slider(obs_properties_t* props, const char* name, const char* description, int /*min*/, int /*max*/, int /*step*/)
+	{
+		return AddProperty(props, name, description);
+	}
+
+	obs_property_t* obs_properties_add_list(obs_properties_t* props, const char* name, const char* description, enum obs_combo_type /*type*/, enum obs_combo_format /*format*/)
+	{
+		return AddProperty(props, name, description);
+	}
+
+	obs_property_t* obs_properties_add_path(obs_properties_t* props, const char* name, const char* description, enum obs_path_type /*type*/, const char* /*filter*/, const char* /*default_path*/)
+	{
+		return AddProperty(props, name, description);
+	}
+
+	obs_property_t* obs_properties_add_text(obs_properties_t* props, const char* name, const char* description, enum obs_text_type /*type*/)
+	{
+		return AddProperty(props, name, description);
+	}
+
+	obs_properties_t* obs_properties_create(void)
+	{
+		return new obs_properties_t;
+	}
+
+	void obs_properties_destroy(obs_properties_t* props)
+	{
+		if (!props)
+			return;
+
+		for (const auto& property : props->properties)
+			obs_properties_destroy(property->group);
+
+		delete props;
+	}
+
+	obs_property_t* obs_properties_get(obs_properties_t* props, const char* property)
+	{
+		if (!props || !property)
+			return nullptr;
+
+		// libobs also looks into groups
+		for (const auto& prop : props->properties)
+		{
+			if (prop->name == property)
+				return prop.get();
+
+			if (obs_property_t* groupProperty = obs_properties_get(prop->group, property))
+				return groupProperty;
+		}
+
+		return nullptr;
+	}
+
+	void obs_property_float_set_suffix(obs_property_t* p, const char* suffix)
+	{
+		if (p)
+			p->suffix = (suffix) ? suffix : "";
+	}
+
+	void obs_property_int_set_suffix(obs_property_t* p, const char* suffix)
+	{
+		if (p)
+			p->suffix = (suffix) ? suffix : "";
+	}
+
+	size_t obs_property_list_add_int(obs_property_t* p, const char* name, long long val)
+	{
+		if (!p)
+			return 0;
+
+		ListItem& item = p->listItems.emplace_back();
+		item.name = (name) ? name : "";
+		item.value = val;
+
+		return p->listItems.size() - 1;
+	}
+
+	size_t obs_property_list_add_string(obs_property_t* p, const char* name, const char* val)
+	{
+		if (!p)
+			return 0;
+
+		ListItem& item = p->listItems.emplace_back();
+		item.name = (name) ? name : "";
+		item.value = std::string((val) ? val : "");
+
+		return p->listItems.size() - 1;
+	}
+
+	void obs_property_list_clear(obs_property_t* p)
+	{
+		if (p)
+			p->listItems.clear();
+	}
+
+	void obs_property_list_item_disable(obs_property_t* p, size_t idx, bool disabled)
+	{
+		if (p && idx < p->listItems.size())
+			p->listItems[idx].disabled = disabled;
+	}
+
+	void obs_property_set_long_description(obs_property_t* p, const char* long_description)
+	{
+		if (p)
+			p->longDescription = (long_description) ? long_description : "";
+	}
+
+	void obs_property_set_modified_callback(obs_property_t* p, obs_property_modified_t modified)
+	{
+		if (p)
+			p->modified = modified;
+	}
+
+	void obs_property_set_visible(obs_property_t* p, bool visible)
+	{
+		if (p)
+			p->visible = visible;
+	}
+
+	bool obs_property_visible(obs_property_t* p)
+	{
+		return (p) ? p->visible : false;
+	}
+}
@@ -0,0 +1,774 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-headless/HeadlessGraphics.hpp>
+#include <obs-headless/HeadlessState.hpp>
+#include <graphics/image-file.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace
+{
+	// Same parameters and techniques as libobs default.effect
+	constexpr const char* BaseEffectSource = R"(
+uniform float4x4 ViewProj;
+uniform texture2d image;
+uniform float multiplier;
+
+technique Draw { pass { } }
+technique DrawAlphaDivide { pass { } }
+technique DrawNonlinearAlpha { pass { } }
+)";
+
+	std::array<gs_effect_t*, OBS_EFFECT_AREA + 1> s_baseEffects = {};
+	std::map<std::string, gs_effect_t*> s_cachedEffects;
+	std::vector<gs_texrender_t*> s_renderTargets;
+	gs_technique_t* s_activeTechnique = nullptr;
+	std::size_t s_blendStateDepth = 0;
+
+	gs_texture_t* CreateTexture(const char* function, std::uint32_t width, std::uint32_t height, gs_color_format format, const std::uint8_t* data, std::uint32_t flags)
+	{
+		if (width == 0 || height == 0)
+		{
+			HeadlessState::RecordError(function, "invalid texture size");
+			return nullptr;
+		}
+
+		std::unique_ptr<gs_texture_t> texture = std::make_unique<gs_texture_t>();
+		texture->flags = flags;
+		texture->format = format;
+		texture->height = height;
+		texture->linesize = width * gs_get_format_bpp(format) / 8;
+		texture->width = width;
+		texture->data.resize(std::size_t(texture->linesize) * height);
+
+		if (data)
+			std::memcpy(texture->data.data(), data, texture->data.size());
+
+		HeadlessCommand command;
+		command.type = HeadlessCommandType::TextureCreate;
+		command.object = texture.get();
+		command.format = format;
+		command.width = width;
+		command.height = height;
+		command.byteCount = (data) ? texture->data.size() : 0;
+		HeadlessState::Record(std::move(command));
+
+		HeadlessState::RegisterObject();
+
+		return texture.release();
+	}
+
+	// Only extracts what sources can query (parameters and techniques with their pass count), shaders aren't compiled
+	bool ParseEffect(const std::string& source, gs_effect_t& effect, std::string& error)
+	{
+		std::vector<std::string> tokens;
+		for (std::size_t i = 0; i < source.size();)
+		{
+			char c = source[i];
+			if (std::isspace(static_cast<unsigned char>(c)))
+				i++;
+			else if (source.compare(i, 2, "//") == 0)
+			{
+				i = source.find('\n', i);
+				if (i == std::string::npos)
+					break;
+			}
+			else if (source.compare(i, 2, "/*") == 0)
+			{
+				i = source.find("*/", i + 2);
+				if (i == std::string::npos)
+				{
+					error = "unterminated comment";
+					return false;
+				}
+
+				i += 2;
+			}
+			else if (std::isalnum(static_cast<unsigned char>(c)) || c == '_')
+			{
+				std::size_t begin = i;
+				while (i < source.size() && (std::isalnum(static_cast<unsigned char>(source[i])) || source[i] == '_' || source[i] == '.'))
+					i++;
+
+				tokens.emplace_back(source, begin, i - begin);
+			}
+			else
+				tokens.emplace_back(1, source[i++]);
+		}
+
+		std::size_t depth = 0;
+		gs_technique_t* technique = nullptr;
+		for (std::size_t i = 0; i < tokens.size(); ++i)
+		{
+			const std::string& token = tokens[i];
+			if (token == "{")
+				depth++;
+			else if (token == "}")
+			{
+				if (depth == 0)
+				{
+					error = "unexpected }";
+					return false;
+				}
+
+				if (--depth == 0)
+					technique = nullptr;
+			}
+			else if (depth == 0 && token == "uniform")
+			{
+				if (i + 2 >= tokens.size())
+				{
+					error = "incomplete uniform declaration";
+					return false;
+				}
+
+				auto& param = effect.params.emplace_back(std::make_unique<gs_eparam_t>());
+				param->name = tokens[i + 2];
+
+				i += 2;
+			}
+			else if (depth == 0 && token == "technique")
+			{
+				if (i + 1 >= tokens.size())
+				{
+					error = "incomplete technique declaration";
+					return false;
+				}
+
+				auto& newTechnique = effect.techniques.emplace_back(std::make_unique<gs_technique_t>());
+				newTechnique->effect = &effect;
+				newTechnique->name = tokens[i + 1];
+
+				technique = newTechnique.get();
+				i++;
+			}
+			else if (depth == 1 && technique && token == "pass")
+				technique->passCount++;
+		}
+
+		if (depth != 0)
+		{
+			error = "missing }";
+			return false;
+		}
+
+		return true;
+	}
+
+	gs_effect_t* CreateEffect(const std::string& source, const std::string& file, char** errorString)
+	{
+		std::unique_ptr<gs_effect_t> effect = std::make_unique<gs_effect_t>();
+		effect->file = file;
+
+		std::string error;
+		if (!ParseEffect(source, *effect, error))
+		{
+			std::string message = file + ": " + error;
+			blog(LOG_ERROR, "failed to parse effect %s", message.c_str());
+
+			if (errorString)
+				*errorString = bstrdup(message.c_str());
+
+			return nullptr;
+		}
+
+		return effect.release();
+	}
+}
+
+void HeadlessState::DestroyEffects()
+{
+	for (gs_effect_t*& effect : s_baseEffects)
+	{
+		delete effect;
+		effect = nullptr;
+	}
+
+	for (auto&& [file, effect] : s_cachedEffects)
+		delete effect;
+
+	s_cachedEffects.clear();
+}
+
+extern "C"
+{
+	void obs_enter_graphics(void)
+	{
+		HeadlessState::EnterGraphics();
+	}
+
+	void obs_leave_graphics(void)
+	{
+		HeadlessState::LeaveGraphics();
+	}
+
+	gs_effect_t* obs_get_base_effect(enum obs_base_effect effect)
+	{
+		if (effect < 0 || static_cast<std::size_t>(effect) >= s_baseEffects.size())
+			return nullptr;
+
+		if (!s_baseEffects[effect])
+			s_baseEffects[effect] = CreateEffect(BaseEffectSource, "default.effect", nullptr);
+
+		return s_baseEffects[effect];
+	}
+
+	void gs_blend_function(enum gs_blend_type /*src*/, enum gs_blend_type /*dest*/)
+	{
+		HeadlessState::CheckGraphics("gs_blend_function");
+	}
+
+	void gs_blend_state_pop(void)
+	{
+		if (!HeadlessState::CheckGraphics("gs_blend_state_pop"))
+			return;
+
+		if (s_blendStateDepth == 0)
+		{
+			HeadlessState::RecordError("gs_blend_state_pop", "no blend state to pop");
+			return;
+		}
+
+		s_blendStateDepth--;
+	}
+
+	void gs_blend_state_push(void)
+	{
+		if (HeadlessState::CheckGraphics("gs_blend_state_push"))
+			s_blendStateDepth++;
+	}
+
+	void gs_clear(uint32_t clear_flags, const struct vec4* /*color*/, float /*depth*/, uint8_t /*stencil*/)
+	{
+		if (!HeadlessState::CheckGraphics("gs_clear"))
+			return;
+
+		HeadlessCommand command;
+		command.type = HeadlessCommandType::Clear;
+		command.byteCount = clear_flags;
+		if (!s_renderTargets.empty())
+		{
+			gs_texrender_t* renderTarget = s_renderTargets.back();
+			command.object = renderTarget;
+			command.width = renderTarget->width;
+			command.height = renderTarget->height;
+
+			if (clear_flags & GS_CLEAR_COLOR)
+				std::fill(renderTarget->target->data.begin(), renderTarget->target->data.end(), std::uint8_t(0));
+		}
+
+		HeadlessState::Record(std::move(command));
+	}
+
+	void gs_draw_sprite(gs_texture_t* tex, uint32_t /*flip*/, uint32_t width, uint32_t height)
+	{
+		if (!HeadlessState::CheckGraphics("gs_draw_sprite"))
+			return;
+
+		if (!tex && (width == 0 || height == 0))
+		{
+			HeadlessState::RecordError("gs_draw_sprite", "a sprite cannot be drawn without a width/height");
+			return;
+		}
+
+		if (!s_activeTechnique || !s_activeTechnique->isPassActive)
+		{
+			HeadlessState::RecordError("gs_draw_sprite", "draw outside of a technique pass");
+			return;
+		}
+
+		HeadlessCommand command;
+		command.type = HeadlessCommandType::Draw;
+		command.object = tex;
+		command.name = s_activeTechnique->name;
+		command.width = (width != 0) ? width : tex->width;
+		command.height = (height != 0) ? height : tex->height;
+		HeadlessState::Record(std::move(command));
+	}
+
+	gs_effect_t* gs_effect_create_from_file(const char* file, char** error_string)
+	{
+		if (!HeadlessState::CheckGraphics("gs_effect_create_from_file") || !file)
+			return nullptr;
+
+		// libobs caches effects by file and only destroys them on shutdown
+		auto it = s_cachedEffects.find(file);
+		if (it != s_cachedEffects.end())
+			return it->second;
+
+		std::ifstream stream(file, std::ios::in | std::ios::binary);
+		if (!stream)
+		{
+			blog(LOG_ERROR, "Could not load effect file '%s'", file);
+			return nullptr;
+		}
+
+		std::stringstream content;
+		content << stream.rdbuf();
+
+		gs_effect_t* effect = CreateEffect(content.str(), file, error_string);
+		if (!effect)
+			return nullptr;
+
+		effect->isCached = true;
+		s_cachedEffects.emplace(file, effect);
+
+		HeadlessCommand command;
+		command.type = HeadlessCommandType::EffectCreate;
+		command.object = effect;
+		command.name = file;
+		HeadlessState::Record(std::move(command));
+
+		return effect;
+	}
+
+	void gs_effect_destroy(gs_effect_t* effect)
+	{
+		if (!effect)
+			return;
+
+		HeadlessState::CheckGraphics("gs_effect_destroy");
+
+		if (!effect->isCached)
+			delete effect;
+	}
+
+	gs_eparam_t* gs_effect_get_param_by_name(const gs_effect_t* effect, const char* name)
+	{
+		if (!effect || !name)
+			return nullptr;
+
+		for (const auto& param : effect->params)
+		{
+			if (param->name == name)
+				return param.get();
+		}
+
+		return nullptr;
+	}
+
+	gs_technique_t* gs_effect_get_technique(const gs_effect_t* effect, const char* name)
+	{
+		if (!effect || !name)
+			return nullptr;
+
+		for (const auto& technique : effect->techniques)
+		{
+			if (technique->name == name)
+				return technique.get();
+		}
+
+		return nullptr;
+	}
+
+	bool gs_effect_loop(gs_effect_t* effect, const char* name)
+	{
+		if (!effect)
+			return false;
+
+		if (!effect->loopTechnique)
+		{
+			gs_technique_t* technique = gs_effect_get_technique(effect, name);
+			if (!technique)
+			{
+				blog(LOG_WARNING, "gs_effect_loop: Technique '%s' not found.", name);
+				return false;
+			}
+
+			gs_technique_begin(technique);
+			effect->loopTechnique = technique;
+		}
+		else
+			gs_technique_end_pass(effect->loopTechnique);
+
+		if (!gs_technique_begin_pass(effect->loopTechnique, effect->loopPass++))
+		{
+			gs_technique_end(effect->loopTechnique);
+			effect->loopTechnique = nullptr;
+			effect->loopPass = 0;
+			return false;
+		}
+
+		return true;
+	}
+
+	void gs_effect_set_bool(gs_eparam_t* param, bool /*val*/)
+	{
+		if (!param)
+			HeadlessState::RecordError("gs_effect_set_bool", "invalid param");
+	}
+
+	void gs_effect_set_float(gs_eparam_t* param, float /*val*/)
+	{
+		if (!param)
+			HeadlessState::RecordError("gs_effect_set_float", "invalid param");
+	}
+
+	void gs_effect_set_int(gs_eparam_t* param, int /*val*/)
+	{
+		if (!param)
+			HeadlessState::RecordError("gs_effect_set_int", "invalid param");
+	}
+
+	void gs_effect_set_texture(gs_eparam_t* param, gs_texture_t* val)
+	{
+		if (!param)
+		{
+			HeadlessState::RecordError("gs_effect_set_texture", "invalid param");
+			return;
+		}
+
+		param->texture = val;
+	}
+
+	void gs_effect_set_vec2(gs_eparam_t* param, const struct vec2* /*val*/)
+	{
+		if (!param)
+			HeadlessState::RecordError("gs_effect_set_vec2", "invalid param");
+	}
+
+	void gs_effect_set_vec4(gs_eparam_t* param, const struct vec4* /*val*/)
+	{
+		if (!param)
+			HeadlessState::RecordError("gs_effect_set_vec4", "invalid param");
+	}
+
+	void gs_image_file_free(gs_image_file_t* image)
+	{
+		if (!image)
+			return;
+
+		if (image->texture)
+		{
+			gs_texture_destroy(image->texture);
+			image->texture = nullptr;
+		}
+
+		image->loaded = false;
+	}
+
+	void gs_image_file_init(gs_image_file_t* image, const char* file)
+	{
+		if (!image)
+			return;
+
+		std::memset(image, 0, sizeof(*image));
+
+		// Images would require a decoder, sources behave as if the file couldn't be loaded
+		if (file && *file)
+			blog(LOG_WARNING, "obs-headless doesn't decode images, ignoring %s", file);
+	}
+
+	void gs_image_file_init_texture(gs_image_file_t* /*image*/)
+	{
+	}
+
+	bool gs_image_file_tick(gs_image_file_t* /*image*/, uint64_t /*elapsed_time_ns*/)
+	{
+		return false;
+	}
+
+	void gs_image_file_update_texture(gs_image_file_t* /*image*/)
+	{
+	}
+
+	void gs_ortho(float /*left*/, float /*right*/, float /*top*/, float /*bottom*/, float /*znear*/, float /*zfar*/)
+	{
+		HeadlessState::CheckGraphics("gs_ortho");
+	}
+
+	void gs_reset_blend_state(void)
+	{
+		HeadlessState::CheckGraphics("gs_reset_blend_state");
+	}
+
+	size_t gs_technique_begin(gs_technique_t* technique)
+	{
+		if (!HeadlessState::CheckGraphics("gs_technique_begin") || !technique)
+			return 0;
+
+		if (s_activeTechnique)
+		{
+			HeadlessState::RecordError("gs_technique_begin", "technique " + s_activeTechnique->name + " is still active");
+			return 0;
+		}
+
+		technique->isActive = true;
+		s_activeTechnique = technique;
+
+		return technique->passCount;
+	}
+
+	bool gs_technique_begin_pass(gs_technique_t* technique, size_t pass)
+	{
+		if (!HeadlessState::CheckGraphics("gs_technique_begin_pass") || !technique || pass >= technique->passCount)
+			return false;
+
+		if (!technique->isActive || technique->isPassActive)
+		{
+			HeadlessState::RecordError("gs_technique_begin_pass", "technique " + technique->name + " isn't active or has an active pass");
+			return false;
+		}
+
+		technique->activePass = pass;
+		technique->isPassActive = true;
+
+		HeadlessCommand command;
+		command.type = HeadlessCommandType::TechniquePass;
+		command.object = technique->effect;
+		command.name = technique->name;
+		if (!s_renderTargets.empty())
+		{
+			command.width = s_renderTargets.back()->width;
+			command.height = s_renderTargets.back()->height;
+		}
+		HeadlessState::Record(std::move(command));
+
+		return true;
+	}
+
+	void gs_technique_end(gs_technique_t* technique)
+	{
+		if (!HeadlessState::CheckGraphics("gs_technique_end") || !technique)
+			return;
+
+		if (technique != s_activeTechnique || technique->isPassActive)
+			HeadlessState::RecordError("gs_technique_end", "technique " + technique->name + " isn't active or has an active pass");
+
+		technique->isActive = false;
+		technique->isPassActive = false;
+		if (technique == s_activeTechnique)
+			s_activeTechnique = nullptr;
+	}
+
+	void gs_technique_end_pass(gs_technique_t* technique)
+	{
+		if (!HeadlessState::CheckGraphics("gs_technique_end_pass") || !technique)
+			return;
+
+		if (!technique->isPassActive)
+			HeadlessState::RecordError("gs_technique_end_pass", "technique " + technique->name + " has no active pass");
+
+		technique->isPassActive = false;
+	}
+
+	bool gs_texrender_begin(gs_texrender_t* texrender, uint32_t cx, uint32_t cy)
+	{
+		if (!HeadlessState::CheckGraphics("gs_texrender_begin"))
+			return false;
+
+		// libobs only renders once until the texrender is reset
+		if (!texrender || texrender->isRendered || cx == 0 || cy == 0)
+			return false;
+
+		if (texrender->width != cx || texrender->height != cy || !texrender->target)
+		{
+			gs_texture_destroy(texrender->target);
+			texrender->target = CreateTexture("gs_texrender_begin", cx, cy, texrender->format, nullptr, 0);
+			if (!texrender->target)
+				return false;
+
+			texrender->width = cx;
+			texrender->height = cy;
+		}
+
+		s_renderTargets.push_back(texrender);
+
+		HeadlessCommand command;
+		command.type = HeadlessCommandType::RenderTargetBegin;
+		command.object = texrender;
+		command.format = texrender->format;
+		command.width = cx;
+		command.height = cy;
+		HeadlessState::Record(std::move(command));
+
+		return true;
+	}
+
+	gs_texrender_t* gs_texrender_create(enum gs_color_format format, enum gs_zstencil_format /*zsformat*/)
+	{
+		if (!HeadlessState::CheckGraphics("gs_texrender_create"))
+			return nullptr;
+
+		gs_texrender_t* texrender = new gs_texrender_t;
+		texrender->format = format;
+
+		HeadlessCommand command;
+		command.type = HeadlessCommandType::RenderTargetCreate;
+		command.object = texrender;
+		command.format = format;
+		HeadlessState::Record(std::move(command));
+
+		HeadlessState::RegisterObject();
+
+		return texrender;
+	}
+
+	void gs_texrender_destroy(gs_texrender_t* texrender)
+	{
+		if (!texrender)
+			return;
+
+		HeadlessState::CheckGraphics("gs_texrender_destroy");
+
+		gs_texture_destroy(texrender->target);
+
+		HeadlessCommand command;
+		command.type = HeadlessCommandType::RenderTargetDestroy;
+		command.object = texrender;
+		HeadlessState::Record(std::move(command));
+
+		HeadlessState::UnregisterObject();
+
+		delete texrender;
+	}
+
+	void gs_texrender_end(gs_texrender_t* texrender)
+	{
+		if (!HeadlessState::CheckGraphics("gs_texrender_end") || !texrender)
+			return;
+
+		if (s_renderTargets.empty() || s_renderTargets.back() != texrender)
+		{
+			HeadlessState::RecordError("gs_texrender_end", "texrender isn't the current render target");
+			return;
+		}
+
+		s_renderTargets.pop_back();
+		texrender->isRendered = true;
+	}
+
+	gs_texture_t* gs_texrender_get_texture(const gs_texrender_t* texrender)
+	{
+		return (texrender) ? texrender->target : nullptr;
+	}
+
+	void gs_texrender_reset(gs_texrender_t* texrender)
+	{
+		if (texrender)
+			texrender->isRendered = false;
+	}
+
+	gs_texture_t* gs_texture_create(uint32_t width, uint32_t height, enum gs_color_format color_format, uint32_t /*levels*/, const uint8_t** data, uint32_t flags)
+	{
+		if (!HeadlessState::CheckGraphics("gs_texture_create"))
+			return nullptr;
+
+		return CreateTexture("gs_texture_create", width, height, color_format, (data) ? data[0] : nullptr, flags);
+	}
+
+	void gs_texture_destroy(gs_texture_t* tex)
+	{
+		if (!tex)
+			return;
+
+		HeadlessState::CheckGraphics("gs_texture_destroy");
+
+		HeadlessCommand command;
+		command.type = HeadlessCommandType::TextureDestroy;
+		command.object = tex;
+		HeadlessState::Record(std::move(command));
+
+		HeadlessState::UnregisterObject();
+
+		delete tex;
+	}
+
+	enum gs_color_format gs_texture_get_color_format(const gs_texture_t* tex)
+	{
+		return (tex) ? tex->format : GS_UNKNOWN;
+	}
+
+	uint32_t gs_texture_get_height(const gs_texture_t* tex)
+	{
+		return (tex) ? tex->height : 0;
+	}
+
+	uint32_t gs_texture_get_width(const gs_texture_t* tex)
+	{
+		return (tex) ? tex->width : 0;
+	}
+
+	bool gs_texture_map(gs_texture_t* tex, uint8_t** ptr, uint32_t* linesize)
+	{
+		if (!HeadlessState::CheckGraphics("gs_texture_map") || !tex)
+			return false;
+
+		if (!(tex->flags & GS_DYNAMIC))
+		{
+			HeadlessState::RecordError("gs_texture_map", "texture is not dynamic");
+			return false;
+		}
+
+		if (tex->isMapped)
+		{
+			HeadlessState::RecordError("gs_texture_map", "texture is already mapped");
+			return false;
+		}
+
+		tex->isMapped = true;
+		*ptr = tex->data.data();
+		*linesize = tex->linesize;
+
+		return true;
+	}
+
+	void gs_texture_set_image(gs_texture_t* tex, const uint8_t* data, uint32_t linesize, bool /*invert*/)
+	{
+		uint8_t* ptr;
+		uint32_t texLinesize;
+		if (!gs_texture_map(tex, &ptr, &texLinesize))
+			return;
+
+		std::uint32_t rowSize = std::min(linesize, texLinesize);
+		for (std::uint32_t y = 0; y < tex->height; ++y)
+			std::memcpy(ptr + y * texLinesize, data + y * linesize, rowSize);
+
+		gs_texture_unmap(tex);
+	}
+
+	void gs_texture_unmap(gs_texture_t* tex)
+	{
+		if (!HeadlessState::CheckGraphics("gs_texture_unmap") || !tex)
+			return;
+
+		if (!tex->isMapped)
+		{
+			HeadlessState::RecordError("gs_texture_unmap", "texture isn't mapped");
+			return;
+		}
+
+		tex->isMapped = false;
+
+		HeadlessCommand command;
+		command.type = HeadlessCommandType::TextureUpload;
+		command.object = tex;
+		command.format = tex->format;
+		command.width = tex->width;
+		command.height = tex->height;
+		command.byteCount = tex->data.size();
+		HeadlessState::Record(std::move(command));
+	}
+}
@@ -0,0 +1,75 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_HEADLESS_HEADLESSGRAPHICS
+#define OBS_KINECT_HEADLESS_HEADLESSGRAPHICS
+
+#include <obs.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct gs_texture
+{
+	std::vector<std::uint8_t> data;
+	gs_color_format format;
+	std::uint32_t flags;
+	std::uint32_t height;
+	std::uint32_t linesize;
+	std::uint32_t width;
+	bool isMapped = false;
+};
+
+struct gs_texture_render
+{
+	gs_texture_t* target = nullptr;
+	gs_color_format format;
+	std::uint32_t height = 0;
+	std::uint32_t width = 0;
+	bool isRendered = false;
+};
+
+struct gs_effect_param
+{
+	std::string name;
+	gs_texture_t* texture = nullptr;
+};
+
+struct gs_effect_technique
+{
+	gs_effect_t* effect;
+	std::string name;
+	std::size_t passCount = 0;
+	std::size_t activePass = 0;
+	bool isActive = false;
+	bool isPassActive = false;
+};
+
+struct gs_effect
+{
+	std::string file;
+	std::vector<std::unique_ptr<gs_effect_param>> params;
+	std::vector<std::unique_ptr<gs_effect_technique>> techniques;
+	gs_technique_t* loopTechnique = nullptr;
+	std::size_t loopPass = 0;
+	bool isCached = false;
+};
+
+#endif
@@ -0,0 +1,352 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-headless/HeadlessState.hpp>
+#include <util/platform.h>
+#include <util/text-lookup.h>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string_view>
+
+struct obs_module
+{
+	std::string binPath;
+	std::string dataPath;
+	std::string name;
+	void* handle = nullptr;
+	bool (*load)(void) = nullptr;
+	void (*unload)(void) = nullptr;
+	void (*post_load)(void) = nullptr;
+	void (*set_locale)(const char* locale) = nullptr;
+	void (*free_locale)(void) = nullptr;
+	uint32_t (*ver)(void) = nullptr;
+	void (*set_pointer)(obs_module_t* module) = nullptr;
+	bool isLoaded = false;
+};
+
+struct text_lookup
+{
+	std::map<std::string, std::string> texts;
+};
+
+namespace
+{
+	std::vector<std::unique_ptr<obs_module_t>> s_modules;
+	std::string s_locale;
+	std::string s_moduleConfigPath;
+	bool s_initialized = false;
+
+	std::string GetModuleName(const std::string& path)
+	{
+		std::size_t nameBegin = path.find_last_of("/\\");
+		nameBegin = (nameBegin != std::string::npos) ? nameBegin + 1 : 0;
+
+		std::size_t nameEnd = path.find('.', nameBegin);
+		return path.substr(nameBegin, (nameEnd != std::string::npos) ? nameEnd - nameBegin : std::string::npos);
+	}
+
+	std::string Trim(const std::string& str)
+	{
+		std::size_t begin = str.find_first_not_of(" \t\r");
+		if (begin == std::string::npos)
+			return {};
+
+		std::size_t end = str.find_last_not_of(" \t\r");
+		return str.substr(begin, end - begin + 1);
+	}
+
+	// Same format as libobs locale files: Key="Value" lines, # and ; start comments
+	bool ParseLocaleFile(const char* path, lookup_t& lookup)
+	{
+		std::ifstream file(path);
+		if (!file)
+			return false;
+
+		std::string line;
+		while (std::getline(file, line))
+		{
+			line = Trim(line);
+			if (line.empty() || line[0] == '#' || line[0] == ';' || line[0] == '[')
+				continue;
+
+			std::size_t separator = line.find('=');
+			if (separator == std::string::npos)
+				continue;
+
+			std::string key = Trim(line.substr(0, separator));
+			std::string value = Trim(line.substr(separator + 1));
+			if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+				value = value.substr(1, value.size() - 2);
+
+			std::string unescaped;
+			unescaped.reserve(value.size());
+			for (std::size_t i = 0; i < value.size(); ++i)
+			{
+				if (value[i] == '\\' && i + 1 < value.size())
+				{
+					char c = value[++i];
+					unescaped.push_back((c == 'n') ? '\n' : (c == 't') ? '\t' : c);
+				}
+				else
+					unescaped.push_back(value[i]);
+			}
+
+			lookup.texts[key] = std::move(unescaped);
+		}
+
+		return true;
+	}
+
+	template<typename F>
+	bool LoadSymbol(void* handle, const char* name, F& func)
+	{
+		func = reinterpret_cast<F>(os_dlsym(handle, name));
+		return func != nullptr;
+	}
+}
+
+extern "C"
+{
+	char* obs_find_module_file(obs_module_t* module, const char* file)
+	{
+		if (!module || !file)
+			return nullptr;
+
+		std::string path = module->dataPath;
+		if (!path.empty() && path.back() != '/' && *file)
+			path += '/';
+
+		path += file;
+		if (!os_file_exists(path.c_str()))
+			return nullptr;
+
+		return bstrdup(path.c_str());
+	}
+
+	uint32_t obs_get_version(void)
+	{
+		return LIBOBS_API_VER;
+	}
+
+	uint64_t obs_get_video_frame_time(void)
+	{
+		return os_gettime_ns();
+	}
+
+	bool obs_init_module(obs_module_t* module)
+	{
+		if (!module)
+			return false;
+
+		if (module->isLoaded)
+			return true;
+
+		module->isLoaded = module->load();
+		if (!module->isLoaded)
+			blog(LOG_WARNING, "Failed to initialize module '%s'", module->name.c_str());
+
+		return module->isLoaded;
+	}
+
+	bool obs_initialized(void)
+	{
+		return s_initialized;
+	}
+
+	char* obs_module_get_config_path(obs_module_t* module, const char* file)
+	{
+		if (!module || !file)
+			return nullptr;
+
+		std::string path = s_moduleConfigPath;
+		if (!path.empty() && path.back() != '/')
+			path += '/';
+
+		path += module->name;
+		path += '/';
+		path += file;
+
+		return bstrdup(path.c_str());
+	}
+
+	lookup_t* obs_module_load_locale(obs_module_t* module, const char* default_locale, const char* locale)
+	{
+		if (!module || !default_locale || !locale)
+		{
+			blog(LOG_WARNING, "obs_module_load_locale: Invalid parameters");
+			return nullptr;
+		}
+
+		std::string localeFile = std::string("locale/") + default_locale + ".ini";
+
+		char* file = obs_find_module_file(module, localeFile.c_str());
+		lookup_t* lookup = (file) ? text_lookup_create(file) : nullptr;
+		bfree(file);
+
+		if (!lookup)
+		{
+			blog(LOG_WARNING, "Failed to load '%s' text for module: '%s'", default_locale, module->name.c_str());
+			return nullptr;
+		}
+
+		if (std::string_view(locale) == default_locale)
+			return lookup;
+
+		localeFile = std::string("locale/") + locale + ".ini";
+
+		file = obs_find_module_file(module, localeFile.c_str());
+		if (!text_lookup_add(lookup, file))
+			blog(LOG_WARNING, "Failed to load '%s' text for module: '%s'", locale, module->name.c_str());
+
+		bfree(file);
+
+		return lookup;
+	}
+
+	int obs_open_module(obs_module_t** module, const char* path, const char* data_path)
+	{
+		if (!module || !path || !s_initialized)
+			return MODULE_ERROR;
+
+		void* handle = os_dlopen(path);
+		if (!handle)
+		{
+			blog(LOG_WARNING, "Module '%s' not loaded", path);
+			return MODULE_FILE_NOT_FOUND;
+		}
+
+		std::unique_ptr<obs_module_t> newModule = std::make_unique<obs_module_t>();
+		newModule->binPath = path;
+		newModule->dataPath = (data_path) ? data_path : "";
+		newModule->handle = handle;
+		newModule->name = GetModuleName(path);
+
+		if (!LoadSymbol(handle, "obs_module_load", newModule->load) ||
+		    !LoadSymbol(handle, "obs_module_set_pointer", newModule->set_pointer) ||
+		    !LoadSymbol(handle, "obs_module_ver", newModule->ver))
+		{
+			blog(LOG_WARNING, "Module '%s' is missing required exports", path);
+			os_dlclose(handle);
+			return MODULE_MISSING_EXPORTS;
+		}
+
+		LoadSymbol(handle, "obs_module_unload", newModule->unload);
+		LoadSymbol(handle, "obs_module_post_load", newModule->post_load);
+		LoadSymbol(handle, "obs_module_set_locale", newModule->set_locale);
+		LoadSymbol(handle, "obs_module_free_locale", newModule->free_locale);
+
+		std::uint32_t moduleMajorVersion = newModule->ver() >> 24;
+		if (moduleMajorVersion > LIBOBS_API_MAJOR_VER)
+		{
+			blog(LOG_WARNING, "Module '%s' compiled with newer libobs %u", path, moduleMajorVersion);
+			os_dlclose(handle);
+			return MODULE_INCOMPATIBLE_VER;
+		}
+
+		*module = newModule.get();
+		s_modules.push_back(std::move(newModule));
+
+		(*module)->set_pointer(*module);
+		if ((*module)->set_locale)
+			(*module)->set_locale(s_locale.c_str());
+
+		return MODULE_SUCCESS;
+	}
+
+	void obs_post_load_modules(void)
+	{
+		for (const auto& module : s_modules)
+		{
+			if (module->isLoaded && module->post_load)
+				module->post_load();
+		}
+	}
+
+	void obs_shutdown(void)
+	{
+		if (!s_initialized)
+			return;
+
+		// libobs doesn't unload module libraries, which can cause issues
+		for (const auto& module : s_modules)
+		{
+			if (module->free_locale)
+				module->free_locale();
+
+			if (module->isLoaded && module->unload)
+				module->unload();
+		}
+		s_modules.clear();
+
+		obs_enter_graphics();
+		HeadlessState::DestroyEffects();
+		obs_leave_graphics();
+
+		s_initialized = false;
+	}
+
+	bool obs_startup(const char* locale, const char* module_config_path, profiler_name_store_t* /*store*/)
+	{
+		if (s_initialized)
+		{
+			blog(LOG_WARNING, "Tried to call obs_startup more than once");
+			return false;
+		}
+
+		s_locale = (locale) ? locale : "en-US";
+		s_moduleConfigPath = (module_config_path) ? module_config_path : "";
+		s_initialized = true;
+
+		return true;
+	}
+
+	bool text_lookup_add(lookup_t* lookup, const char* path)
+	{
+		if (!lookup || !path)
+			return false;
+
+		return ParseLocaleFile(path, *lookup);
+	}
+
+	lookup_t* text_lookup_create(const char* path)
+	{
+		std::unique_ptr<lookup_t> lookup = std::make_unique<lookup_t>();
+		if (!text_lookup_add(lookup.get(), path))
+			return nullptr;
+
+		return lookup.release();
+	}
+
+	void text_lookup_destroy(lookup_t* lookup)
+	{
+		delete lookup;
+	}
+
+	bool text_lookup_getstr(lookup_t* lookup, const char* lookup_val, const char** out)
+	{
+		if (!lookup || !lookup_val)
+			return false;
+
+		auto it = lookup->texts.find(lookup_val);
+		if (it == lookup->texts.end())
+			return false;
+
+		*out = it->second.c_str();
+		return true;
+	}
+}
@@ -0,0 +1,187 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-headless/HeadlessObs.hpp>
+#include <obs-headless/HeadlessGraphics.hpp>
+#include <obs-headless/HeadlessState.hpp>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <utility>
+
+namespace
+{
+	std::mutex s_commandMutex;
+	std::vector<HeadlessCommand> s_commands;
+	std::atomic_size_t s_liveObjectCount(0);
+	std::mutex s_tickCallbackMutex;
+	std::vector<std::pair<void(*)(void*, float), void*>> s_tickCallbacks;
+	std::recursive_mutex s_graphicsMutex;
+	thread_local std::size_t s_graphicsDepth = 0;
+	thread_local obs_source_t* s_currentSource = nullptr;
+}
+
+std::vector<HeadlessCommand> HeadlessObs::FetchCommands()
+{
+	std::lock_guard<std::mutex> lock(s_commandMutex);
+
+	std::vector<HeadlessCommand> commands;
+	commands.swap(s_commands);
+
+	return commands;
+}
+
+std::size_t HeadlessObs::GetLiveObjectCount()
+{
+	return s_liveObjectCount.load();
+}
+
+const std::uint8_t* HeadlessObs::GetTextureData(gs_texture_t* texture, std::uint32_t* linesize)
+{
+	if (!texture)
+		return nullptr;
+
+	if (linesize)
+		*linesize = texture->linesize;
+
+	return texture->data.data();
+}
+
+void HeadlessObs::RunTickCallbacks(float seconds)
+{
+	// Callbacks may add or remove callbacks
+	std::vector<std::pair<void(*)(void*, float), void*>> tickCallbacks;
+	{
+		std::lock_guard<std::mutex> lock(s_tickCallbackMutex);
+		tickCallbacks = s_tickCallbacks;
+	}
+
+	for (const auto& [callback, param] : tickCallbacks)
+		callback(param, seconds);
+}
+
+const char* HeadlessObs::ToString(HeadlessCommandType commandType)
+{
+	switch (commandType)
+	{
+		case HeadlessCommandType::AsyncVideoOutput:    return "AsyncVideoOutput";
+		case HeadlessCommandType::Clear:               return "Clear";
+		case HeadlessCommandType::Draw:                return "Draw";
+		case HeadlessCommandType::EffectCreate:        return "EffectCreate";
+		case HeadlessCommandType::Error:               return "Error";
+		case HeadlessCommandType::RenderTargetBegin:   return "RenderTargetBegin";
+		case HeadlessCommandType::RenderTargetCreate:  return "RenderTargetCreate";
+		case HeadlessCommandType::RenderTargetDestroy: return "RenderTargetDestroy";
+		case HeadlessCommandType::TechniquePass:       return "TechniquePass";
+		case HeadlessCommandType::TextureCreate:       return "TextureCreate";
+		case HeadlessCommandType::TextureDestroy:      return "TextureDestroy";
+		case HeadlessCommandType::TextureUpload:       return "TextureUpload";
+	}
+
+	return "<unknown>";
+}
+
+bool HeadlessState::CheckGraphics(const char* function)
+{
+	if (s_graphicsDepth > 0)
+		return true;
+
+	RecordError(function, "called outside of the graphics context");
+	return false;
+}
+
+void HeadlessState::EnterGraphics()
+{
+	s_graphicsMutex.lock();
+	s_graphicsDepth++;
+}
+
+obs_source_t* HeadlessState::GetCurrentSource()
+{
+	return s_currentSource;
+}
+
+void HeadlessState::LeaveGraphics()
+{
+	if (s_graphicsDepth == 0)
+	{
+		RecordError("obs_leave_graphics", "graphics context wasn't entered");
+		return;
+	}
+
+	s_graphicsDepth--;
+	s_graphicsMutex.unlock();
+}
+
+void HeadlessState::Record(HeadlessCommand command)
+{
+	if (!command.source)
+		command.source = s_currentSource;
+
+	std::lock_guard<std::mutex> lock(s_commandMutex);
+	s_commands.push_back(std::move(command));
+}
+
+void HeadlessState::RecordError(const char* function, const std::string& message)
+{
+	blog(LOG_ERROR, "%s: %s", function, message.c_str());
+
+	HeadlessCommand command;
+	command.type = HeadlessCommandType::Error;
+	command.name = std::string(function) + ": " + message;
+
+	Record(std::move(command));
+}
+
+void HeadlessState::RegisterObject()
+{
+	s_liveObjectCount++;
+}
+
+void HeadlessState::UnregisterObject()
+{
+	s_liveObjectCount--;
+}
+
+HeadlessState::SourceScope::SourceScope(obs_source_t* source) :
+m_previousSource(s_currentSource)
+{
+	s_currentSource = source;
+}
+
+HeadlessState::SourceScope::~SourceScope()
+{
+	s_currentSource = m_previousSource;
+}
+
+extern "C"
+{
+	void obs_add_tick_callback(void (*tick)(void* param, float seconds), void* param)
+	{
+		std::lock_guard<std::mutex> lock(s_tickCallbackMutex);
+		s_tickCallbacks.emplace_back(tick, param);
+	}
+
+	void obs_remove_tick_callback(void (*tick)(void* param, float seconds), void* param)
+	{
+		std::lock_guard<std::mutex> lock(s_tickCallbackMutex);
+
+		auto it = std::find(s_tickCallbacks.begin(), s_tickCallbacks.end(), std::make_pair(tick, param));
+		if (it != s_tickCallbacks.end())
+			s_tickCallbacks.erase(it);
+	}
+}
@@ -0,0 +1,87 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_HEADLESS_HEADLESSOBS
+#define OBS_KINECT_HEADLESS_HEADLESSOBS
+
+#ifdef _WIN32
+	#define OBSHEADLESS_EXPORT __declspec(dllexport)
+	#define OBSHEADLESS_IMPORT __declspec(dllimport)
+#else
+	#define OBSHEADLESS_EXPORT __attribute__((visibility ("default")))
+	#define OBSHEADLESS_IMPORT __attribute__((visibility ("default")))
+#endif
+
+#ifdef OBS_HEADLESS_EXPORT
+	#define OBSHEADLESS_API OBSHEADLESS_EXPORT
+#else
+	#define OBSHEADLESS_API OBSHEADLESS_IMPORT
+#endif
+
+#include <obs.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class HeadlessCommandType
+{
+	AsyncVideoOutput,    //< obs_source_output_video (byteCount = frame size)
+	Clear,               //< gs_clear
+	Draw,                //< gs_draw_sprite
+	EffectCreate,        //< effect file compiled (name = file), effects are cached by file like libobs does
+	Error,               //< misuse of the API (name = message), such as a graphics call outside of obs_enter_graphics/obs_leave_graphics
+	RenderTargetBegin,   //< gs_texrender_begin which succeeded
+	RenderTargetCreate,  //< gs_texrender_create
+	RenderTargetDestroy, //< gs_texrender_destroy
+	TechniquePass,       //< gs_technique_begin_pass which succeeded (name = technique)
+	TextureCreate,       //< gs_texture_create, including render target textures (byteCount = uploaded bytes if created with data)
+	TextureDestroy,      //< gs_texture_destroy
+	TextureUpload        //< gs_texture_unmap/gs_texture_set_image (byteCount = uploaded bytes)
+};
+
+struct HeadlessCommand
+{
+	HeadlessCommandType type;
+	const obs_source_t* source = nullptr; //< source whose callback issued the command (innermost one), if any
+	const void* object = nullptr;         //< texture, render target or effect concerned
+	std::string name;
+	gs_color_format format = GS_UNKNOWN;
+	std::uint32_t width = 0;
+	std::uint32_t height = 0;
+	std::uint64_t byteCount = 0;
+};
+
+// Control interface of obs-headless, a libobs replacement running sources without OBS nor GPU
+// Graphics calls are recorded into an in-memory command log and textures are CPU buffers, shaders are never executed
+class OBSHEADLESS_API HeadlessObs
+{
+	public:
+		HeadlessObs() = delete;
+
+		static std::vector<HeadlessCommand> FetchCommands(); //< returns commands recorded since the last call and clears the log
+		static std::size_t GetLiveObjectCount(); //< textures and render targets which haven't been destroyed yet (cached effects live until obs_shutdown)
+		static const std::uint8_t* GetTextureData(gs_texture_t* texture, std::uint32_t* linesize);
+
+		static void RunTickCallbacks(float seconds); //< libobs runs them once per frame, before ticking sources
+
+		static const char* ToString(HeadlessCommandType commandType);
+};
+
+#endif
@@ -0,0 +1,592 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <util/base.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/profiler.h>
+#include <util/threading.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+struct os_dir
+{
+#ifdef _WIN32
+	HANDLE handle = INVALID_HANDLE_VALUE;
+	WIN32_FIND_DATAW data;
+	bool isFirst = true;
+#else
+	DIR* dir = nullptr;
+	std::string path;
+#endif
+	os_dirent entry;
+};
+
+namespace
+{
+	void DefaultLogHandler(int lvl, const char* msg, va_list args, void* /*p*/)
+	{
+		// Same output level as libobs release builds
+		if (lvl > LOG_INFO)
+			return;
+
+		const char* prefix;
+		switch (lvl)
+		{
+			case LOG_ERROR:   prefix = "error: "; break;
+			case LOG_WARNING: prefix = "warning: "; break;
+			default:          prefix = "info: "; break;
+		}
+
+		char output[4096];
+		std::vsnprintf(output, sizeof(output), msg, args);
+
+		std::fprintf((lvl <= LOG_WARNING) ? stderr : stdout, "%s%s\n", prefix, output);
+	}
+
+	log_handler_t s_logHandler = &DefaultLogHandler;
+	void* s_logParam = nullptr;
+
+#ifdef _WIN32
+	std::wstring ToWide(const char* str)
+	{
+		wchar_t* wideStr;
+		if (os_utf8_to_wcs_ptr(str, 0, &wideStr) == 0)
+			return {};
+
+		std::wstring result(wideStr);
+		bfree(wideStr);
+
+		return result;
+	}
+#endif
+
+	int MakeDirectory(const std::string& path)
+	{
+#ifdef _WIN32
+		if (CreateDirectoryW(ToWide(path.c_str()).c_str(), nullptr))
+			return MKDIR_SUCCESS;
+
+		return (GetLastError() == ERROR_ALREADY_EXISTS) ? MKDIR_EXISTS : MKDIR_ERROR;
+#else
+		if (mkdir(path.c_str(), 0755) == 0)
+			return MKDIR_SUCCESS;
+
+		return (errno == EEXIST) ? MKDIR_EXISTS : MKDIR_ERROR;
+#endif
+	}
+
+	int MakeDirectories(const std::string& path)
+	{
+		int ret = MakeDirectory(path);
+		if (ret != MKDIR_ERROR)
+			return ret;
+
+		std::size_t lastSlash = path.find_last_of('/');
+		if (lastSlash == std::string::npos || lastSlash == 0)
+			return MKDIR_ERROR;
+
+		if (MakeDirectories(path.substr(0, lastSlash)) == MKDIR_ERROR)
+			return MKDIR_ERROR;
+
+		return MakeDirectory(path);
+	}
+}
+
+extern "C"
+{
+	void base_get_log_handler(log_handler_t* handler, void** param)
+	{
+		if (handler)
+			*handler = s_logHandler;
+
+		if (param)
+			*param = s_logParam;
+	}
+
+	void base_set_log_handler(log_handler_t handler, void* param)
+	{
+		s_logHandler = (handler) ? handler : &DefaultLogHandler;
+		s_logParam = param;
+	}
+
+	void blog(int log_level, const char* format, ...)
+	{
+		va_list args;
+		va_start(args, format);
+		blogva(log_level, format, args);
+		va_end(args);
+	}
+
+	void blogva(int log_level, const char* format, va_list args)
+	{
+		s_logHandler(log_level, format, args, s_logParam);
+	}
+
+	void bfree(void* ptr)
+	{
+		std::free(ptr);
+	}
+
+	void* bmalloc(size_t size)
+	{
+		if (size == 0)
+		{
+			blog(LOG_ERROR, "bmalloc: Allocating 0 bytes is broken behavior, please fix your code!");
+			size = 1;
+		}
+
+		void* ptr = std::malloc(size);
+		if (!ptr)
+		{
+			std::fprintf(stderr, "Out of memory while trying to allocate %lu bytes\n", static_cast<unsigned long>(size));
+			std::abort();
+		}
+
+		return ptr;
+	}
+
+	void* bmemdup(const void* ptr, size_t size)
+	{
+		void* out = bmalloc(size);
+		if (size)
+			std::memcpy(out, ptr, size);
+
+		return out;
+	}
+
+	void* brealloc(void* ptr, size_t size)
+	{
+		if (size == 0)
+			size = 1;
+
+		ptr = std::realloc(ptr, size);
+		if (!ptr)
+		{
+			std::fprintf(stderr, "Out of memory while trying to allocate %lu bytes\n", static_cast<unsigned long>(size));
+			std::abort();
+		}
+
+		return ptr;
+	}
+
+	void os_closedir(os_dir_t* dir)
+	{
+		if (!dir)
+			return;
+
+#ifdef _WIN32
+		FindClose(dir->handle);
+#else
+		closedir(dir->dir);
+#endif
+
+		delete dir;
+	}
+
+	void os_dlclose(void* module)
+	{
+		if (!module)
+			return;
+
+#ifdef _WIN32
+		FreeLibrary(static_cast<HMODULE>(module));
+#else
+		dlclose(module);
+#endif
+	}
+
+	void* os_dlopen(const char* path)
+	{
+		if (!path)
+			return nullptr;
+
+#ifdef _WIN32
+		std::string libraryName = path;
+		if (libraryName.find(".dll") == std::string::npos)
+			libraryName += ".dll";
+
+		void* handle = LoadLibraryW(ToWide(libraryName.c_str()).c_str());
+		if (!handle)
+			blog(LOG_INFO, "LoadLibrary failed for '%s': error %lu", path, GetLastError());
+#else
+		std::string libraryName = path;
+#ifdef __APPLE__
+		if (libraryName.find(".so") == std::string::npos && libraryName.find(".dylib") == std::string::npos)
+#else
+		if (libraryName.find(".so") == std::string::npos)
+#endif
+			libraryName += ".so";
+
+		void* handle = dlopen(libraryName.c_str(), RTLD_LAZY);
+		if (!handle)
+			blog(LOG_ERROR, "os_dlopen(%s->%s): %s", path, libraryName.c_str(), dlerror());
+#endif
+
+		return handle;
+	}
+
+	void* os_dlsym(void* module, const char* func)
+	{
+#ifdef _WIN32
+		return reinterpret_cast<void*>(GetProcAddress(static_cast<HMODULE>(module), func));
+#else
+		return dlsym(module, func);
+#endif
+	}
+
+	bool os_file_exists(const char* path)
+	{
+#ifdef _WIN32
+		return GetFileAttributesW(ToWide(path).c_str()) != INVALID_FILE_ATTRIBUTES;
+#else
+		return access(path, F_OK) == 0;
+#endif
+	}
+
+	FILE* os_fopen(const char* path, const char* mode)
+	{
+		if (!path)
+			return nullptr;
+
+#ifdef _WIN32
+		return _wfopen(ToWide(path).c_str(), ToWide(mode).c_str());
+#else
+		return std::fopen(path, mode);
+#endif
+	}
+
+	int os_fseeki64(FILE* file, int64_t offset, int origin)
+	{
+#ifdef _WIN32
+		return _fseeki64(file, offset, origin);
+#else
+		return fseeko(file, static_cast<off_t>(offset), origin);
+#endif
+	}
+
+	int64_t os_ftelli64(FILE* file)
+	{
+#ifdef _WIN32
+		return _ftelli64(file);
+#else
+		return ftello(file);
+#endif
+	}
+
+	char* os_get_config_path_ptr(const char* name)
+	{
+#ifdef _WIN32
+		const char* basePath = std::getenv("APPDATA");
+		std::string path = (basePath) ? basePath : ".";
+#else
+		std::string path;
+		if (const char* configHome = std::getenv("XDG_CONFIG_HOME"))
+			path = configHome;
+		else
+		{
+			const char* home = std::getenv("HOME");
+			if (!home)
+				home = ".";
+
+			path = home;
+			path += "/.config";
+		}
+#endif
+
+		if (name && *name)
+		{
+			path += '/';
+			path += name;
+		}
+
+		return bstrdup(path.c_str());
+	}
+
+	uint64_t os_gettime_ns(void)
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	int os_mkdir(const char* path)
+	{
+		return MakeDirectory(path);
+	}
+
+	int os_mkdirs(const char* dir)
+	{
+		std::string path = dir;
+		for (char& c : path)
+		{
+			if (c == '\\')
+				c = '/';
+		}
+
+		return MakeDirectories(path);
+	}
+
+	os_dir_t* os_opendir(const char* path)
+	{
+		if (!path)
+			return nullptr;
+
+		os_dir_t* dir = new os_dir_t;
+
+#ifdef _WIN32
+		std::string searchPath = path;
+		searchPath += "/*.*";
+
+		dir->handle = FindFirstFileW(ToWide(searchPath.c_str()).c_str(), &dir->data);
+		if (dir->handle == INVALID_HANDLE_VALUE)
+		{
+			delete dir;
+			return nullptr;
+		}
+#else
+		dir->dir = opendir(path);
+		if (!dir->dir)
+		{
+			delete dir;
+			return nullptr;
+		}
+
+		dir->path = path;
+#endif
+
+		return dir;
+	}
+
+	struct os_dirent* os_readdir(os_dir_t* dir)
+	{
+		if (!dir)
+			return nullptr;
+
+#ifdef _WIN32
+		if (!dir->isFirst)
+		{
+			if (!FindNextFileW(dir->handle, &dir->data))
+				return nullptr;
+		}
+		dir->isFirst = false;
+
+		os_wcs_to_utf8(dir->data.cFileName, 0, dir->entry.d_name, sizeof(dir->entry.d_name));
+		dir->entry.directory = (dir->data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+		struct dirent* entry = readdir(dir->dir);
+		if (!entry)
+			return nullptr;
+
+		std::strncpy(dir->entry.d_name, entry->d_name, sizeof(dir->entry.d_name) - 1);
+		dir->entry.d_name[sizeof(dir->entry.d_name) - 1] = '\0';
+
+		std::string entryPath = dir->path + "/" + entry->d_name;
+
+		struct stat entryStat;
+		dir->entry.directory = (stat(entryPath.c_str(), &entryStat) == 0 && S_ISDIR(entryStat.st_mode));
+#endif
+
+		return &dir->entry;
+	}
+
+	void os_set_thread_name(const char* name)
+	{
+#if defined(__linux__)
+		// Linux limits thread names to 15 characters
+		char threadName[16];
+		std::strncpy(threadName, name, sizeof(threadName) - 1);
+		threadName[sizeof(threadName) - 1] = '\0';
+
+		pthread_setname_np(pthread_self(), threadName);
+#else
+		static_cast<void>(name);
+#endif
+	}
+
+	void os_sleep_ms(uint32_t duration)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(duration));
+	}
+
+	bool os_sleepto_ns(uint64_t time_target)
+	{
+		uint64_t now = os_gettime_ns();
+		if (time_target < now)
+			return false;
+
+		std::this_thread::sleep_for(std::chrono::nanoseconds(time_target - now));
+		return true;
+	}
+
+	size_t os_utf8_to_wcs_ptr(const char* str, size_t len, wchar_t** pstr)
+	{
+		if (!str)
+		{
+			*pstr = nullptr;
+			return 0;
+		}
+
+		if (len == 0)
+			len = std::strlen(str);
+
+		std::vector<wchar_t> output;
+		output.reserve(len + 1);
+
+		for (size_t i = 0; i < len;)
+		{
+			unsigned char c = static_cast<unsigned char>(str[i]);
+
+			std::uint32_t codepoint;
+			size_t byteCount;
+			if (c < 0x80)
+			{
+				codepoint = c;
+				byteCount = 1;
+			}
+			else if ((c & 0xE0) == 0xC0)
+			{
+				codepoint = c & 0x1F;
+				byteCount = 2;
+			}
+			else if ((c & 0xF0) == 0xE0)
+			{
+				codepoint = c & 0x0F;
+				byteCount = 3;
+			}
+			else if ((c & 0xF8) == 0xF0)
+			{
+				codepoint = c & 0x07;
+				byteCount = 4;
+			}
+			else
+			{
+				*pstr = nullptr;
+				return 0;
+			}
+
+			if (i + byteCount > len)
+			{
+				*pstr = nullptr;
+				return 0;
+			}
+
+			for (size_t j = 1; j < byteCount; ++j)
+				codepoint = (codepoint << 6) | (static_cast<unsigned char>(str[i + j]) & 0x3F);
+
+			i += byteCount;
+
+			if constexpr (sizeof(wchar_t) == 2)
+			{
+				if (codepoint >= 0x10000)
+				{
+					codepoint -= 0x10000;
+					output.push_back(static_cast<wchar_t>(0xD800 + (codepoint >> 10)));
+					output.push_back(static_cast<wchar_t>(0xDC00 + (codepoint & 0x3FF)));
+					continue;
+				}
+			}
+
+			output.push_back(static_cast<wchar_t>(codepoint));
+		}
+
+		size_t outputLength = output.size();
+		output.push_back(L'\0');
+
+		*pstr = static_cast<wchar_t*>(bmemdup(output.data(), output.size() * sizeof(wchar_t)));
+		return outputLength;
+	}
+
+	size_t os_wcs_to_utf8(const wchar_t* str, size_t len, char* dst, size_t dst_size)
+	{
+		if (!str)
+			return 0;
+
+		if (len == 0)
+			len = std::wcslen(str);
+
+		std::string output;
+		output.reserve(len);
+
+		for (size_t i = 0; i < len; ++i)
+		{
+			std::uint32_t codepoint = static_cast<std::uint32_t>(str[i]);
+			if constexpr (sizeof(wchar_t) == 2)
+			{
+				if (codepoint >= 0xD800 && codepoint < 0xDC00 && i + 1 < len)
+					codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (static_cast<std::uint32_t>(str[++i]) - 0xDC00);
+			}
+
+			if (codepoint < 0x80)
+				output.push_back(static_cast<char>(codepoint));
+			else if (codepoint < 0x800)
+			{
+				output.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+				output.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+			}
+			else if (codepoint < 0x10000)
+			{
+				output.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+				output.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+				output.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+			}
+			else
+			{
+				output.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+				output.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+				output.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+				output.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+			}
+		}
+
+		if (!dst)
+			return output.size();
+
+		if (dst_size == 0)
+			return 0;
+
+		size_t outputLength = std::min(output.size(), dst_size - 1);
+		std::memcpy(dst, output.data(), outputLength);
+		dst[outputLength] = '\0';
+
+		return outputLength;
+	}
+
+	void profile_end(const char* /*name*/)
+	{
+	}
+
+	void profile_start(const char* /*name*/)
+	{
+	}
+}
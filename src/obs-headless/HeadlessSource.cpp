@@ -0,0 +1,445 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-headless/HeadlessState.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+struct obs_source
+{
+	std::atomic_long refCount = 1;
+	std::atomic_uint32_t asyncHeight = 0;
+	std::atomic_uint32_t asyncWidth = 0;
+	std::atomic_long showRefs = 0;
+	std::string name;
+	std::vector<obs_source_t*> filters;
+	obs_data_t* settings = nullptr;
+	obs_source_info info;
+	obs_source_t* filterParent = nullptr;
+	obs_source_t* filterTarget = nullptr;
+	void* context = nullptr;
+	bool deferUpdate = false;
+	bool isRenderingFilter = false;
+	bool isShowing = false;
+};
+
+namespace
+{
+	std::map<std::string, obs_source_info> s_sourceTypes;
+
+	void DefaultRender(obs_source_t* source)
+	{
+		gs_effect_t* effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+		gs_technique_t* technique = gs_effect_get_technique(effect, "Draw");
+
+		std::size_t passCount = gs_technique_begin(technique);
+		for (std::size_t i = 0; i < passCount; ++i)
+		{
+			gs_technique_begin_pass(technique, i);
+			if (source->context)
+				source->info.video_render(source->context, effect);
+			gs_technique_end_pass(technique);
+		}
+		gs_technique_end(technique);
+	}
+
+	std::uint32_t GetBaseHeight(const obs_source_t* source)
+	{
+		if (source->context && source->info.get_height)
+			return source->info.get_height(source->context);
+
+		if (source->filterParent)
+			return GetBaseHeight(source->filterTarget);
+
+		return source->asyncHeight;
+	}
+
+	std::uint32_t GetBaseWidth(const obs_source_t* source)
+	{
+		if (source->context && source->info.get_width)
+			return source->info.get_width(source->context);
+
+		if (source->filterParent)
+			return GetBaseWidth(source->filterTarget);
+
+		return source->asyncWidth;
+	}
+
+	void MainRender(obs_source_t* source)
+	{
+		bool customDraw = (source->info.output_flags & OBS_SOURCE_CUSTOM_DRAW) != 0;
+		bool defaultEffect = !source->filterParent && source->filters.empty() && !customDraw;
+
+		HeadlessState::SourceScope scope(source);
+		if (defaultEffect)
+			DefaultRender(source);
+		else if (source->context)
+			source->info.video_render(source->context, nullptr);
+	}
+
+	void RenderAsyncVideo(obs_source_t* /*source*/)
+	{
+		// Async frames are only recorded (see obs_source_output_video), they aren't converted to textures
+	}
+}
+
+extern "C"
+{
+	obs_source_t* obs_filter_get_parent(const obs_source_t* filter)
+	{
+		return (filter) ? filter->filterParent : nullptr;
+	}
+
+	obs_source_t* obs_filter_get_target(const obs_source_t* filter)
+	{
+		return (filter) ? filter->filterTarget : nullptr;
+	}
+
+	void obs_register_source_s(const struct obs_source_info* info, size_t size)
+	{
+		if (!info || !info->id)
+			return;
+
+		if (!info->get_name || !info->create || !info->destroy)
+		{
+			blog(LOG_ERROR, "obs_register_source: %s is missing required callbacks", info->id);
+			return;
+		}
+
+		if (s_sourceTypes.find(info->id) != s_sourceTypes.end())
+		{
+			blog(LOG_WARNING, "Source '%s' already exists!  Duplicate library?", info->id);
+			return;
+		}
+
+		obs_source_info sourceInfo = {};
+		std::memcpy(&sourceInfo, info, std::min(size, sizeof(sourceInfo)));
+
+		s_sourceTypes.emplace(info->id, sourceInfo);
+	}
+
+	void obs_source_addref(obs_source_t* source)
+	{
+		if (source)
+			source->refCount++;
+	}
+
+	obs_source_t* obs_source_create(const char* id, const char* name, obs_data_t* settings, obs_data_t* /*hotkey_data*/)
+	{
+		auto it = s_sourceTypes.find((id) ? id : "");
+		if (it == s_sourceTypes.end())
+		{
+			blog(LOG_ERROR, "Source ID '%s' not found", (id) ? id : "");
+			return nullptr;
+		}
+
+		obs_source_t* source = new obs_source_t;
+		source->info = it->second;
+		source->name = (name) ? name : "";
+		source->settings = obs_data_create();
+
+		if (source->info.get_defaults)
+			source->info.get_defaults(source->settings);
+
+		if (source->info.get_defaults2)
+			source->info.get_defaults2(source->info.type_data, source->settings);
+
+		obs_data_apply(source->settings, settings);
+
+		{
+			HeadlessState::SourceScope scope(source);
+			source->context = source->info.create(source->settings, source);
+		}
+
+		if (!source->context)
+			blog(LOG_ERROR, "Failed to create source '%s'!", source->name.c_str());
+
+		return source;
+	}
+
+	void obs_source_dec_showing(obs_source_t* source)
+	{
+		if (!source)
+			return;
+
+		if (source->showRefs == 0)
+		{
+			HeadlessState::RecordError("obs_source_dec_showing", "source " + source->name + " isn't showing");
+			return;
+		}
+
+		source->showRefs--;
+		for (obs_source_t* filter : source->filters)
+			obs_source_dec_showing(filter);
+	}
+
+	void obs_source_filter_add(obs_source_t* source, obs_source_t* filter)
+	{
+		if (!source || !filter || filter->filterParent)
+			return;
+
+		if (std::find(source->filters.begin(), source->filters.end(), filter) != source->filters.end())
+		{
+			blog(LOG_WARNING, "Tried to add a filter that was already present on the source");
+			return;
+		}
+
+		obs_source_addref(filter);
+
+		if (!source->filters.empty())
+			source->filters.back()->filterTarget = filter;
+
+		source->filters.push_back(filter);
+
+		filter->filterParent = source;
+		filter->filterTarget = source;
+
+		for (long i = 0; i < source->showRefs; ++i)
+			obs_source_inc_showing(filter);
+	}
+
+	void obs_source_filter_remove(obs_source_t* source, obs_source_t* filter)
+	{
+		if (!source || !filter)
+			return;
+
+		auto it = std::find(source->filters.begin(), source->filters.end(), filter);
+		if (it == source->filters.end())
+			return;
+
+		if (it != source->filters.begin())
+			(*std::prev(it))->filterTarget = filter->filterTarget;
+
+		source->filters.erase(it);
+
+		while (filter->showRefs > 0)
+			obs_source_dec_showing(filter);
+
+		filter->filterParent = nullptr;
+		filter->filterTarget = nullptr;
+
+		obs_source_release(filter);
+	}
+
+	uint32_t obs_source_get_base_height(obs_source_t* source)
+	{
+		return (source) ? GetBaseHeight(source) : 0;
+	}
+
+	uint32_t obs_source_get_base_width(obs_source_t* source)
+	{
+		return (source) ? GetBaseWidth(source) : 0;
+	}
+
+	uint32_t obs_source_get_height(obs_source_t* source)
+	{
+		if (!source)
+			return 0;
+
+		return GetBaseHeight((!source->filters.empty()) ? source->filters.front() : source);
+	}
+
+	const char* obs_source_get_name(const obs_source_t* source)
+	{
+		return (source) ? source->name.c_str() : nullptr;
+	}
+
+	uint32_t obs_source_get_output_flags(const obs_source_t* source)
+	{
+		return (source) ? source->info.output_flags : 0;
+	}
+
+	obs_data_t* obs_source_get_settings(const obs_source_t* source)
+	{
+		if (!source)
+			return nullptr;
+
+		obs_data_addref(source->settings);
+		return source->settings;
+	}
+
+	uint32_t obs_source_get_width(obs_source_t* source)
+	{
+		if (!source)
+			return 0;
+
+		return GetBaseWidth((!source->filters.empty()) ? source->filters.front() : source);
+	}
+
+	void obs_source_inc_showing(obs_source_t* source)
+	{
+		if (!source)
+			return;
+
+		source->showRefs++;
+		for (obs_source_t* filter : source->filters)
+			obs_source_inc_showing(filter);
+	}
+
+	void obs_source_output_video(obs_source_t* source, const struct obs_source_frame* frame)
+	{
+		if (!source)
+			return;
+
+		if (!frame)
+		{
+			source->asyncWidth = 0;
+			source->asyncHeight = 0;
+			return;
+		}
+
+		source->asyncWidth = frame->width;
+		source->asyncHeight = frame->height;
+
+		// libobs copies the frame before returning
+		std::uint64_t byteCount = 0;
+		for (std::size_t i = 0; i < MAX_AV_PLANES && frame->data[i]; ++i)
+			byteCount += std::uint64_t(frame->linesize[i]) * frame->height;
+
+		HeadlessCommand command;
+		command.type = HeadlessCommandType::AsyncVideoOutput;
+		command.source = source;
+		command.width = frame->width;
+		command.height = frame->height;
+		command.byteCount = byteCount;
+		HeadlessState::Record(std::move(command));
+	}
+
+	void obs_source_release(obs_source_t* source)
+	{
+		if (!source || --source->refCount > 0)
+			return;
+
+		if (source->filterParent)
+			HeadlessState::RecordError("obs_source_release", "filter " + source->name + " destroyed while attached to a source");
+
+		while (!source->filters.empty())
+			obs_source_filter_remove(source, source->filters.front());
+
+		if (source->context)
+		{
+			HeadlessState::SourceScope scope(source);
+			source->info.destroy(source->context);
+		}
+
+		obs_data_release(source->settings);
+		delete source;
+	}
+
+	bool obs_source_showing(const obs_source_t* source)
+	{
+		return (source) ? source->showRefs > 0 : false;
+	}
+
+	void obs_source_skip_video_filter(obs_source_t* filter)
+	{
+		if (!filter)
+			return;
+
+		obs_source_t* parent = filter->filterParent;
+		obs_source_t* target = filter->filterTarget;
+		if (!parent || !target)
+			return;
+
+		if (target == parent)
+		{
+			std::uint32_t parentFlags = parent->info.output_flags;
+			bool customDraw = (parentFlags & OBS_SOURCE_CUSTOM_DRAW) != 0;
+			bool async = (parentFlags & OBS_SOURCE_ASYNC) != 0;
+
+			if (!customDraw && !async)
+			{
+				HeadlessState::SourceScope scope(target);
+				DefaultRender(target);
+			}
+			else if (target->info.video_render)
+				MainRender(target);
+			else
+				RenderAsyncVideo(target);
+		}
+		else
+			obs_source_video_render(target);
+	}
+
+	void obs_source_update(obs_source_t* source, obs_data_t* settings)
+	{
+		if (!source)
+			return;
+
+		if (settings)
+			obs_data_apply(source->settings, settings);
+
+		// Video sources are updated from the video thread, on their next tick
+		if (source->info.output_flags & OBS_SOURCE_VIDEO)
+			source->deferUpdate = true;
+		else if (source->context && source->info.update)
+		{
+			HeadlessState::SourceScope scope(source);
+			source->info.update(source->context, source->settings);
+		}
+	}
+
+	void obs_source_video_render(obs_source_t* source)
+	{
+		if (!source || !source->context)
+			return;
+
+		if (!source->filters.empty() && !source->isRenderingFilter)
+		{
+			source->isRenderingFilter = true;
+			obs_source_video_render(source->filters.front());
+			source->isRenderingFilter = false;
+		}
+		else if (source->info.video_render)
+			MainRender(source);
+		else if (source->filterTarget)
+			obs_source_video_render(source->filterTarget);
+		else
+			RenderAsyncVideo(source);
+	}
+
+	void obs_source_video_tick(obs_source_t* source, float seconds)
+	{
+		if (!source)
+			return;
+
+		HeadlessState::SourceScope scope(source);
+
+		if (source->deferUpdate)
+		{
+			source->deferUpdate = false;
+			if (source->context && source->info.update)
+				source->info.update(source->context, source->settings);
+		}
+
+		bool isShowing = source->showRefs > 0;
+		if (source->isShowing != isShowing)
+		{
+			source->isShowing = isShowing;
+
+			auto callback = (isShowing) ? source->info.show : source->info.hide;
+			if (source->context && callback)
+				callback(source->context);
+		}
+
+		if (source->context && source->info.video_tick)
+			source->info.video_tick(source->context, seconds);
+	}
+}
@@ -0,0 +1,63 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_HEADLESS_HEADLESSSTATE
+#define OBS_KINECT_HEADLESS_HEADLESSSTATE
+
+#include <obs-headless/HeadlessObs.hpp>
+#include <string>
+
+// State shared by the libobs functions of obs-headless
+class HeadlessState
+{
+	public:
+		HeadlessState() = delete;
+
+		static bool CheckGraphics(const char* function); //< records an error and returns false if the calling thread didn't enter the graphics context
+
+		static void DestroyEffects(); //< base and cached effects, called by obs_shutdown
+
+		static void EnterGraphics();
+
+		static obs_source_t* GetCurrentSource();
+
+		static void LeaveGraphics();
+
+		static void Record(HeadlessCommand command);
+		static void RecordError(const char* function, const std::string& message);
+
+		static void RegisterObject();
+		static void UnregisterObject();
+
+		// Commands recorded while a source callback is running are attributed to it
+		class SourceScope
+		{
+			public:
+				SourceScope(obs_source_t* source);
+				SourceScope(const SourceScope&) = delete;
+				~SourceScope();
+
+				SourceScope& operator=(const SourceScope&) = delete;
+
+			private:
+				obs_source_t* m_previousSource;
+		};
+};
+
+#endif
@@ -17,10 +17,12 @@
 
 #include "AzureKinectDevice.hpp"
 #include "AzureKinectPlugin.hpp"
+#include <obs-kinect-core/KinectStreamPlanner.hpp>
 #include <util/threading.h>
 #include <array>
 #include <optional>
 #include <sstream>
+#include <stdexcept>
 
 #if HAS_BODY_TRACKING
 #include <k4abt.hpp>
@@ -133,6 +135,69 @@ namespace
 		return deviceConfig;
 	}
 
+	// Capture time of the first image of the capture (0 if it has none), system timestamps use the same clock as os_gettime_ns (QPC on Windows, CLOCK_MONOTONIC on Linux)
+	std::uint64_t GetCaptureTimestamp(const k4a::capture& capture)
+	{
+		k4a::image image = capture.get_color_image();
+		if (!image)
+			image = capture.get_depth_image();
+
+		if (!image)
+			image = capture.get_ir_image();
+
+		if (!image)
+			return 0;
+
+		return static_cast<std::uint64_t>(image.get_system_timestamp().count());
+	}
+
+	// Picks the smallest mode with the same aspect ratio as maxResolution which isn't upscaled to fit the output size
+	ColorResolution SelectColorResolution(ColorResolution maxResolution, const KinectDevice::OutputSize& outputSize)
+	{
+		struct Mode
+		{
+			ColorResolution resolution;
+			std::uint32_t width;
+			std::uint32_t height;
+		};
+
+		// Sorted by size
+		constexpr std::array<Mode, 4> WideModes = {
+			{
+				{ ColorResolution::R1280x720,  1280, 720 },
+				{ ColorResolution::R1920x1080, 1920, 1080 },
+				{ ColorResolution::R2560x1440, 2560, 1440 },
+				{ ColorResolution::R3840x2160, 3840, 2160 }
+			}
+		};
+
+		constexpr std::array<Mode, 2> StandardModes = {
+			{
+				{ ColorResolution::R2048x1536, 2048, 1536 },
+				{ ColorResolution::R4096x3072, 4096, 3072 }
+			}
+		};
+
+		if (outputSize.width == 0 || outputSize.height == 0)
+			return maxResolution;
+
+		auto SelectMode = [&](const auto& modes)
+		{
+			for (const Mode& mode : modes)
+			{
+				if (mode.resolution == maxResolution || mode.width >= outputSize.width || mode.height >= outputSize.height)
+					return mode.resolution;
+			}
+
+			return maxResolution;
+		};
+
+		if (maxResolution == ColorResolution::R2048x1536 || maxResolution == ColorResolution::R4096x3072)
+			return SelectMode(StandardModes);
+		else
+			return SelectMode(WideModes);
+	}
+
 	bool CompareConfig(const k4a_device_configuration_t& lhs, const k4a_device_configuration_t& rhs)
 	{
 		if (lhs.color_resolution != rhs.color_resolution)
@@ -163,13 +228,14 @@ namespace
 	}
 }
 
-AzureKinectDevice::AzureKinectDevice(std::uint32_t deviceIndex) :
+AzureKinectDevice::AzureKinectDevice(std::uint32_t deviceIndex, std::string serialNumber, std::shared_ptr<std::mutex> openMutex) :
+m_openMutex(std::move(openMutex)),
 m_colorResolution(ColorResolution::R1920x1080),
-m_depthMode(DepthMode::NFOVUnbinned)
+m_depthMode(DepthMode::NFOVUnbinned),
+m_serialNumber(std::move(serialNumber)),
+m_deviceIndex(deviceIndex)
 {
-	m_device = k4a::device::open(deviceIndex);
-
-	SetUniqueName("#" + std::to_string(deviceIndex) + ": " + m_device.get_serialnum());
+	SetUniqueName("#" + std::to_string(deviceIndex) + ": " + m_serialNumber);
 
 	SourceFlags supportedSources = Source_Color | Source_Depth | Source_Infrared | Source_ColorMappedDepth;
 
@@ -180,6 +246,8 @@ m_depthMode(DepthMode::NFOVUnbinned)
 
 	SetSupportedSources(supportedSources);
 
+	m_streamPlanner.emplace(GetUniqueName(), supportedSources);
+
 	auto OrBool = [](bool a, bool b)
 	{
 		return a || b;
@@ -272,7 +340,16 @@ obs_properties_t* AzureKinectDevice::CreateProperties() const
 
 	obs_properties_add_button2(props, "azuresdk_dump", Translate("ObsKinect.DumpCameraSettings"), [](obs_properties_t* /*props*/, obs_property_t* /*property*/, void* data)
 	{
-		k4a_device_t device = static_cast<k4a_device_t>(data);
+		const AzureKinectDevice* azureDevice = static_cast<const AzureKinectDevice*>(data);
+
+		std::lock_guard<std::mutex> lock(azureDevice->m_deviceLock);
+		if (!azureDevice->m_device)
+		{
+			warnlog("device is not opened, it has to be used by a source to dump its settings");
+			return false;
+		}
+
+		k4a_device_t device = azureDevice->m_device.handle();
 
 		std::ostringstream ss;
 		ss << "Color settings dump:\n";
@@ -339,11 +416,17 @@ obs_properties_t* AzureKinectDevice::CreateProperties() const
 		infolog("%s", output.c_str());
 
 		return true;
-	}, m_device.handle());
+	}, const_cast<AzureKinectDevice*>(this));
 
 	return props;
 }
 
+void AzureKinectDevice::CloseDevice()
+{
+	std::lock_guard<std::mutex> lock(m_deviceLock);
+	m_device.close();
+}
+
 void AzureKinectDevice::HandleBoolParameterUpdate(const std::string& parameterName, bool value)
 {
 	try
@@ -422,7 +505,23 @@ void AzureKinectDevice::HandleIntParameterUpdate(const std::string& parameterNam
 	}
 }
 
-void AzureKinectDevice::ThreadFunc(std::condition_variable& cv, std::mutex& m, std::exception_ptr& error)
+void AzureKinectDevice::OpenDevice()
+{
+	k4a::device device;
+	{
+		std::lock_guard<std::mutex> lock(*m_openMutex);
+		device = k4a::device::open(m_deviceIndex);
+	}
+
+	// Indices are attributed by the SDK and can change when devices are plugged/unplugged
+	if (device.get_serialnum() != m_serialNumber)
+		throw std::runtime_error("device #" + std::to_string(m_deviceIndex) + " is no longer " + m_serialNumber + ", please refresh devices");
+
+	std::lock_guard<std::mutex> lock(m_deviceLock);
+	m_device = std::move(device);
+}
+
+void AzureKinectDevice::ThreadFunc()
 {
 	os_set_thread_name("AzureKinectDevice");
 
@@ -433,17 +532,47 @@ void AzureKinectDevice::ThreadFunc(std::condition_variable& cv, std::mutex& m, s
 	std::optional<k4abt::tracker> bodyTracker;
 #endif
 
+	// Cameras are configured for the sources the planner chooses to stream, which may include sources that are no longer
+	// enabled (so toggling them doesn't restart cameras), frames are only retrieved for enabled sources
+	KinectStreamPlanner& streamPlanner = *m_streamPlanner;
+
 	k4a_device_configuration_t activeConfig = K4A_DEVICE_CONFIG_INIT_DISABLE_ALL;
 	SourceFlags enabledSourceFlags = 0;
+	SourceFlags requestedSourceFlags = 0;
 	bool cameraStarted = false;
 	auto UpdateKinectStreams = [&](SourceFlags enabledSources)
 	{
-		k4a_device_configuration_t newConfig = BuildConfiguration(enabledSources, m_colorResolution.load(), m_depthMode.load());
-		if (!CompareConfig(newConfig, activeConfig))
+		ColorResolution colorResolution = SelectColorResolution(m_colorResolution.load(), GetOutputSize());
+		DepthMode depthMode = m_depthMode.load();
+
+		if (streamPlanner.GetStreamSources() == 0)
+		{
+			// No access left, stop cameras but keep the device open
+			if (cameraStarted)
+			{
+				m_device.stop_cameras();
+				cameraStarted = false;
+			}
+
+			activeConfig = K4A_DEVICE_CONFIG_INIT_DISABLE_ALL;
+			enabledSourceFlags = 0;
+			transformation.reset();
+#if HAS_BODY_TRACKING
+			bodyTracker.reset();
+#endif
+			return;
+		}
+
+		k4a_device_configuration_t newConfig = BuildConfiguration(streamPlanner.GetStreamSources(), colorResolution, depthMode);
+		if (!cameraStarted || !CompareConfig(newConfig, activeConfig))
 		{
 			// Restart cameras only if configuration changed
 			if (cameraStarted)
 			{
+				// May drop stale sources from the configuration, as cameras restart anyway
+				streamPlanner.RegisterRestart();
+				newConfig = BuildConfiguration(streamPlanner.GetStreamSources(), colorResolution, depthMode);
+
 				m_device.stop_cameras();
 				cameraStarted = false;
 			}
@@ -478,23 +607,27 @@ void AzureKinectDevice::ThreadFunc(std::condition_variable& cv, std::mutex& m, s
 		enabledSourceFlags = enabledSources;
 	};
 
-	{
-		std::unique_lock<std::mutex> lk(m);
-		cv.notify_all();
-	} // m & cv no longer exists from here
-
-	if (error)
-		return;
+	NotifyCaptureStarted();
 
 	while (IsRunning())
 	{
 		try
 		{
+			bool updateStreams = false;
 			if (auto sourceFlagUpdate = GetSourceFlagsUpdate())
+			{
+				requestedSourceFlags = sourceFlagUpdate.value();
+				updateStreams = true; //< also triggered by color resolution/depth mode changes
+			}
+
+			if (streamPlanner.Update(requestedSourceFlags))
+				updateStreams = true;
+
+			if (updateStreams)
 			{
 				try
 				{
-					UpdateKinectStreams(sourceFlagUpdate.value());
+					UpdateKinectStreams(requestedSourceFlags);
 				}
 				catch (const std::exception& e)
 				{
@@ -515,7 +648,15 @@ void AzureKinectDevice::ThreadFunc(std::condition_variable& cv, std::mutex& m, s
 			k4a::capture capture;
 			m_device.get_capture(&capture);
 
+			std::uint64_t timestamp = GetCaptureTimestamp(capture);
+
+			// No access will process this capture, skip its (costly) conversion and body tracking
+			if (!IsFrameNeeded(timestamp))
+				continue;
+
 			KinectFramePtr framePtr = std::make_shared<KinectFrame>();
+			framePtr->timestamp = timestamp;
+
 			if (enabledSourceFlags & Source_Color)
 			{
 				if (k4a::image colorImage = capture.get_color_image())
@@ -596,6 +737,9 @@ void AzureKinectDevice::ThreadFunc(std::condition_variable& cv, std::mutex& m, s
 		m_device.stop_cameras();
 	}
 
+	// Next thread starts cameras from scratch (with every source requested until now)
+	streamPlanner.Update(0);
+
 	infolog("exiting thread");
 }
 
@@ -22,7 +22,11 @@
 
 #include "AzureHelper.hpp"
 #include <obs-kinect-core/KinectDevice.hpp>
+#include <obs-kinect-core/KinectStreamPlanner.hpp>
 #include <k4a/k4a.hpp>
+#include <memory>
+#include <mutex>
+#include <optional>
 
 enum class ColorResolution
 {
@@ -46,24 +50,31 @@ enum class DepthMode
 class AzureKinectDevice final : public KinectDevice
 {
 	public:
-		AzureKinectDevice(std::uint32_t deviceIndex);
+		AzureKinectDevice(std::uint32_t deviceIndex, std::string serialNumber, std::shared_ptr<std::mutex> openMutex);
 		~AzureKinectDevice();
 
 		obs_properties_t* CreateProperties() const;
 
 	private:
+		void CloseDevice() override;
 		void HandleBoolParameterUpdate(const std::string& parameterName, bool value);
 		void HandleIntParameterUpdate(const std::string& parameterName, long long value);
-		void ThreadFunc(std::condition_variable& cv, std::mutex& m, std::exception_ptr& exceptionPtr) override;
+		void OpenDevice() override;
+		void ThreadFunc() override;
 
 		static BodyIndexFrameData ToBodyIndexFrame(const k4a::image& image);
 		static ColorFrameData ToColorFrame(const k4a::image& image);
 		static DepthFrameData ToDepthFrame(const k4a::image& image);
 		static InfraredFrameData ToInfraredFrame(const k4a::image& image);
 
-		k4a::device m_device;
+		std::optional<KinectStreamPlanner> m_streamPlanner; //< outlives the device thread so it remembers requested sources
+		std::shared_ptr<std::mutex> m_openMutex; //< serializes opening with AzureKinectPlugin::Refresh
+		k4a::device m_device; //< only opened while the device is used (see OpenDevice)
+		mutable std::mutex m_deviceLock; //< protects m_device opening/closing against properties
 		std::atomic<ColorResolution> m_colorResolution;
 		std::atomic<DepthMode> m_depthMode;
+		std::string m_serialNumber;
+		std::uint32_t m_deviceIndex;
 };
 
 #endif
@@ -44,7 +44,8 @@ void ErrorCallback(void* /*context*/, k4a_log_level_t level, const char* file, c
 }
 
 
-AzureKinectPlugin::AzureKinectPlugin()
+AzureKinectPlugin::AzureKinectPlugin() :
+m_openMutex(std::make_shared<std::mutex>())
 {
 #ifdef DEBUG
 	k4a_log_level_t logLevel = K4A_LOG_LEVEL_INFO;
@@ -84,14 +85,32 @@ std::vector<std::unique_ptr<KinectDevice>> AzureKinectPlugin::Refresh() const
 
 		for (std::uint32_t i = 0; i < deviceCount; ++i)
 		{
+			// The SDK only gives the serial number of an opened device and a device can only be opened once,
+			// devices already in use keep the serial number they had when last enumerated
+			std::string serialNumber;
 			try
 			{
-				devices.emplace_back(std::make_unique<AzureKinectDevice>(i));
+				// A device can't be opened twice, don't make an OpenDevice happening at the same time fail
+				std::lock_guard<std::mutex> lock(*m_openMutex);
+
+				k4a::device device = k4a::device::open(i);
+				serialNumber = device.get_serialnum();
+
+				m_serialNumbers[i] = serialNumber;
 			}
 			catch (const std::exception& e)
 			{
-				warnlog("failed to open Azure Kinect #%d: %s", i, e.what());
+				auto it = m_serialNumbers.find(i);
+				if (it == m_serialNumbers.end())
+				{
+					warnlog("failed to open Azure Kinect #%d: %s", i, e.what());
+					continue;
+				}
+
+				serialNumber = it->second;
 			}
+
+			devices.emplace_back(std::make_unique<AzureKinectDevice>(i, std::move(serialNumber), m_openMutex));
 		}
 	}
 	catch (const std::exception& e)
@@ -23,6 +23,10 @@
 #include "AzureHelper.hpp"
 #include <obs-kinect-core/Enums.hpp>
 #include <obs-kinect-core/KinectPluginImpl.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 #if __has_include(<k4abt.hpp>)
 #define HAS_BODY_TRACKING 1
@@ -47,6 +51,9 @@ class AzureKinectPlugin : public KinectPluginImpl
 		AzureKinectPlugin& operator=(AzureKinectPlugin&&) = delete;
 
 	private:
+		mutable std::unordered_map<std::uint32_t, std::string> m_serialNumbers; //< by device index, Refresh is never called concurrently
+		std::shared_ptr<std::mutex> m_openMutex; //< shared with devices, Refresh opens devices on the loader thread while sources may be opening them
+
 #if HAS_BODY_TRACKING
 		ObsLibPtr m_bodyTrackingLib;
 #endif
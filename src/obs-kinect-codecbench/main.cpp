@@ -0,0 +1,172 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect-core/KinectRecording.hpp>
+#include <obs-kinect-core/PlaneCodec.hpp>
+#include <obs-kinect-core/WorkerPool.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Measures PlaneCodec ratio and throughput on the planes of a recording (see KinectRecorder)
+// Usage: obs-kinect-codecbench <recording.kinectrec> [thread count]
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct StreamStats
+	{
+		const char* name;
+		bool temporal;
+		std::uint64_t rawSize = 0;
+		std::uint64_t encodedSize = 0;
+		std::uint64_t planeCount = 0;
+		Clock::duration decodeTime = Clock::duration::zero();
+		Clock::duration encodeTime = Clock::duration::zero();
+	};
+
+	template<typename T, typename FrameData>
+	void BenchmarkPlane(PlaneCodec& codec, const std::optional<FrameData>& frameData, const std::optional<FrameData>& previousFrameData, StreamStats& intraStats, StreamStats& temporalStats, std::vector<std::uint8_t>& encoded, std::vector<T>& decoded)
+	{
+		if (!frameData)
+			return;
+
+		const T* pixels = reinterpret_cast<const T*>(frameData->ptr.get());
+		const T* reference = nullptr;
+		if (previousFrameData && previousFrameData->width == frameData->width && previousFrameData->height == frameData->height && previousFrameData->pitch == frameData->pitch)
+			reference = reinterpret_cast<const T*>(previousFrameData->ptr.get());
+
+		decoded.resize(std::size_t(frameData->width) * frameData->height);
+		std::uint32_t decodedPitch = static_cast<std::uint32_t>(frameData->width * sizeof(T));
+
+		for (StreamStats* stats : { &intraStats, &temporalStats })
+		{
+			const T* planeReference = (stats->temporal) ? reference : nullptr;
+			if (stats->temporal && !planeReference)
+				continue;
+
+			Clock::time_point start = Clock::now();
+			if constexpr (sizeof(T) == 2)
+				codec.EncodeDepth(pixels, frameData->pitch, frameData->width, frameData->height, encoded, planeReference, frameData->pitch);
+			else
+				codec.EncodeBodyIndex(pixels, frameData->pitch, frameData->width, frameData->height, encoded, planeReference, frameData->pitch);
+
+			Clock::time_point encodeEnd = Clock::now();
+			if constexpr (sizeof(T) == 2)
+				codec.DecodeDepth(encoded.data(), encoded.size(), decoded.data(), decodedPitch, planeReference, frameData->pitch);
+			else
+				codec.DecodeBodyIndex(encoded.data(), encoded.size(), decoded.data(), decodedPitch, planeReference, frameData->pitch);
+
+			Clock::time_point end = Clock::now();
+
+			for (std::uint32_t y = 0; y < frameData->height; ++y)
+			{
+				const std::uint8_t* inputRow = reinterpret_cast<const std::uint8_t*>(pixels) + y * frameData->pitch;
+				if (std::memcmp(inputRow, &decoded[y * frameData->width], decodedPitch) != 0)
+					throw std::runtime_error(std::string(stats->name) + " plane doesn't match after decoding");
+			}
+
+			stats->rawSize += std::uint64_t(decodedPitch) * frameData->height;
+			stats->encodedSize += encoded.size();
+			stats->planeCount++;
+			stats->encodeTime += encodeEnd - start;
+			stats->decodeTime += end - encodeEnd;
+		}
+	}
+
+	void PrintStats(const StreamStats& stats)
+	{
+		if (stats.planeCount == 0)
+			return;
+
+		auto ToMBps = [&](Clock::duration duration)
+		{
+			double seconds = std::chrono::duration<double>(duration).count();
+			return (seconds > 0.0) ? double(stats.rawSize) / (1024.0 * 1024.0) / seconds : 0.0;
+		};
+
+		std::printf("%-18s %-9s %8llu %10.2f %12.1f %12.1f\n", stats.name, (stats.temporal) ? "temporal" : "intra", static_cast<unsigned long long>(stats.planeCount), double(stats.rawSize) / double(stats.encodedSize), ToMBps(stats.encodeTime), ToMBps(stats.decodeTime));
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "usage: %s <recording> [thread count]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		auto recording = std::make_shared<KinectRecording>(argv[1]);
+
+		std::size_t threadCount = (argc >= 3) ? std::strtoul(argv[2], nullptr, 10) : 1;
+		std::optional<WorkerPool> workerPool;
+		if (threadCount > 1)
+			workerPool.emplace(threadCount - 1);
+
+		PlaneCodec codec((workerPool) ? &*workerPool : nullptr);
+
+		StreamStats stats[] = {
+			{ "depth",              false }, { "depth",              true },
+			{ "infrared",           false }, { "infrared",           true },
+			{ "body index",         false }, { "body index",         true },
+			{ "color mapped depth", false }, { "color mapped depth", true },
+			{ "color mapped body",  false }, { "color mapped body",  true }
+		};
+
+		std::vector<std::uint8_t> encoded;
+		std::vector<std::uint8_t> decoded8;
+		std::vector<std::uint16_t> decoded16;
+
+		SourceFlags planeSources = Source_Body | Source_ColorMappedBody | Source_ColorMappedDepth | Source_Depth | Source_Infrared;
+
+		KinectFrameConstPtr previousFrame = std::make_shared<KinectFrame>();
+		for (std::size_t i = 0; i < recording->GetFrameCount(); ++i)
+		{
+			KinectFrameConstPtr frame = recording->ReadFrame(i, planeSources);
+
+			BenchmarkPlane(codec, frame->depthFrame, previousFrame->depthFrame, stats[0], stats[1], encoded, decoded16);
+			BenchmarkPlane(codec, frame->infraredFrame, previousFrame->infraredFrame, stats[2], stats[3], encoded, decoded16);
+			BenchmarkPlane(codec, frame->bodyIndexFrame, previousFrame->bodyIndexFrame, stats[4], stats[5], encoded, decoded8);
+			BenchmarkPlane(codec, frame->colorMappedDepthFrame, previousFrame->colorMappedDepthFrame, stats[6], stats[7], encoded, decoded16);
+			BenchmarkPlane(codec, frame->colorMappedBodyFrame, previousFrame->colorMappedBodyFrame, stats[8], stats[9], encoded, decoded8);
+
+			previousFrame = std::move(frame);
+		}
+
+		std::printf("%s: %zu frames, %zu thread(s)\n", argv[1], recording->GetFrameCount(), std::max<std::size_t>(threadCount, 1));
+		std::printf("%-18s %-9s %8s %10s %12s %12s\n", "stream", "mode", "planes", "ratio", "enc (MB/s)", "dec (MB/s)");
+		for (const StreamStats& streamStats : stats)
+			PrintStats(streamStats);
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
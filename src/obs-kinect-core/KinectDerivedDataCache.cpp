@@ -0,0 +1,154 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include <obs-kinect-core/KinectDerivedDataCache.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+auto KinectDerivedDataCache::GetDepthDynamicValues(const KinectFrame& frame) -> DynamicValues
+{
+	assert(frame.depthFrame);
+
+	std::lock_guard<std::mutex> lock(m_statisticsLock);
+	if (m_depthStatistics.frameIndex != frame.frameIndex)
+	{
+		const DepthFrameData& depthFrame = *frame.depthFrame;
+		m_depthStatistics.values = ComputeDynamicValues(depthFrame.ptr.get(), depthFrame.width * depthFrame.height);
+		m_depthStatistics.frameIndex = frame.frameIndex;
+	}
+
+	return m_depthStatistics.values;
+}
+
+auto KinectDerivedDataCache::GetInfraredDynamicValues(const KinectFrame& frame) -> DynamicValues
+{
+	assert(frame.infraredFrame);
+
+	std::lock_guard<std::mutex> lock(m_statisticsLock);
+	if (m_infraredStatistics.frameIndex != frame.frameIndex)
+	{
+		const InfraredFrameData& infraredFrame = *frame.infraredFrame;
+		m_infraredStatistics.values = ComputeDynamicValues(infraredFrame.ptr.get(), infraredFrame.width * infraredFrame.height);
+		m_infraredStatistics.frameIndex = frame.frameIndex;
+	}
+
+	return m_infraredStatistics.values;
+}
+
+auto KinectDerivedDataCache::GetMappedBodyIndex(const KinectFrame& frame, std::uint8_t maxDirtyDepth) -> MappedBodyIndex
+{
+	assert(frame.bodyIndexFrame && frame.colorFrame && frame.depthFrame && frame.depthMappingFrame);
+
+	std::lock_guard<std::mutex> lock(m_mappingLock);
+	EvictUnusedMappings(frame.frameIndex);
+
+	MapperEntry& entry = m_mappers[{ frame.colorFrame->width, frame.colorFrame->height, maxDirtyDepth }];
+	entry.lastBodyIndexRequest = frame.frameIndex;
+
+	if (entry.bodyIndexFrameIndex != frame.frameIndex)
+	{
+		const ColorFrameData& colorFrame = *frame.colorFrame;
+		const std::uint8_t* bodyIndexOutput = entry.mapper.MapBodyIndex(colorFrame, *frame.depthFrame, *frame.bodyIndexFrame, *frame.depthMappingFrame, maxDirtyDepth);
+
+		entry.bodyIndex = UpdateSnapshot(std::move(entry.bodyIndex), bodyIndexOutput, std::size_t(colorFrame.width) * colorFrame.height);
+		entry.bodyIndexFrameIndex = frame.frameIndex;
+	}
+
+	return entry.bodyIndex;
+}
+
+auto KinectDerivedDataCache::GetMappedDepth(const KinectFrame& frame, std::uint8_t maxDirtyDepth) -> MappedDepth
+{
+	assert(frame.colorFrame && frame.depthFrame && frame.depthMappingFrame);
+
+	std::lock_guard<std::mutex> lock(m_mappingLock);
+	EvictUnusedMappings(frame.frameIndex);
+
+	MapperEntry& entry = m_mappers[{ frame.colorFrame->width, frame.colorFrame->height, maxDirtyDepth }];
+	entry.lastDepthRequest = frame.frameIndex;
+
+	if (entry.depthFrameIndex != frame.frameIndex)
+	{
+		const ColorFrameData& colorFrame = *frame.colorFrame;
+		const std::uint16_t* depthOutput = entry.mapper.MapDepth(colorFrame, *frame.depthFrame, *frame.depthMappingFrame, maxDirtyDepth);
+
+		entry.depth = UpdateSnapshot(std::move(entry.depth), depthOutput, std::size_t(colorFrame.width) * colorFrame.height);
+		entry.depthFrameIndex = frame.frameIndex;
+	}
+
+	return entry.depth;
+}
+
+auto KinectDerivedDataCache::ComputeDynamicValues(const std::uint16_t* values, std::size_t valueCount) -> DynamicValues
+{
+	constexpr std::uint16_t MaxValue = std::numeric_limits<std::uint16_t>::max();
+
+	unsigned long long average = std::accumulate(values, values + valueCount, 0LL) / valueCount;
+	unsigned long long varianceAcc = std::accumulate(values, values + valueCount, 0LL, [average](unsigned long long init, unsigned long long delta)
+	{
+		return init + (delta - average) * (delta - average); // underflow allowed (will overflow back to the right value)
+	});
+
+	double variance = double(varianceAcc) / valueCount;
+
+	double averageValue = double(average) / MaxValue;
+	double standardDeviation = std::sqrt(variance / MaxValue);
+
+	return { averageValue, standardDeviation };
+}
+
+void KinectDerivedDataCache::EvictUnusedMappings(std::uint64_t frameIndex)
+{
+	// Reclaim memory of mappings no source asked for in a while (source settings changed or source closed)
+	for (auto it = m_mappers.begin(); it != m_mappers.end();)
+	{
+		MapperEntry& entry = it->second;
+		if (entry.bodyIndex && frameIndex - entry.lastBodyIndexRequest > EvictionDelay)
+		{
+			entry.mapper.ReleaseBodyIndexMapping();
+			entry.bodyIndex.reset();
+			entry.bodyIndexFrameIndex = InvalidFrameIndex;
+		}
+
+		if (entry.depth && frameIndex - entry.lastDepthRequest > EvictionDelay)
+		{
+			entry.mapper.ReleaseDepthMapping();
+			entry.depth.reset();
+			entry.depthFrameIndex = InvalidFrameIndex;
+		}
+
+		if (!entry.bodyIndex && !entry.depth && frameIndex - std::max(entry.lastBodyIndexRequest, entry.lastDepthRequest) > EvictionDelay)
+			it = m_mappers.erase(it);
+		else
+			++it;
+	}
+}
+
+template<typename T>
+std::shared_ptr<std::vector<T>> KinectDerivedDataCache::UpdateSnapshot(std::shared_ptr<std::vector<T>> snapshot, const T* data, std::size_t size)
+{
+	// Snapshots given to sources may still be in use (e.g. by the CPU compositor thread), only reuse a snapshot memory if we're its only owner
+	if (!snapshot || snapshot.use_count() > 1)
+		snapshot = std::make_shared<std::vector<T>>();
+
+	snapshot->assign(data, data + size);
+
+	return snapshot;
+}
@@ -16,8 +16,19 @@
 ******************************************************************************/
 
 #include <obs-kinect-core/KinectDevice.hpp>
+#include <obs-kinect-core/KinectDerivedDataCache.hpp>
 #include <obs-kinect-core/KinectDeviceAccess.hpp>
+#include <obs-kinect-core/KinectFrameDownscaler.hpp>
+#include <obs-kinect-core/KinectFrameSubscriber.hpp>
+#include <obs-kinect-core/KinectNetworkSender.hpp>
+#include <obs-kinect-core/KinectRecorder.hpp>
+#include <obs-kinect-core/KinectReplayBuffer.hpp>
+#include <obs-kinect-core/KinectSharedMemoryPublisher.hpp>
+#include <obs-kinect-core/WorkerPool.hpp>
+#include <util/threading.h>
 #include <algorithm>
+#include <chrono>
+#include <stdexcept>
 #include <type_traits>
 
 template<typename T>
@@ -26,10 +37,23 @@ struct AlwaysFalse : std::false_type {};
 KinectDevice::KinectDevice() :
 m_deviceSources(0),
 m_supportedSources(0),
+m_captureState(CaptureState::Stopped),
+m_hasFrameSubscribers(false),
 m_running(false),
+m_maxFrameRate(0),
 m_uniqueName("Unnamed device"),
+m_derivedDataCache(std::make_shared<KinectDerivedDataCache>()),
+m_frameDownscaler(std::make_unique<KinectFrameDownscaler>(WorkerPool::GetSharedPool())),
 m_frameIndex(0),
-m_deviceSourceUpdated(true)
+m_idleReleaseCloseDelay(0),
+m_idleReleaseDeadline(0),
+m_idleReleaseDelay(DefaultIdleReleaseDelay),
+m_keepAliveDelay(DefaultKeepAliveDelay),
+m_nextFrameTime(0),
+m_deviceOpened(false),
+m_deviceSourceUpdated(true),
+m_idleReleaseExit(false),
+m_idleReleaseStage(IdleReleaseStage::None)
 {
 }
 
@@ -37,6 +61,15 @@ KinectDevice::~KinectDevice()
 {
 	assert(m_accesses.empty());
 	StopCapture(); //< Just in case
+
+	{
+		std::lock_guard<std::mutex> lock(m_idleReleaseLock);
+		m_idleReleaseExit = true;
+	}
+	m_idleReleaseCv.notify_all();
+
+	if (m_idleReleaseThread.joinable())
+		m_idleReleaseThread.join();
 }
 
 KinectDeviceAccess KinectDevice::AcquireAccess(SourceFlags enabledSources)
@@ -59,6 +92,11 @@ KinectDeviceAccess KinectDevice::AcquireAccess(SourceFlags enabledSources)
 
 	RefreshParameters();
 	UpdateEnabledSources();
+	UpdateIdleReleaseDelay();
+	UpdateKeepAliveDelay();
+	UpdateMaxFrameRate();
+	UpdateOutputSize();
+	UpdateServices();
 
 	return KinectDeviceAccess(*this, accessDataPtr.get());
 }
@@ -78,6 +116,16 @@ bool KinectDevice::GetBoolParameterValue(const std::string& parameterName) const
 	return parameter.value;
 }
 
+CaptureState KinectDevice::GetCaptureState() const
+{
+	return m_captureState;
+}
+
+const std::shared_ptr<KinectDerivedDataCache>& KinectDevice::GetDerivedDataCache() const
+{
+	return m_derivedDataCache;
+}
+
 double KinectDevice::GetDoubleParameterValue(const std::string& parameterName) const
 {
 	auto it = m_parameters.find(parameterName);
@@ -104,6 +152,116 @@ auto KinectDevice::GetLastFrame() -> KinectFrameConstPtr
 	return m_lastFrame;
 }
 
+void KinectDevice::CancelIdleRelease()
+{
+	{
+		// Idle release thread holds the lock while stopping capture or closing the device, this waits for it to finish
+		std::lock_guard<std::mutex> lock(m_idleReleaseLock);
+		m_idleReleaseStage = IdleReleaseStage::None;
+	}
+	m_idleReleaseCv.notify_all();
+}
+
+void KinectDevice::CaptureThreadFunc()
+{
+	try
+	{
+		if (!m_deviceOpened)
+		{
+			OpenDevice();
+			m_deviceOpened = true;
+		}
+
+		ThreadFunc();
+
+		// Thread may also give up without throwing (and without starting)
+		CaptureState startingState = CaptureState::Starting;
+		if (m_running && m_captureState.compare_exchange_strong(startingState, CaptureState::Failed))
+			errorlog("failed to start %s capture", m_uniqueName.c_str());
+	}
+	catch (const std::exception& e)
+	{
+		if (m_captureState == CaptureState::Running)
+			errorlog("%s capture stopped: %s", m_uniqueName.c_str(), e.what());
+		else
+			errorlog("failed to start %s capture: %s", m_uniqueName.c_str(), e.what());
+
+		m_captureState = CaptureState::Failed;
+	}
+}
+
+auto KinectDevice::GetLastOutputFrame(const OutputSize& outputSize) -> KinectFrameConstPtr
+{
+	std::lock_guard<std::mutex> lock(m_lastFrameLock);
+	if (!m_lastFrame)
+		return m_lastFrame;
+
+	// Downscaled frames are built for every access output size when the frame arrives (see UpdateFrame),
+	// an access whose size just changed gets the full frame until the next one
+	std::uint32_t factor = KinectFrameDownscaler::ComputeFactor(*m_lastFrame, outputSize.width, outputSize.height);
+	for (const auto& [downscaleFactor, downscaledFrame] : m_lastDownscaledFrames)
+	{
+		if (downscaleFactor == factor)
+			return downscaledFrame;
+	}
+
+	return m_lastFrame;
+}
+
+void KinectDevice::IdleReleaseThreadFunc()
+{
+	os_set_thread_name("KinectDeviceIdleRelease");
+
+	std::unique_lock<std::mutex> lock(m_idleReleaseLock);
+	while (!m_idleReleaseExit)
+	{
+		if (m_idleReleaseStage == IdleReleaseStage::None)
+		{
+			m_idleReleaseCv.wait(lock);
+			continue;
+		}
+
+		// Canceling or rescheduling wakes the thread up, which checks the stage and deadline again
+		std::uint64_t now = os_gettime_ns();
+		if (now < m_idleReleaseDeadline)
+		{
+			m_idleReleaseCv.wait_for(lock, std::chrono::nanoseconds(m_idleReleaseDeadline - now));
+			continue;
+		}
+
+		switch (m_idleReleaseStage)
+		{
+			case IdleReleaseStage::KeepAlive:
+			{
+				StopCaptureThread();
+
+				// m_deviceOpened is only read after the device thread has been joined
+				if (m_deviceOpened)
+				{
+					m_idleReleaseStage = IdleReleaseStage::Release;
+					m_idleReleaseDeadline = os_gettime_ns() + m_idleReleaseCloseDelay;
+				}
+				else
+					m_idleReleaseStage = IdleReleaseStage::None;
+
+				break;
+			}
+
+			case IdleReleaseStage::Release:
+			{
+				CloseDevice();
+				m_deviceOpened = false;
+
+				m_idleReleaseStage = IdleReleaseStage::None;
+				break;
+			}
+
+			case IdleReleaseStage::None:
+				break;
+		}
+	}
+}
+
 void KinectDevice::RefreshParameters()
 {
 	for (auto&& [parameterName, _] : m_parameters)
@@ -116,11 +274,69 @@ void KinectDevice::ReleaseAccess(AccessData* accessData)
 	assert(it != m_accesses.end());
 	m_accesses.erase(it);
 
-	RefreshParameters();
+	// A device kept alive keeps its parameters but has no source enabled, backends stop streaming until it's used again (see ScheduleIdleRelease)
+	bool keepAlive = m_accesses.empty() && m_keepAliveDelay > 0 && m_captureState != CaptureState::Failed;
+	if (!keepAlive)
+		RefreshParameters();
+
 	UpdateEnabledSources();
+	UpdateServices();
 
 	if (m_accesses.empty())
-		StopCapture();
+	{
+		if (!keepAlive)
+			StopCapture();
+
+		ScheduleIdleRelease();
+	}
+	else
+	{
+		UpdateIdleReleaseDelay();
+		UpdateKeepAliveDelay();
+		UpdateMaxFrameRate();
+		UpdateOutputSize();
+	}
+}
+
+void KinectDevice::ScheduleIdleRelease()
+{
+	CancelIdleRelease();
+
+	if (!m_running)
+	{
+		if (!m_deviceOpened)
+			return;
+
+		if (m_idleReleaseDelay == 0)
+		{
+			CloseDevice();
+			m_deviceOpened = false;
+			return;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_idleReleaseLock);
+
+		// Restarting capture is expensive (up to a few seconds), keep it running in case a source shows up again soon
+		if (m_running)
+		{
+			m_idleReleaseStage = IdleReleaseStage::KeepAlive;
+			m_idleReleaseDeadline = os_gettime_ns() + m_keepAliveDelay;
+		}
+		else
+		{
+			m_idleReleaseStage = IdleReleaseStage::Release;
+			m_idleReleaseDeadline = os_gettime_ns() + m_idleReleaseDelay;
+		}
+
+		m_idleReleaseCloseDelay = m_idleReleaseDelay;
+	}
+
+	if (m_idleReleaseThread.joinable())
+		m_idleReleaseCv.notify_all();
+	else
+		m_idleReleaseThread = std::thread(&KinectDevice::IdleReleaseThreadFunc, this);
 }
 
 void KinectDevice::UpdateDeviceParameters(AccessData* access, obs_data_t* settings)
@@ -162,6 +378,176 @@ void KinectDevice::UpdateEnabledSources()
 	SetEnabledSources(sourceFlags);
 }
 
+void KinectDevice::UpdateFrameSharing()
+{
+	bool shareFrames = !m_accesses.empty() && m_serviceSettings.shareFrames;
+
+	std::unique_ptr<KinectSharedMemoryPublisher> publisher;
+	{
+		// A publisher which failed is recreated
+		std::lock_guard<std::mutex> lock(m_frameSubscriberLock);
+		if ((m_publisher && !m_publisher->HasFailed()) == shareFrames)
+			return;
+	}
+
+	if (shareFrames)
+	{
+		try
+		{
+			publisher = std::make_unique<KinectSharedMemoryPublisher>(m_uniqueName, m_supportedSources);
+		}
+		catch (const std::exception& e)
+		{
+			errorlog("failed to share frames: %s", e.what());
+			return;
+		}
+	}
+
+	SwapFrameSubscriber(m_publisher, publisher);
+}
+
+void KinectDevice::UpdateIdleReleaseDelay()
+{
+	// Keep the delay of the last accesses once every one of them has been released
+	if (m_accesses.empty())
+		return;
+
+	std::uint64_t idleReleaseDelay = 0;
+	for (const auto& access : m_accesses)
+		idleReleaseDelay = std::max(idleReleaseDelay, access->idleReleaseDelay);
+
+	m_idleReleaseDelay = idleReleaseDelay;
+}
+
+void KinectDevice::UpdateKeepAliveDelay()
+{
+	// Keep the delay of the last accesses once every one of them has been released
+	if (m_accesses.empty())
+		return;
+
+	std::uint64_t keepAliveDelay = 0;
+	for (const auto& access : m_accesses)
+		keepAliveDelay = std::max(keepAliveDelay, access->keepAliveDelay);
+
+	m_keepAliveDelay = keepAliveDelay;
+}
+
+void KinectDevice::UpdateMaxFrameRate()
+{
+	// Keep the frame rate of the last accesses once every one of them has been released
+	if (m_accesses.empty())
+		return;
+
+	std::uint32_t maxFrameRate = 0;
+	for (const auto& access : m_accesses)
+	{
+		if (access->maxFrameRate == 0)
+		{
+			maxFrameRate = 0;
+			break;
+		}
+
+		maxFrameRate = std::max(maxFrameRate, access->maxFrameRate);
+	}
+
+	m_maxFrameRate = maxFrameRate;
+}
+
+void KinectDevice::UpdateNetworkSender()
+{
+	std::uint16_t port = (!m_accesses.empty()) ? m_serviceSettings.networkPort : 0;
+
+	std::unique_ptr<KinectNetworkSender> sender;
+	{
+		std::lock_guard<std::mutex> lock(m_frameSubscriberLock);
+		if ((m_sender) ? m_sender->GetPort() == port : port == 0)
+			return;
+	}
+
+	if (port != 0)
+	{
+		try
+		{
+			sender = std::make_unique<KinectNetworkSender>(port, m_uniqueName, m_supportedSources);
+		}
+		catch (const std::exception& e)
+		{
+			errorlog("failed to serve frames on port %u: %s", unsigned(port), e.what());
+		}
+	}
+
+	SwapFrameSubscriber(m_sender, sender);
+}
+
+void KinectDevice::UpdateReplayBuffer()
+{
+	std::size_t memoryBudget = (!m_accesses.empty()) ? m_serviceSettings.replayBufferMemory : 0;
+	std::uint64_t maxDuration = (!m_accesses.empty()) ? m_serviceSettings.replayBufferDuration : 0;
+	if (maxDuration == 0)
+		memoryBudget = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_frameSubscriberLock);
+		if (m_replayBuffer)
+		{
+			if (m_replayBuffer->GetMemoryBudget() == memoryBudget && m_replayBuffer->GetMaxDuration() == maxDuration)
+				return;
+		}
+		else if (memoryBudget == 0)
+			return;
+	}
+
+	// Buffered frames are lost when the settings change
+	std::unique_ptr<KinectReplayBuffer> replayBuffer;
+	if (memoryBudget > 0)
+	{
+		try
+		{
+			replayBuffer = std::make_unique<KinectReplayBuffer>(memoryBudget, maxDuration);
+		}
+		catch (const std::exception& e)
+		{
+			errorlog("failed to create replay buffer: %s", e.what());
+		}
+	}
+
+	SwapFrameSubscriber(m_replayBuffer, replayBuffer);
+
+	// Previous buffer (if any) is released outside of the lock, this waits for its save to finish
+	replayBuffer.reset();
+}
+
+void KinectDevice::UpdateOutputSize()
+{
+	// Keep the size of the last accesses once every one of them has been released
+	if (m_accesses.empty())
+		return;
+
+	std::vector<OutputSize> accessOutputSizes;
+	OutputSize outputSize;
+	for (const auto& access : m_accesses)
+	{
+		accessOutputSizes.push_back(access->outputSize);
+		if (access->outputSize.width == 0 || access->outputSize.height == 0)
+		{
+			outputSize = OutputSize{};
+			break;
+		}
+
+		outputSize.width = std::max(outputSize.width, access->outputSize.width);
+		outputSize.height = std::max(outputSize.height, access->outputSize.height);
+	}
+
+	std::lock_guard<std::mutex> lock(m_deviceSourceLock);
+	m_accessOutputSizes = std::move(accessOutputSizes);
+
+	if (m_outputSize.width == outputSize.width && m_outputSize.height == outputSize.height)
+		return;
+
+	m_outputSize = outputSize;
+	m_deviceSourceUpdated = false; //< lets the device thread pick another color mode
+}
+
 void KinectDevice::UpdateParameter(const std::string& parameterName)
 {
 	auto it = m_parameters.find(parameterName);
@@ -213,6 +599,13 @@ void KinectDevice::UpdateParameter(const std::string& parameterName)
 	}, it->second);
 }
 
+void KinectDevice::UpdateServices()
+{
+	UpdateFrameSharing();
+	UpdateNetworkSender();
+	UpdateReplayBuffer();
+}
+
 void KinectDevice::SetEnabledSources(SourceFlags sourceFlags)
 {
 	if (m_deviceSources == sourceFlags)
@@ -233,6 +626,27 @@ const std::string& KinectDevice::GetUniqueName() const
 	return m_uniqueName;
 }
 
+bool KinectDevice::HasReplayBuffer() const
+{
+	std::lock_guard<std::mutex> lock(m_frameSubscriberLock);
+	return m_replayBuffer != nullptr;
+}
+
+bool KinectDevice::IsRecording() const
+{
+	std::lock_guard<std::mutex> lock(m_frameSubscriberLock);
+	return m_recorder != nullptr;
+}
+
+bool KinectDevice::SaveReplayBuffer(const std::string& filePath)
+{
+	std::lock_guard<std::mutex> lock(m_frameSubscriberLock);
+	if (!m_replayBuffer)
+		throw std::runtime_error("replay buffer is disabled");
+
+	return m_replayBuffer->Save(filePath, m_uniqueName);
+}
+
 void KinectDevice::SetDefaultValues(obs_data_t* settings) const
 {
 	for (auto&& [parameterName, parameterData] : m_parameters)
@@ -261,36 +675,89 @@ void KinectDevice::SetDefaultValues(obs_data_t* settings) const
 	}
 }
 
+void KinectDevice::SetServiceSettings(const ServiceSettings& serviceSettings)
+{
+	m_serviceSettings = serviceSettings;
+	UpdateServices();
+}
+
 void KinectDevice::StartCapture()
 {
+	CancelIdleRelease();
+
 	if (m_running)
-		return;
+		return; //< device has been kept alive
 
-	std::mutex mutex;
-	std::condition_variable cv;
+	// The new device thread has to receive enabled sources, even if they didn't change since the last one
+	{
+		std::lock_guard<std::mutex> lock(m_deviceSourceLock);
+		m_deviceSourceUpdated = false;
+	}
 
+	// Opening the device may take a while (up to a few seconds), this is done on the device thread to not stall OBS
+	m_captureState = CaptureState::Starting;
 	m_running = true;
+	m_thread = std::thread(&KinectDevice::CaptureThreadFunc, this);
+}
 
-	std::exception_ptr exceptionPtr;
-
-	std::unique_lock<std::mutex> lock(mutex);
-	m_thread = std::thread([&] { ThreadFunc(cv, mutex, exceptionPtr); });
-
-	// Wait until thread has been activated
-	cv.wait(lock);
+void KinectDevice::StartRecording(const std::string& filePath)
+{
+	auto recorder = std::make_unique<KinectRecorder>(filePath, m_uniqueName);
+	SwapFrameSubscriber(m_recorder, recorder);
 
-	if (exceptionPtr)
-		std::rethrow_exception(exceptionPtr);
+	// Previous recording (if any) is finished outside of the lock
+	recorder.reset();
 }
 
 void KinectDevice::StopCapture()
+{
+	// Derived classes stop capture before destroying their handles, the device must not be released concurrently
+	CancelIdleRelease();
+	StopCaptureThread();
+}
+
+void KinectDevice::StopCaptureThread()
 {
 	if (!m_running)
 		return;
 
 	m_running = false;
 	m_thread.join();
+	m_captureState = CaptureState::Stopped;
+
+	std::lock_guard<std::mutex> lock(m_lastFrameLock);
 	m_lastFrame.reset();
+	m_lastDownscaledFrames.clear();
+}
+
+template<typename T>
+void KinectDevice::SwapFrameSubscriber(std::unique_ptr<T>& subscriber, std::unique_ptr<T>& newSubscriber)
+{
+	std::lock_guard<std::mutex> lock(m_frameSubscriberLock);
+	if (subscriber)
+		m_frameSubscribers.erase(std::find(m_frameSubscribers.begin(), m_frameSubscribers.end(), subscriber.get()));
+
+	std::swap(subscriber, newSubscriber);
+
+	if (subscriber)
+		m_frameSubscribers.push_back(subscriber.get());
+
+	m_hasFrameSubscribers = !m_frameSubscribers.empty();
+}
+
+void KinectDevice::StopRecording()
+{
+	std::unique_ptr<KinectRecorder> recorder;
+	SwapFrameSubscriber(m_recorder, recorder);
+
+	// Recorder flushes pending frames on destruction, don't block the device thread meanwhile
+	recorder.reset();
+}
+
+auto KinectDevice::GetOutputSize() const -> OutputSize
+{
+	std::lock_guard<std::mutex> lock(m_deviceSourceLock);
+	return m_outputSize;
 }
 
 std::optional<SourceFlags> KinectDevice::GetSourceFlagsUpdate()
@@ -305,11 +772,27 @@ std::optional<SourceFlags> KinectDevice::GetSourceFlagsUpdate()
 	return {};
 }
 
+bool KinectDevice::IsFrameNeeded(std::uint64_t timestamp)
+{
+	// Recordings, replay buffers and frames sent to other processes/computers (whose frame rate isn't known) need every frame
+	if (m_hasFrameSubscribers.load(std::memory_order_relaxed))
+		return true;
+
+	// Accesses decimate frames using their timestamp (see KinectDeviceAccess::GetLastFrame), use the same one so both agree on which frames to keep
+	return AcceptFrame(timestamp, m_maxFrameRate, m_nextFrameTime);
+}
+
 bool KinectDevice::IsRunning() const
 {
 	return m_running;
 }
 
+void KinectDevice::NotifyCaptureStarted()
+{
+	CaptureState expectedState = CaptureState::Starting;
+	m_captureState.compare_exchange_strong(expectedState, CaptureState::Running);
+}
+
 void KinectDevice::RegisterBoolParameter(std::string parameterName, bool defaultValue, std::function<bool(bool, bool)> combinator)
 {
 	BoolParameter parameter;
@@ -364,9 +847,63 @@ void KinectDevice::TriggerSourceFlagsUpdate()
 
 void KinectDevice::UpdateFrame(KinectFramePtr kinectFrame)
 {
+	kinectFrame->frameIndex = m_frameIndex++;
+	if (kinectFrame->timestamp == 0)
+		kinectFrame->timestamp = os_gettime_ns();
+
+	{
+		std::lock_guard<std::mutex> lock(m_frameSubscriberLock);
+		for (KinectFrameSubscriber* subscriber : m_frameSubscribers)
+			subscriber->OnFrame(kinectFrame);
+	}
+
+	// Downscale the frame once for each factor accesses need, rather than once per access on the graphics thread
+	std::vector<OutputSize> accessOutputSizes;
+	{
+		std::lock_guard<std::mutex> lock(m_deviceSourceLock);
+		accessOutputSizes = m_accessOutputSizes;
+	}
+
+	std::vector<std::pair<std::uint32_t, KinectFrameConstPtr>> downscaledFrames;
+	for (const OutputSize& outputSize : accessOutputSizes)
+	{
+		std::uint32_t factor = KinectFrameDownscaler::ComputeFactor(*kinectFrame, outputSize.width, outputSize.height);
+		if (factor < 2 || std::any_of(downscaledFrames.begin(), downscaledFrames.end(), [&](const auto& pair) { return pair.first == factor; }))
+			continue;
+
+		KinectFrameConstPtr downscaledFrame = m_frameDownscaler->Downscale(kinectFrame, factor);
+		if (downscaledFrame != kinectFrame)
+			downscaledFrames.emplace_back(factor, std::move(downscaledFrame));
+	}
+
 	std::lock_guard<std::mutex> lock(m_lastFrameLock);
 	m_lastFrame = std::move(kinectFrame);
-	m_lastFrame->frameIndex = m_frameIndex++;
+	m_lastDownscaledFrames = std::move(downscaledFrames);
+}
+
+bool KinectDevice::AcceptFrame(std::uint64_t timestamp, std::uint32_t maxFrameRate, std::uint64_t& nextFrameTime)
+{
+	// Frames without a known capture time can't be decimated
+	if (maxFrameRate == 0 || timestamp == 0)
+		return true;
+
+	// Frames come with some jitter, accept them a bit early so decimating 30 fps to 15 fps keeps every other frame
+	// (next frame time may also be too far away if the frame rate or timestamp origin changed)
+	std::uint64_t frameInterval = 1'000'000'000ULL / maxFrameRate;
+	if (timestamp + frameInterval / 4 < nextFrameTime && nextFrameTime <= timestamp + frameInterval)
+		return false;
+
+	// Keep a steady cadence (decimating 15 fps to 10 fps shouldn't give 7.5 fps) unless we fell more than a frame behind
+	if (nextFrameTime + frameInterval > timestamp && nextFrameTime <= timestamp + frameInterval)
+		nextFrameTime += frameInterval;
+	else
+		nextFrameTime = timestamp + frameInterval;
+
+	return true;
+}
+
+void KinectDevice::CloseDevice()
+{
 }
 
 void KinectDevice::HandleBoolParameterUpdate(const std::string& /*parameterName*/, bool /*value*/)
@@ -380,3 +917,7 @@ void KinectDevice::HandleDoubleParameterUpdate(const std::string& /*parameterNam
 void KinectDevice::HandleIntParameterUpdate(const std::string& /*parameterName*/, long long /*value*/)
 {
 }
+
+void KinectDevice::OpenDevice()
+{
+}
@@ -38,6 +38,12 @@ KinectDeviceAccess::~KinectDeviceAccess()
 		m_owner->ReleaseAccess(m_data);
 }
 
+const std::shared_ptr<KinectDerivedDataCache>& KinectDeviceAccess::GetDerivedDataCache() const
+{
+	assert(m_owner);
+	return m_owner->GetDerivedDataCache();
+}
+
 const KinectDevice& KinectDeviceAccess::GetDevice() const
 {
 	assert(m_owner);
@@ -52,7 +58,21 @@ SourceFlags KinectDeviceAccess::GetEnabledSourceFlags() const
 KinectFrameConstPtr KinectDeviceAccess::GetLastFrame()
 {
 	assert(m_owner);
-	return m_owner->GetLastFrame();
+	KinectFrameConstPtr frame = m_owner->GetLastOutputFrame(m_data->outputSize);
+	if (!frame)
+		return frame;
+
+	if (m_data->outputFrame && m_data->outputFrame->frameIndex == frame->frameIndex)
+		return m_data->outputFrame;
+
+	// Keep giving the previous frame until a new one is due, sources skip frames they already processed
+	bool isFrameDue = KinectDevice::AcceptFrame(frame->timestamp, m_data->maxFrameRate, m_data->nextFrameTime);
+	if (!isFrameDue && m_data->outputFrame)
+		return m_data->outputFrame;
+
+	m_data->outputFrame = std::move(frame);
+
+	return m_data->outputFrame;
 }
 
 void KinectDeviceAccess::SetEnabledSourceFlags(SourceFlags enabledSources)
@@ -61,6 +81,32 @@ void KinectDeviceAccess::SetEnabledSourceFlags(SourceFlags enabledSources)
 	m_owner->UpdateEnabledSources();
 }
 
+void KinectDeviceAccess::SetIdleReleaseDelay(std::uint64_t delay)
+{
+	m_data->idleReleaseDelay = delay;
+	m_owner->UpdateIdleReleaseDelay();
+}
+
+void KinectDeviceAccess::SetMaxFrameRate(std::uint32_t frameRate)
+{
+	m_data->maxFrameRate = frameRate;
+	m_owner->UpdateMaxFrameRate();
+}
+
+void KinectDeviceAccess::SetKeepAliveDelay(std::uint64_t delay)
+{
+	m_data->keepAliveDelay = delay;
+	m_owner->UpdateKeepAliveDelay();
+}
+
+void KinectDeviceAccess::SetOutputSize(std::uint32_t width, std::uint32_t height)
+{
+	m_data->outputSize.width = width;
+	m_data->outputSize.height = height;
+	m_data->outputFrame.reset();
+	m_owner->UpdateOutputSize();
+}
+
 void KinectDeviceAccess::UpdateDeviceParameters(obs_data_t* settings)
 {
 	m_owner->UpdateDeviceParameters(m_data, settings);
@@ -0,0 +1,435 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include <obs-kinect-core/KinectFrameCodec.hpp>
+#include <obs-kinect-core/KinectRecordingFormat.hpp>
+#include <obs-kinect-core/WorkerPool.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareSampling.hpp>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+namespace
+{
+	using KinectRecordingFormat::StreamType;
+
+	enum class StreamCodec : std::uint32_t
+	{
+		Raw = 0,
+		Plane = 1, //< PlaneCodec
+		Yuv420 = 2
+	};
+
+	struct FrameHeader
+	{
+		std::uint32_t streamCount;
+		std::uint32_t reserved;
+		std::uint64_t frameIndex;
+		std::uint64_t timestamp;
+	};
+
+	struct StreamHeader
+	{
+		StreamType type;
+		StreamCodec codec;
+		std::uint32_t format;
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint32_t pitch;
+		std::uint64_t payloadSize;
+	};
+
+	static_assert(sizeof(FrameHeader) == 24);
+	static_assert(sizeof(StreamHeader) == 32);
+
+	constexpr std::uint32_t MaxDimension = 16384;
+
+	std::uint8_t ClampByte(int value)
+	{
+		return static_cast<std::uint8_t>(std::clamp(value, 0, 255));
+	}
+
+	std::size_t GetYuv420Size(std::uint32_t width, std::uint32_t height)
+	{
+		std::size_t chromaSize = std::size_t((width + 1) / 2) * ((height + 1) / 2);
+		return std::size_t(width) * height + chromaSize * 2;
+	}
+}
+
+KinectFrameCodec::KinectFrameCodec(WorkerPool* workerPool) :
+m_planeCodec(workerPool),
+m_workerPool(workerPool)
+{
+}
+
+KinectFramePtr KinectFrameCodec::Decode(const std::uint8_t* input, std::size_t inputSize)
+{
+	if (inputSize < sizeof(FrameHeader))
+		throw std::runtime_error("truncated frame");
+
+	FrameHeader frameHeader;
+	std::memcpy(&frameHeader, input, sizeof(frameHeader));
+
+	if (frameHeader.streamCount > std::size_t(StreamType::Count))
+		throw std::runtime_error("invalid stream count");
+
+	std::size_t offset = sizeof(FrameHeader) + frameHeader.streamCount * sizeof(StreamHeader);
+	if (inputSize < offset)
+		throw std::runtime_error("truncated frame");
+
+	KinectFramePtr framePtr = std::make_shared<KinectFrame>();
+	framePtr->frameIndex = frameHeader.frameIndex;
+	framePtr->timestamp = frameHeader.timestamp;
+
+	for (std::uint32_t i = 0; i < frameHeader.streamCount; ++i)
+	{
+		StreamHeader stream;
+		std::memcpy(&stream, input + sizeof(FrameHeader) + i * sizeof(StreamHeader), sizeof(stream));
+
+		if (stream.payloadSize > inputSize - offset)
+			throw std::runtime_error("truncated stream payload");
+
+		if (stream.width == 0 || stream.height == 0 || stream.width > MaxDimension || stream.height > MaxDimension)
+			throw std::runtime_error("invalid stream size");
+
+		const std::uint8_t* payload = input + offset;
+		std::size_t payloadSize = static_cast<std::size_t>(stream.payloadSize);
+		offset += payloadSize;
+
+		auto FillFrameData = [&](auto& frameData) -> auto&
+		{
+			using T = std::remove_pointer_t<decltype(frameData->ptr.get())>;
+
+			auto& data = frameData.emplace();
+			data.width = stream.width;
+			data.height = stream.height;
+
+			switch (stream.codec)
+			{
+				case StreamCodec::Raw:
+				{
+					if (stream.pitch < stream.width * sizeof(T) || payloadSize != std::size_t(stream.pitch) * stream.height)
+						throw std::runtime_error("invalid raw stream size");
+
+					data.pitch = stream.pitch;
+					data.memory.assign(payload, payload + payloadSize);
+					break;
+				}
+
+				case StreamCodec::Plane:
+				{
+					PlaneCodec::PlaneInfo planeInfo = PlaneCodec::ReadPlaneInfo(payload, payloadSize);
+					if (planeInfo.width != stream.width || planeInfo.height != stream.height || planeInfo.temporal)
+						throw std::runtime_error("plane doesn't match stream");
+
+					data.pitch = static_cast<std::uint32_t>(stream.width * sizeof(T));
+					data.memory.resize(std::size_t(data.pitch) * data.height);
+
+					if constexpr (std::is_same_v<T, std::uint16_t>)
+					{
+						if (planeInfo.type != PlaneCodecType::Rvl16)
+							throw std::runtime_error("unexpected plane type");
+
+						m_planeCodec.DecodeDepth(payload, payloadSize, reinterpret_cast<std::uint16_t*>(data.memory.data()), data.pitch);
+					}
+					else if constexpr (std::is_same_v<T, std::uint8_t>)
+					{
+						if (planeInfo.type != PlaneCodecType::Rle8)
+							throw std::runtime_error("unexpected plane type");
+
+						m_planeCodec.DecodeBodyIndex(payload, payloadSize, data.memory.data(), data.pitch);
+					}
+					else
+						throw std::runtime_error("unexpected plane stream");
+
+					break;
+				}
+
+				case StreamCodec::Yuv420:
+				{
+					if constexpr (std::is_same_v<T, std::uint8_t>)
+					{
+						if (stream.type != StreamType::Color || (stream.format != GS_RGBA && stream.format != GS_BGRA))
+							throw std::runtime_error("unexpected yuv stream");
+
+						if (payloadSize != GetYuv420Size(stream.width, stream.height))
+							throw std::runtime_error("invalid yuv stream size");
+
+						data.pitch = stream.width * 4;
+						data.memory.resize(std::size_t(data.pitch) * data.height);
+
+						DecodeYuv420(payload, data.memory.data(), data.pitch, stream.width, stream.height, stream.format == GS_BGRA);
+					}
+					else
+						throw std::runtime_error("unexpected yuv stream");
+
+					break;
+				}
+
+				default:
+					throw std::runtime_error("unknown stream codec " + std::to_string(std::uint32_t(stream.codec)));
+			}
+
+			data.ptr.reset(reinterpret_cast<T*>(data.memory.data()));
+
+			return data;
+		};
+
+		switch (stream.type)
+		{
+			case StreamType::BackgroundRemoval: FillFrameData(framePtr->backgroundRemovalFrame); break;
+			case StreamType::BodyIndex:         FillFrameData(framePtr->bodyIndexFrame); break;
+			case StreamType::Color:             FillFrameData(framePtr->colorFrame).format = static_cast<gs_color_format>(stream.format); break;
+			case StreamType::ColorMappedBody:   FillFrameData(framePtr->colorMappedBodyFrame); break;
+			case StreamType::ColorMappedDepth:  FillFrameData(framePtr->colorMappedDepthFrame); break;
+			case StreamType::Depth:             FillFrameData(framePtr->depthFrame); break;
+			case StreamType::DepthMapping:      FillFrameData(framePtr->depthMappingFrame); break;
+			case StreamType::Infrared:          FillFrameData(framePtr->infraredFrame); break;
+
+			default:
+				throw std::runtime_error("unknown stream type " + std::to_string(std::uint32_t(stream.type)));
+		}
+	}
+
+	return framePtr;
+}
+
+void KinectFrameCodec::Encode(const KinectFrame& frame, SourceFlags enabledSources, std::vector<std::uint8_t>& output)
+{
+	std::array<StreamHeader, std::size_t(StreamType::Count)> streams;
+
+	FrameHeader frameHeader = {};
+	frameHeader.frameIndex = frame.frameIndex;
+	frameHeader.timestamp = frame.timestamp;
+
+	// Stream headers are filled as payloads get appended
+	output.resize(sizeof(FrameHeader) + std::size_t(StreamType::Count) * sizeof(StreamHeader));
+	std::size_t payloadOffset = output.size();
+
+	auto AppendPayload = [&](const std::uint8_t* data, std::size_t size)
+	{
+		output.resize(payloadOffset + size);
+		std::memcpy(output.data() + payloadOffset, data, size);
+		payloadOffset += size;
+	};
+
+	auto AddStream = [&](StreamType type, const auto& frameData, std::uint32_t format)
+	{
+		if (!frameData || !frameData->ptr || (enabledSources & KinectRecordingFormat::ToSourceFlag(type)) == 0)
+			return;
+
+		using T = std::remove_pointer_t<decltype(frameData->ptr.get())>;
+
+		StreamHeader& stream = streams[frameHeader.streamCount++];
+		stream.type = type;
+		stream.format = format;
+		stream.width = frameData->width;
+		stream.height = frameData->height;
+		stream.pitch = frameData->pitch;
+
+		std::size_t streamOffset = payloadOffset;
+		const std::uint8_t* data = reinterpret_cast<const std::uint8_t*>(frameData->ptr.get());
+
+		if constexpr (std::is_same_v<T, std::uint16_t>)
+		{
+			stream.codec = StreamCodec::Plane;
+			m_planeCodec.EncodeDepth(frameData->ptr.get(), frameData->pitch, frameData->width, frameData->height, m_planeBuffer);
+			AppendPayload(m_planeBuffer.data(), m_planeBuffer.size());
+		}
+		else if (type == StreamType::Color)
+		{
+			if (format == GS_RGBA || format == GS_BGRA)
+			{
+				stream.codec = StreamCodec::Yuv420;
+				output.resize(payloadOffset + GetYuv420Size(frameData->width, frameData->height));
+				EncodeYuv420(data, frameData->pitch, frameData->width, frameData->height, format == GS_BGRA, output.data() + payloadOffset);
+				payloadOffset = output.size();
+			}
+			else
+			{
+				stream.codec = StreamCodec::Raw;
+				AppendPayload(data, std::size_t(frameData->pitch) * frameData->height);
+			}
+		}
+		else if constexpr (std::is_same_v<T, std::uint8_t>)
+		{
+			stream.codec = StreamCodec::Plane;
+			m_planeCodec.EncodeBodyIndex(frameData->ptr.get(), frameData->pitch, frameData->width, frameData->height, m_planeBuffer);
+			AppendPayload(m_planeBuffer.data(), m_planeBuffer.size());
+		}
+		else
+		{
+			stream.codec = StreamCodec::Raw;
+			AppendPayload(data, std::size_t(frameData->pitch) * frameData->height);
+		}
+
+		stream.payloadSize = payloadOffset - streamOffset;
+	};
+
+	AddStream(StreamType::BackgroundRemoval, frame.backgroundRemovalFrame, 0);
+	AddStream(StreamType::BodyIndex, frame.bodyIndexFrame, 0);
+	AddStream(StreamType::Color, frame.colorFrame, (frame.colorFrame) ? std::uint32_t(frame.colorFrame->format) : 0);
+	AddStream(StreamType::ColorMappedBody, frame.colorMappedBodyFrame, 0);
+	AddStream(StreamType::ColorMappedDepth, frame.colorMappedDepthFrame, 0);
+	AddStream(StreamType::Depth, frame.depthFrame, 0);
+	AddStream(StreamType::DepthMapping, frame.depthMappingFrame, 0);
+	AddStream(StreamType::Infrared, frame.infraredFrame, 0);
+
+	// Remove unused stream header space
+	std::size_t headerSize = sizeof(FrameHeader) + frameHeader.streamCount * sizeof(StreamHeader);
+	std::size_t reservedHeaderSize = sizeof(FrameHeader) + std::size_t(StreamType::Count) * sizeof(StreamHeader);
+	output.erase(output.begin() + headerSize, output.begin() + reservedHeaderSize);
+
+	std::memcpy(output.data(), &frameHeader, sizeof(frameHeader));
+	std::memcpy(output.data() + sizeof(FrameHeader), streams.data(), frameHeader.streamCount * sizeof(StreamHeader));
+}
+
+std::uint64_t KinectFrameCodec::ComputeRawSize(const KinectFrame& frame)
+{
+	std::uint64_t size = 0;
+	auto AddSize = [&](const auto& frameData)
+	{
+		if (frameData && frameData->ptr)
+			size += std::uint64_t(frameData->pitch) * frameData->height;
+	};
+
+	AddSize(frame.backgroundRemovalFrame);
+	AddSize(frame.bodyIndexFrame);
+	AddSize(frame.colorFrame);
+	AddSize(frame.colorMappedBodyFrame);
+	AddSize(frame.colorMappedDepthFrame);
+	AddSize(frame.depthFrame);
+	AddSize(frame.depthMappingFrame);
+	AddSize(frame.infraredFrame);
+
+	return size;
+}
+
+void KinectFrameCodec::DecodeYuv420(const std::uint8_t* input, std::uint8_t* output, std::uint32_t outputPitch, std::uint32_t width, std::uint32_t height, bool bgra)
+{
+	std::uint32_t chromaWidth = (width + 1) / 2;
+	std::uint32_t chromaHeight = (height + 1) / 2;
+
+	const std::uint8_t* lumaPlane = input;
+	const std::uint8_t* cbPlane = lumaPlane + std::size_t(width) * height;
+	const std::uint8_t* crPlane = cbPlane + std::size_t(chromaWidth) * chromaHeight;
+
+	std::uint32_t redShift = (bgra) ? 16 : 0;
+	std::uint32_t blueShift = (bgra) ? 0 : 16;
+
+	// Full range BT.601 in 8.8 fixed point, each chroma row covers two luma rows
+	ForEachRowBand(m_workerPool, chromaHeight, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t chromaY = begin; chromaY < end; ++chromaY)
+		{
+			const std::uint8_t* cbRow = cbPlane + std::size_t(chromaY) * chromaWidth;
+			const std::uint8_t* crRow = crPlane + std::size_t(chromaY) * chromaWidth;
+
+			std::uint32_t lastY = std::min(chromaY * 2 + 2, height);
+			for (std::uint32_t y = chromaY * 2; y < lastY; ++y)
+			{
+				const std::uint8_t* lumaRow = lumaPlane + std::size_t(y) * width;
+				std::uint8_t* outputRow = output + std::size_t(y) * outputPitch;
+
+				for (std::uint32_t chromaX = 0; chromaX < chromaWidth; ++chromaX)
+				{
+					int cb = cbRow[chromaX] - 128;
+					int cr = crRow[chromaX] - 128;
+
+					// Computed once for both pixels sharing this chroma sample
+					int redOffset = 359 * cr + 128;
+					int greenOffset = -88 * cb - 183 * cr + 128;
+					int blueOffset = 454 * cb + 128;
+
+					std::uint32_t lastX = std::min(chromaX * 2 + 2, width);
+					for (std::uint32_t x = chromaX * 2; x < lastX; ++x)
+					{
+						int luma = lumaRow[x] << 8;
+
+						std::uint32_t red = ClampByte((luma + redOffset) >> 8);
+						std::uint32_t green = ClampByte((luma + greenOffset) >> 8);
+						std::uint32_t blue = ClampByte((luma + blueOffset) >> 8);
+
+						// Whole pixel is written at once (little endian)
+						std::uint32_t pixel = (red << redShift) | (green << 8) | (blue << blueShift) | 0xFF000000;
+						std::memcpy(&outputRow[x * 4], &pixel, sizeof(pixel));
+					}
+				}
+			}
+		}
+	});
+}
+
+void KinectFrameCodec::EncodeYuv420(const std::uint8_t* input, std::uint32_t inputPitch, std::uint32_t width, std::uint32_t height, bool bgra, std::uint8_t* output)
+{
+	std::uint32_t chromaWidth = (width + 1) / 2;
+	std::uint32_t chromaHeight = (height + 1) / 2;
+
+	std::uint8_t* lumaPlane = output;
+	std::uint8_t* cbPlane = lumaPlane + std::size_t(width) * height;
+	std::uint8_t* crPlane = cbPlane + std::size_t(chromaWidth) * chromaHeight;
+
+	std::size_t redIndex = (bgra) ? 2 : 0;
+	std::size_t blueIndex = (bgra) ? 0 : 2;
+
+	ForEachRowBand(m_workerPool, chromaHeight, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t chromaY = begin; chromaY < end; ++chromaY)
+		{
+			// Last row and column are duplicated for odd sizes
+			std::uint32_t firstY = chromaY * 2;
+			std::uint32_t secondY = std::min(firstY + 1, height - 1);
+
+			const std::uint8_t* inputRows[2] = { input + std::size_t(firstY) * inputPitch, input + std::size_t(secondY) * inputPitch };
+			std::uint8_t* lumaRows[2] = { lumaPlane + std::size_t(firstY) * width, lumaPlane + std::size_t(secondY) * width };
+			std::uint8_t* cbRow = cbPlane + std::size_t(chromaY) * chromaWidth;
+			std::uint8_t* crRow = crPlane + std::size_t(chromaY) * chromaWidth;
+
+			for (std::uint32_t chromaX = 0; chromaX < chromaWidth; ++chromaX)
+			{
+				std::uint32_t columns[2] = { chromaX * 2, std::min(chromaX * 2 + 1, width - 1) };
+
+				int redSum = 0;
+				int greenSum = 0;
+				int blueSum = 0;
+				for (std::size_t row = 0; row < 2; ++row)
+				{
+					for (std::uint32_t x : columns)
+					{
+						const std::uint8_t* pixel = &inputRows[row][x * 4];
+						int red = pixel[redIndex];
+						int green = pixel[1];
+						int blue = pixel[blueIndex];
+
+						lumaRows[row][x] = static_cast<std::uint8_t>((77 * red + 150 * green + 29 * blue + 128) >> 8);
+
+						redSum += red;
+						greenSum += green;
+						blueSum += blue;
+					}
+				}
+
+				// Sums of four pixels, rounded average is folded in the final shift
+				cbRow[chromaX] = ClampByte(((-43 * redSum - 85 * greenSum + 128 * blueSum + 512) >> 10) + 128);
+				crRow[chromaX] = ClampByte(((128 * redSum - 107 * greenSum - 21 * blueSum + 512) >> 10) + 128);
+			}
+		}
+	});
+}
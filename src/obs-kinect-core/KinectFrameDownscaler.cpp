@@ -0,0 +1,218 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect-core/KinectFrameDownscaler.hpp>
+#include <obs-kinect-core/SimdHelper.hpp>
+#include <obs-kinect-core/WorkerPool.hpp>
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+	// Only 8 bits per channel formats can be averaged
+	bool CanDownscale(gs_color_format format)
+	{
+		switch (format)
+		{
+			case GS_BGRA:
+			case GS_BGRX:
+			case GS_RGBA:
+				return true;
+
+			default:
+				return false;
+		}
+	}
+
+	void AccumulateRow(const std::uint8_t* input, std::uint16_t* sums, std::size_t count)
+	{
+		std::size_t i = 0;
+#if OBSKINECT_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&input[i]));
+			__m128i lowSums = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&sums[i]));
+			__m128i highSums = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&sums[i + 8]));
+
+			lowSums = _mm_add_epi16(lowSums, _mm_unpacklo_epi8(values, zero));
+			highSums = _mm_add_epi16(highSums, _mm_unpackhi_epi8(values, zero));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&sums[i]), lowSums);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&sums[i + 8]), highSums);
+		}
+#endif
+
+		for (; i < count; ++i)
+			sums[i] += input[i];
+	}
+
+	// Box filter: input rows of each output row are summed per column (16 bits, SSE2) then columns are summed per output pixel
+	template<std::uint32_t ChannelCount>
+	void BoxFilter(WorkerPool& workerPool, const std::uint8_t* input, std::uint32_t inputPitch, std::uint8_t* output, std::uint32_t outputPitch, std::uint32_t outputWidth, std::uint32_t outputHeight, std::uint32_t factor)
+	{
+		const std::uint32_t sampleCount = factor * factor;
+		const std::uint64_t reciprocal = ((std::uint64_t(1) << 40) + sampleCount - 1) / sampleCount; //< exact division of sums below 2^40 / sampleCount
+
+		workerPool.ParallelFor(outputHeight, [&](std::uint32_t begin, std::uint32_t end)
+		{
+			std::vector<std::uint16_t> columnSums(std::size_t(outputWidth) * factor * ChannelCount);
+
+			for (std::uint32_t y = begin; y < end; ++y)
+			{
+				std::fill(columnSums.begin(), columnSums.end(), std::uint16_t(0));
+				for (std::uint32_t dy = 0; dy < factor; ++dy)
+					AccumulateRow(&input[std::size_t(y * factor + dy) * inputPitch], columnSums.data(), columnSums.size());
+
+				const std::uint16_t* columnSum = columnSums.data();
+				std::uint8_t* outputPixel = &output[std::size_t(y) * outputPitch];
+				for (std::uint32_t x = 0; x < outputWidth; ++x)
+				{
+					std::uint32_t sums[ChannelCount] = {};
+					for (std::uint32_t dx = 0; dx < factor; ++dx)
+					{
+						for (std::uint32_t channel = 0; channel < ChannelCount; ++channel)
+							sums[channel] += columnSum[channel];
+
+						columnSum += ChannelCount;
+					}
+
+					for (std::uint32_t channel = 0; channel < ChannelCount; ++channel)
+						*outputPixel++ = static_cast<std::uint8_t>((std::uint64_t(sums[channel] + sampleCount / 2) * reciprocal) >> 40);
+				}
+			}
+		});
+	}
+
+	template<std::uint32_t ChannelCount, typename T>
+	T BoxFilterFrame(WorkerPool& workerPool, const T& frameData, std::uint32_t factor)
+	{
+		T outputFrame;
+		outputFrame.width = frameData.width / factor;
+		outputFrame.height = frameData.height / factor;
+		outputFrame.pitch = outputFrame.width * ChannelCount;
+		outputFrame.memory.resize(std::size_t(outputFrame.pitch) * outputFrame.height);
+		outputFrame.ptr.reset(outputFrame.memory.data());
+
+		BoxFilter<ChannelCount>(workerPool, frameData.ptr.get(), frameData.pitch, outputFrame.ptr.get(), outputFrame.pitch, outputFrame.width, outputFrame.height, factor);
+
+		return outputFrame;
+	}
+
+	// Depth, body indices and depth coordinates can't be averaged, keep the value at the center of each block
+	template<typename T>
+	T PointSampleFrame(const T& frameData, std::uint32_t factor)
+	{
+		using Value = std::remove_extent_t<typename decltype(frameData.ptr)::element_type>;
+
+		T outputFrame;
+		outputFrame.width = frameData.width / factor;
+		outputFrame.height = frameData.height / factor;
+		outputFrame.pitch = outputFrame.width * sizeof(Value);
+		outputFrame.memory.resize(std::size_t(outputFrame.pitch) * outputFrame.height);
+		outputFrame.ptr.reset(reinterpret_cast<Value*>(outputFrame.memory.data()));
+
+		const std::uint8_t* input = reinterpret_cast<const std::uint8_t*>(frameData.ptr.get());
+		Value* output = outputFrame.ptr.get();
+		for (std::uint32_t y = 0; y < outputFrame.height; ++y)
+		{
+			const Value* inputRow = reinterpret_cast<const Value*>(&input[std::size_t(y * factor + factor / 2) * frameData.pitch]);
+			for (std::uint32_t x = 0; x < outputFrame.width; ++x)
+				*output++ = inputRow[x * factor + factor / 2];
+		}
+
+		return outputFrame;
+	}
+
+	// Frame data pointing to another frame memory (which has to be kept alive through KinectFrame::storage)
+	template<typename T>
+	std::optional<T> ShareFrameData(const std::optional<T>& frameData)
+	{
+		if (!frameData)
+			return std::nullopt;
+
+		T sharedData;
+		sharedData.width = frameData->width;
+		sharedData.height = frameData->height;
+		sharedData.pitch = frameData->pitch;
+		sharedData.ptr.reset(frameData->ptr.get());
+
+		if constexpr (std::is_same_v<T, ColorFrameData>)
+			sharedData.format = frameData->format;
+
+		return sharedData;
+	}
+}
+
+KinectFrameDownscaler::KinectFrameDownscaler(std::shared_ptr<WorkerPool> workerPool) :
+m_workerPool(std::move(workerPool))
+{
+}
+
+KinectFrameConstPtr KinectFrameDownscaler::Downscale(KinectFrameConstPtr frame, std::uint32_t factor) const
+{
+	if (factor < 2 || factor > MaxFactor || !frame->colorFrame || !CanDownscale(frame->colorFrame->format))
+		return frame;
+
+	// Every color space frame has to be downscaled to stay aligned with the color frame
+	const ColorFrameData& colorFrame = *frame->colorFrame;
+	auto IsColorSized = [&](const auto& frameData)
+	{
+		return !frameData || (frameData->width == colorFrame.width && frameData->height == colorFrame.height);
+	};
+
+	if (!IsColorSized(frame->backgroundRemovalFrame) || !IsColorSized(frame->colorMappedBodyFrame) || !IsColorSized(frame->colorMappedDepthFrame) || !IsColorSized(frame->depthMappingFrame))
+		return frame;
+
+	auto outputFrame = std::make_shared<KinectFrame>();
+	if (frame->backgroundRemovalFrame)
+		outputFrame->backgroundRemovalFrame = BoxFilterFrame<1>(*m_workerPool, *frame->backgroundRemovalFrame, factor);
+
+	if (frame->colorMappedBodyFrame)
+		outputFrame->colorMappedBodyFrame = PointSampleFrame(*frame->colorMappedBodyFrame, factor);
+
+	if (frame->colorMappedDepthFrame)
+		outputFrame->colorMappedDepthFrame = PointSampleFrame(*frame->colorMappedDepthFrame, factor);
+
+	if (frame->depthMappingFrame)
+		outputFrame->depthMappingFrame = PointSampleFrame(*frame->depthMappingFrame, factor);
+
+	outputFrame->colorFrame = BoxFilterFrame<4>(*m_workerPool, colorFrame, factor);
+	outputFrame->colorFrame->format = colorFrame.format;
+
+	outputFrame->bodyIndexFrame = ShareFrameData(frame->bodyIndexFrame);
+	outputFrame->depthFrame = ShareFrameData(frame->depthFrame);
+	outputFrame->infraredFrame = ShareFrameData(frame->infraredFrame);
+	outputFrame->frameIndex = frame->frameIndex;
+	outputFrame->timestamp = frame->timestamp;
+	outputFrame->storage = std::move(frame);
+
+	return outputFrame;
+}
+
+std::uint32_t KinectFrameDownscaler::ComputeFactor(const KinectFrame& frame, std::uint32_t outputWidth, std::uint32_t outputHeight)
+{
+	if (!frame.colorFrame || outputWidth == 0 || outputHeight == 0)
+		return 1;
+
+	// Frame is scaled to fit in the output size, don't go below the size it's rendered at
+	const ColorFrameData& colorFrame = *frame.colorFrame;
+	std::uint32_t factor = std::max(colorFrame.width / outputWidth, colorFrame.height / outputHeight);
+
+	return std::clamp<std::uint32_t>(factor, 1, MaxFactor);
+}
@@ -0,0 +1,426 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include <obs-kinect-core/KinectNetworkReceiver.hpp>
+#include <obs-kinect-core/KinectFrameCodec.hpp>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+using namespace KinectNetworkFormat;
+
+namespace
+{
+	constexpr std::uint64_t ClockOffsetLifetime = 10'000'000'000; //< ns, after which a worse ping is accepted
+
+	HelloMessage ReceiveHello(TcpSocket& socket)
+	{
+		MessageHeader header;
+		HelloMessage hello;
+		if (!socket.Receive(&header, sizeof(header)) || header.type != MessageType::Hello || header.size != sizeof(HelloMessage) || !socket.Receive(&hello, sizeof(hello)))
+			throw std::runtime_error("no hello message received");
+
+		if (hello.magic != Magic)
+			throw std::runtime_error("not an obs-kinect sender");
+
+		if (hello.version != Version)
+			throw std::runtime_error("unsupported protocol version " + std::to_string(hello.version));
+
+		hello.deviceName[sizeof(hello.deviceName) - 1] = '\0';
+
+		return hello;
+	}
+}
+
+KinectNetworkReceiver::KinectNetworkReceiver(std::string host, std::uint16_t port, std::uint64_t jitterDelay, WorkerPool* workerPool) :
+m_host(std::move(host)),
+m_clockOffset(0),
+m_clockOffsetRoundTrip(0),
+m_clockOffsetTime(0),
+m_enabledSources(0),
+m_jitterDelay(jitterDelay),
+m_connected(false),
+m_running(true),
+m_workerPool(workerPool),
+m_sessionId(0),
+m_port(port)
+{
+	m_decodeThread = std::thread(&KinectNetworkReceiver::DecodeFunc, this);
+	m_receiveThread = std::thread(&KinectNetworkReceiver::ReceiveFunc, this);
+}
+
+KinectNetworkReceiver::~KinectNetworkReceiver()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_running = false;
+		m_pendingCv.notify_all();
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(m_sendLock);
+		m_socket.Shutdown();
+	}
+
+	m_receiveThread.join();
+	m_decodeThread.join();
+}
+
+bool KinectNetworkReceiver::IsConnected() const
+{
+	return m_connected;
+}
+
+auto KinectNetworkReceiver::PopStats() -> Stats
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	Stats stats = m_stats;
+	m_stats = Stats{};
+	m_stats.roundTripTime = stats.roundTripTime;
+
+	return stats;
+}
+
+void KinectNetworkReceiver::SetEnabledSources(SourceFlags enabledSources)
+{
+	if (m_enabledSources.exchange(enabledSources) == enabledSources)
+		return;
+
+	SubscribeMessage subscribe = {};
+	subscribe.enabledSources = enabledSources;
+	SendMessage(MessageType::Subscribe, &subscribe, sizeof(subscribe));
+}
+
+void KinectNetworkReceiver::SetJitterDelay(std::uint64_t jitterDelay)
+{
+	m_jitterDelay = jitterDelay;
+}
+
+KinectFramePtr KinectNetworkReceiver::WaitForFrame(std::uint32_t timeoutMs)
+{
+	std::uint64_t now = os_gettime_ns();
+	std::uint64_t deadline = now + std::uint64_t(timeoutMs) * 1'000'000;
+
+	std::unique_lock<std::mutex> lock(m_lock);
+	for (;;)
+	{
+		if (!m_buffer.empty() && m_buffer.front().playoutTime <= now)
+		{
+			KinectFramePtr frame = std::move(m_buffer.front().frame);
+			m_buffer.pop_front();
+
+			// Timestamp was converted to our clock if the clock offset was known
+			if (frame->timestamp != 0 && now > frame->timestamp)
+			{
+				std::uint64_t latency = now - frame->timestamp;
+				m_stats.latencySum += latency;
+				m_stats.latencyCount++;
+				m_stats.maxLatency = std::max(m_stats.maxLatency, latency);
+			}
+
+			return frame;
+		}
+
+		if (now >= deadline)
+			return nullptr;
+
+		std::uint64_t waitUntil = deadline;
+		if (!m_buffer.empty())
+			waitUntil = std::min(waitUntil, m_buffer.front().playoutTime);
+
+		m_bufferCv.wait_for(lock, std::chrono::nanoseconds(waitUntil - now));
+		now = os_gettime_ns();
+	}
+}
+
+auto KinectNetworkReceiver::Probe(const std::string& host, std::uint16_t port, std::uint32_t timeoutMs) -> ServerInfo
+{
+	TcpSocket socket = TcpSocket::Connect(host, port, timeoutMs);
+	socket.SetReceiveTimeout(timeoutMs);
+
+	HelloMessage hello = ReceiveHello(socket);
+
+	ServerInfo serverInfo;
+	serverInfo.deviceName = hello.deviceName;
+	serverInfo.supportedSources = hello.supportedSources;
+
+	return serverInfo;
+}
+
+void KinectNetworkReceiver::DecodeFunc()
+{
+	os_set_thread_name("KinectNetworkReceiver decode");
+
+	KinectFrameCodec codec(m_workerPool);
+	std::uint64_t nextPing = os_gettime_ns();
+
+	// Arrival time - sender time (including clock offset) of the last frames of the session
+	std::vector<std::int64_t> transitTimes(TransitWindowSize);
+	std::size_t transitIndex = 0;
+	std::uint64_t sessionId = 0;
+
+	for (;;)
+	{
+		std::optional<PendingFrame> pendingFrame;
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+
+			std::uint64_t now = os_gettime_ns();
+			if (now < nextPing)
+				m_pendingCv.wait_for(lock, std::chrono::nanoseconds(nextPing - now), [&] { return !m_running || !m_pendingFrames.empty(); });
+
+			if (!m_running)
+				break;
+
+			if (!m_pendingFrames.empty())
+			{
+				pendingFrame = std::move(m_pendingFrames.front());
+				m_pendingFrames.pop_front();
+			}
+		}
+
+		std::uint64_t now = os_gettime_ns();
+		if (now >= nextPing)
+		{
+			if (m_connected)
+			{
+				PingMessage ping;
+				ping.clientTime = now;
+				SendMessage(MessageType::Ping, &ping, sizeof(ping));
+			}
+
+			nextPing = now + PingInterval;
+		}
+
+		if (!pendingFrame)
+			continue;
+
+		KinectFramePtr frame;
+		try
+		{
+			frame = codec.Decode(pendingFrame->data.data(), pendingFrame->data.size());
+		}
+		catch (const std::exception& e)
+		{
+			warnlog("failed to decode frame: %s", e.what());
+			continue;
+		}
+
+		std::uint64_t decodeTime = os_gettime_ns() - now;
+
+		if (pendingFrame->sessionId != sessionId)
+		{
+			sessionId = pendingFrame->sessionId;
+			transitIndex = 0;
+		}
+
+		// Earliest arrival of this frame according to the recent frames, clock offset cancels out
+		std::uint64_t senderTime = frame->timestamp;
+		transitTimes[transitIndex++ % transitTimes.size()] = static_cast<std::int64_t>(pendingFrame->arrivalTime - senderTime);
+
+		std::size_t transitCount = std::min(transitIndex, transitTimes.size());
+		std::int64_t minTransit = *std::min_element(transitTimes.begin(), transitTimes.begin() + transitCount);
+
+		BufferedFrame bufferedFrame;
+		bufferedFrame.playoutTime = senderTime + static_cast<std::uint64_t>(minTransit) + m_jitterDelay;
+
+		if (m_clockOffsetRoundTrip != 0)
+			frame->timestamp = senderTime - static_cast<std::uint64_t>(m_clockOffset.load());
+		else
+			frame->timestamp = 0;
+
+		std::uint64_t rawSize = KinectFrameCodec::ComputeRawSize(*frame);
+		bufferedFrame.frame = std::move(frame);
+
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_stats.decodeTime += decodeTime;
+		m_stats.rawBytes += rawSize;
+
+		if (m_buffer.size() >= MaxBufferedFrames)
+		{
+			m_buffer.pop_front();
+			m_stats.droppedFrames++;
+		}
+
+		m_buffer.emplace_back(std::move(bufferedFrame));
+		m_bufferCv.notify_one();
+	}
+}
+
+void KinectNetworkReceiver::HandlePong(const std::vector<std::uint8_t>& content)
+{
+	if (content.size() < sizeof(PongMessage))
+		return;
+
+	PongMessage pong;
+	std::memcpy(&pong, content.data(), sizeof(pong));
+
+	std::uint64_t now = os_gettime_ns();
+	if (pong.clientTime > now)
+		return;
+
+	// Assume the pong was sent halfway through the round trip, keep the offset of the fastest recent ping as it is the most accurate
+	std::uint64_t roundTrip = std::max<std::uint64_t>(now - pong.clientTime, 1);
+	std::uint64_t bestRoundTrip = m_clockOffsetRoundTrip;
+	if (bestRoundTrip == 0 || roundTrip <= bestRoundTrip || now - m_clockOffsetTime > ClockOffsetLifetime)
+	{
+		m_clockOffset = static_cast<std::int64_t>(pong.serverTime - (pong.clientTime + roundTrip / 2));
+		m_clockOffsetTime = now;
+		m_clockOffsetRoundTrip = roundTrip;
+		bestRoundTrip = roundTrip;
+	}
+
+	std::unique_lock<std::mutex> lock(m_lock);
+	m_stats.roundTripTime = bestRoundTrip;
+}
+
+void KinectNetworkReceiver::ReceiveFunc()
+{
+	os_set_thread_name("KinectNetworkReceiver receive");
+
+	bool connectionFailed = false;
+	while (m_running)
+	{
+		TcpSocket socket;
+		try
+		{
+			socket = TcpSocket::Connect(m_host, m_port, ConnectTimeout);
+		}
+		catch (const std::exception& e)
+		{
+			// Don't spam the log while the sender is unreachable
+			if (!connectionFailed)
+				warnlog("%s, retrying", e.what());
+
+			connectionFailed = true;
+
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_pendingCv.wait_for(lock, std::chrono::seconds(1), [&] { return !m_running; });
+			continue;
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(m_sendLock);
+			if (!m_running)
+				break;
+
+			m_socket = std::move(socket);
+		}
+
+		try
+		{
+			ReceiveSession();
+			connectionFailed = false;
+		}
+		catch (const std::exception& e)
+		{
+			warnlog("connection to %s:%u failed: %s", m_host.c_str(), unsigned(m_port), e.what());
+			connectionFailed = true;
+		}
+
+		m_connected = false;
+
+		std::unique_lock<std::mutex> lock(m_sendLock);
+		m_socket.Close();
+	}
+}
+
+void KinectNetworkReceiver::ReceiveSession()
+{
+	HelloMessage hello = ReceiveHello(m_socket);
+	infolog("connected to %s (%s:%u)", hello.deviceName, m_host.c_str(), unsigned(m_port));
+
+	m_clockOffsetRoundTrip = 0;
+	m_sessionId++;
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_buffer.clear();
+		m_pendingFrames.clear();
+	}
+
+	m_connected = true;
+
+	SubscribeMessage subscribe = {};
+	subscribe.enabledSources = m_enabledSources;
+	SendMessage(MessageType::Subscribe, &subscribe, sizeof(subscribe));
+
+	std::vector<std::uint8_t> content;
+	for (;;)
+	{
+		MessageHeader header;
+		if (!m_socket.Receive(&header, sizeof(header)))
+			break;
+
+		if (header.size > MaxMessageSize)
+			throw std::runtime_error("message is too big (" + std::to_string(header.size) + " bytes)");
+
+		if (header.type == MessageType::Frame)
+		{
+			PendingFrame pendingFrame;
+			pendingFrame.data.resize(header.size);
+			if (!m_socket.Receive(pendingFrame.data.data(), pendingFrame.data.size()))
+				break;
+
+			pendingFrame.arrivalTime = os_gettime_ns();
+			pendingFrame.sessionId = m_sessionId;
+
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_stats.receivedBytes += sizeof(header) + header.size;
+			m_stats.receivedFrames++;
+
+			// Decoding can't keep up, drop the oldest frame
+			if (m_pendingFrames.size() >= MaxPendingFrames)
+			{
+				m_pendingFrames.pop_front();
+				m_stats.droppedFrames++;
+			}
+
+			m_pendingFrames.emplace_back(std::move(pendingFrame));
+			m_pendingCv.notify_one();
+		}
+		else
+		{
+			content.resize(header.size);
+			if (!m_socket.Receive(content.data(), content.size()))
+				break;
+
+			if (header.type == MessageType::Pong)
+				HandlePong(content);
+		}
+	}
+
+	if (m_running)
+		infolog("disconnected from %s (%s:%u)", hello.deviceName, m_host.c_str(), unsigned(m_port));
+}
+
+bool KinectNetworkReceiver::SendMessage(MessageType type, const void* content, std::size_t size)
+{
+	MessageHeader header;
+	header.type = type;
+	header.size = static_cast<std::uint32_t>(size);
+
+	std::unique_lock<std::mutex> lock(m_sendLock);
+	if (!m_socket.IsValid())
+		return false;
+
+	return m_socket.Send(&header, sizeof(header)) && m_socket.Send(content, size);
+}
@@ -0,0 +1,315 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include <obs-kinect-core/KinectNetworkSender.hpp>
+#include <obs-kinect-core/KinectFrameCodec.hpp>
+#include <obs-kinect-core/KinectNetworkFormat.hpp>
+#include <obs-kinect-core/WorkerPool.hpp>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace KinectNetworkFormat;
+
+struct KinectNetworkSender::Client
+{
+	std::condition_variable cv;
+	std::mutex lock;
+	std::string address;
+	std::thread receiveThread;
+	std::thread sendThread;
+	std::vector<PongMessage> pendingPongs;
+	KinectFrameConstPtr pendingFrame;
+	TcpSocket socket;
+	std::uint64_t droppedFrameCount = 0;
+	std::uint64_t sentBytes = 0;
+	std::uint64_t sentFrameCount = 0;
+	SourceFlags enabledSources = 0;
+	bool running = true;
+};
+
+KinectNetworkSender::KinectNetworkSender(std::uint16_t port, std::string deviceName, SourceFlags supportedSources) :
+m_workerPool(WorkerPool::GetSharedPool()),
+m_deviceName(std::move(deviceName)),
+m_running(true),
+m_supportedSources(supportedSources)
+{
+	m_listenSocket = TcpSocket::Listen(port);
+	m_port = m_listenSocket.GetLocalPort();
+
+	infolog("serving %s frames on port %u", m_deviceName.c_str(), unsigned(m_port));
+
+	m_acceptThread = std::thread(&KinectNetworkSender::AcceptFunc, this);
+}
+
+KinectNetworkSender::~KinectNetworkSender()
+{
+	m_running = false;
+	m_acceptThread.join();
+
+	for (auto& clientPtr : m_clients)
+		StopClient(*clientPtr);
+}
+
+std::uint16_t KinectNetworkSender::GetPort() const
+{
+	return m_port;
+}
+
+void KinectNetworkSender::OnFrame(const KinectFrameConstPtr& frame)
+{
+	Publish(frame);
+}
+
+void KinectNetworkSender::Publish(KinectFrameConstPtr frame)
+{
+	std::unique_lock<std::mutex> lock(m_clientLock);
+	for (auto& clientPtr : m_clients)
+	{
+		Client& client = *clientPtr;
+
+		std::unique_lock<std::mutex> clientLock(client.lock);
+		if (client.pendingFrame)
+			client.droppedFrameCount++; //< previous frame wasn't sent in time
+
+		client.pendingFrame = frame;
+		client.cv.notify_one();
+	}
+}
+
+void KinectNetworkSender::AcceptFunc()
+{
+	os_set_thread_name("KinectNetworkSender");
+
+	while (m_running)
+	{
+		TcpSocket socket;
+		try
+		{
+			socket = m_listenSocket.Accept(AcceptTimeout);
+		}
+		catch (const std::exception& e)
+		{
+			errorlog("failed to accept connection: %s", e.what());
+			os_sleep_ms(AcceptTimeout);
+		}
+
+		std::unique_lock<std::mutex> lock(m_clientLock);
+
+		// Reap disconnected clients
+		for (auto it = m_clients.begin(); it != m_clients.end();)
+		{
+			Client& client = **it;
+
+			bool running;
+			{
+				std::unique_lock<std::mutex> clientLock(client.lock);
+				running = client.running;
+			}
+
+			if (!running)
+			{
+				StopClient(client);
+				it = m_clients.erase(it);
+			}
+			else
+				++it;
+		}
+
+		if (!socket.IsValid())
+			continue;
+
+		auto clientPtr = std::make_unique<Client>();
+		clientPtr->address = socket.GetRemoteAddress();
+		clientPtr->socket = std::move(socket);
+		clientPtr->receiveThread = std::thread(&KinectNetworkSender::ClientReceiveFunc, this, std::ref(*clientPtr));
+		clientPtr->sendThread = std::thread(&KinectNetworkSender::ClientSendFunc, this, std::ref(*clientPtr));
+
+		infolog("%s connected to %s", clientPtr->address.c_str(), m_deviceName.c_str());
+
+		m_clients.emplace_back(std::move(clientPtr));
+	}
+}
+
+void KinectNetworkSender::ClientReceiveFunc(Client& client)
+{
+	os_set_thread_name("KinectNetworkSender client receive");
+
+	// Receivers only send small messages
+	std::vector<std::uint8_t> content;
+
+	for (;;)
+	{
+		MessageHeader header;
+		if (!client.socket.Receive(&header, sizeof(header)))
+			break;
+
+		if (header.size > 4096)
+		{
+			warnlog("%s sent an invalid message (type: %u, size: %u)", client.address.c_str(), unsigned(header.type), unsigned(header.size));
+			break;
+		}
+
+		content.resize(header.size);
+		if (!client.socket.Receive(content.data(), content.size()))
+			break;
+
+		switch (header.type)
+		{
+			case MessageType::Subscribe:
+			{
+				if (content.size() < sizeof(SubscribeMessage))
+					break;
+
+				SubscribeMessage subscribe;
+				std::memcpy(&subscribe, content.data(), sizeof(subscribe));
+
+				std::unique_lock<std::mutex> lock(client.lock);
+				client.enabledSources = subscribe.enabledSources & m_supportedSources;
+				client.cv.notify_one();
+				break;
+			}
+
+			case MessageType::Ping:
+			{
+				if (content.size() < sizeof(PingMessage))
+					break;
+
+				PingMessage ping;
+				std::memcpy(&ping, content.data(), sizeof(ping));
+
+				std::unique_lock<std::mutex> lock(client.lock);
+				client.pendingPongs.push_back({ ping.clientTime, 0 });
+				client.cv.notify_one();
+				break;
+			}
+
+			default:
+				break; //< ignore unknown messages
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(client.lock);
+	client.running = false;
+	client.cv.notify_one();
+}
+
+void KinectNetworkSender::ClientSendFunc(Client& client)
+{
+	os_set_thread_name("KinectNetworkSender client send");
+
+	auto SendMessage = [&](MessageType type, const void* content, std::size_t size)
+	{
+		MessageHeader header;
+		header.type = type;
+		header.size = static_cast<std::uint32_t>(size);
+
+		if (!client.socket.Send(&header, sizeof(header)) || !client.socket.Send(content, size))
+			return false;
+
+		client.sentBytes += sizeof(header) + size;
+		return true;
+	};
+
+	KinectFrameCodec codec(m_workerPool.get());
+	std::vector<std::uint8_t> encodedFrame;
+	std::vector<PongMessage> pongs;
+
+	HelloMessage hello = {};
+	hello.magic = Magic;
+	hello.version = Version;
+	hello.supportedSources = m_supportedSources;
+	std::strncpy(hello.deviceName, m_deviceName.c_str(), sizeof(hello.deviceName) - 1);
+
+	bool connected = SendMessage(MessageType::Hello, &hello, sizeof(hello));
+	while (connected)
+	{
+		KinectFrameConstPtr frame;
+		SourceFlags enabledSources;
+		{
+			std::unique_lock<std::mutex> lock(client.lock);
+			client.cv.wait(lock, [&] { return !client.running || !client.pendingPongs.empty() || (client.pendingFrame && client.enabledSources != 0); });
+
+			if (!client.running)
+				break;
+
+			pongs.swap(client.pendingPongs);
+			enabledSources = client.enabledSources;
+			if (enabledSources != 0)
+				frame = std::move(client.pendingFrame);
+		}
+
+		for (PongMessage& pong : pongs)
+		{
+			pong.serverTime = os_gettime_ns();
+			if (!SendMessage(MessageType::Pong, &pong, sizeof(pong)))
+			{
+				connected = false;
+				break;
+			}
+		}
+		pongs.clear();
+
+		if (!connected || !frame)
+			continue;
+
+		try
+		{
+			codec.Encode(*frame, enabledSources, encodedFrame);
+		}
+		catch (const std::exception& e)
+		{
+			errorlog("failed to encode frame for %s: %s", client.address.c_str(), e.what());
+			continue;
+		}
+
+		if (encodedFrame.size() > MaxMessageSize)
+		{
+			errorlog("encoded frame is too big (%zu bytes)", encodedFrame.size());
+			continue;
+		}
+
+		if (!SendMessage(MessageType::Frame, encodedFrame.data(), encodedFrame.size()))
+			break;
+
+		client.sentFrameCount++;
+	}
+
+	// Unblock the receive thread
+	client.socket.Shutdown();
+
+	std::unique_lock<std::mutex> lock(client.lock);
+	client.running = false;
+}
+
+void KinectNetworkSender::StopClient(Client& client)
+{
+	{
+		std::unique_lock<std::mutex> lock(client.lock);
+		client.running = false;
+		client.cv.notify_one();
+	}
+	client.socket.Shutdown();
+
+	client.receiveThread.join();
+	client.sendThread.join();
+
+	infolog("%s disconnected from %s (%llu frames sent, %llu dropped, %llu bytes)", client.address.c_str(), m_deviceName.c_str(), static_cast<unsigned long long>(client.sentFrameCount), static_cast<unsigned long long>(client.droppedFrameCount), static_cast<unsigned long long>(client.sentBytes));
+}
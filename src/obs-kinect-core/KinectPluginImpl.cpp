@@ -18,3 +18,7 @@
 #include <obs-kinect-core/KinectPluginImpl.hpp>
 
 KinectPluginImpl::~KinectPluginImpl() = default;
+
+void KinectPluginImpl::SetHotplugCallback(HotplugCallback /*callback*/)
+{
+}
@@ -0,0 +1,259 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect-core/KinectRecorder.hpp>
+#include <util/threading.h>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+KinectRecorder::KinectRecorder(const std::string& filePath, const std::string& deviceName) :
+m_filePath(filePath),
+m_droppedFrameCount(0),
+m_fileOffset(0),
+m_recordedSources(0),
+m_running(true),
+m_writeFailed(false)
+{
+	m_file = os_fopen(filePath.c_str(), "wb");
+	if (!m_file)
+		throw std::runtime_error("failed to open " + filePath);
+
+	KinectRecordingFormat::FileHeader header = {};
+	header.magic = KinectRecordingFormat::FileMagic;
+	header.version = KinectRecordingFormat::Version;
+	header.creationTime = static_cast<std::uint64_t>(std::time(nullptr));
+	std::strncpy(header.deviceName, deviceName.c_str(), sizeof(header.deviceName) - 1);
+
+	Write(&header, sizeof(header));
+
+	m_writerThread = std::thread(&KinectRecorder::WriterFunc, this);
+}
+
+KinectRecorder::~KinectRecorder()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_frameLock);
+		m_running = false;
+		m_frameCv.notify_all();
+	}
+	m_writerThread.join();
+
+	WriteIndex();
+
+	// Sources are only known once every frame has been written
+	if (!m_writeFailed && os_fseeki64(m_file, offsetof(KinectRecordingFormat::FileHeader, sourceFlags), SEEK_SET) == 0)
+		std::fwrite(&m_recordedSources, sizeof(m_recordedSources), 1, m_file);
+
+	if (std::fclose(m_file) != 0)
+		m_writeFailed = true;
+
+	if (m_writeFailed)
+		errorlog("recording %s is incomplete (write failed)", m_filePath.c_str());
+	else
+		infolog("recorded %zu frames to %s (%llu dropped)", m_index.size(), m_filePath.c_str(), static_cast<unsigned long long>(m_droppedFrameCount));
+}
+
+const std::string& KinectRecorder::GetFilePath() const
+{
+	return m_filePath;
+}
+
+void KinectRecorder::OnFrame(const KinectFrameConstPtr& frame)
+{
+	Record(frame);
+}
+
+void KinectRecorder::Record(KinectFrameConstPtr frame, bool waitIfFull)
+{
+	std::unique_lock<std::mutex> lock(m_frameLock);
+	if (waitIfFull)
+		m_spaceCv.wait(lock, [&] { return m_pendingFrames.size() < MaxPendingFrames; });
+
+	// Never block the device thread, drop frames if the disk can't keep up
+	if (m_pendingFrames.size() >= MaxPendingFrames)
+	{
+		m_droppedFrameCount++;
+		return;
+	}
+
+	m_pendingFrames.emplace_back(std::move(frame));
+	m_frameCv.notify_one();
+}
+
+std::string KinectRecorder::BuildFilePath(const std::string& deviceName)
+{
+	std::string directory = GetRecordingDirectory();
+	if (os_mkdirs(directory.c_str()) == MKDIR_ERROR)
+		throw std::runtime_error("failed to create " + directory);
+
+	std::string fileName = deviceName;
+	std::replace_if(fileName.begin(), fileName.end(), [](char c) { return !std::isalnum(static_cast<unsigned char>(c)) && c != '-'; }, '_');
+
+	std::array<char, 32> dateStr;
+	std::time_t now = std::time(nullptr);
+	std::strftime(dateStr.data(), dateStr.size(), "%Y-%m-%d_%H-%M-%S", std::localtime(&now));
+
+	return directory + "/" + fileName + "_" + dateStr.data() + KinectRecordingFormat::FileExtension;
+}
+
+std::string KinectRecorder::GetRecordingDirectory()
+{
+	if (const char* directory = std::getenv("OBS_KINECT_RECORDINGS_DIR"))
+		return directory;
+
+	ObsMemoryPtr<char> configPath(os_get_config_path_ptr("obs-studio/plugin_config/obs-kinect/recordings"));
+	if (!configPath)
+		throw std::runtime_error("failed to get config path");
+
+	return configPath.get();
+}
+
+void KinectRecorder::Write(const void* data, std::size_t size)
+{
+	if (m_writeFailed)
+		return;
+
+	if (std::fwrite(data, 1, size, m_file) != size)
+	{
+		errorlog("failed to write to %s", m_filePath.c_str());
+		m_writeFailed = true;
+		return;
+	}
+
+	m_fileOffset += size;
+}
+
+void KinectRecorder::WriteFrame(const KinectFrame& frame)
+{
+	using namespace KinectRecordingFormat;
+
+	struct Stream
+	{
+		StreamHeader header;
+		const void* data;
+	};
+
+	std::array<Stream, std::size_t(StreamType::Count)> streams;
+	std::size_t streamCount = 0;
+
+	auto AddStream = [&](StreamType type, const auto& frameData, std::uint32_t format)
+	{
+		if (!frameData || !frameData->ptr)
+			return;
+
+		Stream& stream = streams[streamCount++];
+		stream.header = {};
+		stream.header.type = type;
+		stream.header.format = format;
+		stream.header.width = frameData->width;
+		stream.header.height = frameData->height;
+		stream.header.pitch = frameData->pitch;
+		stream.header.payloadSize = std::uint64_t(frameData->pitch) * frameData->height;
+		stream.data = frameData->ptr.get();
+	};
+
+	AddStream(StreamType::BackgroundRemoval, frame.backgroundRemovalFrame, 0);
+	AddStream(StreamType::BodyIndex, frame.bodyIndexFrame, 0);
+	AddStream(StreamType::Color, frame.colorFrame, (frame.colorFrame) ? std::uint32_t(frame.colorFrame->format) : 0);
+	AddStream(StreamType::ColorMappedBody, frame.colorMappedBodyFrame, 0);
+	AddStream(StreamType::ColorMappedDepth, frame.colorMappedDepthFrame, 0);
+	AddStream(StreamType::Depth, frame.depthFrame, 0);
+	AddStream(StreamType::DepthMapping, frame.depthMappingFrame, 0);
+	AddStream(StreamType::Infrared, frame.infraredFrame, 0);
+
+	std::uint64_t chunkOffset = m_fileOffset;
+	std::uint64_t payloadOffset = AlignPayload(chunkOffset + sizeof(ChunkHeader) + streamCount * sizeof(StreamHeader));
+	for (std::size_t i = 0; i < streamCount; ++i)
+	{
+		streams[i].header.payloadOffset = payloadOffset;
+		payloadOffset = AlignPayload(payloadOffset + streams[i].header.payloadSize);
+
+		m_recordedSources |= ToSourceFlag(streams[i].header.type);
+	}
+
+	ChunkHeader chunkHeader = {};
+	chunkHeader.magic = ChunkMagic;
+	chunkHeader.streamCount = static_cast<std::uint32_t>(streamCount);
+	chunkHeader.chunkSize = payloadOffset - chunkOffset;
+	chunkHeader.frameIndex = frame.frameIndex;
+	chunkHeader.timestamp = frame.timestamp;
+
+	Write(&chunkHeader, sizeof(chunkHeader));
+	for (std::size_t i = 0; i < streamCount; ++i)
+		Write(&streams[i].header, sizeof(StreamHeader));
+
+	for (std::size_t i = 0; i < streamCount; ++i)
+	{
+		WritePadding(streams[i].header.payloadOffset);
+		Write(streams[i].data, streams[i].header.payloadSize);
+	}
+
+	WritePadding(chunkOffset + chunkHeader.chunkSize);
+
+	if (!m_writeFailed)
+		m_index.push_back({ chunkOffset, frame.timestamp });
+}
+
+void KinectRecorder::WriteIndex()
+{
+	KinectRecordingFormat::Footer footer = {};
+	footer.indexOffset = m_fileOffset;
+	footer.entryCount = m_index.size();
+	footer.magic = KinectRecordingFormat::FooterMagic;
+	footer.version = KinectRecordingFormat::Version;
+
+	Write(m_index.data(), m_index.size() * sizeof(KinectRecordingFormat::IndexEntry));
+	Write(&footer, sizeof(footer));
+}
+
+void KinectRecorder::WritePadding(std::uint64_t alignedOffset)
+{
+	static constexpr std::array<std::uint8_t, KinectRecordingFormat::PayloadAlignment> padding = {};
+
+	assert(alignedOffset >= m_fileOffset && alignedOffset - m_fileOffset < padding.size());
+	Write(padding.data(), static_cast<std::size_t>(alignedOffset - m_fileOffset));
+}
+
+void KinectRecorder::WriterFunc()
+{
+	os_set_thread_name("KinectRecorder");
+
+	for (;;)
+	{
+		KinectFrameConstPtr frame;
+		{
+			std::unique_lock<std::mutex> lock(m_frameLock);
+			m_frameCv.wait(lock, [&] { return !m_running || !m_pendingFrames.empty(); });
+
+			if (m_pendingFrames.empty())
+				break; //< stopped and everything has been written
+
+			frame = std::move(m_pendingFrames.front());
+			m_pendingFrames.pop_front();
+			m_spaceCv.notify_one();
+		}
+
+		WriteFrame(*frame);
+	}
+}
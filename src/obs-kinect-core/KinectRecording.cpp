@@ -0,0 +1,294 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect-core/KinectRecording.hpp>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#ifdef _WIN32
+#include <obs-kinect-core/Win32Helper.hpp>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+KinectRecording::KinectRecording(const std::string& filePath) :
+m_filePath(filePath),
+m_data(nullptr),
+m_fileSize(0),
+m_sourceFlags(0)
+{
+	Map();
+
+	try
+	{
+		BuildIndex();
+	}
+	catch (const std::exception&)
+	{
+		Unmap();
+		throw;
+	}
+}
+
+KinectRecording::~KinectRecording()
+{
+	Unmap();
+}
+
+const std::string& KinectRecording::GetDeviceName() const
+{
+	return m_deviceName;
+}
+
+const std::string& KinectRecording::GetFilePath() const
+{
+	return m_filePath;
+}
+
+std::size_t KinectRecording::GetFrameCount() const
+{
+	return m_index.size();
+}
+
+std::uint64_t KinectRecording::GetFrameTimestamp(std::size_t frameIndex) const
+{
+	return m_index.at(frameIndex).timestamp;
+}
+
+SourceFlags KinectRecording::GetSourceFlags() const
+{
+	return m_sourceFlags;
+}
+
+KinectFramePtr KinectRecording::ReadFrame(std::size_t frameIndex, SourceFlags enabledSources) const
+{
+	using namespace KinectRecordingFormat;
+
+	const IndexEntry& entry = m_index.at(frameIndex);
+	ChunkHeader chunkHeader = ReadStruct<ChunkHeader>(entry.chunkOffset);
+	if (chunkHeader.magic != ChunkMagic || chunkHeader.chunkSize > m_fileSize - entry.chunkOffset)
+		throw std::runtime_error("corrupted chunk for frame #" + std::to_string(frameIndex));
+
+	KinectFramePtr framePtr = std::make_shared<KinectFrame>();
+	framePtr->frameIndex = chunkHeader.frameIndex;
+	framePtr->timestamp = chunkHeader.timestamp;
+	framePtr->storage = shared_from_this();
+
+	for (std::uint32_t i = 0; i < chunkHeader.streamCount; ++i)
+	{
+		StreamHeader streamHeader = ReadStruct<StreamHeader>(entry.chunkOffset + sizeof(ChunkHeader) + i * sizeof(StreamHeader));
+		if (streamHeader.type >= StreamType::Count)
+			throw std::runtime_error("unknown stream type " + std::to_string(static_cast<std::uint32_t>(streamHeader.type)));
+
+		if ((enabledSources & ToSourceFlag(streamHeader.type)) == 0)
+			continue;
+
+		if (streamHeader.payloadOffset < entry.chunkOffset || streamHeader.payloadSize > entry.chunkOffset + chunkHeader.chunkSize - streamHeader.payloadOffset ||
+		    streamHeader.payloadSize < std::uint64_t(streamHeader.pitch) * streamHeader.height)
+			throw std::runtime_error("corrupted stream for frame #" + std::to_string(frameIndex));
+
+		// Mapping is read-only but frames are only exposed as const
+		std::uint8_t* payload = const_cast<std::uint8_t*>(m_data + streamHeader.payloadOffset);
+
+		auto FillFrameData = [&](auto& frameData) -> auto&
+		{
+			auto& data = frameData.emplace();
+			data.width = streamHeader.width;
+			data.height = streamHeader.height;
+			data.pitch = streamHeader.pitch;
+			data.ptr.reset(reinterpret_cast<decltype(data.ptr.get())>(payload));
+
+			return data;
+		};
+
+		switch (streamHeader.type)
+		{
+			case StreamType::BackgroundRemoval: FillFrameData(framePtr->backgroundRemovalFrame); break;
+			case StreamType::BodyIndex:         FillFrameData(framePtr->bodyIndexFrame); break;
+			case StreamType::Color:             FillFrameData(framePtr->colorFrame).format = static_cast<gs_color_format>(streamHeader.format); break;
+			case StreamType::ColorMappedBody:   FillFrameData(framePtr->colorMappedBodyFrame); break;
+			case StreamType::ColorMappedDepth:  FillFrameData(framePtr->colorMappedDepthFrame); break;
+			case StreamType::Depth:             FillFrameData(framePtr->depthFrame); break;
+			case StreamType::DepthMapping:      FillFrameData(framePtr->depthMappingFrame); break;
+			case StreamType::Infrared:          FillFrameData(framePtr->infraredFrame); break;
+
+			case StreamType::Count:
+				break;
+		}
+	}
+
+	return framePtr;
+}
+
+void KinectRecording::BuildIndex()
+{
+	using namespace KinectRecordingFormat;
+
+	FileHeader fileHeader = ReadStruct<FileHeader>(0);
+	if (fileHeader.magic != FileMagic)
+		throw std::runtime_error(m_filePath + " is not a Kinect recording");
+
+	if (fileHeader.version != Version)
+		throw std::runtime_error(m_filePath + " has an unsupported version (" + std::to_string(fileHeader.version) + ")");
+
+	m_deviceName.assign(fileHeader.deviceName, strnlen(fileHeader.deviceName, sizeof(fileHeader.deviceName)));
+
+	if (m_fileSize >= sizeof(FileHeader) + sizeof(Footer))
+	{
+		Footer footer = ReadStruct<Footer>(m_fileSize - sizeof(Footer));
+		if (footer.magic == FooterMagic && footer.version == Version && footer.indexOffset >= sizeof(FileHeader) && footer.indexOffset <= m_fileSize - sizeof(Footer) &&
+		    footer.entryCount <= m_fileSize / sizeof(IndexEntry) && footer.entryCount * sizeof(IndexEntry) == m_fileSize - sizeof(Footer) - footer.indexOffset)
+		{
+			m_index.resize(footer.entryCount);
+			std::memcpy(m_index.data(), m_data + footer.indexOffset, footer.entryCount * sizeof(IndexEntry));
+
+			for (const IndexEntry& entry : m_index)
+			{
+				if (entry.chunkOffset < sizeof(FileHeader) || entry.chunkOffset > footer.indexOffset - sizeof(ChunkHeader))
+					throw std::runtime_error(m_filePath + " has a corrupted index");
+			}
+
+			m_sourceFlags = fileHeader.sourceFlags;
+			return;
+		}
+	}
+
+	// No index, the recording was interrupted: rebuild it from the chunks which were entirely written
+	std::uint64_t offset = sizeof(FileHeader);
+	while (offset <= m_fileSize - sizeof(ChunkHeader))
+	{
+		ChunkHeader chunkHeader = ReadStruct<ChunkHeader>(offset);
+		if (chunkHeader.magic != ChunkMagic || chunkHeader.chunkSize < sizeof(ChunkHeader) || chunkHeader.chunkSize > m_fileSize - offset)
+			break;
+
+		if (chunkHeader.streamCount > std::uint32_t(StreamType::Count) || chunkHeader.streamCount * sizeof(StreamHeader) > chunkHeader.chunkSize - sizeof(ChunkHeader))
+			break;
+
+		for (std::uint32_t i = 0; i < chunkHeader.streamCount; ++i)
+		{
+			StreamHeader streamHeader = ReadStruct<StreamHeader>(offset + sizeof(ChunkHeader) + i * sizeof(StreamHeader));
+			m_sourceFlags |= ToSourceFlag(streamHeader.type);
+		}
+
+		m_index.push_back({ offset, chunkHeader.timestamp });
+		offset += chunkHeader.chunkSize;
+	}
+
+	warnlog("%s has no index (interrupted recording?), recovered %zu frames", m_filePath.c_str(), m_index.size());
+}
+
+void KinectRecording::Map()
+{
+#ifdef _WIN32
+	m_fileHandle = INVALID_HANDLE_VALUE;
+	m_mappingHandle = nullptr;
+
+	wchar_t* widePathPtr;
+	if (os_utf8_to_wcs_ptr(m_filePath.c_str(), m_filePath.size(), &widePathPtr) == 0)
+		throw std::runtime_error("invalid path " + m_filePath);
+
+	ObsMemoryPtr<wchar_t> widePath(widePathPtr);
+
+	HandlePtr file(CreateFileW(widePath.get(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+	if (file.get() == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("failed to open " + m_filePath);
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file.get(), &fileSize))
+		throw std::runtime_error("failed to get size of " + m_filePath);
+
+	m_fileSize = static_cast<std::uint64_t>(fileSize.QuadPart);
+	if (m_fileSize < sizeof(KinectRecordingFormat::FileHeader))
+		throw std::runtime_error(m_filePath + " is not a Kinect recording");
+
+	HandlePtr mapping(CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+	if (!mapping)
+		throw std::runtime_error("failed to map " + m_filePath);
+
+	m_data = static_cast<const std::uint8_t*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0));
+	if (!m_data)
+		throw std::runtime_error("failed to map " + m_filePath);
+
+	m_fileHandle = file.release();
+	m_mappingHandle = mapping.release();
+#else
+	m_fileDescriptor = open(m_filePath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (m_fileDescriptor < 0)
+		throw std::runtime_error("failed to open " + m_filePath + ": " + std::strerror(errno));
+
+	try
+	{
+		struct stat fileStat;
+		if (fstat(m_fileDescriptor, &fileStat) != 0)
+			throw std::runtime_error("failed to get size of " + m_filePath + ": " + std::strerror(errno));
+
+		m_fileSize = static_cast<std::uint64_t>(fileStat.st_size);
+		if (m_fileSize < sizeof(KinectRecordingFormat::FileHeader))
+			throw std::runtime_error(m_filePath + " is not a Kinect recording");
+
+		void* data = mmap(nullptr, m_fileSize, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+		if (data == MAP_FAILED)
+			throw std::runtime_error("failed to map " + m_filePath + ": " + std::strerror(errno));
+
+		// Frames are mostly read in order
+		madvise(data, m_fileSize, MADV_SEQUENTIAL);
+
+		m_data = static_cast<const std::uint8_t*>(data);
+	}
+	catch (const std::exception&)
+	{
+		close(m_fileDescriptor);
+		throw;
+	}
+#endif
+}
+
+template<typename T>
+T KinectRecording::ReadStruct(std::uint64_t offset) const
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+
+	if (offset > m_fileSize || sizeof(T) > m_fileSize - offset)
+		throw std::runtime_error(m_filePath + " is truncated");
+
+	T value;
+	std::memcpy(&value, m_data + offset, sizeof(T));
+
+	return value;
+}
+
+void KinectRecording::Unmap()
+{
+	if (!m_data)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+	CloseHandle(m_mappingHandle);
+	CloseHandle(m_fileHandle);
+#else
+	munmap(const_cast<std::uint8_t*>(m_data), m_fileSize);
+	close(m_fileDescriptor);
+#endif
+
+	m_data = nullptr;
+}
@@ -0,0 +1,443 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include <obs-kinect-core/KinectReplayBuffer.hpp>
+#include <obs-kinect-core/KinectRecorder.hpp>
+#include <util/threading.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace
+{
+	constexpr std::uint64_t NoPinnedRecord = std::numeric_limits<std::uint64_t>::max();
+}
+
+KinectReplayBuffer::KinectReplayBuffer(std::size_t memoryBudget, std::uint64_t maxDuration) :
+m_saving(false),
+m_memoryBudget(memoryBudget),
+m_droppedFrameCount(0),
+m_recordCount(0),
+m_recordHead(0),
+m_firstRecordId(0),
+m_maxDuration(maxDuration),
+m_pinnedRecordId(NoPinnedRecord),
+m_writeOffset(0),
+m_running(true)
+{
+	// Everything is allocated upfront, chunks are not initialized so pages are only committed once frames are written
+	std::size_t chunkCount = std::max<std::size_t>((memoryBudget + ArenaChunkSize - 1) / ArenaChunkSize, 1);
+	m_chunks.reserve(chunkCount);
+	for (std::size_t i = 0; i < chunkCount; ++i)
+		m_chunks.emplace_back(new std::uint8_t[ArenaChunkSize]);
+
+	m_ringSize = std::uint64_t(chunkCount) * ArenaChunkSize;
+
+	m_records.resize(256);
+	m_pendingFrames.reserve(MaxPendingFrames);
+
+	m_compressorThread = std::thread(&KinectReplayBuffer::CompressorFunc, this);
+}
+
+KinectReplayBuffer::~KinectReplayBuffer()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_running = false;
+		m_frameCv.notify_all();
+	}
+	m_compressorThread.join();
+
+	if (m_saverThread.joinable())
+		m_saverThread.join();
+
+	if (m_droppedFrameCount > 0)
+		infolog("replay buffer dropped %llu frames", static_cast<unsigned long long>(m_droppedFrameCount));
+}
+
+std::uint64_t KinectReplayBuffer::GetMaxDuration() const
+{
+	return m_maxDuration;
+}
+
+std::size_t KinectReplayBuffer::GetMemoryBudget() const
+{
+	return m_memoryBudget;
+}
+
+bool KinectReplayBuffer::IsSaving() const
+{
+	return m_saving;
+}
+
+void KinectReplayBuffer::OnFrame(const KinectFrameConstPtr& frame)
+{
+	Push(frame);
+}
+
+void KinectReplayBuffer::Push(KinectFrameConstPtr frame)
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	// Never block the device thread, drop frames if compression can't keep up
+	if (m_pendingFrames.size() >= MaxPendingFrames)
+	{
+		m_droppedFrameCount++;
+		return;
+	}
+
+	m_pendingFrames.emplace_back(std::move(frame));
+	m_frameCv.notify_one();
+}
+
+bool KinectReplayBuffer::Save(const std::string& filePath, const std::string& deviceName)
+{
+	bool saving = false;
+	if (!m_saving.compare_exchange_strong(saving, true))
+		return false;
+
+	// Previous save is over
+	if (m_saverThread.joinable())
+		m_saverThread.join();
+
+	std::unique_ptr<KinectRecorder> recorder;
+	try
+	{
+		recorder = std::make_unique<KinectRecorder>(filePath, deviceName);
+	}
+	catch (const std::exception&)
+	{
+		m_saving = false;
+		throw;
+	}
+
+	std::uint64_t firstRecordId;
+	std::uint64_t endRecordId;
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		firstRecordId = m_firstRecordId;
+		endRecordId = m_firstRecordId + m_recordCount;
+
+		// Frames being saved are kept until they've been decompressed, new frames are dropped if this makes the ring full
+		m_pinnedRecordId = firstRecordId;
+	}
+
+	m_saverThread = std::thread(&KinectReplayBuffer::SaverFunc, this, std::move(recorder), firstRecordId, endRecordId);
+	return true;
+}
+
+auto KinectReplayBuffer::GetRecord(std::uint64_t recordId) -> FrameRecord&
+{
+	assert(recordId >= m_firstRecordId && recordId - m_firstRecordId < m_recordCount);
+	return m_records[(m_recordHead + (recordId - m_firstRecordId)) % m_records.size()];
+}
+
+void KinectReplayBuffer::CompressFrame(const KinectFrame& frame)
+{
+	using namespace KinectRecordingFormat;
+
+	FrameRecord record;
+	record.frameIndex = frame.frameIndex;
+	record.size = 0;
+	record.streamCount = 0;
+	record.timestamp = frame.timestamp;
+
+	std::array<const void*, std::size_t(StreamType::Count)> streamData;
+
+	auto AddStream = [&](StreamType type, const auto& frameData, std::uint32_t format)
+	{
+		if (!frameData || !frameData->ptr)
+			return;
+
+		using FrameDataType = std::decay_t<decltype(*frameData)>;
+
+		std::size_t streamIndex = record.streamCount++;
+		std::vector<std::uint8_t>& encodedStream = m_encodedStreams[streamIndex];
+
+		StreamRecord& stream = record.streams[streamIndex];
+		stream.type = type;
+		stream.format = format;
+		stream.width = frameData->width;
+		stream.height = frameData->height;
+		stream.pitch = frameData->pitch;
+
+		if constexpr (std::is_same_v<FrameDataType, DepthFrameData> || std::is_same_v<FrameDataType, InfraredFrameData>)
+		{
+			m_codec.EncodeDepth(frameData->ptr.get(), frameData->pitch, frameData->width, frameData->height, encodedStream);
+			stream.compressed = true;
+			stream.size = encodedStream.size();
+			streamData[streamIndex] = encodedStream.data();
+		}
+		else if constexpr (std::is_same_v<FrameDataType, BackgroundRemovalFrameData> || std::is_same_v<FrameDataType, BodyIndexFrameData>)
+		{
+			m_codec.EncodeBodyIndex(frameData->ptr.get(), frameData->pitch, frameData->width, frameData->height, encodedStream);
+			stream.compressed = true;
+			stream.size = encodedStream.size();
+			streamData[streamIndex] = encodedStream.data();
+		}
+		else
+		{
+			// Color and depth mapping don't compress losslessly well enough to be worth the CPU time
+			stream.compressed = false;
+			stream.size = std::uint64_t(frameData->pitch) * frameData->height;
+			streamData[streamIndex] = frameData->ptr.get();
+		}
+
+		record.size += stream.size;
+	};
+
+	AddStream(StreamType::BackgroundRemoval, frame.backgroundRemovalFrame, 0);
+	AddStream(StreamType::BodyIndex, frame.bodyIndexFrame, 0);
+	AddStream(StreamType::Color, frame.colorFrame, (frame.colorFrame) ? std::uint32_t(frame.colorFrame->format) : 0);
+	AddStream(StreamType::ColorMappedBody, frame.colorMappedBodyFrame, 0);
+	AddStream(StreamType::ColorMappedDepth, frame.colorMappedDepthFrame, 0);
+	AddStream(StreamType::Depth, frame.depthFrame, 0);
+	AddStream(StreamType::DepthMapping, frame.depthMappingFrame, 0);
+	AddStream(StreamType::Infrared, frame.infraredFrame, 0);
+
+	if (record.size > m_ringSize)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_droppedFrameCount++;
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		// Make room by releasing the oldest frames, except the ones being saved
+		while (m_recordCount > 0 && m_firstRecordId < m_pinnedRecordId)
+		{
+			const FrameRecord& oldestRecord = GetRecord(m_firstRecordId);
+
+			bool tooOld = (record.timestamp > oldestRecord.timestamp && record.timestamp - oldestRecord.timestamp > m_maxDuration);
+			bool tooLarge = (m_ringSize - (m_writeOffset - oldestRecord.offset) < record.size);
+			if (!tooOld && !tooLarge)
+				break;
+
+			m_firstRecordId++;
+			m_recordCount--;
+			m_recordHead = (m_recordHead + 1) % m_records.size();
+		}
+
+		std::uint64_t usedSize = (m_recordCount > 0) ? m_writeOffset - GetRecord(m_firstRecordId).offset : 0;
+		if (m_ringSize - usedSize < record.size)
+		{
+			m_droppedFrameCount++;
+			return;
+		}
+	}
+
+	// Space between the write offset and the oldest frame isn't used by anyone, fill it outside of the lock
+	record.offset = m_writeOffset;
+
+	std::uint64_t offset = record.offset;
+	for (std::size_t i = 0; i < record.streamCount; ++i)
+	{
+		WriteRing(offset, streamData[i], static_cast<std::size_t>(record.streams[i].size));
+		offset += record.streams[i].size;
+	}
+
+	std::unique_lock<std::mutex> lock(m_lock);
+	if (m_recordCount == m_records.size())
+	{
+		std::vector<FrameRecord> records(m_records.size() * 2);
+		for (std::size_t i = 0; i < m_recordCount; ++i)
+			records[i] = m_records[(m_recordHead + i) % m_records.size()];
+
+		m_records = std::move(records);
+		m_recordHead = 0;
+	}
+
+	m_records[(m_recordHead + m_recordCount) % m_records.size()] = record;
+	m_recordCount++;
+	m_writeOffset += record.size;
+}
+
+void KinectReplayBuffer::CompressorFunc()
+{
+	os_set_thread_name("KinectReplayBuffer");
+
+	for (;;)
+	{
+		KinectFrameConstPtr frame;
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_frameCv.wait(lock, [&] { return !m_running || !m_pendingFrames.empty(); });
+
+			if (!m_running)
+				break;
+
+			frame = std::move(m_pendingFrames.front());
+			m_pendingFrames.erase(m_pendingFrames.begin());
+		}
+
+		try
+		{
+			CompressFrame(*frame);
+		}
+		catch (const std::exception& e)
+		{
+			errorlog("failed to add frame to replay buffer: %s", e.what());
+		}
+	}
+}
+
+KinectFramePtr KinectReplayBuffer::DecompressFrame(const FrameRecord& record, std::vector<std::uint8_t>& buffer, PlaneCodec& codec) const
+{
+	using namespace KinectRecordingFormat;
+
+	KinectFramePtr framePtr = std::make_shared<KinectFrame>();
+	framePtr->frameIndex = record.frameIndex;
+	framePtr->timestamp = record.timestamp;
+
+	std::uint64_t offset = record.offset;
+	for (std::size_t i = 0; i < record.streamCount; ++i)
+	{
+		const StreamRecord& stream = record.streams[i];
+
+		auto FillFrameData = [&](auto& frameData) -> auto&
+		{
+			using T = std::remove_pointer_t<decltype(frameData->ptr.get())>;
+
+			auto& data = frameData.emplace();
+			data.width = stream.width;
+			data.height = stream.height;
+
+			if (stream.compressed)
+			{
+				buffer.resize(static_cast<std::size_t>(stream.size));
+				ReadRing(offset, buffer.data(), buffer.size());
+
+				data.pitch = static_cast<std::uint32_t>(stream.width * sizeof(T));
+				data.memory.resize(std::size_t(data.pitch) * data.height);
+
+				if constexpr (std::is_same_v<T, std::uint16_t>)
+					codec.DecodeDepth(buffer.data(), buffer.size(), reinterpret_cast<std::uint16_t*>(data.memory.data()), data.pitch);
+				else if constexpr (std::is_same_v<T, std::uint8_t>)
+					codec.DecodeBodyIndex(buffer.data(), buffer.size(), data.memory.data(), data.pitch);
+				else
+					throw std::runtime_error("unexpected compressed stream");
+			}
+			else
+			{
+				data.pitch = stream.pitch;
+				data.memory.resize(static_cast<std::size_t>(stream.size));
+				ReadRing(offset, data.memory.data(), data.memory.size());
+			}
+
+			data.ptr.reset(reinterpret_cast<T*>(data.memory.data()));
+
+			return data;
+		};
+
+		switch (stream.type)
+		{
+			case StreamType::BackgroundRemoval: FillFrameData(framePtr->backgroundRemovalFrame); break;
+			case StreamType::BodyIndex:         FillFrameData(framePtr->bodyIndexFrame); break;
+			case StreamType::Color:             FillFrameData(framePtr->colorFrame).format = static_cast<gs_color_format>(stream.format); break;
+			case StreamType::ColorMappedBody:   FillFrameData(framePtr->colorMappedBodyFrame); break;
+			case StreamType::ColorMappedDepth:  FillFrameData(framePtr->colorMappedDepthFrame); break;
+			case StreamType::Depth:             FillFrameData(framePtr->depthFrame); break;
+			case StreamType::DepthMapping:      FillFrameData(framePtr->depthMappingFrame); break;
+			case StreamType::Infrared:          FillFrameData(framePtr->infraredFrame); break;
+
+			case StreamType::Count:
+				break;
+		}
+
+		offset += stream.size;
+	}
+
+	return framePtr;
+}
+
+void KinectReplayBuffer::ReadRing(std::uint64_t offset, void* data, std::size_t size) const
+{
+	std::uint8_t* ptr = static_cast<std::uint8_t*>(data);
+	while (size > 0)
+	{
+		std::uint64_t ringOffset = offset % m_ringSize;
+		std::size_t chunkOffset = static_cast<std::size_t>(ringOffset % ArenaChunkSize);
+		std::size_t copySize = std::min(size, ArenaChunkSize - chunkOffset);
+
+		std::memcpy(ptr, &m_chunks[static_cast<std::size_t>(ringOffset / ArenaChunkSize)][chunkOffset], copySize);
+
+		offset += copySize;
+		ptr += copySize;
+		size -= copySize;
+	}
+}
+
+void KinectReplayBuffer::SaverFunc(std::unique_ptr<KinectRecorder> recorder, std::uint64_t firstRecordId, std::uint64_t endRecordId)
+{
+	os_set_thread_name("KinectReplayBufferSaver");
+
+	PlaneCodec codec;
+	std::vector<std::uint8_t> buffer;
+
+	for (std::uint64_t recordId = firstRecordId; recordId < endRecordId; ++recordId)
+	{
+		FrameRecord record;
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+			record = GetRecord(recordId);
+		}
+
+		try
+		{
+			recorder->Record(DecompressFrame(record, buffer, codec), true);
+		}
+		catch (const std::exception& e)
+		{
+			errorlog("failed to save replay buffer frame: %s", e.what());
+		}
+
+		// Frame data has been copied out of the ring, it can be overwritten
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_pinnedRecordId = recordId + 1;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_pinnedRecordId = NoPinnedRecord;
+	}
+
+	recorder.reset(); //< writes the index
+	m_saving = false;
+}
+
+void KinectReplayBuffer::WriteRing(std::uint64_t offset, const void* data, std::size_t size)
+{
+	const std::uint8_t* ptr = static_cast<const std::uint8_t*>(data);
+	while (size > 0)
+	{
+		std::uint64_t ringOffset = offset % m_ringSize;
+		std::size_t chunkOffset = static_cast<std::size_t>(ringOffset % ArenaChunkSize);
+		std::size_t copySize = std::min(size, ArenaChunkSize - chunkOffset);
+
+		std::memcpy(&m_chunks[static_cast<std::size_t>(ringOffset / ArenaChunkSize)][chunkOffset], ptr, copySize);
+
+		offset += copySize;
+		ptr += copySize;
+		size -= copySize;
+	}
+}
@@ -0,0 +1,229 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include <obs-kinect-core/KinectSharedMemoryPublisher.hpp>
+#include <obs-kinect-core/KinectSharedMemoryFormat.hpp>
+#include <array>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+KinectSharedMemoryPublisher::KinectSharedMemoryPublisher(std::string deviceName, SourceFlags supportedSources) :
+m_deviceName(std::move(deviceName)),
+m_slotPayloadSize(0),
+m_supportedSources(supportedSources),
+m_failed(false)
+{
+#ifdef _WIN32
+	throw std::runtime_error("shared memory is not supported on this platform");
+#endif
+}
+
+KinectSharedMemoryPublisher::~KinectSharedMemoryPublisher()
+{
+	CloseSegment();
+}
+
+bool KinectSharedMemoryPublisher::HasFailed() const
+{
+	return m_failed;
+}
+
+void KinectSharedMemoryPublisher::OnFrame(const KinectFrameConstPtr& frame)
+{
+	if (m_failed)
+		return;
+
+	try
+	{
+		Publish(*frame);
+	}
+	catch (const std::exception& e)
+	{
+		errorlog("failed to share frame, sharing stopped: %s", e.what());
+
+		CloseSegment();
+		m_failed = true;
+	}
+}
+
+void KinectSharedMemoryPublisher::Publish(const KinectFrame& frame)
+{
+	using namespace KinectRecordingFormat;
+	using namespace KinectSharedMemoryFormat;
+
+	struct Stream
+	{
+		StreamHeader header;
+		const void* data;
+	};
+
+	std::array<Stream, std::size_t(StreamType::Count)> streams;
+	std::size_t streamCount = 0;
+
+	auto AddStream = [&](StreamType type, const auto& frameData, std::uint32_t format)
+	{
+		if (!frameData || !frameData->ptr)
+			return;
+
+		Stream& stream = streams[streamCount++];
+		stream.header = {};
+		stream.header.type = type;
+		stream.header.format = format;
+		stream.header.width = frameData->width;
+		stream.header.height = frameData->height;
+		stream.header.pitch = frameData->pitch;
+		stream.header.payloadSize = std::uint64_t(frameData->pitch) * frameData->height;
+		stream.data = frameData->ptr.get();
+	};
+
+	AddStream(StreamType::BackgroundRemoval, frame.backgroundRemovalFrame, 0);
+	AddStream(StreamType::BodyIndex, frame.bodyIndexFrame, 0);
+	AddStream(StreamType::Color, frame.colorFrame, (frame.colorFrame) ? std::uint32_t(frame.colorFrame->format) : 0);
+	AddStream(StreamType::ColorMappedBody, frame.colorMappedBodyFrame, 0);
+	AddStream(StreamType::ColorMappedDepth, frame.colorMappedDepthFrame, 0);
+	AddStream(StreamType::Depth, frame.depthFrame, 0);
+	AddStream(StreamType::DepthMapping, frame.depthMappingFrame, 0);
+	AddStream(StreamType::Infrared, frame.infraredFrame, 0);
+
+	std::uint64_t payloadOffset = AlignPayload(sizeof(SlotHeader));
+	for (std::size_t i = 0; i < streamCount; ++i)
+	{
+		streams[i].header.payloadOffset = payloadOffset;
+		payloadOffset = AlignPayload(payloadOffset + streams[i].header.payloadSize);
+	}
+
+	std::uint64_t payloadSize = payloadOffset - AlignPayload(sizeof(SlotHeader));
+	if (!m_segment || payloadSize > m_slotPayloadSize)
+		CreateSegment(payloadSize);
+
+	std::uint8_t* segmentData = m_segment->GetData();
+	SegmentHeader* header = reinterpret_cast<SegmentHeader*>(segmentData);
+
+	std::uint32_t publishCount = header->publishCount.load(std::memory_order_relaxed);
+	std::uint8_t* slotData = segmentData + SlotOffset(header->slotSize, publishCount % header->slotCount);
+	SlotHeader* slotHeader = reinterpret_cast<SlotHeader*>(slotData);
+
+	// Seqlock write: odd sequence while the slot is being written
+	std::uint32_t sequence = slotHeader->sequence.load(std::memory_order_relaxed);
+	slotHeader->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slotHeader->streamCount = static_cast<std::uint32_t>(streamCount);
+	slotHeader->frameIndex = frame.frameIndex;
+	slotHeader->timestamp = frame.timestamp;
+	for (std::size_t i = 0; i < streamCount; ++i)
+	{
+		slotHeader->streams[i] = streams[i].header;
+		std::memcpy(slotData + streams[i].header.payloadOffset, streams[i].data, static_cast<std::size_t>(streams[i].header.payloadSize));
+	}
+
+	slotHeader->sequence.store(sequence + 2, std::memory_order_release);
+	// Store/load pair with the readers' increment/wait pair (Dekker): with sequential consistency, either we see a reader
+	// waiting or it sees the new count before going to sleep, release/acquire would allow both to miss each other
+	header->publishCount.store(publishCount + 1, std::memory_order_seq_cst);
+
+	if (header->waiterCount.load(std::memory_order_seq_cst) > 0)
+		SharedMemorySegment::WakeAll(header->publishCount);
+}
+
+void KinectSharedMemoryPublisher::CloseSegment()
+{
+	if (!m_segment)
+		return;
+
+	using namespace KinectSharedMemoryFormat;
+
+	// Readers keep their mapping until they notice the segment is closed
+	SegmentHeader* header = reinterpret_cast<SegmentHeader*>(m_segment->GetData());
+	header->state.store(std::uint32_t(SegmentState::Closed), std::memory_order_release);
+	SharedMemorySegment::WakeAll(header->publishCount);
+
+	SharedMemorySegment::Unlink(m_segment->GetName());
+	m_segment.reset();
+}
+
+void KinectSharedMemoryPublisher::CreateSegment(std::uint64_t payloadSize)
+{
+	using namespace KinectSharedMemoryFormat;
+	using KinectRecordingFormat::AlignPayload;
+
+	// Keep some margin for frames growing a bit (e.g. a stream being enabled)
+	std::uint64_t slotPayloadSize = AlignPayload(payloadSize + payloadSize / 4);
+	std::uint64_t slotSize = AlignPayload(sizeof(SlotHeader)) + slotPayloadSize;
+	std::size_t segmentSize = static_cast<std::size_t>(SlotOffset(slotSize, SlotCount));
+
+	// Try to keep our name when recreating the segment so readers find us again
+	std::string previousName = (m_segment) ? m_segment->GetName() : std::string();
+	CloseSegment();
+
+	std::optional<SharedMemorySegment> segment;
+	if (!previousName.empty())
+		segment = SharedMemorySegment::Create(previousName, segmentSize);
+
+	for (std::uint32_t i = 0; i < MaxPublishers && !segment; ++i)
+	{
+		std::string segmentName = GetSegmentName(i);
+
+		segment = SharedMemorySegment::Create(segmentName, segmentSize);
+		if (segment)
+			break;
+
+		// Segments left by a process which didn't exit properly can be reclaimed
+		std::optional<SharedMemorySegment> existingSegment = SharedMemorySegment::Open(segmentName);
+		if (!existingSegment || existingSegment->GetSize() < sizeof(SegmentHeader))
+			continue;
+
+		const SegmentHeader* existingHeader = reinterpret_cast<const SegmentHeader*>(existingSegment->GetData());
+		if (existingHeader->magic.load(std::memory_order_acquire) != Magic)
+			continue; //< being created
+
+		if (existingHeader->state.load(std::memory_order_acquire) == std::uint32_t(SegmentState::Active) && SharedMemorySegment::IsProcessAlive(existingHeader->writerProcessId))
+			continue;
+
+		infolog("reclaiming stale shared memory segment %s", segmentName.c_str());
+		SharedMemorySegment::Unlink(segmentName);
+		segment = SharedMemorySegment::Create(segmentName, segmentSize);
+	}
+
+	if (!segment)
+		throw std::runtime_error("no shared memory segment available (max " + std::to_string(MaxPublishers) + " publishers)");
+
+	// Fresh shared memory is zero-filled
+	SegmentHeader* header = new (segment->GetData()) SegmentHeader;
+	header->version = Version;
+	header->slotCount = SlotCount;
+	header->supportedSources = m_supportedSources;
+	header->slotSize = slotSize;
+	header->writerProcessId = SharedMemorySegment::GetCurrentProcessId();
+	header->state.store(std::uint32_t(SegmentState::Active), std::memory_order_relaxed);
+	header->publishCount.store(0, std::memory_order_relaxed);
+	header->waiterCount.store(0, std::memory_order_relaxed);
+	header->reserved = 0;
+	std::strncpy(header->deviceName, m_deviceName.c_str(), sizeof(header->deviceName) - 1);
+
+	for (std::uint32_t i = 0; i < SlotCount; ++i)
+		new (segment->GetData() + SlotOffset(slotSize, i)) SlotHeader{};
+
+	header->magic.store(Magic, std::memory_order_release);
+
+	infolog("sharing %s frames through %s", m_deviceName.c_str(), segment->GetName().c_str());
+
+	m_segment = std::move(segment);
+	m_slotPayloadSize = slotPayloadSize;
+}
@@ -0,0 +1,111 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include <obs-kinect-core/KinectStreamPlanner.hpp>
+#include <util/platform.h>
+
+KinectStreamPlanner::KinectStreamPlanner(std::string deviceName, SourceFlags supportedSources, std::uint64_t hysteresisDelay) :
+m_deviceName(std::move(deviceName)),
+m_restartCount(0),
+m_hysteresisDelay(hysteresisDelay),
+m_knownSources(0),
+m_requestedSources(0),
+m_streamSources(0),
+m_supportedSources(supportedSources)
+{
+	m_lastRequestTimes.fill(0);
+}
+
+std::size_t KinectStreamPlanner::GetRestartCount() const
+{
+	return m_restartCount;
+}
+
+SourceFlags KinectStreamPlanner::GetStreamSources() const
+{
+	return m_streamSources;
+}
+
+void KinectStreamPlanner::RegisterRestart()
+{
+	RegisterRestart(os_gettime_ns());
+}
+
+void KinectStreamPlanner::RegisterRestart(std::uint64_t now)
+{
+	m_restartCount++;
+
+	// Streams are restarted anyway, it's the right time to stop streaming sources nobody requested for a while
+	if (m_requestedSources != 0)
+	{
+		m_streamSources = m_requestedSources | GetRecentSources(now);
+		m_knownSources &= m_streamSources;
+	}
+
+	infolog("restarting %s streams (restart #%zu), streaming %s for %s", m_deviceName.c_str(), m_restartCount, EnabledSourceToString(m_streamSources).c_str(), EnabledSourceToString(m_requestedSources).c_str());
+}
+
+bool KinectStreamPlanner::Update(SourceFlags requestedSources)
+{
+	return Update(requestedSources, os_gettime_ns());
+}
+
+bool KinectStreamPlanner::Update(SourceFlags requestedSources, std::uint64_t now)
+{
+	for (std::size_t i = 0; i < m_lastRequestTimes.size(); ++i)
+	{
+		if (requestedSources & (SourceFlags(1) << i))
+			m_lastRequestTimes[i] = now;
+	}
+
+	m_knownSources |= requestedSources & m_supportedSources;
+	m_requestedSources = requestedSources;
+
+	SourceFlags streamSources;
+	if (requestedSources == 0)
+		streamSources = 0; //< no access left, cameras can stop
+	else if (m_streamSources == 0)
+		streamSources = requestedSources | m_knownSources; //< cameras are starting, include sources requested previously
+	else if (requestedSources & ~m_streamSources)
+	{
+		// A new source requires a restart, drop stale sources at the same time
+		streamSources = requestedSources | GetRecentSources(now);
+		m_knownSources &= streamSources;
+	}
+	else
+		return false; //< never shrink running streams
+
+	if (streamSources == m_streamSources)
+		return false;
+
+	m_streamSources = streamSources;
+	return true;
+}
+
+SourceFlags KinectStreamPlanner::GetRecentSources(std::uint64_t now) const
+{
+	SourceFlags recentSources = 0;
+	for (std::size_t i = 0; i < m_lastRequestTimes.size(); ++i)
+	{
+		SourceFlags sourceFlag = SourceFlags(1) << i;
+		if ((m_knownSources & sourceFlag) && now - m_lastRequestTimes[i] < m_hysteresisDelay)
+			recentSources |= sourceFlag;
+	}
+
+	return recentSources;
+}
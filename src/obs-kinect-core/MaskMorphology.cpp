@@ -0,0 +1,172 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect-core/MaskMorphology.hpp>
+#include <obs-kinect-core/SimdHelper.hpp>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	template<bool Max>
+	std::uint8_t Combine(std::uint8_t lhs, std::uint8_t rhs)
+	{
+		if constexpr (Max)
+			return std::max(lhs, rhs);
+		else
+			return std::min(lhs, rhs);
+	}
+
+	template<bool Max>
+	void CombineRows(const std::uint8_t* lhs, const std::uint8_t* rhs, std::uint8_t* output, std::size_t count)
+	{
+		std::size_t i = 0;
+#if OBSKINECT_SSE2
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i lhsValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&lhs[i]));
+			__m128i rhsValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&rhs[i]));
+
+			__m128i result;
+			if constexpr (Max)
+				result = _mm_max_epu8(lhsValues, rhsValues);
+			else
+				result = _mm_min_epu8(lhsValues, rhsValues);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&output[i]), result);
+		}
+#endif
+
+		for (; i < count; ++i)
+			output[i] = Combine<Max>(lhs[i], rhs[i]);
+	}
+}
+
+void MaskMorphology::Apply(MorphologyOperation operation, std::size_t radius, const std::uint8_t* input, std::uint32_t inputPitch, std::uint8_t* output, std::uint32_t outputPitch, std::uint32_t width, std::uint32_t height)
+{
+	if (width == 0 || height == 0)
+		return;
+
+	if (operation == MorphologyOperation::None || radius == 0)
+	{
+		if (input != output)
+		{
+			for (std::uint32_t y = 0; y < height; ++y)
+				std::memcpy(&output[y * outputPitch], &input[y * inputPitch], width);
+		}
+
+		return;
+	}
+
+	switch (operation)
+	{
+		case MorphologyOperation::Erode:
+			Filter<false>(radius, input, inputPitch, output, outputPitch, width, height);
+			break;
+
+		case MorphologyOperation::Dilate:
+			Filter<true>(radius, input, inputPitch, output, outputPitch, width, height);
+			break;
+
+		case MorphologyOperation::Open:
+			Filter<false>(radius, input, inputPitch, output, outputPitch, width, height);
+			Filter<true>(radius, output, outputPitch, output, outputPitch, width, height);
+			break;
+
+		case MorphologyOperation::Close:
+			Filter<true>(radius, input, inputPitch, output, outputPitch, width, height);
+			Filter<false>(radius, output, outputPitch, output, outputPitch, width, height);
+			break;
+
+		case MorphologyOperation::None:
+			break;
+	}
+}
+
+template<bool Max>
+void MaskMorphology::Filter(std::size_t radius, const std::uint8_t* input, std::uint32_t inputPitch, std::uint8_t* output, std::uint32_t outputPitch, std::uint32_t width, std::uint32_t height)
+{
+	// van Herk/Gil-Werman: split the (edge-replicated) signal in blocks of windowSize elements,
+	// compute a running min/max from the start (forward) and from the end (backward) of each block,
+	// any window then spans at most two blocks and its result is op(backward[x], forward[x + windowSize - 1])
+	const std::size_t windowSize = 2 * radius + 1;
+
+	m_intermediateImage.resize(std::size_t(width) * height);
+
+	// Horizontal pass (one row at a time)
+	const std::size_t paddedWidth = width + 2 * radius;
+	m_paddedLine.resize(paddedWidth);
+	m_forwardBuffer.resize(paddedWidth);
+	m_backwardBuffer.resize(paddedWidth);
+
+	for (std::uint32_t y = 0; y < height; ++y)
+	{
+		const std::uint8_t* inputRow = &input[y * inputPitch];
+
+		std::memset(&m_paddedLine[0], inputRow[0], radius);
+		std::memcpy(&m_paddedLine[radius], inputRow, width);
+		std::memset(&m_paddedLine[radius + width], inputRow[width - 1], radius);
+
+		for (std::size_t i = 0; i < paddedWidth; ++i)
+			m_forwardBuffer[i] = (i % windowSize == 0) ? m_paddedLine[i] : Combine<Max>(m_forwardBuffer[i - 1], m_paddedLine[i]);
+
+		m_backwardBuffer[paddedWidth - 1] = m_paddedLine[paddedWidth - 1];
+		for (std::size_t i = paddedWidth - 1; i > 0; --i)
+		{
+			std::size_t index = i - 1;
+			m_backwardBuffer[index] = ((index + 1) % windowSize == 0) ? m_paddedLine[index] : Combine<Max>(m_backwardBuffer[index + 1], m_paddedLine[index]);
+		}
+
+		std::uint8_t* outputRow = &m_intermediateImage[y * width];
+		for (std::uint32_t x = 0; x < width; ++x)
+			outputRow[x] = Combine<Max>(m_backwardBuffer[x], m_forwardBuffer[x + windowSize - 1]);
+	}
+
+	// Vertical pass, same algorithm working on whole rows (which makes it easily vectorizable)
+	const std::size_t paddedHeight = height + 2 * radius;
+	m_forwardBuffer.resize(paddedHeight * width);
+	m_backwardBuffer.resize(paddedHeight * width);
+
+	auto GetPaddedRow = [&](std::size_t index) -> const std::uint8_t*
+	{
+		std::size_t y = std::clamp<std::size_t>(index, radius, radius + height - 1) - radius;
+		return &m_intermediateImage[y * width];
+	};
+
+	for (std::size_t i = 0; i < paddedHeight; ++i)
+	{
+		std::uint8_t* forwardRow = &m_forwardBuffer[i * width];
+		if (i % windowSize == 0)
+			std::memcpy(forwardRow, GetPaddedRow(i), width);
+		else
+			CombineRows<Max>(forwardRow - width, GetPaddedRow(i), forwardRow, width);
+	}
+
+	std::memcpy(&m_backwardBuffer[(paddedHeight - 1) * width], GetPaddedRow(paddedHeight - 1), width);
+	for (std::size_t i = paddedHeight - 1; i > 0; --i)
+	{
+		std::size_t index = i - 1;
+		std::uint8_t* backwardRow = &m_backwardBuffer[index * width];
+		if ((index + 1) % windowSize == 0)
+			std::memcpy(backwardRow, GetPaddedRow(index), width);
+		else
+			CombineRows<Max>(backwardRow + width, GetPaddedRow(index), backwardRow, width);
+	}
+
+	for (std::uint32_t y = 0; y < height; ++y)
+		CombineRows<Max>(&m_backwardBuffer[y * width], &m_forwardBuffer[(y + windowSize - 1) * width], &output[y * outputPitch], width);
+}
@@ -0,0 +1,573 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect-core/PlaneCodec.hpp>
+#include <obs-kinect-core/SimdHelper.hpp>
+#include <obs-kinect-core/WorkerPool.hpp>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+	// Encoded plane layout: header, encoded size of each band (std::uint32_t) and then band data
+	struct EncodedHeader
+	{
+		PlaneCodecType type;
+		std::uint8_t flags;
+		std::uint16_t bandHeight;
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint32_t bandCount;
+	};
+
+	static_assert(sizeof(EncodedHeader) == 16);
+
+	constexpr std::uint8_t Flag_Temporal = 1 << 0;
+
+	unsigned CountTrailingZeros(std::uint32_t mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+#else
+		return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+	}
+
+	// Residuals: difference for depth-like values, xor for indices (so unchanged pixels are zero in both cases)
+	void ApplyResidual(std::uint8_t* pixels, const std::uint8_t* reference, std::uint32_t width)
+	{
+		std::uint32_t x = 0;
+#if OBSKINECT_SSE2
+		for (; x + 16 <= width; x += 16)
+		{
+			__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pixels[x]));
+			__m128i ref = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&reference[x]));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pixels[x]), _mm_xor_si128(value, ref));
+		}
+#endif
+
+		for (; x < width; ++x)
+			pixels[x] ^= reference[x];
+	}
+
+	void ApplyResidual(std::uint16_t* pixels, const std::uint16_t* reference, std::uint32_t width)
+	{
+		std::uint32_t x = 0;
+#if OBSKINECT_SSE2
+		for (; x + 8 <= width; x += 8)
+		{
+			__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pixels[x]));
+			__m128i ref = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&reference[x]));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pixels[x]), _mm_add_epi16(value, ref));
+		}
+#endif
+
+		for (; x < width; ++x)
+			pixels[x] = static_cast<std::uint16_t>(pixels[x] + reference[x]);
+	}
+
+	void ComputeResidual(const std::uint8_t* pixels, const std::uint8_t* reference, std::uint8_t* output, std::uint32_t width)
+	{
+		std::uint32_t x = 0;
+#if OBSKINECT_SSE2
+		for (; x + 16 <= width; x += 16)
+		{
+			__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pixels[x]));
+			__m128i ref = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&reference[x]));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&output[x]), _mm_xor_si128(value, ref));
+		}
+#endif
+
+		for (; x < width; ++x)
+			output[x] = pixels[x] ^ reference[x];
+	}
+
+	void ComputeResidual(const std::uint16_t* pixels, const std::uint16_t* reference, std::uint16_t* output, std::uint32_t width)
+	{
+		std::uint32_t x = 0;
+#if OBSKINECT_SSE2
+		for (; x + 8 <= width; x += 8)
+		{
+			__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pixels[x]));
+			__m128i ref = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&reference[x]));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&output[x]), _mm_sub_epi16(value, ref));
+		}
+#endif
+
+		for (; x < width; ++x)
+			output[x] = static_cast<std::uint16_t>(pixels[x] - reference[x]);
+	}
+
+	// Returns the index of the first pixel in [begin, count[ which is (or isn't) zero
+	template<bool Zero>
+	std::size_t FindPixel(const std::uint16_t* pixels, std::size_t begin, std::size_t count)
+	{
+		std::size_t i = begin;
+#if OBSKINECT_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pixels[i]));
+			std::uint32_t zeroMask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(value, zero)));
+			std::uint32_t mask = (Zero) ? zeroMask : ~zeroMask & 0xFFFF;
+			if (mask != 0)
+				return i + CountTrailingZeros(mask) / 2;
+		}
+#endif
+
+		for (; i < count; ++i)
+		{
+			if ((pixels[i] == 0) == Zero)
+				break;
+		}
+
+		return i;
+	}
+
+	// Returns the index of the first pixel in [begin, count[ which differs from value
+	std::size_t FindRunEnd(const std::uint8_t* pixels, std::size_t begin, std::size_t count, std::uint8_t value)
+	{
+		std::size_t i = begin;
+#if OBSKINECT_SSE2
+		const __m128i ref = _mm_set1_epi8(static_cast<char>(value));
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pixels[i]));
+			std::uint32_t mask = ~static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, ref))) & 0xFFFF;
+			if (mask != 0)
+				return i + CountTrailingZeros(mask);
+		}
+#endif
+
+		for (; i < count; ++i)
+		{
+			if (pixels[i] != value)
+				break;
+		}
+
+		return i;
+	}
+
+	// RVL variable length coding: 3 bits of value and a continuation bit per nibble, nibbles are packed in 32bits words
+	struct NibbleWriter
+	{
+		void Finish()
+		{
+			if (nibbleCount > 0)
+			{
+				word <<= 4 * (8 - nibbleCount);
+				FlushWord();
+			}
+		}
+
+		void FlushWord()
+		{
+			std::memcpy(ptr, &word, sizeof(word));
+			ptr += sizeof(word);
+			word = 0;
+			nibbleCount = 0;
+		}
+
+		void Write(std::uint32_t value)
+		{
+			do
+			{
+				std::uint32_t nibble = value & 0x7;
+				value >>= 3;
+				if (value)
+					nibble |= 0x8;
+
+				word = (word << 4) | nibble;
+				if (++nibbleCount == 8)
+					FlushWord();
+			}
+			while (value);
+		}
+
+		std::uint8_t* ptr;
+		std::uint32_t word = 0;
+		unsigned int nibbleCount = 0;
+	};
+
+	struct NibbleReader
+	{
+		std::uint32_t Read()
+		{
+			std::uint32_t value = 0;
+			unsigned int shift = 0;
+			for (;;)
+			{
+				if (nibbleCount == 0)
+				{
+					if (end - ptr < std::ptrdiff_t(sizeof(word)))
+						throw std::runtime_error("truncated band");
+
+					std::memcpy(&word, ptr, sizeof(word));
+					ptr += sizeof(word);
+					nibbleCount = 8;
+				}
+
+				std::uint32_t nibble = word >> 28;
+				word <<= 4;
+				nibbleCount--;
+
+				value |= (nibble & 0x7) << shift;
+				if ((nibble & 0x8) == 0)
+					return value;
+
+				shift += 3;
+				if (shift >= 32)
+					throw std::runtime_error("invalid value");
+			}
+		}
+
+		const std::uint8_t* ptr;
+		const std::uint8_t* end;
+		std::uint32_t word = 0;
+		unsigned int nibbleCount = 0;
+	};
+
+	void EncodeRvl(const std::uint16_t* pixels, std::size_t pixelCount, std::vector<std::uint8_t>& output)
+	{
+		// Worst case is alternating single zero/non-zero pixels: 8 nibbles per pixel pair, plus the last partial word
+		output.resize(pixelCount * 4 + 16);
+
+		NibbleWriter writer;
+		writer.ptr = output.data();
+
+		int previous = 0;
+		std::size_t i = 0;
+		while (i < pixelCount)
+		{
+			std::size_t zeroBegin = i;
+			i = FindPixel<false>(pixels, i, pixelCount);
+			writer.Write(static_cast<std::uint32_t>(i - zeroBegin));
+
+			std::size_t nonZeroBegin = i;
+			i = FindPixel<true>(pixels, i, pixelCount);
+			writer.Write(static_cast<std::uint32_t>(i - nonZeroBegin));
+
+			for (std::size_t j = nonZeroBegin; j < i; ++j)
+			{
+				int delta = int(pixels[j]) - previous;
+				previous = pixels[j];
+
+				writer.Write((static_cast<std::uint32_t>(delta) << 1) ^ static_cast<std::uint32_t>(delta >> 31)); //< zigzag
+			}
+		}
+
+		writer.Finish();
+		output.resize(writer.ptr - output.data());
+	}
+
+	void DecodeRvl(const std::uint8_t* data, std::size_t dataSize, std::uint16_t* pixels, std::size_t pixelCount)
+	{
+		NibbleReader reader;
+		reader.ptr = data;
+		reader.end = data + dataSize;
+
+		std::uint32_t previous = 0; //< unsigned so that invalid data can't overflow
+		std::size_t i = 0;
+		while (i < pixelCount)
+		{
+			std::uint32_t zeroCount = reader.Read();
+			if (zeroCount > pixelCount - i)
+				throw std::runtime_error("invalid zero run");
+
+			std::fill_n(&pixels[i], zeroCount, std::uint16_t(0));
+			i += zeroCount;
+
+			std::uint32_t nonZeroCount = reader.Read();
+			if (nonZeroCount > pixelCount - i)
+				throw std::runtime_error("invalid value run");
+
+			for (std::uint32_t j = 0; j < nonZeroCount; ++j)
+			{
+				std::uint32_t value = reader.Read();
+				previous += (value >> 1) ^ (0U - (value & 1));
+
+				pixels[i++] = static_cast<std::uint16_t>(previous);
+			}
+		}
+	}
+
+	void EncodeRle(const std::uint8_t* pixels, std::size_t pixelCount, std::vector<std::uint8_t>& output)
+	{
+		// Worst case is a run per pixel (value and a one byte length)
+		output.resize(pixelCount * 2);
+
+		std::uint8_t* ptr = output.data();
+		std::size_t i = 0;
+		while (i < pixelCount)
+		{
+			std::uint8_t value = pixels[i];
+			std::size_t runEnd = FindRunEnd(pixels, i + 1, pixelCount, value);
+
+			*ptr++ = value;
+
+			// Run length minus one, as LEB128
+			std::size_t length = runEnd - i - 1;
+			while (length >= 0x80)
+			{
+				*ptr++ = static_cast<std::uint8_t>(length | 0x80);
+				length >>= 7;
+			}
+			*ptr++ = static_cast<std::uint8_t>(length);
+
+			i = runEnd;
+		}
+
+		output.resize(ptr - output.data());
+	}
+
+	void DecodeRle(const std::uint8_t* data, std::size_t dataSize, std::uint8_t* pixels, std::size_t pixelCount)
+	{
+		const std::uint8_t* ptr = data;
+		const std::uint8_t* end = data + dataSize;
+
+		std::size_t i = 0;
+		while (i < pixelCount)
+		{
+			if (ptr == end)
+				throw std::runtime_error("truncated band");
+
+			std::uint8_t value = *ptr++;
+
+			std::size_t length = 0;
+			for (unsigned int shift = 0;; shift += 7)
+			{
+				if (ptr == end || shift >= 35)
+					throw std::runtime_error("invalid run length");
+
+				std::uint8_t byte = *ptr++;
+				length |= std::size_t(byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0)
+					break;
+			}
+
+			if (length >= pixelCount - i)
+				throw std::runtime_error("invalid run length");
+
+			std::memset(&pixels[i], value, length + 1);
+			i += length + 1;
+		}
+	}
+}
+
+PlaneCodec::PlaneCodec(WorkerPool* workerPool) :
+m_workerPool(workerPool)
+{
+}
+
+void PlaneCodec::DecodeBodyIndex(const std::uint8_t* input, std::size_t inputSize, std::uint8_t* output, std::uint32_t outputPitch, const std::uint8_t* reference, std::uint32_t referencePitch)
+{
+	Decode(PlaneCodecType::Rle8, input, inputSize, output, outputPitch, reference, referencePitch, &DecodeRle);
+}
+
+void PlaneCodec::DecodeDepth(const std::uint8_t* input, std::size_t inputSize, std::uint16_t* output, std::uint32_t outputPitch, const std::uint16_t* reference, std::uint32_t referencePitch)
+{
+	Decode(PlaneCodecType::Rvl16, input, inputSize, output, outputPitch, reference, referencePitch, &DecodeRvl);
+}
+
+void PlaneCodec::EncodeBodyIndex(const std::uint8_t* input, std::uint32_t inputPitch, std::uint32_t width, std::uint32_t height, std::vector<std::uint8_t>& output, const std::uint8_t* reference, std::uint32_t referencePitch)
+{
+	Encode(PlaneCodecType::Rle8, input, inputPitch, width, height, output, reference, referencePitch, &EncodeRle);
+}
+
+void PlaneCodec::EncodeDepth(const std::uint16_t* input, std::uint32_t inputPitch, std::uint32_t width, std::uint32_t height, std::vector<std::uint8_t>& output, const std::uint16_t* reference, std::uint32_t referencePitch)
+{
+	Encode(PlaneCodecType::Rvl16, input, inputPitch, width, height, output, reference, referencePitch, &EncodeRvl);
+}
+
+auto PlaneCodec::ReadPlaneInfo(const std::uint8_t* input, std::size_t inputSize) -> PlaneInfo
+{
+	EncodedHeader header;
+	if (inputSize < sizeof(header))
+		throw std::runtime_error("truncated plane");
+
+	std::memcpy(&header, input, sizeof(header));
+	if (header.type != PlaneCodecType::Rvl16 && header.type != PlaneCodecType::Rle8)
+		throw std::runtime_error("unknown plane codec " + std::to_string(static_cast<int>(header.type)));
+
+	if (header.bandHeight == 0 || header.bandCount != (std::uint64_t(header.height) + header.bandHeight - 1) / header.bandHeight)
+		throw std::runtime_error("invalid band count");
+
+	PlaneInfo info;
+	info.type = header.type;
+	info.width = header.width;
+	info.height = header.height;
+	info.temporal = (header.flags & Flag_Temporal) != 0;
+
+	return info;
+}
+
+template<typename T, typename DecodeFunc>
+void PlaneCodec::Decode(PlaneCodecType type, const std::uint8_t* input, std::size_t inputSize, T* output, std::uint32_t outputPitch, const T* reference, std::uint32_t referencePitch, DecodeFunc&& decodeBand)
+{
+	PlaneInfo info = ReadPlaneInfo(input, inputSize);
+	if (info.type != type)
+		throw std::runtime_error("unexpected plane codec " + std::to_string(static_cast<int>(info.type)));
+
+	if (info.temporal && !reference)
+		throw std::runtime_error("plane requires a reference");
+
+	EncodedHeader header;
+	std::memcpy(&header, input, sizeof(header));
+
+	std::size_t tableSize = std::size_t(header.bandCount) * sizeof(std::uint32_t);
+	if (inputSize - sizeof(header) < tableSize)
+		throw std::runtime_error("truncated plane");
+
+	// Band offsets, validated before any decoding starts
+	std::vector<std::size_t> bandOffsets(header.bandCount + 1);
+	bandOffsets[0] = sizeof(header) + tableSize;
+	for (std::uint32_t band = 0; band < header.bandCount; ++band)
+	{
+		std::uint32_t bandSize;
+		std::memcpy(&bandSize, input + sizeof(header) + band * sizeof(std::uint32_t), sizeof(bandSize));
+
+		if (bandSize > inputSize - bandOffsets[band])
+			throw std::runtime_error("truncated plane");
+
+		bandOffsets[band + 1] = bandOffsets[band] + bandSize;
+	}
+
+	std::size_t rowSize = std::size_t(info.width) * sizeof(T);
+	bool contiguous = (outputPitch == rowSize);
+	if (!contiguous)
+		m_planeBuffer.resize(rowSize * info.height);
+
+	ForEachBand(header.bandCount, [&](std::uint32_t band)
+	{
+		std::uint32_t firstRow = band * header.bandHeight;
+		std::uint32_t rowCount = std::min<std::uint32_t>(header.bandHeight, info.height - firstRow);
+
+		T* bandPixels;
+		if (contiguous)
+			bandPixels = reinterpret_cast<T*>(reinterpret_cast<std::uint8_t*>(output) + firstRow * rowSize);
+		else
+			bandPixels = reinterpret_cast<T*>(&m_planeBuffer[firstRow * rowSize]);
+
+		decodeBand(input + bandOffsets[band], bandOffsets[band + 1] - bandOffsets[band], bandPixels, std::size_t(info.width) * rowCount);
+
+		for (std::uint32_t y = firstRow; y < firstRow + rowCount; ++y)
+		{
+			T* outputRow = reinterpret_cast<T*>(reinterpret_cast<std::uint8_t*>(output) + y * outputPitch);
+			if (!contiguous)
+				std::memcpy(outputRow, &bandPixels[(y - firstRow) * info.width], rowSize);
+
+			if (info.temporal)
+				ApplyResidual(outputRow, reinterpret_cast<const T*>(reinterpret_cast<const std::uint8_t*>(reference) + y * referencePitch), info.width);
+		}
+	});
+}
+
+template<typename T, typename EncodeFunc>
+void PlaneCodec::Encode(PlaneCodecType type, const T* input, std::uint32_t inputPitch, std::uint32_t width, std::uint32_t height, std::vector<std::uint8_t>& output, const T* reference, std::uint32_t referencePitch, EncodeFunc&& encodeBand)
+{
+	std::uint32_t bandCount = (height + BandHeight - 1) / BandHeight;
+	if (m_bandBuffers.size() < bandCount)
+		m_bandBuffers.resize(bandCount);
+
+	// Bands are coded from contiguous pixels, copy them (or compute residuals) if input isn't
+	std::size_t rowSize = std::size_t(width) * sizeof(T);
+	bool contiguous = (inputPitch == rowSize && !reference);
+	if (!contiguous)
+		m_planeBuffer.resize(rowSize * height);
+
+	ForEachBand(bandCount, [&](std::uint32_t band)
+	{
+		std::uint32_t firstRow = band * BandHeight;
+		std::uint32_t rowCount = std::min(BandHeight, height - firstRow);
+
+		const T* bandPixels;
+		if (contiguous)
+			bandPixels = reinterpret_cast<const T*>(reinterpret_cast<const std::uint8_t*>(input) + firstRow * rowSize);
+		else
+		{
+			T* planePixels = reinterpret_cast<T*>(&m_planeBuffer[firstRow * rowSize]);
+			for (std::uint32_t y = firstRow; y < firstRow + rowCount; ++y)
+			{
+				const T* inputRow = reinterpret_cast<const T*>(reinterpret_cast<const std::uint8_t*>(input) + y * inputPitch);
+				T* outputRow = &planePixels[(y - firstRow) * width];
+				if (reference)
+					ComputeResidual(inputRow, reinterpret_cast<const T*>(reinterpret_cast<const std::uint8_t*>(reference) + y * referencePitch), outputRow, width);
+				else
+					std::memcpy(outputRow, inputRow, rowSize);
+			}
+
+			bandPixels = planePixels;
+		}
+
+		encodeBand(bandPixels, std::size_t(width) * rowCount, m_bandBuffers[band]);
+	});
+
+	EncodedHeader header;
+	header.type = type;
+	header.flags = (reference) ? Flag_Temporal : 0;
+	header.bandHeight = BandHeight;
+	header.width = width;
+	header.height = height;
+	header.bandCount = bandCount;
+
+	std::size_t outputSize = sizeof(header) + bandCount * sizeof(std::uint32_t);
+	for (std::uint32_t band = 0; band < bandCount; ++band)
+		outputSize += m_bandBuffers[band].size();
+
+	output.resize(outputSize);
+
+	std::uint8_t* ptr = output.data();
+	std::memcpy(ptr, &header, sizeof(header));
+	ptr += sizeof(header);
+
+	for (std::uint32_t band = 0; band < bandCount; ++band)
+	{
+		std::uint32_t bandSize = static_cast<std::uint32_t>(m_bandBuffers[band].size());
+		std::memcpy(ptr, &bandSize, sizeof(bandSize));
+		ptr += sizeof(bandSize);
+	}
+
+	for (std::uint32_t band = 0; band < bandCount; ++band)
+	{
+		std::memcpy(ptr, m_bandBuffers[band].data(), m_bandBuffers[band].size());
+		ptr += m_bandBuffers[band].size();
+	}
+}
+
+void PlaneCodec::ForEachBand(std::uint32_t bandCount, const std::function<void(std::uint32_t band)>& func)
+{
+	if (!m_workerPool)
+	{
+		for (std::uint32_t band = 0; band < bandCount; ++band)
+			func(band);
+
+		return;
+	}
+
+	m_workerPool->ParallelFor(bandCount, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t band = begin; band < end; ++band)
+			func(band);
+	});
+}
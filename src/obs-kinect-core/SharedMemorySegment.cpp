@@ -0,0 +1,220 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include <obs-kinect-core/SharedMemorySegment.hpp>
+#include <util/platform.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <obs-kinect-core/Win32Helper.hpp>
+#else
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <climits>
+#include <ctime>
+#endif
+
+SharedMemorySegment::SharedMemorySegment(std::string name, std::uint8_t* data, std::size_t size) :
+m_name(std::move(name)),
+m_data(data),
+m_size(size)
+{
+}
+
+SharedMemorySegment::SharedMemorySegment(SharedMemorySegment&& segment) noexcept :
+m_name(std::move(segment.m_name)),
+m_data(segment.m_data),
+m_size(segment.m_size)
+{
+	segment.m_data = nullptr;
+	segment.m_size = 0;
+}
+
+SharedMemorySegment::~SharedMemorySegment()
+{
+#ifndef _WIN32
+	if (m_data)
+		munmap(m_data, m_size);
+#endif
+}
+
+std::uint8_t* SharedMemorySegment::GetData() const
+{
+	return m_data;
+}
+
+const std::string& SharedMemorySegment::GetName() const
+{
+	return m_name;
+}
+
+std::size_t SharedMemorySegment::GetSize() const
+{
+	return m_size;
+}
+
+SharedMemorySegment& SharedMemorySegment::operator=(SharedMemorySegment&& segment) noexcept
+{
+	std::swap(m_name, segment.m_name);
+	std::swap(m_data, segment.m_data);
+	std::swap(m_size, segment.m_size);
+
+	return *this;
+}
+
+std::optional<SharedMemorySegment> SharedMemorySegment::Create(const std::string& name, std::size_t size)
+{
+#ifdef _WIN32
+	throw std::runtime_error("shared memory is not supported on this platform");
+#else
+	int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0)
+	{
+		if (errno == EEXIST)
+			return {};
+
+		throw std::runtime_error("failed to create " + name + ": " + std::strerror(errno));
+	}
+
+	if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+	{
+		int error = errno;
+		close(fd);
+		shm_unlink(name.c_str());
+
+		throw std::runtime_error("failed to resize " + name + ": " + std::strerror(error));
+	}
+
+	void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	int error = errno;
+	close(fd); //< mapping stays valid
+
+	if (data == MAP_FAILED)
+	{
+		shm_unlink(name.c_str());
+		throw std::runtime_error("failed to map " + name + ": " + std::strerror(error));
+	}
+
+	return SharedMemorySegment(name, static_cast<std::uint8_t*>(data), size);
+#endif
+}
+
+std::optional<SharedMemorySegment> SharedMemorySegment::Open(const std::string& name)
+{
+#ifdef _WIN32
+	throw std::runtime_error("shared memory is not supported on this platform");
+#else
+	int fd = shm_open(name.c_str(), O_RDWR, 0);
+	if (fd < 0)
+	{
+		if (errno == ENOENT)
+			return {};
+
+		throw std::runtime_error("failed to open " + name + ": " + std::strerror(errno));
+	}
+
+	struct stat fileStats;
+	if (fstat(fd, &fileStats) != 0 || fileStats.st_size <= 0)
+	{
+		close(fd);
+		return {}; //< being created
+	}
+
+	std::size_t size = static_cast<std::size_t>(fileStats.st_size);
+	void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	int error = errno;
+	close(fd);
+
+	if (data == MAP_FAILED)
+		throw std::runtime_error("failed to map " + name + ": " + std::strerror(error));
+
+	return SharedMemorySegment(name, static_cast<std::uint8_t*>(data), size);
+#endif
+}
+
+void SharedMemorySegment::Unlink(const std::string& name)
+{
+#ifndef _WIN32
+	shm_unlink(name.c_str());
+#endif
+}
+
+bool SharedMemorySegment::IsProcessAlive(std::uint64_t processId)
+{
+#ifdef _WIN32
+	HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(processId));
+	if (!process)
+		return false;
+
+	bool alive = (WaitForSingleObject(process, 0) == WAIT_TIMEOUT);
+	CloseHandle(process);
+
+	return alive;
+#else
+	return kill(static_cast<pid_t>(processId), 0) == 0 || errno == EPERM;
+#endif
+}
+
+std::uint64_t SharedMemorySegment::GetCurrentProcessId()
+{
+#ifdef _WIN32
+	return ::GetCurrentProcessId();
+#else
+	return static_cast<std::uint64_t>(getpid());
+#endif
+}
+
+void SharedMemorySegment::WaitForChange(const std::atomic<std::uint32_t>& word, std::uint32_t value, std::uint32_t timeoutMs)
+{
+#ifdef __linux__
+	// std::atomic<std::uint32_t> is lock-free and has the same representation as std::uint32_t
+	timespec timeout;
+	timeout.tv_sec = timeoutMs / 1000;
+	timeout.tv_nsec = (timeoutMs % 1000) * 1'000'000L;
+
+	syscall(SYS_futex, reinterpret_cast<const std::uint32_t*>(&word), FUTEX_WAIT, value, &timeout, nullptr, 0);
+#else
+	// No portable cross-process wait, poll at a rate high enough for camera framerates
+	std::uint32_t elapsed = 0;
+	while (word.load(std::memory_order_acquire) == value && elapsed < timeoutMs)
+	{
+		os_sleep_ms(2);
+		elapsed += 2;
+	}
+#endif
+}
+
+void SharedMemorySegment::WakeAll(std::atomic<std::uint32_t>& word)
+{
+#ifdef __linux__
+	syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+	static_cast<void>(word);
+#endif
+}
@@ -0,0 +1,128 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect-core/SoftwareDepthMapper.hpp>
+#include <limits>
+
+const std::uint8_t* SoftwareDepthMapper::MapBodyIndex(const ColorFrameData& colorFrame, const DepthFrameData& depthFrame, const BodyIndexFrameData& bodyIndexFrame, const DepthMappingFrameData& depthMappingFrame, std::uint8_t maxDirtyDepth)
+{
+	constexpr float InvalidDepth = -std::numeric_limits<float>::infinity();
+
+	const DepthMappingFrameData::DepthCoordinates* depthMapping = reinterpret_cast<const DepthMappingFrameData::DepthCoordinates*>(depthMappingFrame.ptr.get());
+	const std::uint8_t* bodyPixels = reinterpret_cast<const std::uint8_t*>(bodyIndexFrame.ptr.get());
+
+	m_bodyMappingMemory.resize(colorFrame.width * colorFrame.height * sizeof(std::uint8_t), InvalidBodyIndexOutput);
+	m_bodyMappingDirtyCounter.resize(colorFrame.width * colorFrame.height, 0);
+	std::uint8_t* bodyIndexOutput = m_bodyMappingMemory.data();
+
+	for (std::size_t y = 0; y < colorFrame.height; ++y)
+	{
+		for (std::size_t x = 0; x < colorFrame.width; ++x)
+		{
+			std::uint8_t& dirtyCounter = m_bodyMappingDirtyCounter[y * colorFrame.width + x];
+			std::uint8_t* output = &bodyIndexOutput[y * colorFrame.width + x];
+			const auto& depthCoordinates = depthMapping[y * depthMappingFrame.width + x];
+			if (depthCoordinates.x == InvalidDepth || depthCoordinates.y == InvalidDepth)
+			{
+				if (++dirtyCounter > maxDirtyDepth)
+					*output = InvalidBodyIndexOutput;
+
+				continue;
+			}
+
+			int dX = static_cast<int>(depthCoordinates.x + 0.5f);
+			int dY = static_cast<int>(depthCoordinates.y + 0.5f);
+
+			if (dX < 0 || dX >= int(depthFrame.width) ||
+				dY < 0 || dY >= int(depthFrame.height))
+			{
+				if (++dirtyCounter > maxDirtyDepth)
+					*output = InvalidBodyIndexOutput;
+
+				continue;
+			}
+
+			*output = bodyPixels[depthFrame.width * dY + dX];
+			dirtyCounter = 0;
+		}
+	}
+
+	return bodyIndexOutput;
+}
+
+const std::uint16_t* SoftwareDepthMapper::MapDepth(const ColorFrameData& colorFrame, const DepthFrameData& depthFrame, const DepthMappingFrameData& depthMappingFrame, std::uint8_t maxDirtyDepth)
+{
+	constexpr float InvalidDepth = -std::numeric_limits<float>::infinity();
+
+	const DepthMappingFrameData::DepthCoordinates* depthMapping = reinterpret_cast<const DepthMappingFrameData::DepthCoordinates*>(depthMappingFrame.ptr.get());
+
+	m_depthMappingMemory.resize(colorFrame.width * colorFrame.height * sizeof(std::uint16_t), InvalidDepthOutput);
+	m_depthMappingDirtyCounter.resize(colorFrame.width * colorFrame.height, 0);
+	std::uint16_t* depthOutput = reinterpret_cast<std::uint16_t*>(m_depthMappingMemory.data());
+
+	for (std::size_t y = 0; y < colorFrame.height; ++y)
+	{
+		for (std::size_t x = 0; x < colorFrame.width; ++x)
+		{
+			std::uint8_t& dirtyCounter = m_depthMappingDirtyCounter[y * colorFrame.width + x];
+			std::uint16_t* output = &depthOutput[y * colorFrame.width + x];
+			const auto& depthCoordinates = depthMapping[y * depthMappingFrame.width + x];
+			if (depthCoordinates.x == InvalidDepth || depthCoordinates.y == InvalidDepth)
+			{
+				if (++dirtyCounter > maxDirtyDepth)
+					*output = InvalidDepthOutput;
+
+				continue;
+			}
+
+			int dX = static_cast<int>(depthCoordinates.x + 0.5f);
+			int dY = static_cast<int>(depthCoordinates.y + 0.5f);
+
+			if (dX < 0 || dX >= int(depthFrame.width) ||
+				dY < 0 || dY >= int(depthFrame.height))
+			{
+				if (++dirtyCounter > maxDirtyDepth)
+					*output = InvalidDepthOutput;
+
+				continue;
+			}
+
+			*output = depthFrame.ptr[depthFrame.width * dY + dX];
+			dirtyCounter = 0;
+		}
+	}
+
+	return depthOutput;
+}
+
+void SoftwareDepthMapper::ReleaseBodyIndexMapping()
+{
+	m_bodyMappingMemory.clear();
+	m_bodyMappingMemory.shrink_to_fit();
+
+	m_bodyMappingDirtyCounter.clear();
+	m_bodyMappingDirtyCounter.shrink_to_fit();
+}
+
+void SoftwareDepthMapper::ReleaseDepthMapping()
+{
+	m_depthMappingMemory.clear();
+	m_depthMappingMemory.shrink_to_fit();
+
+	m_depthMappingDirtyCounter.clear();
+	m_depthMappingDirtyCounter.shrink_to_fit();
+}
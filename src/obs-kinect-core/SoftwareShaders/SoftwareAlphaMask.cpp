@@ -0,0 +1,106 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect-core/SoftwareShaders/SoftwareAlphaMask.hpp>
+#include <obs-kinect-core/SimdHelper.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareSampling.hpp>
+
+SoftwareAlphaMask::SoftwareAlphaMask(gs_color_format colorFormat, WorkerPool* workerPool) :
+m_colorFormat(colorFormat),
+m_workerPool(workerPool)
+{
+	if (colorFormat != GS_RGBA && colorFormat != GS_BGRA)
+		throw std::runtime_error("unsupported software render target format");
+}
+
+SoftwareTexture SoftwareAlphaMask::Filter(const SoftwareTexture& color, const SoftwareTexture& mask)
+{
+	SoftwareTexture renderTarget = PrepareRenderTarget(m_workMemory, m_colorFormat, color.width, color.height);
+
+	// Fast path when no filtering nor format conversion is involved
+	if (color.format == m_colorFormat && mask.format == GS_R8 && mask.width == color.width && mask.height == color.height)
+	{
+		FastFilter(color, mask, renderTarget);
+		return renderTarget;
+	}
+
+	ForEachRowBand(m_workerPool, renderTarget.height, [&](std::uint32_t beginRow, std::uint32_t endRow)
+	{
+		for (std::uint32_t y = beginRow; y < endRow; ++y)
+		{
+			std::uint8_t* row = &m_workMemory[y * renderTarget.pitch];
+			float v = PixelCenter(y, renderTarget.height);
+
+			for (std::uint32_t x = 0; x < renderTarget.width; ++x)
+			{
+				float u = PixelCenter(x, renderTarget.width);
+
+				SoftwareTexel result = SampleLinear(color, u, v);
+				result[3] *= SampleLinear(mask, u, v)[0];
+
+				StoreTexel(row, m_colorFormat, x, result);
+			}
+		}
+	});
+
+	return renderTarget;
+}
+
+void SoftwareAlphaMask::FastFilter(const SoftwareTexture& color, const SoftwareTexture& mask, const SoftwareTexture& renderTarget)
+{
+	ForEachRowBand(m_workerPool, renderTarget.height, [&](std::uint32_t beginRow, std::uint32_t endRow)
+	{
+		for (std::uint32_t y = beginRow; y < endRow; ++y)
+		{
+			const std::uint8_t* colorRow = &color.ptr[y * color.pitch];
+			const std::uint8_t* maskRow = &mask.ptr[y * mask.pitch];
+			std::uint8_t* output = &m_workMemory[y * renderTarget.pitch];
+
+			std::uint32_t x = 0;
+#if OBSKINECT_SSE2
+			const __m128i alphaMask = _mm_set1_epi32(int(0xFF000000));
+			const __m128i half = _mm_set1_epi32(128);
+
+			for (; x + 4 <= renderTarget.width; x += 4)
+			{
+				std::uint32_t maskBytes;
+				std::memcpy(&maskBytes, &maskRow[x], sizeof(maskBytes));
+
+				__m128i colors = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&colorRow[x * 4]));
+
+				// One 32bits lane per pixel: alpha * mask / 255, rounded
+				__m128i masks = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(int(maskBytes)), _mm_setzero_si128()), _mm_setzero_si128());
+				__m128i alphas = _mm_srli_epi32(colors, 24);
+
+				__m128i value = _mm_add_epi32(_mm_madd_epi16(alphas, masks), half);
+				value = _mm_srli_epi32(_mm_add_epi32(value, _mm_srli_epi32(value, 8)), 8);
+
+				__m128i result = _mm_or_si128(_mm_andnot_si128(alphaMask, colors), _mm_slli_epi32(value, 24));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(&output[x * 4]), result);
+			}
+#endif
+
+			for (; x < renderTarget.width; ++x)
+			{
+				std::memcpy(&output[x * 4], &colorRow[x * 4], 3);
+
+				unsigned int value = colorRow[x * 4 + 3] * maskRow[x] + 128;
+				output[x * 4 + 3] = static_cast<std::uint8_t>((value + (value >> 8)) >> 8);
+			}
+		}
+	});
+}
@@ -0,0 +1,210 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect-core/SoftwareShaders/SoftwareGaussianBlur.hpp>
+#include <obs-kinect-core/SimdHelper.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareSampling.hpp>
+
+namespace
+{
+	constexpr std::array<float, 3> KernelOffsets = { 0.0f, 1.3846153846f, 3.2307692308f };
+	constexpr std::array<float, 3> BlurWeights = { 0.2270270270f, 0.3162162162f, 0.0702702703f };
+
+	// The shader uses bilinear filtering to fetch two texels per sample, expand it to a 9-tap kernel (offsets -4 to 4)
+	constexpr float Fraction1 = KernelOffsets[1] - 1.f;
+	constexpr float Fraction2 = KernelOffsets[2] - 3.f;
+
+	constexpr std::array<float, 5> TapWeights = {
+		BlurWeights[0],
+		BlurWeights[1] * (1.f - Fraction1),
+		BlurWeights[1] * Fraction1,
+		BlurWeights[2] * (1.f - Fraction2),
+		BlurWeights[2] * Fraction2
+	};
+}
+
+SoftwareGaussianBlur::SoftwareGaussianBlur(gs_color_format colorFormat, WorkerPool* workerPool) :
+m_colorFormat(colorFormat),
+m_workerPool(workerPool)
+{
+	if (colorFormat != GS_R8 && colorFormat != GS_RGBA && colorFormat != GS_BGRA)
+		throw std::runtime_error("unsupported software render target format");
+}
+
+SoftwareTexture SoftwareGaussianBlur::Blur(const SoftwareTexture& source, std::size_t count)
+{
+	SoftwareTexture workTextureA = PrepareRenderTarget(m_workMemoryA, m_colorFormat, source.width, source.height);
+	SoftwareTexture workTextureB = PrepareRenderTarget(m_workMemoryB, m_colorFormat, source.width, source.height);
+
+	for (std::size_t blurIndex = 0; blurIndex < count; ++blurIndex)
+	{
+		const SoftwareTexture& passSource = (blurIndex == 0) ? source : workTextureB;
+
+		// Fast path when no format conversion is involved, matches the generic path within one unit
+		if (passSource.format == m_colorFormat)
+		{
+			FastBlurHorizontalPass(passSource, m_workMemoryA);
+			FastBlurVerticalPass(workTextureA, m_workMemoryB);
+		}
+		else
+		{
+			BlurPass(passSource, m_workMemoryA, 1.f, 0.f);
+			BlurPass(workTextureA, m_workMemoryB, 0.f, 1.f);
+		}
+	}
+
+	return workTextureB;
+}
+
+void SoftwareGaussianBlur::BlurPass(const SoftwareTexture& source, std::vector<std::uint8_t>& targetMemory, float filterX, float filterY)
+{
+	float invWidth = 1.f / source.width;
+	float invHeight = 1.f / source.height;
+
+	// Render targets have the source size
+	std::uint32_t targetPitch = source.width * GetSoftwareBytesPerPixel(m_colorFormat);
+
+	ForEachRowBand(m_workerPool, source.height, [&](std::uint32_t beginRow, std::uint32_t endRow)
+	{
+		for (std::uint32_t y = beginRow; y < endRow; ++y)
+		{
+			std::uint8_t* row = &targetMemory[y * targetPitch];
+			float v = PixelCenter(y, source.height);
+
+			for (std::uint32_t x = 0; x < source.width; ++x)
+			{
+				float u = PixelCenter(x, source.width);
+
+				SoftwareTexel center = SampleLinear(source, u, v);
+
+				SoftwareTexel color;
+				for (std::size_t c = 0; c < 3; ++c)
+					color[c] = center[c] * BlurWeights[0];
+
+				for (std::size_t i = 1; i < KernelOffsets.size(); ++i)
+				{
+					float offsetU = invWidth * filterX * KernelOffsets[i];
+					float offsetV = invHeight * filterY * KernelOffsets[i];
+
+					SoftwareTexel positive = SampleLinear(source, u + offsetU, v + offsetV);
+					SoftwareTexel negative = SampleLinear(source, u - offsetU, v - offsetV);
+
+					for (std::size_t c = 0; c < 3; ++c)
+						color[c] += BlurWeights[i] * (positive[c] + negative[c]);
+				}
+
+				color[3] = 1.f;
+
+				StoreTexel(row, m_colorFormat, x, color);
+			}
+		}
+	});
+}
+
+void SoftwareGaussianBlur::FastBlurHorizontalPass(const SoftwareTexture& source, std::vector<std::uint8_t>& targetMemory)
+{
+	std::uint32_t bytesPerPixel = GetSoftwareBytesPerPixel(m_colorFormat);
+	std::uint32_t targetPitch = source.width * bytesPerPixel;
+	int maxX = int(source.width) - 1;
+
+	ForEachRowBand(m_workerPool, source.height, [&](std::uint32_t beginRow, std::uint32_t endRow)
+	{
+		for (std::uint32_t y = beginRow; y < endRow; ++y)
+		{
+			const std::uint8_t* input = &source.ptr[y * source.pitch];
+			std::uint8_t* output = &targetMemory[y * targetPitch];
+
+			for (int x = 0; x <= maxX; ++x)
+			{
+				for (std::uint32_t c = 0; c < bytesPerPixel; ++c)
+				{
+					float value = TapWeights[0] * input[x * bytesPerPixel + c];
+					for (int tap = 1; tap < int(TapWeights.size()); ++tap)
+					{
+						int left = std::max(x - tap, 0);
+						int right = std::min(x + tap, maxX);
+
+						value += TapWeights[tap] * (input[left * bytesPerPixel + c] + input[right * bytesPerPixel + c]);
+					}
+
+					output[x * bytesPerPixel + c] = static_cast<std::uint8_t>(std::min(value + 0.5f, 255.f));
+				}
+
+				if (bytesPerPixel == 4)
+					output[x * bytesPerPixel + 3] = 255; //< shader outputs an opaque color
+			}
+		}
+	});
+}
+
+void SoftwareGaussianBlur::FastBlurVerticalPass(const SoftwareTexture& source, std::vector<std::uint8_t>& targetMemory)
+{
+	std::uint32_t rowSize = source.width * GetSoftwareBytesPerPixel(m_colorFormat);
+	int maxY = int(source.height) - 1;
+
+	ForEachRowBand(m_workerPool, source.height, [&](std::uint32_t beginRow, std::uint32_t endRow)
+	{
+		for (std::uint32_t y = beginRow; y < endRow; ++y)
+		{
+			// Since every texel of a row uses the same weights and rows, this pass works on whole rows
+			std::array<const std::uint8_t*, 2 * TapWeights.size() - 1> rows;
+			std::array<float, rows.size()> rowWeights;
+			for (int tap = 0; tap < int(rows.size()); ++tap)
+			{
+				int offset = tap - int(TapWeights.size() - 1);
+				rows[tap] = &source.ptr[std::clamp(int(y) + offset, 0, maxY) * source.pitch];
+				rowWeights[tap] = TapWeights[std::abs(offset)];
+			}
+
+			std::uint8_t* output = &targetMemory[y * rowSize];
+
+			std::uint32_t x = 0;
+#if OBSKINECT_SSE2
+			const __m128i zero = _mm_setzero_si128();
+			for (; x + 16 <= rowSize; x += 16)
+			{
+				__m128 acc[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+				for (std::size_t tap = 0; tap < rows.size(); ++tap)
+				{
+					__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&rows[tap][x]));
+					__m128i low = _mm_unpacklo_epi8(bytes, zero);
+					__m128i high = _mm_unpackhi_epi8(bytes, zero);
+					__m128 weight = _mm_set1_ps(rowWeights[tap]);
+
+					acc[0] = _mm_add_ps(acc[0], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), weight));
+					acc[1] = _mm_add_ps(acc[1], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), weight));
+					acc[2] = _mm_add_ps(acc[2], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), weight));
+					acc[3] = _mm_add_ps(acc[3], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), weight));
+				}
+
+				__m128i low = _mm_packs_epi32(_mm_cvtps_epi32(acc[0]), _mm_cvtps_epi32(acc[1]));
+				__m128i high = _mm_packs_epi32(_mm_cvtps_epi32(acc[2]), _mm_cvtps_epi32(acc[3]));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(&output[x]), _mm_packus_epi16(low, high));
+			}
+#endif
+
+			for (; x < rowSize; ++x)
+			{
+				float value = 0.f;
+				for (std::size_t tap = 0; tap < rows.size(); ++tap)
+					value += rowWeights[tap] * rows[tap][x];
+
+				output[x] = static_cast<std::uint8_t>(std::min(value + 0.5f, 255.f));
+			}
+		}
+	});
+}
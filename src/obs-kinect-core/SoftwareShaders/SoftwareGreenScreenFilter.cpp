@@ -0,0 +1,176 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect-core/SoftwareShaders/SoftwareGreenScreenFilter.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareSampling.hpp>
+
+namespace
+{
+	// Mirrors greenscreen_filter.effect uniforms
+	struct DepthUniforms
+	{
+		template<typename Params>
+		DepthUniforms(const Params& params)
+		{
+			constexpr float maxDepthValue = 0xFFFF;
+			constexpr float invMaxDepthValue = 1.f / maxDepthValue;
+
+			invDepthProgressive = maxDepthValue / params.progressiveDepth;
+			maxDepth = params.maxDepth * invMaxDepthValue;
+			minDepth = params.minDepth * invMaxDepthValue;
+		}
+
+		float invDepthProgressive;
+		float maxDepth;
+		float minDepth;
+	};
+
+	struct MappedCoords
+	{
+		float u;
+		float v;
+		bool valid;
+	};
+
+	MappedCoords ComputeMappedCoords(const SoftwareTexture& depthMapping, const SoftwareTexture& depthSpaceTexture, float u, float v)
+	{
+		SoftwareTexel depthCoordinates = SampleLinear(depthMapping, u, v);
+
+		MappedCoords coords;
+		coords.u = depthCoordinates[0] * (1.f / depthSpaceTexture.width);
+		coords.v = depthCoordinates[1] * (1.f / depthSpaceTexture.height);
+		coords.valid = (coords.u > 0.f && coords.v > 0.f && coords.u < 1.f && coords.v < 1.f);
+
+		return coords;
+	}
+
+	float ComputeBodyValue(float bodyIndex)
+	{
+		return (bodyIndex < 0.1f) ? 1.f : 0.f;
+	}
+
+	float ComputeDepthValue(const DepthUniforms& uniforms, float depth)
+	{
+		bool check = (depth > uniforms.minDepth && depth < uniforms.maxDepth);
+		return (check) ? std::clamp((uniforms.maxDepth - depth) * uniforms.invDepthProgressive, 0.f, 1.f) : 0.f;
+	}
+
+	template<typename Params>
+	float ComputeBodyAndDepthValues(const Params& params, const DepthUniforms& uniforms, float u, float v, float(*combine)(float, float))
+	{
+		if (params.colorToDepthTexture)
+		{
+			// Body index and depth textures are in depth space (InvDepthImageSize is set from depth texture last)
+			MappedCoords coords = ComputeMappedCoords(*params.colorToDepthTexture, *params.depthTexture, u, v);
+			if (!coords.valid)
+				return 0.f;
+
+			float bodyValue = ComputeBodyValue(SamplePoint(*params.bodyIndexTexture, coords.u, coords.v)[0]);
+			float depthValue = ComputeDepthValue(uniforms, SamplePoint(*params.depthTexture, coords.u, coords.v)[0]);
+
+			return combine(bodyValue, depthValue);
+		}
+		else
+		{
+			float bodyValue = ComputeBodyValue(SamplePoint(*params.bodyIndexTexture, u, v)[0]);
+			float depthValue = ComputeDepthValue(uniforms, SamplePoint(*params.depthTexture, u, v)[0]);
+
+			return combine(bodyValue, depthValue);
+		}
+	}
+}
+
+SoftwareGreenScreenFilter::SoftwareGreenScreenFilter(WorkerPool* workerPool) :
+m_workerPool(workerPool)
+{
+}
+
+SoftwareTexture SoftwareGreenScreenFilter::Filter(std::uint32_t width, std::uint32_t height, const BodyFilterParams& params)
+{
+	return Process(width, height, [&](float u, float v)
+	{
+		if (params.colorToDepthTexture)
+		{
+			MappedCoords coords = ComputeMappedCoords(*params.colorToDepthTexture, *params.bodyIndexTexture, u, v);
+			if (!coords.valid)
+				return 0.f;
+
+			return ComputeBodyValue(SamplePoint(*params.bodyIndexTexture, coords.u, coords.v)[0]);
+		}
+		else
+			return ComputeBodyValue(SamplePoint(*params.bodyIndexTexture, u, v)[0]);
+	});
+}
+
+SoftwareTexture SoftwareGreenScreenFilter::Filter(std::uint32_t width, std::uint32_t height, const BodyOrDepthFilterParams& params)
+{
+	DepthUniforms uniforms(params);
+
+	return Process(width, height, [&](float u, float v)
+	{
+		return ComputeBodyAndDepthValues(params, uniforms, u, v, [](float bodyValue, float depthValue) { return std::max(bodyValue, depthValue); });
+	});
+}
+
+SoftwareTexture SoftwareGreenScreenFilter::Filter(std::uint32_t width, std::uint32_t height, const BodyWithinDepthFilterParams& params)
+{
+	DepthUniforms uniforms(params);
+
+	return Process(width, height, [&](float u, float v)
+	{
+		return ComputeBodyAndDepthValues(params, uniforms, u, v, [](float bodyValue, float depthValue) { return std::min(bodyValue, depthValue); });
+	});
+}
+
+SoftwareTexture SoftwareGreenScreenFilter::Filter(std::uint32_t width, std::uint32_t height, const DepthFilterParams& params)
+{
+	DepthUniforms uniforms(params);
+
+	return Process(width, height, [&](float u, float v)
+	{
+		if (params.colorToDepthTexture)
+		{
+			MappedCoords coords = ComputeMappedCoords(*params.colorToDepthTexture, *params.depthTexture, u, v);
+			if (!coords.valid)
+				return 0.f;
+
+			return ComputeDepthValue(uniforms, SamplePoint(*params.depthTexture, coords.u, coords.v)[0]);
+		}
+		else
+			return ComputeDepthValue(uniforms, SamplePoint(*params.depthTexture, u, v)[0]);
+	});
+}
+
+template<typename F>
+SoftwareTexture SoftwareGreenScreenFilter::Process(std::uint32_t width, std::uint32_t height, F&& func)
+{
+	SoftwareTexture renderTarget = PrepareRenderTarget(m_workMemory, GS_R8, width, height);
+
+	ForEachRowBand(m_workerPool, height, [&](std::uint32_t beginRow, std::uint32_t endRow)
+	{
+		for (std::uint32_t y = beginRow; y < endRow; ++y)
+		{
+			std::uint8_t* row = &m_workMemory[y * renderTarget.pitch];
+			float v = PixelCenter(y, height);
+
+			for (std::uint32_t x = 0; x < width; ++x)
+				row[x] = ToUnorm8(func(PixelCenter(x, width), v));
+		}
+	});
+
+	return renderTarget;
+}
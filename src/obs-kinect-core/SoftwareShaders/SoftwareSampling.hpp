@@ -0,0 +1,219 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_SOFTWARESAMPLING
+#define OBS_KINECT_PLUGIN_SOFTWARESAMPLING
+
+#include <obs-kinect-core/WorkerPool.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareTexture.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// Helpers reproducing libobs sampling (clamp addressing) and render target quantization
+
+using SoftwareTexel = std::array<float, 4>;
+
+inline std::uint32_t GetSoftwareBytesPerPixel(gs_color_format format)
+{
+	switch (format)
+	{
+		case GS_R8:    return 1;
+		case GS_R16:   return 2;
+		case GS_RG32F: return 8;
+		case GS_RGBA:
+		case GS_BGRA:
+		case GS_BGRX:  return 4;
+
+		default:
+			throw std::runtime_error("unsupported software texture format");
+	}
+}
+
+inline SoftwareTexel FetchTexel(const SoftwareTexture& texture, std::uint32_t x, std::uint32_t y)
+{
+	const std::uint8_t* row = texture.ptr + std::size_t(y) * texture.pitch;
+
+	switch (texture.format)
+	{
+		case GS_R8:
+			return { row[x] / 255.f, 0.f, 0.f, 1.f };
+
+		case GS_R16:
+		{
+			std::uint16_t value;
+			std::memcpy(&value, &row[x * sizeof(std::uint16_t)], sizeof(value));
+
+			return { value / 65535.f, 0.f, 0.f, 1.f };
+		}
+
+		case GS_RG32F:
+		{
+			float values[2];
+			std::memcpy(values, &row[x * sizeof(values)], sizeof(values));
+
+			return { values[0], values[1], 0.f, 1.f };
+		}
+
+		case GS_RGBA:
+		{
+			const std::uint8_t* pixel = &row[x * 4];
+			return { pixel[0] / 255.f, pixel[1] / 255.f, pixel[2] / 255.f, pixel[3] / 255.f };
+		}
+
+		case GS_BGRA:
+		{
+			const std::uint8_t* pixel = &row[x * 4];
+			return { pixel[2] / 255.f, pixel[1] / 255.f, pixel[0] / 255.f, pixel[3] / 255.f };
+		}
+
+		case GS_BGRX:
+		{
+			const std::uint8_t* pixel = &row[x * 4];
+			return { pixel[2] / 255.f, pixel[1] / 255.f, pixel[0] / 255.f, 1.f };
+		}
+
+		default:
+			throw std::runtime_error("unsupported software texture format");
+	}
+}
+
+inline std::uint8_t ToUnorm8(float value)
+{
+	// NaN are stored as zero, as GPUs do
+	if (!(value > 0.f))
+		return 0;
+
+	return static_cast<std::uint8_t>(std::lround(std::min(value, 1.f) * 255.f));
+}
+
+inline void StoreTexel(std::uint8_t* row, gs_color_format format, std::uint32_t x, const SoftwareTexel& texel)
+{
+	switch (format)
+	{
+		case GS_R8:
+			row[x] = ToUnorm8(texel[0]);
+			break;
+
+		case GS_RGBA:
+		{
+			std::uint8_t* pixel = &row[x * 4];
+			pixel[0] = ToUnorm8(texel[0]);
+			pixel[1] = ToUnorm8(texel[1]);
+			pixel[2] = ToUnorm8(texel[2]);
+			pixel[3] = ToUnorm8(texel[3]);
+			break;
+		}
+
+		case GS_BGRA:
+		{
+			std::uint8_t* pixel = &row[x * 4];
+			pixel[0] = ToUnorm8(texel[2]);
+			pixel[1] = ToUnorm8(texel[1]);
+			pixel[2] = ToUnorm8(texel[0]);
+			pixel[3] = ToUnorm8(texel[3]);
+			break;
+		}
+
+		default:
+			throw std::runtime_error("unsupported software render target format");
+	}
+}
+
+// Point filtering, u and v are normalized
+inline SoftwareTexel SamplePoint(const SoftwareTexture& texture, float u, float v)
+{
+	float x = std::clamp(std::floor(u * texture.width), 0.f, float(texture.width - 1));
+	float y = std::clamp(std::floor(v * texture.height), 0.f, float(texture.height - 1));
+
+	return FetchTexel(texture, std::uint32_t(x), std::uint32_t(y));
+}
+
+// Bilinear filtering, u and v are normalized
+inline SoftwareTexel SampleLinear(const SoftwareTexture& texture, float u, float v)
+{
+	float texelX = u * texture.width - 0.5f;
+	float texelY = v * texture.height - 0.5f;
+
+	float floorX = std::floor(texelX);
+	float floorY = std::floor(texelY);
+	float fracX = texelX - floorX;
+	float fracY = texelY - floorY;
+
+	float maxX = float(texture.width - 1);
+	float maxY = float(texture.height - 1);
+
+	std::uint32_t x0 = std::uint32_t(std::clamp(floorX, 0.f, maxX));
+	std::uint32_t x1 = std::uint32_t(std::clamp(floorX + 1.f, 0.f, maxX));
+	std::uint32_t y0 = std::uint32_t(std::clamp(floorY, 0.f, maxY));
+	std::uint32_t y1 = std::uint32_t(std::clamp(floorY + 1.f, 0.f, maxY));
+
+	SoftwareTexel topLeft = FetchTexel(texture, x0, y0);
+	if (fracX == 0.f && fracY == 0.f)
+		return topLeft; //< sampling at texel center
+
+	SoftwareTexel topRight = FetchTexel(texture, x1, y0);
+	SoftwareTexel bottomLeft = FetchTexel(texture, x0, y1);
+	SoftwareTexel bottomRight = FetchTexel(texture, x1, y1);
+
+	SoftwareTexel result;
+	for (std::size_t i = 0; i < result.size(); ++i)
+	{
+		float top = topLeft[i] + (topRight[i] - topLeft[i]) * fracX;
+		float bottom = bottomLeft[i] + (bottomRight[i] - bottomLeft[i]) * fracX;
+		result[i] = top + (bottom - top) * fracY;
+	}
+
+	return result;
+}
+
+inline SoftwareTexture PrepareRenderTarget(std::vector<std::uint8_t>& memory, gs_color_format format, std::uint32_t width, std::uint32_t height)
+{
+	SoftwareTexture renderTarget;
+	renderTarget.format = format;
+	renderTarget.width = width;
+	renderTarget.height = height;
+	renderTarget.pitch = width * GetSoftwareBytesPerPixel(format);
+
+	memory.resize(std::size_t(renderTarget.pitch) * height);
+	renderTarget.ptr = memory.data();
+
+	return renderTarget;
+}
+
+// Normalized coordinates of a pixel center, as interpolated by the vertex shader over a full-target sprite
+inline float PixelCenter(std::uint32_t coord, std::uint32_t size)
+{
+	return (coord + 0.5f) / size;
+}
+
+// Calls func(beginRow, endRow) on row bands, in parallel if a worker pool is given
+template<typename F>
+void ForEachRowBand(WorkerPool* workerPool, std::uint32_t height, F&& func)
+{
+	if (workerPool)
+		workerPool->ParallelFor(height, func);
+	else
+		func(0, height);
+}
+
+#endif
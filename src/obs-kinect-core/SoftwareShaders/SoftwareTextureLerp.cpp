@@ -0,0 +1,131 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect-core/SoftwareShaders/SoftwareTextureLerp.hpp>
+#include <obs-kinect-core/SimdHelper.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareSampling.hpp>
+
+SoftwareTextureLerp::SoftwareTextureLerp(gs_color_format colorFormat, WorkerPool* workerPool) :
+m_colorFormat(colorFormat),
+m_workerPool(workerPool)
+{
+	if (colorFormat != GS_RGBA && colorFormat != GS_BGRA)
+		throw std::runtime_error("unsupported software render target format");
+}
+
+SoftwareTexture SoftwareTextureLerp::Lerp(const SoftwareTexture& from, const SoftwareTexture& to, const SoftwareTexture& factor)
+{
+	SoftwareTexture renderTarget = PrepareRenderTarget(m_workMemory, m_colorFormat, to.width, to.height);
+
+	auto SameLayout = [&](const SoftwareTexture& texture, gs_color_format format)
+	{
+		return texture.format == format && texture.width == renderTarget.width && texture.height == renderTarget.height;
+	};
+
+	// Fast path when no filtering nor format conversion is involved
+	if (SameLayout(from, m_colorFormat) && SameLayout(to, m_colorFormat) && SameLayout(factor, GS_R8))
+	{
+		FastLerp(from, to, factor, renderTarget);
+		return renderTarget;
+	}
+
+	ForEachRowBand(m_workerPool, renderTarget.height, [&](std::uint32_t beginRow, std::uint32_t endRow)
+	{
+		for (std::uint32_t y = beginRow; y < endRow; ++y)
+		{
+			std::uint8_t* row = &m_workMemory[y * renderTarget.pitch];
+			float v = PixelCenter(y, renderTarget.height);
+
+			for (std::uint32_t x = 0; x < renderTarget.width; ++x)
+			{
+				float u = PixelCenter(x, renderTarget.width);
+
+				SoftwareTexel color1 = SampleLinear(from, u, v);
+				SoftwareTexel color2 = SampleLinear(to, u, v);
+				float alpha = SampleLinear(factor, u, v)[0];
+
+				SoftwareTexel result;
+				for (std::size_t c = 0; c < result.size(); ++c)
+					result[c] = color1[c] + (color2[c] - color1[c]) * alpha;
+
+				StoreTexel(row, m_colorFormat, x, result);
+			}
+		}
+	});
+
+	return renderTarget;
+}
+
+void SoftwareTextureLerp::FastLerp(const SoftwareTexture& from, const SoftwareTexture& to, const SoftwareTexture& factor, const SoftwareTexture& renderTarget)
+{
+	// (from * (255 - f) + to * f) / 255, which fits in 16bits integers
+	ForEachRowBand(m_workerPool, renderTarget.height, [&](std::uint32_t beginRow, std::uint32_t endRow)
+	{
+		for (std::uint32_t y = beginRow; y < endRow; ++y)
+		{
+			const std::uint8_t* fromRow = &from.ptr[y * from.pitch];
+			const std::uint8_t* toRow = &to.ptr[y * to.pitch];
+			const std::uint8_t* factorRow = &factor.ptr[y * factor.pitch];
+			std::uint8_t* output = &m_workMemory[y * renderTarget.pitch];
+
+			std::uint32_t x = 0;
+#if OBSKINECT_SSE2
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i max = _mm_set1_epi16(255);
+			const __m128i half = _mm_set1_epi16(128);
+
+			auto LerpPixels = [&](__m128i fromValues, __m128i toValues, __m128i factors)
+			{
+				__m128i value = _mm_add_epi16(_mm_mullo_epi16(fromValues, _mm_sub_epi16(max, factors)), _mm_mullo_epi16(toValues, factors));
+
+				// Exact division by 255 with rounding
+				value = _mm_add_epi16(value, half);
+				return _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+			};
+
+			for (; x + 4 <= renderTarget.width; x += 4)
+			{
+				std::uint32_t factorBytes;
+				std::memcpy(&factorBytes, &factorRow[x], sizeof(factorBytes));
+
+				// Broadcast each factor to the four channels of its pixel
+				__m128i factors = _mm_cvtsi32_si128(int(factorBytes));
+				factors = _mm_unpacklo_epi8(factors, factors);
+				factors = _mm_unpacklo_epi16(factors, factors);
+
+				__m128i fromValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&fromRow[x * 4]));
+				__m128i toValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&toRow[x * 4]));
+
+				__m128i low = LerpPixels(_mm_unpacklo_epi8(fromValues, zero), _mm_unpacklo_epi8(toValues, zero), _mm_unpacklo_epi8(factors, zero));
+				__m128i high = LerpPixels(_mm_unpackhi_epi8(fromValues, zero), _mm_unpackhi_epi8(toValues, zero), _mm_unpackhi_epi8(factors, zero));
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(&output[x * 4]), _mm_packus_epi16(low, high));
+			}
+#endif
+
+			for (; x < renderTarget.width; ++x)
+			{
+				unsigned int f = factorRow[x];
+				for (std::uint32_t c = 0; c < 4; ++c)
+				{
+					unsigned int value = fromRow[x * 4 + c] * (255 - f) + toRow[x * 4 + c] * f + 128;
+					output[x * 4 + c] = static_cast<std::uint8_t>((value + (value >> 8)) >> 8);
+				}
+			}
+		}
+	});
+}
@@ -0,0 +1,50 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect-core/SoftwareShaders/SoftwareVisibilityMask.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareSampling.hpp>
+
+SoftwareVisibilityMask::SoftwareVisibilityMask(WorkerPool* workerPool) :
+m_workerPool(workerPool)
+{
+}
+
+SoftwareTexture SoftwareVisibilityMask::Mask(const SoftwareTexture& filter, const SoftwareTexture& mask)
+{
+	SoftwareTexture renderTarget = PrepareRenderTarget(m_workMemory, GS_R8, filter.width, filter.height);
+
+	ForEachRowBand(m_workerPool, renderTarget.height, [&](std::uint32_t beginRow, std::uint32_t endRow)
+	{
+		for (std::uint32_t y = beginRow; y < endRow; ++y)
+		{
+			std::uint8_t* row = &m_workMemory[y * renderTarget.pitch];
+			float v = PixelCenter(y, renderTarget.height);
+
+			for (std::uint32_t x = 0; x < renderTarget.width; ++x)
+			{
+				float u = PixelCenter(x, renderTarget.width);
+
+				float currentFilter = SampleLinear(filter, u, v)[0];
+				SoftwareTexel maskValue = SampleLinear(mask, u, v);
+
+				row[x] = ToUnorm8(currentFilter + (maskValue[0] - currentFilter) * maskValue[3]);
+			}
+		}
+	});
+
+	return renderTarget;
+}
@@ -0,0 +1,371 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include <obs-kinect-core/TcpSocket.hpp>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef _WIN32
+	using SocketHandle = SOCKET;
+	constexpr std::intptr_t InvalidHandle = static_cast<std::intptr_t>(INVALID_SOCKET);
+
+	int CloseSocket(SocketHandle handle)
+	{
+		return closesocket(handle);
+	}
+
+	std::string GetLastSocketError()
+	{
+		return "error " + std::to_string(WSAGetLastError());
+	}
+
+	void InitializeSockets()
+	{
+		static std::once_flag initFlag;
+		std::call_once(initFlag, []
+		{
+			WSADATA data;
+			if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+				throw std::runtime_error("failed to initialize Winsock");
+		});
+	}
+
+	void SetBlocking(SocketHandle handle, bool blocking)
+	{
+		u_long nonBlocking = (blocking) ? 0 : 1;
+		ioctlsocket(handle, FIONBIO, &nonBlocking);
+	}
+#else
+	using SocketHandle = int;
+	constexpr std::intptr_t InvalidHandle = -1;
+
+	int CloseSocket(SocketHandle handle)
+	{
+		return close(handle);
+	}
+
+	std::string GetLastSocketError()
+	{
+		return std::strerror(errno);
+	}
+
+	void InitializeSockets()
+	{
+	}
+
+	void SetBlocking(SocketHandle handle, bool blocking)
+	{
+		int flags = fcntl(handle, F_GETFL, 0);
+		fcntl(handle, F_SETFL, (blocking) ? flags & ~O_NONBLOCK : flags | O_NONBLOCK);
+	}
+#endif
+
+	SocketHandle ToHandle(std::intptr_t handle)
+	{
+		return static_cast<SocketHandle>(handle);
+	}
+
+	// Waits until the socket is readable (or writable), returns false on timeout
+	bool WaitForSocket(SocketHandle handle, bool write, std::uint32_t timeoutMs)
+	{
+		fd_set set;
+		FD_ZERO(&set);
+		FD_SET(handle, &set);
+
+		timeval timeout;
+		timeout.tv_sec = static_cast<long>(timeoutMs / 1000);
+		timeout.tv_usec = static_cast<long>((timeoutMs % 1000) * 1000);
+
+		int result = select(static_cast<int>(handle) + 1, (write) ? nullptr : &set, (write) ? &set : nullptr, nullptr, &timeout);
+		if (result < 0)
+			throw std::runtime_error("select failed: " + GetLastSocketError());
+
+		return result > 0;
+	}
+}
+
+TcpSocket::TcpSocket() :
+m_handle(InvalidHandle)
+{
+}
+
+TcpSocket::TcpSocket(std::intptr_t handle) :
+m_handle(handle)
+{
+}
+
+TcpSocket::TcpSocket(TcpSocket&& socket) noexcept :
+m_handle(socket.m_handle)
+{
+	socket.m_handle = InvalidHandle;
+}
+
+TcpSocket::~TcpSocket()
+{
+	Close();
+}
+
+TcpSocket TcpSocket::Accept(std::uint32_t timeoutMs)
+{
+	if (!WaitForSocket(ToHandle(m_handle), false, timeoutMs))
+		return TcpSocket();
+
+	SocketHandle client = accept(ToHandle(m_handle), nullptr, nullptr);
+	if (static_cast<std::intptr_t>(client) == InvalidHandle)
+		return TcpSocket(); //< connection may have been reset in the meantime
+
+	int noDelay = 1;
+	setsockopt(client, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+#ifdef SO_NOSIGPIPE
+	int noSigPipe = 1;
+	setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+
+	return TcpSocket(static_cast<std::intptr_t>(client));
+}
+
+void TcpSocket::Close()
+{
+	if (m_handle == InvalidHandle)
+		return;
+
+	CloseSocket(ToHandle(m_handle));
+	m_handle = InvalidHandle;
+}
+
+std::uint16_t TcpSocket::GetLocalPort() const
+{
+	sockaddr_storage address;
+	socklen_t addressLength = sizeof(address);
+	if (getsockname(ToHandle(m_handle), reinterpret_cast<sockaddr*>(&address), &addressLength) != 0)
+		throw std::runtime_error("getsockname failed: " + GetLastSocketError());
+
+	if (address.ss_family == AF_INET6)
+		return ntohs(reinterpret_cast<const sockaddr_in6*>(&address)->sin6_port);
+	else
+		return ntohs(reinterpret_cast<const sockaddr_in*>(&address)->sin_port);
+}
+
+std::string TcpSocket::GetRemoteAddress() const
+{
+	sockaddr_storage address;
+	socklen_t addressLength = sizeof(address);
+	if (getpeername(ToHandle(m_handle), reinterpret_cast<sockaddr*>(&address), &addressLength) != 0)
+		return "<unknown>";
+
+	char host[NI_MAXHOST];
+	char service[NI_MAXSERV];
+	if (getnameinfo(reinterpret_cast<const sockaddr*>(&address), addressLength, host, sizeof(host), service, sizeof(service), NI_NUMERICHOST | NI_NUMERICSERV) != 0)
+		return "<unknown>";
+
+	return std::string(host) + ":" + service;
+}
+
+bool TcpSocket::IsValid() const
+{
+	return m_handle != InvalidHandle;
+}
+
+bool TcpSocket::Receive(void* data, std::size_t size)
+{
+	char* ptr = static_cast<char*>(data);
+	while (size > 0)
+	{
+		int chunkSize = static_cast<int>(std::min<std::size_t>(size, 1 << 30));
+		auto received = recv(ToHandle(m_handle), ptr, chunkSize, 0);
+		if (received <= 0)
+			return false;
+
+		ptr += received;
+		size -= static_cast<std::size_t>(received);
+	}
+
+	return true;
+}
+
+bool TcpSocket::Send(const void* data, std::size_t size)
+{
+#ifdef MSG_NOSIGNAL
+	constexpr int flags = MSG_NOSIGNAL;
+#else
+	constexpr int flags = 0;
+#endif
+
+	const char* ptr = static_cast<const char*>(data);
+	while (size > 0)
+	{
+		int chunkSize = static_cast<int>(std::min<std::size_t>(size, 1 << 30));
+		auto sent = send(ToHandle(m_handle), ptr, chunkSize, flags);
+		if (sent <= 0)
+			return false;
+
+		ptr += sent;
+		size -= static_cast<std::size_t>(sent);
+	}
+
+	return true;
+}
+
+void TcpSocket::SetReceiveTimeout(std::uint32_t timeoutMs)
+{
+#ifdef _WIN32
+	DWORD timeout = timeoutMs;
+#else
+	timeval timeout;
+	timeout.tv_sec = static_cast<long>(timeoutMs / 1000);
+	timeout.tv_usec = static_cast<long>((timeoutMs % 1000) * 1000);
+#endif
+
+	setsockopt(ToHandle(m_handle), SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+void TcpSocket::Shutdown()
+{
+	if (m_handle == InvalidHandle)
+		return;
+
+#ifdef _WIN32
+	shutdown(ToHandle(m_handle), SD_BOTH);
+#else
+	shutdown(ToHandle(m_handle), SHUT_RDWR);
+#endif
+}
+
+TcpSocket& TcpSocket::operator=(TcpSocket&& socket) noexcept
+{
+	std::swap(m_handle, socket.m_handle);
+	return *this;
+}
+
+TcpSocket TcpSocket::Connect(const std::string& host, std::uint16_t port, std::uint32_t timeoutMs)
+{
+	InitializeSockets();
+
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	addrinfo* addresses;
+	std::string service = std::to_string(port);
+	if (int error = getaddrinfo(host.c_str(), service.c_str(), &hints, &addresses); error != 0)
+		throw std::runtime_error("failed to resolve " + host + ": " + gai_strerror(error));
+
+	std::unique_ptr<addrinfo, decltype(&freeaddrinfo)> addressList(addresses, &freeaddrinfo);
+
+	std::string lastError = "no address";
+	for (addrinfo* address = addresses; address; address = address->ai_next)
+	{
+		TcpSocket socket(static_cast<std::intptr_t>(::socket(address->ai_family, address->ai_socktype, address->ai_protocol)));
+		if (!socket.IsValid())
+		{
+			lastError = GetLastSocketError();
+			continue;
+		}
+
+		SocketHandle handle = ToHandle(socket.m_handle);
+
+		// Non-blocking connect to apply the timeout
+		SetBlocking(handle, false);
+		if (connect(handle, address->ai_addr, static_cast<socklen_t>(address->ai_addrlen)) != 0)
+		{
+			if (!WaitForSocket(handle, true, timeoutMs))
+			{
+				lastError = "timeout";
+				continue;
+			}
+
+			int socketError = 0;
+			socklen_t errorLength = sizeof(socketError);
+			getsockopt(handle, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&socketError), &errorLength);
+			if (socketError != 0)
+			{
+				lastError = std::strerror(socketError);
+				continue;
+			}
+		}
+		SetBlocking(handle, true);
+
+		int noDelay = 1;
+		setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+#ifdef SO_NOSIGPIPE
+		int noSigPipe = 1;
+		setsockopt(handle, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+
+		return socket;
+	}
+
+	throw std::runtime_error("failed to connect to " + host + ":" + service + " (" + lastError + ")");
+}
+
+TcpSocket TcpSocket::Listen(std::uint16_t port)
+{
+	InitializeSockets();
+
+	TcpSocket socket(static_cast<std::intptr_t>(::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)));
+	if (!socket.IsValid())
+		throw std::runtime_error("failed to create socket: " + GetLastSocketError());
+
+	SocketHandle handle = ToHandle(socket.m_handle);
+
+	int reuseAddress = 1;
+	setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuseAddress), sizeof(reuseAddress));
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+
+	if (bind(handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+		throw std::runtime_error("failed to bind port " + std::to_string(port) + ": " + GetLastSocketError());
+
+	if (listen(handle, SOMAXCONN) != 0)
+		throw std::runtime_error("failed to listen: " + GetLastSocketError());
+
+	return socket;
+}
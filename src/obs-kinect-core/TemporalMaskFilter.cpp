@@ -0,0 +1,89 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect-core/TemporalMaskFilter.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+TemporalMaskFilter::TemporalMaskFilter() :
+m_historyHeight(0),
+m_historyWidth(0),
+m_historyFactor(-1.f),
+m_resetThreshold(-1.f)
+{
+}
+
+void TemporalMaskFilter::Apply(float historyFactor, float resetThreshold, const std::uint8_t* input, std::uint32_t inputPitch, std::uint8_t* output, std::uint32_t outputPitch, std::uint32_t width, std::uint32_t height)
+{
+	if (m_historyWidth != width || m_historyHeight != height)
+	{
+		// No usable history (first frame or resolution change), output current mask as-is
+		m_history.resize(std::size_t(width) * height);
+		for (std::uint32_t y = 0; y < height; ++y)
+			std::memcpy(&m_history[y * width], &input[y * inputPitch], width);
+
+		m_historyHeight = height;
+		m_historyWidth = width;
+	}
+	else
+	{
+		if (historyFactor != m_historyFactor || resetThreshold != m_resetThreshold)
+			UpdateWeights(historyFactor, resetThreshold);
+
+		for (std::uint32_t y = 0; y < height; ++y)
+		{
+			const std::uint8_t* inputRow = &input[y * inputPitch];
+			std::uint8_t* historyRow = &m_history[y * width];
+
+			for (std::uint32_t x = 0; x < width; ++x)
+			{
+				unsigned int current = inputRow[x];
+				unsigned int history = historyRow[x];
+				unsigned int weight = m_historyWeights[(current > history) ? current - history : history - current];
+
+				historyRow[x] = static_cast<std::uint8_t>((current * (256 - weight) + history * weight + 128) >> 8);
+			}
+		}
+	}
+
+	for (std::uint32_t y = 0; y < height; ++y)
+		std::memcpy(&output[y * outputPitch], &m_history[y * width], width);
+}
+
+void TemporalMaskFilter::Reset()
+{
+	m_history.clear();
+	m_history.shrink_to_fit();
+	m_historyHeight = 0;
+	m_historyWidth = 0;
+}
+
+void TemporalMaskFilter::UpdateWeights(float historyFactor, float resetThreshold)
+{
+	m_historyFactor = historyFactor;
+	m_resetThreshold = resetThreshold;
+
+	historyFactor = std::clamp(historyFactor, 0.f, 1.f);
+	float threshold = std::max(resetThreshold, 1.f / 255.f) * 255.f;
+
+	for (std::size_t diff = 0; diff < m_historyWeights.size(); ++diff)
+	{
+		float weight = historyFactor * std::clamp(1.f - float(diff) / threshold, 0.f, 1.f);
+		m_historyWeights[diff] = static_cast<std::uint16_t>(std::lround(weight * 256.f));
+	}
+}
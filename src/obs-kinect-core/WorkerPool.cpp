@@ -0,0 +1,176 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect-core/WorkerPool.hpp>
+#include <algorithm>
+
+namespace
+{
+	// Pool whose bands are being processed by the current thread (worker or dispatching thread)
+	thread_local const WorkerPool* s_processingPool = nullptr;
+}
+
+WorkerPool::WorkerPool(std::size_t workerCount) :
+m_func(nullptr),
+m_generation(0),
+m_bandCount(0),
+m_bandSize(0),
+m_count(0),
+m_nextBand(0),
+m_pendingBands(0),
+m_running(true)
+{
+	if (workerCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = (hardwareThreads > 1) ? hardwareThreads - 1 : 0;
+	}
+
+	m_workers.reserve(workerCount);
+	for (std::size_t i = 0; i < workerCount; ++i)
+		m_workers.emplace_back(&WorkerPool::WorkerFunc, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+	m_workCv.notify_all();
+
+	for (std::thread& worker : m_workers)
+		worker.join();
+}
+
+std::size_t WorkerPool::GetWorkerCount() const
+{
+	return m_workers.size();
+}
+
+void WorkerPool::ParallelFor(std::uint32_t count, const BandFunc& func)
+{
+	if (count == 0)
+		return;
+
+	// Nested calls from a band run inline, as the dispatch lock is held by the outer call
+	if (m_workers.empty() || count == 1 || s_processingPool == this)
+	{
+		func(0, count);
+		return;
+	}
+
+	// Only one job at a time
+	std::lock_guard<std::mutex> dispatchLock(m_dispatchMutex);
+
+	// A few more bands than threads to balance uneven bands
+	std::uint32_t bandCount = std::min<std::uint32_t>(count, std::uint32_t(m_workers.size() + 1) * 4);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_func = &func;
+		m_count = count;
+		m_bandCount = bandCount;
+		m_bandSize = (count + bandCount - 1) / bandCount;
+		m_nextBand = 0;
+		m_pendingBands = bandCount;
+		m_exception = nullptr;
+		m_generation++;
+	}
+	m_workCv.notify_all();
+
+	ProcessBands();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCv.wait(lock, [&] { return m_pendingBands == 0; });
+	m_func = nullptr;
+
+	if (m_exception)
+		std::rethrow_exception(m_exception);
+}
+
+std::shared_ptr<WorkerPool> WorkerPool::GetSharedPool()
+{
+	static std::mutex poolMutex;
+	static std::weak_ptr<WorkerPool> sharedPool;
+
+	std::lock_guard<std::mutex> lock(poolMutex);
+	std::shared_ptr<WorkerPool> pool = sharedPool.lock();
+	if (!pool)
+	{
+		pool = std::make_shared<WorkerPool>();
+		sharedPool = pool;
+	}
+
+	return pool;
+}
+
+void WorkerPool::ProcessBands()
+{
+	const WorkerPool* previousPool = s_processingPool;
+	s_processingPool = this;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_nextBand < m_bandCount)
+	{
+		std::uint32_t bandIndex = m_nextBand++;
+		std::uint32_t begin = bandIndex * m_bandSize;
+		std::uint32_t end = std::min(begin + m_bandSize, m_count);
+		const BandFunc* func = m_func;
+
+		lock.unlock();
+
+		std::exception_ptr exception;
+		try
+		{
+			if (begin < end)
+				(*func)(begin, end);
+		}
+		catch (...)
+		{
+			exception = std::current_exception();
+		}
+
+		lock.lock();
+
+		if (exception && !m_exception)
+			m_exception = exception;
+
+		if (--m_pendingBands == 0)
+			m_doneCv.notify_all();
+	}
+
+	s_processingPool = previousPool;
+}
+
+void WorkerPool::WorkerFunc()
+{
+	std::uint64_t lastGeneration = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workCv.wait(lock, [&] { return !m_running || (m_generation != lastGeneration && m_nextBand < m_bandCount); });
+			if (!m_running)
+				break;
+
+			lastGeneration = m_generation;
+		}
+
+		ProcessBands();
+	}
+}
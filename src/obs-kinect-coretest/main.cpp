@@ -0,0 +1,518 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect-core/KinectFrameDownscaler.hpp>
+#include <obs-kinect-core/KinectStreamPlanner.hpp>
+#include <obs-kinect-core/MaskMorphology.hpp>
+#include <obs-kinect-core/TemporalMaskFilter.hpp>
+#include <obs-kinect-core/WorkerPool.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Checks core algorithms against straightforward implementations
+// Usage: obs-kinect-coretest
+
+namespace
+{
+	struct Check
+	{
+		std::string name;
+		std::function<std::string()> func; //< returns an empty string on success, a failure description otherwise
+	};
+
+	// Deterministic noise, tests must not depend on the platform rand()
+	class Random
+	{
+		public:
+			explicit Random(std::uint32_t seed) :
+			m_state(seed)
+			{
+			}
+
+			std::uint32_t operator()()
+			{
+				m_state = m_state * 1664525u + 1013904223u;
+				return m_state >> 8;
+			}
+
+		private:
+			std::uint32_t m_state;
+	};
+
+	template<typename T>
+	void FillFrameData(T& frameData, std::uint32_t width, std::uint32_t height, std::uint32_t bytesPerPixel, Random& random)
+	{
+		// Use a larger pitch to catch pitch/width confusions
+		frameData.width = width;
+		frameData.height = height;
+		frameData.pitch = width * bytesPerPixel + 12;
+		frameData.memory.resize(std::size_t(frameData.pitch) * height);
+		for (std::uint8_t& value : frameData.memory)
+			value = std::uint8_t(random() % 256);
+
+		frameData.ptr.reset(reinterpret_cast<decltype(frameData.ptr.get())>(frameData.memory.data()));
+	}
+
+	// Box filter with a rounded division for 8 bits channels, center pixel of each block for others
+	std::string CompareDownscaledFrameData(const char* name, const FrameData& input, const std::uint8_t* inputPtr, const FrameData& output, const std::uint8_t* outputPtr, std::uint32_t bytesPerPixel, std::uint32_t factor, bool average)
+	{
+		if (output.width != input.width / factor || output.height != input.height / factor)
+			return std::string(name) + " is " + std::to_string(output.width) + "x" + std::to_string(output.height);
+
+		for (std::uint32_t y = 0; y < output.height; ++y)
+		{
+			for (std::uint32_t x = 0; x < output.width; ++x)
+			{
+				for (std::uint32_t i = 0; i < bytesPerPixel; ++i)
+				{
+					std::uint32_t expected;
+					if (average)
+					{
+						std::uint32_t sum = 0;
+						for (std::uint32_t dy = 0; dy < factor; ++dy)
+						{
+							for (std::uint32_t dx = 0; dx < factor; ++dx)
+								sum += inputPtr[(y * factor + dy) * input.pitch + (x * factor + dx) * bytesPerPixel + i];
+						}
+
+						expected = (sum + factor * factor / 2) / (factor * factor);
+					}
+					else
+						expected = inputPtr[(y * factor + factor / 2) * input.pitch + (x * factor + factor / 2) * bytesPerPixel + i];
+
+					std::uint32_t value = outputPtr[y * output.pitch + x * bytesPerPixel + i];
+					if (value != expected)
+					{
+						return std::string(name) + " " + std::to_string(input.width) + "x" + std::to_string(input.height) + " by " + std::to_string(factor) +
+						       ": byte " + std::to_string(i) + " of pixel (" + std::to_string(x) + ", " + std::to_string(y) + ") is " + std::to_string(value) + ", expected " + std::to_string(expected);
+					}
+				}
+			}
+		}
+
+		return {};
+	}
+
+	std::string CheckFrameDownscaler()
+	{
+		const struct
+		{
+			std::uint32_t width;
+			std::uint32_t height;
+		} sizes[] = { { 16, 9 }, { 67, 31 }, { 640, 360 } };
+		const std::uint32_t factors[] = { 2, 3, 5, 8, 16, KinectFrameDownscaler::MaxFactor };
+
+		Random random(1337);
+		KinectFrameDownscaler downscaler(std::make_shared<WorkerPool>(3));
+
+		for (const auto& size : sizes)
+		{
+			for (std::uint32_t factor : factors)
+			{
+				if (size.width / factor == 0 || size.height / factor == 0)
+					continue;
+
+				auto frame = std::make_shared<KinectFrame>();
+				frame->frameIndex = 42;
+
+				ColorFrameData& colorFrame = frame->colorFrame.emplace();
+				colorFrame.format = GS_BGRA;
+				FillFrameData(colorFrame, size.width, size.height, 4, random);
+				FillFrameData(frame->backgroundRemovalFrame.emplace(), size.width, size.height, 1, random);
+				FillFrameData(frame->colorMappedBodyFrame.emplace(), size.width, size.height, 1, random);
+				FillFrameData(frame->colorMappedDepthFrame.emplace(), size.width, size.height, 2, random);
+				FillFrameData(frame->depthMappingFrame.emplace(), size.width, size.height, 8, random);
+				FillFrameData(frame->depthFrame.emplace(), 5, 3, 2, random);
+
+				KinectFrameConstPtr output = downscaler.Downscale(frame, factor);
+				if (output == frame)
+					return std::to_string(size.width) + "x" + std::to_string(size.height) + " by " + std::to_string(factor) + ": frame wasn't downscaled";
+
+				if (output->frameIndex != frame->frameIndex || !output->depthFrame || output->depthFrame->ptr.get() != frame->depthFrame->ptr.get() || output->colorFrame->format != GS_BGRA)
+					return "depth space frames and frame properties must be kept";
+
+				std::string error;
+				if (error.empty())
+					error = CompareDownscaledFrameData("color", colorFrame, colorFrame.ptr.get(), *output->colorFrame, output->colorFrame->ptr.get(), 4, factor, true);
+
+				if (error.empty())
+					error = CompareDownscaledFrameData("background removal", *frame->backgroundRemovalFrame, frame->backgroundRemovalFrame->ptr.get(), *output->backgroundRemovalFrame, output->backgroundRemovalFrame->ptr.get(), 1, factor, true);
+
+				if (error.empty())
+					error = CompareDownscaledFrameData("color-mapped body", *frame->colorMappedBodyFrame, frame->colorMappedBodyFrame->ptr.get(), *output->colorMappedBodyFrame, output->colorMappedBodyFrame->ptr.get(), 1, factor, false);
+
+				if (error.empty())
+					error = CompareDownscaledFrameData("color-mapped depth", *frame->colorMappedDepthFrame, reinterpret_cast<const std::uint8_t*>(frame->colorMappedDepthFrame->ptr.get()), *output->colorMappedDepthFrame, reinterpret_cast<const std::uint8_t*>(output->colorMappedDepthFrame->ptr.get()), 2, factor, false);
+
+				if (error.empty())
+					error = CompareDownscaledFrameData("depth mapping", *frame->depthMappingFrame, reinterpret_cast<const std::uint8_t*>(frame->depthMappingFrame->ptr.get()), *output->depthMappingFrame, reinterpret_cast<const std::uint8_t*>(output->depthMappingFrame->ptr.get()), 8, factor, false);
+
+				if (!error.empty())
+					return error;
+
+				// A color space frame which isn't color-sized can't be kept aligned
+				frame->colorMappedDepthFrame->width--;
+				if (downscaler.Downscale(frame, factor) != frame)
+					return "frame with a misaligned color space frame was downscaled";
+			}
+		}
+
+		// Frame is scaled to fit in the output size
+		KinectFrame frame;
+		frame.colorFrame.emplace();
+		frame.colorFrame->format = GS_BGRA;
+		frame.colorFrame->width = 1920;
+		frame.colorFrame->height = 1080;
+
+		if (KinectFrameDownscaler::ComputeFactor(frame, 640, 360) != 3 || KinectFrameDownscaler::ComputeFactor(frame, 960, 360) != 3 || KinectFrameDownscaler::ComputeFactor(frame, 1280, 720) != 1 || KinectFrameDownscaler::ComputeFactor(frame, 0, 0) != 1)
+			return "wrong downscale factor";
+
+		return {};
+	}
+
+	std::vector<std::uint8_t> BruteForceFilter(const std::vector<std::uint8_t>& input, std::uint32_t width, std::uint32_t height, std::size_t radius, bool max)
+	{
+		// Out-of-image pixels are the nearest edge pixels, as in MaskMorphology
+		std::vector<std::uint8_t> output(input.size());
+		for (std::uint32_t y = 0; y < height; ++y)
+		{
+			for (std::uint32_t x = 0; x < width; ++x)
+			{
+				std::uint8_t value = (max) ? 0 : 255;
+				for (std::int64_t dy = -std::int64_t(radius); dy <= std::int64_t(radius); ++dy)
+				{
+					std::int64_t sampleY = std::clamp<std::int64_t>(std::int64_t(y) + dy, 0, height - 1);
+					for (std::int64_t dx = -std::int64_t(radius); dx <= std::int64_t(radius); ++dx)
+					{
+						std::int64_t sampleX = std::clamp<std::int64_t>(std::int64_t(x) + dx, 0, width - 1);
+						std::uint8_t sample = input[sampleY * width + sampleX];
+						value = (max) ? std::max(value, sample) : std::min(value, sample);
+					}
+				}
+
+				output[y * width + x] = value;
+			}
+		}
+
+		return output;
+	}
+
+	std::vector<std::uint8_t> BruteForceMorphology(const std::vector<std::uint8_t>& input, std::uint32_t width, std::uint32_t height, MorphologyOperation operation, std::size_t radius)
+	{
+		switch (operation)
+		{
+			case MorphologyOperation::None: return input;
+			case MorphologyOperation::Erode: return BruteForceFilter(input, width, height, radius, false);
+			case MorphologyOperation::Dilate: return BruteForceFilter(input, width, height, radius, true);
+			case MorphologyOperation::Open: return BruteForceFilter(BruteForceFilter(input, width, height, radius, false), width, height, radius, true);
+			case MorphologyOperation::Close: return BruteForceFilter(BruteForceFilter(input, width, height, radius, true), width, height, radius, false);
+		}
+
+		return input;
+	}
+
+	std::string CheckMorphology()
+	{
+		// Vertical pass combines whole rows 16 bytes at a time with SSE2 and finishes with a scalar loop:
+		// widths below 16 only run the scalar code, multiples of 16 only the SSE2 code and others both
+		const std::uint32_t widths[] = { 1, 7, 15, 16, 17, 48, 61 };
+		const std::uint32_t heights[] = { 1, 5, 33 };
+		const std::size_t radii[] = { 1, 2, 3, 7, 40 }; //< 40 is larger than any test image, every window reaches both edges
+		const MorphologyOperation operations[] = { MorphologyOperation::Erode, MorphologyOperation::Dilate, MorphologyOperation::Open, MorphologyOperation::Close };
+		const char* operationNames[] = { "erode", "dilate", "open", "close" };
+
+		Random random(42);
+		MaskMorphology morphology;
+
+		for (std::uint32_t width : widths)
+		{
+			for (std::uint32_t height : heights)
+			{
+				// Mask-like input (mostly 0 and 255 blobs) with intermediate values and a distinct value on the borders
+				std::vector<std::uint8_t> input(std::size_t(width) * height);
+				for (std::uint32_t y = 0; y < height; ++y)
+				{
+					for (std::uint32_t x = 0; x < width; ++x)
+					{
+						std::uint8_t& value = input[y * width + x];
+						if (x == 0 || y == 0 || x == width - 1 || y == height - 1)
+							value = std::uint8_t(random() % 256);
+						else
+							value = (random() % 4 == 0) ? std::uint8_t(random() % 256) : (((x / 5 + y / 3) % 2 == 0) ? 255 : 0);
+					}
+				}
+
+				// Use a larger pitch to catch pitch/width confusions
+				const std::uint32_t inputPitch = width + 3;
+				const std::uint32_t outputPitch = width + 5;
+
+				std::vector<std::uint8_t> pitchedInput(std::size_t(inputPitch) * height, 0xCD);
+				for (std::uint32_t y = 0; y < height; ++y)
+					std::copy_n(&input[y * width], width, &pitchedInput[y * inputPitch]);
+
+				for (std::size_t radius : radii)
+				{
+					for (std::size_t opIndex = 0; opIndex < std::size(operations); ++opIndex)
+					{
+						std::vector<std::uint8_t> expected = BruteForceMorphology(input, width, height, operations[opIndex], radius);
+
+						std::vector<std::uint8_t> output(std::size_t(outputPitch) * height, 0xCD);
+						morphology.Apply(operations[opIndex], radius, pitchedInput.data(), inputPitch, output.data(), outputPitch, width, height);
+
+						// In-place
+						std::vector<std::uint8_t> inPlace = pitchedInput;
+						morphology.Apply(operations[opIndex], radius, inPlace.data(), inputPitch, inPlace.data(), inputPitch, width, height);
+
+						for (std::uint32_t y = 0; y < height; ++y)
+						{
+							for (std::uint32_t x = 0; x < width; ++x)
+							{
+								std::uint8_t expectedValue = expected[y * width + x];
+								std::uint8_t value = output[y * outputPitch + x];
+								std::uint8_t inPlaceValue = inPlace[y * inputPitch + x];
+								if (value != expectedValue || inPlaceValue != expectedValue)
+								{
+									return std::string(operationNames[opIndex]) + " radius " + std::to_string(radius) + " on " + std::to_string(width) + "x" + std::to_string(height) +
+									       ": pixel (" + std::to_string(x) + ", " + std::to_string(y) + ") is " + std::to_string(value) + " (" + std::to_string(inPlaceValue) + " in-place), expected " + std::to_string(expectedValue);
+								}
+							}
+
+							// Bytes past the width belong to the caller
+							for (std::uint32_t x = width; x < outputPitch; ++x)
+							{
+								if (output[y * outputPitch + x] != 0xCD)
+									return std::string(operationNames[opIndex]) + " radius " + std::to_string(radius) + " on " + std::to_string(width) + "x" + std::to_string(height) + ": wrote past row width";
+							}
+						}
+					}
+				}
+			}
+		}
+
+		return {};
+	}
+
+	// temporal_filter.effect in float, history is a R8 render target
+	std::uint8_t ShaderTemporalFilter(std::uint8_t currentValue, std::uint8_t historyValue, float historyFactor, float resetThreshold)
+	{
+		float current = currentValue / 255.f;
+		float history = historyValue / 255.f;
+		resetThreshold = std::max(resetThreshold, 1.f / 255.f);
+
+		float historyWeight = historyFactor * std::clamp(1.f - std::abs(current - history) / resetThreshold, 0.f, 1.f);
+		float value = current + (history - current) * historyWeight;
+
+		return static_cast<std::uint8_t>(std::lround(std::clamp(value, 0.f, 1.f) * 255.f));
+	}
+
+	std::string CheckTemporalMaskFilter()
+	{
+		// CPU filter uses 8 bits fixed-point weights, it may only differ from the shader by rounding
+		constexpr int Tolerance = 1;
+		constexpr std::uint32_t Width = 256;
+		constexpr std::uint32_t Height = 16;
+		constexpr std::size_t FrameCount = 30;
+
+		const struct
+		{
+			float historyFactor;
+			float resetThreshold;
+		} settings[] = { { 0.f, 0.5f }, { 0.5f, 0.1f }, { 0.9f, 0.25f }, { 1.f, 1.f }, { 0.75f, 0.f } };
+
+		Random random(7);
+
+		for (const auto& setting : settings)
+		{
+			TemporalMaskFilter filter;
+
+			// Rows 0-1: every value against every history, other rows: noisy masks with moving blobs
+			std::vector<std::uint8_t> history;
+			for (std::size_t frameIndex = 0; frameIndex < FrameCount; ++frameIndex)
+			{
+				std::vector<std::uint8_t> input(std::size_t(Width) * Height);
+				for (std::uint32_t y = 0; y < Height; ++y)
+				{
+					for (std::uint32_t x = 0; x < Width; ++x)
+					{
+						std::uint8_t& value = input[y * Width + x];
+						if (y < 2)
+							value = std::uint8_t((frameIndex % 2 == y) ? x : 255 - x);
+						else if (random() % 8 == 0)
+							value = std::uint8_t(random() % 256);
+						else
+							value = (((x + frameIndex * 3) / 16 + y / 4) % 2 == 0) ? 255 : 0;
+					}
+				}
+
+				std::vector<std::uint8_t> output(input.size());
+				filter.Apply(setting.historyFactor, setting.resetThreshold, input.data(), Width, output.data(), Width, Width, Height);
+
+				for (std::size_t i = 0; i < input.size(); ++i)
+				{
+					// First frame is output as-is, shader is given a zero history factor
+					std::uint8_t expected = (history.empty()) ? input[i] : ShaderTemporalFilter(input[i], history[i], setting.historyFactor, setting.resetThreshold);
+					if (std::abs(int(output[i]) - int(expected)) > Tolerance)
+					{
+						return "history factor " + std::to_string(setting.historyFactor) + ", reset threshold " + std::to_string(setting.resetThreshold) + ", frame " + std::to_string(frameIndex) +
+						       ": pixel " + std::to_string(i) + " (current " + std::to_string(input[i]) + ", history " + ((history.empty()) ? std::string("none") : std::to_string(history[i])) + ") is " + std::to_string(output[i]) + ", expected " + std::to_string(expected);
+					}
+				}
+
+				// Compare each frame from the same history, differences would otherwise accumulate
+				history = std::move(output);
+			}
+		}
+
+		return {};
+	}
+
+	std::string CheckStreamPlanner()
+	{
+		constexpr std::uint64_t Second = 1'000'000'000ULL;
+
+		KinectStreamPlanner planner("test", Source_Color | Source_Depth | Source_Infrared, 30 * Second);
+
+		// Same handling as AzureKinectDevice: running streams are restarted when stream sources change
+		auto Step = [&](SourceFlags requestedSources, std::uint64_t now, SourceFlags expectedStreamSources, std::size_t expectedRestartCount) -> std::string
+		{
+			SourceFlags previousStreamSources = planner.GetStreamSources();
+			if (planner.Update(requestedSources, now) && previousStreamSources != 0 && planner.GetStreamSources() != 0)
+				planner.RegisterRestart(now);
+
+			if (planner.GetStreamSources() != expectedStreamSources || planner.GetRestartCount() != expectedRestartCount)
+			{
+				return "at " + std::to_string(now / Second) + "s requesting " + EnabledSourceToString(requestedSources) + ": streaming " + EnabledSourceToString(planner.GetStreamSources()) +
+				       " with " + std::to_string(planner.GetRestartCount()) + " restart(s), expected " + EnabledSourceToString(expectedStreamSources) + " with " + std::to_string(expectedRestartCount);
+			}
+
+			return {};
+		};
+
+		const struct
+		{
+			std::uint64_t time;
+			SourceFlags requestedSources;
+			SourceFlags expectedStreamSources;
+			std::size_t expectedRestartCount;
+		} steps[] = {
+			{ 0,   Source_Color,                   Source_Color,                   0 }, //< cameras start
+			{ 1,   Source_Color | Source_Depth,    Source_Color | Source_Depth,    1 }, //< greenscreen enabled for the first time
+			{ 2,   Source_Color,                   Source_Color | Source_Depth,    1 }, //< disabled
+			{ 60,  Source_Color,                   Source_Color | Source_Depth,    1 }, //< waited past the hysteresis delay, streams don't shrink
+			{ 61,  Source_Color | Source_Depth,    Source_Color | Source_Depth,    1 }, //< enabled again
+			{ 62,  Source_Color,                   Source_Color | Source_Depth,    1 },
+			{ 100, Source_Color | Source_Infrared, Source_Color | Source_Infrared, 2 }, //< restart needed anyway, depth is stale and dropped
+			{ 101, 0,                              0,                              2 }, //< no access left
+			{ 200, Source_Color,                   Source_Color | Source_Infrared, 2 }, //< cameras start with previously requested sources
+			{ 201, Source_Color | Source_Body,     Source_Color | Source_Body,     3 }, //< infrared is stale, unsupported sources are streamed when requested...
+			{ 202, 0,                              0,                              3 },
+			{ 203, Source_Color,                   Source_Color,                   3 }  //< ...but not remembered
+		};
+
+		for (const auto& step : steps)
+		{
+			std::string error = Step(step.requestedSources, step.time * Second, step.expectedStreamSources, step.expectedRestartCount);
+			if (!error.empty())
+				return error;
+		}
+
+		return {};
+	}
+
+	// Nested calls (e.g. a software shader used from a band) used to deadlock on the dispatch lock
+	std::string CheckWorkerPool()
+	{
+		constexpr std::uint32_t OuterCount = 64;
+		constexpr std::uint32_t InnerCount = 100;
+
+		WorkerPool pool(3);
+
+		std::vector<std::atomic<std::uint32_t>> hits(OuterCount * InnerCount);
+		pool.ParallelFor(OuterCount, [&](std::uint32_t begin, std::uint32_t end)
+		{
+			for (std::uint32_t i = begin; i < end; ++i)
+			{
+				pool.ParallelFor(InnerCount, [&](std::uint32_t innerBegin, std::uint32_t innerEnd)
+				{
+					for (std::uint32_t j = innerBegin; j < innerEnd; ++j)
+						hits[i * InnerCount + j]++;
+				});
+			}
+		});
+
+		for (std::size_t i = 0; i < hits.size(); ++i)
+		{
+			if (hits[i] != 1)
+				return "index " + std::to_string(i) + " processed " + std::to_string(hits[i]) + " time(s)";
+		}
+
+		// Pool still dispatches to its workers after nested calls
+		std::atomic<std::uint32_t> sum = 0;
+		pool.ParallelFor(InnerCount, [&](std::uint32_t begin, std::uint32_t end)
+		{
+			for (std::uint32_t i = begin; i < end; ++i)
+				sum += i;
+		});
+
+		if (sum != InnerCount * (InnerCount - 1) / 2)
+			return "wrong sum after nested calls: " + std::to_string(sum);
+
+		return {};
+	}
+}
+
+int main()
+{
+	std::vector<Check> checks = {
+		{ "KinectFrameDownscaler", CheckFrameDownscaler },
+		{ "KinectStreamPlanner", CheckStreamPlanner },
+		{ "MaskMorphology", CheckMorphology },
+		{ "TemporalMaskFilter", CheckTemporalMaskFilter },
+		{ "WorkerPool", CheckWorkerPool }
+	};
+
+	try
+	{
+		std::size_t failureCount = 0;
+		for (const Check& check : checks)
+		{
+			std::string error = check.func();
+			if (!error.empty())
+				failureCount++;
+
+			std::printf("%-36s %s\n", check.name.c_str(), (error.empty()) ? "ok" : ("FAILED (" + error + ")").c_str());
+		}
+
+		std::printf("%zu/%zu checks passed\n", checks.size() - failureCount, checks.size());
+
+		return (failureCount == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+}
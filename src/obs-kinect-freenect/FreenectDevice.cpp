@@ -16,27 +16,51 @@
 ******************************************************************************/
 
 #include "FreenectDevice.hpp"
+#include "FreenectPlugin.hpp"
 #include <libfreenect/libfreenect_registration.h>
 #include <util/threading.h>
 #include <cstring>
 #include <mutex>
 #include <sstream>
 
-KinectFreenectDevice::KinectFreenectDevice(freenect_device* device, const char* serial) :
-m_device(device)
+KinectFreenectDevice::KinectFreenectDevice(const KinectFreenectPlugin& plugin, freenect_context* context, std::string serial) :
+m_plugin(plugin),
+m_context(context),
+m_device(nullptr),
+m_serial(std::move(serial))
 {
 	SetSupportedSources(Source_Color | Source_Depth | Source_ColorMappedDepth);
-	SetUniqueName("Kinect " + std::string(serial));
+	SetUniqueName("Kinect " + m_serial);
 }
 
 KinectFreenectDevice::~KinectFreenectDevice()
 {
 	StopCapture(); //< Ensure thread has joined before closing the device
 
-	freenect_close_device(m_device);
+	CloseDevice();
 }
 
-void KinectFreenectDevice::ThreadFunc(std::condition_variable& cv, std::mutex& m, std::exception_ptr& error)
+void KinectFreenectDevice::CloseDevice()
+{
+	if (m_device)
+	{
+		freenect_close_device(m_device);
+		m_device = nullptr;
+
+		m_plugin.ReleaseEventThread();
+	}
+}
+
+void KinectFreenectDevice::OpenDevice()
+{
+	if (freenect_open_device_by_camera_serial(m_context, &m_device, m_serial.c_str()) != 0)
+		throw std::runtime_error("failed to open Kinect " + m_serial);
+
+	// Frames are delivered through the plugin event thread
+	m_plugin.AcquireEventThread();
+}
+
+void KinectFreenectDevice::ThreadFunc()
 {
 	os_set_thread_name("KinectDeviceFreenect");
 
@@ -46,36 +70,21 @@ void KinectFreenectDevice::ThreadFunc(std::condition_variable& cv, std::mutex& m
 	freenect_frame_mode currentDepthMode;
 	currentDepthMode.is_valid = 0;
 
-	try
-	{
-		freenect_frame_mode colorMode = freenect_find_video_mode(FREENECT_RESOLUTION_MEDIUM, FREENECT_VIDEO_RGB);
-		if (!colorMode.is_valid)
-			throw std::runtime_error("failed to find a valid color mode");
+	freenect_frame_mode colorMode = freenect_find_video_mode(FREENECT_RESOLUTION_MEDIUM, FREENECT_VIDEO_RGB);
+	if (!colorMode.is_valid)
+		throw std::runtime_error("failed to find a valid color mode");
 
-		if (freenect_set_video_mode(m_device, colorMode) < 0)
-			throw std::runtime_error("failed to set video mode");
+	if (freenect_set_video_mode(m_device, colorMode) < 0)
+		throw std::runtime_error("failed to set video mode");
 
-		currentColorMode = colorMode;
+	currentColorMode = colorMode;
 
-		freenect_frame_mode depthMode = freenect_find_depth_mode(FREENECT_RESOLUTION_MEDIUM, FREENECT_DEPTH_11BIT_PACKED);
+	freenect_frame_mode depthMode = freenect_find_depth_mode(FREENECT_RESOLUTION_MEDIUM, FREENECT_DEPTH_11BIT_PACKED);
 
-		if (freenect_set_depth_mode(m_device, depthMode) < 0)
-			throw std::runtime_error("failed to set video mode");
+	if (freenect_set_depth_mode(m_device, depthMode) < 0)
+		throw std::runtime_error("failed to set video mode");
 
-		currentDepthMode = depthMode;
-	}
-	catch (const std::exception&)
-	{
-		error = std::current_exception();
-	}
-
-	{
-		std::unique_lock<std::mutex> lk(m);
-		cv.notify_all();
-	} // m & cv no longer exists from here
-
-	if (error)
-		return;
+	currentDepthMode = depthMode;
 
 	if (freenect_start_video(m_device) != 0)
 		errorlog("failed to start video");
@@ -83,6 +92,8 @@ void KinectFreenectDevice::ThreadFunc(std::condition_variable& cv, std::mutex& m
 	if (freenect_start_depth(m_device) != 0)
 		errorlog("failed to start depth");
 
+	NotifyCaptureStarted();
+
 	struct FreenectUserdata
 	{
 		std::mutex depthMutex;
@@ -24,21 +24,27 @@
 #include <obs-kinect-core/KinectDevice.hpp>
 #include <libfreenect/libfreenect.h>
 
+class KinectFreenectPlugin;
+
 class KinectFreenectDevice final : public KinectDevice
 {
 	public:
-		KinectFreenectDevice(freenect_device* device, const char* serial);
+		KinectFreenectDevice(const KinectFreenectPlugin& plugin, freenect_context* context, std::string serial);
 		~KinectFreenectDevice();
 
 	private:
-		void ThreadFunc(std::condition_variable& cv, std::mutex& m, std::exception_ptr& exceptionPtr) override;
+		void CloseDevice() override;
+		void OpenDevice() override;
+		void ThreadFunc() override;
 
 		/*static ColorFrameData RetrieveColorFrame(const libfreenect2::Frame* frame);
 		static DepthFrameData RetrieveDepthFrame(const libfreenect2::Frame* frame);
 		static InfraredFrameData RetrieveInfraredFrame(const libfreenect2::Frame* frame);*/
 
+		const KinectFreenectPlugin& m_plugin; //< devices are destroyed before their plugin
 		freenect_context* m_context;
-		freenect_device* m_device;
+		freenect_device* m_device; //< only opened while the device is used (see OpenDevice)
+		std::string m_serial;
 };
 
 #endif
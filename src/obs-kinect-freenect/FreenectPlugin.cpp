@@ -19,6 +19,7 @@
 #include "FreenectDevice.hpp"
 #include <util/threading.h>
 #include <libusb.h>
+#include <cassert>
 #include <stdexcept>
 
 void ErrorCallback(freenect_context* /*device*/, freenect_loglevel level, const char* message)
@@ -38,10 +39,19 @@ void ErrorCallback(freenect_context* /*device*/, freenect_loglevel level, const
 
 KinectFreenectPlugin::KinectFreenectPlugin() :
 m_context(nullptr),
-m_contextThreadRunning(true)
+m_usbContext(nullptr),
+m_contextThreadRunning(false),
+m_openDeviceCount(0),
+m_hasHotplug(false)
 {
-	if (freenect_init(&m_context, nullptr) != 0)
+	if (libusb_init(&m_usbContext) != 0)
+		throw std::runtime_error("failed to initialize libusb context");
+
+	if (freenect_init(&m_context, m_usbContext) != 0)
+	{
+		libusb_exit(m_usbContext);
 		throw std::runtime_error("failed to initialize freenect context");
+	}
 
 #ifdef DEBUG
 	freenect_loglevel logLevel = FREENECT_LOG_DEBUG;
@@ -55,32 +65,35 @@ m_contextThreadRunning(true)
 	// we're not supporting audio for now
 	freenect_select_subdevices(m_context, static_cast<freenect_device_flags>(FREENECT_DEVICE_MOTOR | FREENECT_DEVICE_CAMERA));
 
-	m_contextThread = std::thread([this]()
+	// Hotplug events are dispatched by libusb while processing freenect events (not supported on Windows)
+	if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG))
 	{
-		os_set_thread_name("KinectPluginFreenectEvents");
+		constexpr int MicrosoftVendorId = 0x045E;
 
-		while (m_contextThreadRunning)
-		{
-			timeval timeout = { 0, 100 * 1000 };
-			int res = freenect_process_events_timeout(m_context, &timeout);
-			if (res < 0)
-			{
-				if (res == LIBUSB_ERROR_INTERRUPTED)
-					continue; //< Ignore interruption signals
-
-				errorlog("freenect event processing errored (libusb error code: %d)", res);
-			}
-		}
-	});
+		int events = LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT;
+		if (libusb_hotplug_register_callback(m_usbContext, static_cast<libusb_hotplug_event>(events), LIBUSB_HOTPLUG_NO_FLAGS, MicrosoftVendorId, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, &HandleHotplugEvent, this, &m_hotplugHandle) == LIBUSB_SUCCESS)
+			m_hasHotplug = true;
+		else
+			warnlog("failed to register libusb hotplug callback, devices will only be detected when refreshing");
+	}
+
+	// Hotplug callbacks are only dispatched while handling events, keep a (blocking) event thread around for them
+	if (m_hasHotplug)
+		StartEventThread();
 }
 
 KinectFreenectPlugin::~KinectFreenectPlugin()
 {
-	m_contextThreadRunning = false;
-	m_contextThread.join();
+	StopEventThread();
+
+	if (m_hasHotplug)
+		libusb_hotplug_deregister_callback(m_usbContext, m_hotplugHandle);
 
 	if (freenect_shutdown(m_context) < 0)
 		warnlog("freenect shutdown failed");
+
+	// freenect doesn't release a libusb context it didn't create
+	libusb_exit(m_usbContext);
 }
 
 std::string KinectFreenectPlugin::GetUniqueName() const
@@ -88,29 +101,112 @@ std::string KinectFreenectPlugin::GetUniqueName() const
 	return "KinectV1-Freenect";
 }
 
+void KinectFreenectPlugin::AcquireEventThread() const
+{
+	std::lock_guard<std::mutex> lock(m_contextThreadMutex);
+	if (m_openDeviceCount++ == 0 && !m_contextThread.joinable())
+		StartEventThread();
+}
+
+void KinectFreenectPlugin::ReleaseEventThread() const
+{
+	std::lock_guard<std::mutex> lock(m_contextThreadMutex);
+	assert(m_openDeviceCount > 0);
+	if (--m_openDeviceCount == 0 && !m_hasHotplug)
+		StopEventThread();
+}
+
 std::vector<std::unique_ptr<KinectDevice>> KinectFreenectPlugin::Refresh() const
 {
 	std::vector<std::unique_ptr<KinectDevice>> devices;
 
-	freenect_device_attributes* attributes;
-	int deviceCount = freenect_list_device_attributes(m_context, &attributes);
-	for (int i = 0; i < deviceCount; ++i)
+	// Devices are only opened when used (see KinectFreenectDevice::OpenDevice), this doesn't disturb running ones
+	freenect_device_attributes* attributeList;
+	int deviceCount = freenect_list_device_attributes(m_context, &attributeList);
+	if (deviceCount < 0)
+	{
+		warnlog("failed to list Kinect devices");
+		return devices;
+	}
+
+	int i = 0;
+	for (freenect_device_attributes* attributes = attributeList; attributes; attributes = attributes->next)
 	{
 		try
 		{
-			freenect_device* device;
-			if (freenect_open_device_by_camera_serial(m_context, &device, attributes->camera_serial) == 0)
-				devices.emplace_back(std::make_unique<KinectFreenectDevice>(device, attributes->camera_serial));
-			else
-				warnlog("failed to open Kinect #%d", i);
+			devices.emplace_back(std::make_unique<KinectFreenectDevice>(*this, m_context, attributes->camera_serial));
 		}
 		catch (const std::exception& e)
 		{
-			warnlog("failed to open Kinect #%d: %s", i, e.what());
+			warnlog("failed to create Kinect #%d: %s", i, e.what());
 		}
 
-		attributes = attributes->next;
+		i++;
 	}
 
+	freenect_free_device_attributes(attributeList);
+
 	return devices;
 }
+
+void KinectFreenectPlugin::SetHotplugCallback(HotplugCallback callback)
+{
+	std::lock_guard<std::mutex> lock(m_hotplugMutex);
+	m_hotplugCallback = std::move(callback);
+}
+
+void KinectFreenectPlugin::EventThreadFunc() const
+{
+	os_set_thread_name("KinectPluginFreenectEvents");
+
+	while (m_contextThreadRunning)
+	{
+		// No timeout: this blocks until a transfer completes, a hotplug event occurs or StopEventThread interrupts it
+		int res = freenect_process_events(m_context);
+		if (res < 0)
+		{
+			if (res == LIBUSB_ERROR_INTERRUPTED)
+				continue; //< Ignore interruption signals
+
+			errorlog("freenect event processing errored (libusb error code: %d)", res);
+		}
+	}
+}
+
+void KinectFreenectPlugin::StartEventThread() const
+{
+	m_contextThreadRunning = true;
+	m_contextThread = std::thread(&KinectFreenectPlugin::EventThreadFunc, this);
+}
+
+void KinectFreenectPlugin::StopEventThread() const
+{
+	if (!m_contextThread.joinable())
+		return;
+
+	m_contextThreadRunning = false;
+	libusb_interrupt_event_handler(m_usbContext); //< wakes up the event thread
+	m_contextThread.join();
+}
+
+int LIBUSB_CALL KinectFreenectPlugin::HandleHotplugEvent(libusb_context* /*context*/, libusb_device* device, libusb_hotplug_event /*event*/, void* userdata)
+{
+	KinectFreenectPlugin* plugin = static_cast<KinectFreenectPlugin*>(userdata);
+
+	// Only Kinect cameras matter, motor and audio subdevices come and go with them
+	libusb_device_descriptor descriptor;
+	if (libusb_get_device_descriptor(device, &descriptor) == LIBUSB_SUCCESS)
+	{
+		constexpr std::uint16_t NuiCameraProductId = 0x02AE;
+		constexpr std::uint16_t K4WCameraProductId = 0x02BF;
+
+		if (descriptor.idProduct == NuiCameraProductId || descriptor.idProduct == K4WCameraProductId)
+		{
+			std::lock_guard<std::mutex> lock(plugin->m_hotplugMutex);
+			if (plugin->m_hotplugCallback)
+				plugin->m_hotplugCallback();
+		}
+	}
+
+	return 0; //< keep the callback registered
+}
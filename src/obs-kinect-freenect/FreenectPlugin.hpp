@@ -24,7 +24,9 @@
 #include <obs-kinect-core/Enums.hpp>
 #include <obs-kinect-core/KinectPluginImpl.hpp>
 #include <libfreenect/libfreenect.h>
+#include <libusb.h>
 #include <atomic>
+#include <mutex>
 #include <thread>
 
 class KinectFreenectPlugin : public KinectPluginImpl
@@ -39,13 +41,32 @@ class KinectFreenectPlugin : public KinectPluginImpl
 
 		std::vector<std::unique_ptr<KinectDevice>> Refresh() const override;
 
+		// Called by devices when they're opened/closed, events are only processed while at least one device is open (or hotplug is available)
+		void AcquireEventThread() const;
+		void ReleaseEventThread() const;
+
+		void SetHotplugCallback(HotplugCallback callback) override;
+
 		KinectFreenectPlugin& operator=(const KinectFreenectPlugin&) = delete;
 		KinectFreenectPlugin& operator=(KinectFreenectPlugin&&) = delete;
 
 	private:
+		void EventThreadFunc() const;
+		void StartEventThread() const;
+		void StopEventThread() const;
+
+		static int LIBUSB_CALL HandleHotplugEvent(libusb_context* context, libusb_device* device, libusb_hotplug_event event, void* userdata);
+
+		HotplugCallback m_hotplugCallback;
 		freenect_context* m_context;
-		std::atomic_bool m_contextThreadRunning;
-		std::thread m_contextThread;
+		libusb_context* m_usbContext; //< owned by the plugin (and given to freenect) to receive hotplug events
+		libusb_hotplug_callback_handle m_hotplugHandle;
+		mutable std::atomic_bool m_contextThreadRunning;
+		std::mutex m_hotplugMutex;
+		mutable std::mutex m_contextThreadMutex;
+		mutable std::thread m_contextThread;
+		mutable unsigned int m_openDeviceCount;
+		bool m_hasHotplug;
 };
 
 #endif
@@ -22,6 +22,7 @@
 #include <util/threading.h>
 #include <array>
 #include <sstream>
+#include <stdexcept>
 
 KinectFreenect2Device::KinectFreenect2Device(libfreenect2::Freenect2Device* device) :
 m_device(device)
@@ -37,32 +38,14 @@ KinectFreenect2Device::~KinectFreenect2Device()
 	m_device->close();
 }
 
-void KinectFreenect2Device::ThreadFunc(std::condition_variable& cv, std::mutex& m, std::exception_ptr& error)
+void KinectFreenect2Device::ThreadFunc()
 {
 	os_set_thread_name("KinectDeviceFreenect2");
 
-	try
-	{
-		//TODO
-	}
-	catch (const std::exception&)
-	{
-		error = std::current_exception();
-	}
-
-	{
-		std::unique_lock<std::mutex> lk(m);
-		cv.notify_all();
-	} // m & cv no longer exists from here
-
-	if (error)
-		return;
-
 	if (!m_device->startStreams(true, true))
-	{
-		errorlog("failed to start streams");
-		return;
-	}
+		throw std::runtime_error("failed to start streams");
+
+	NotifyCaptureStarted();
 
 	std::optional<libfreenect2::SyncMultiFrameListener> multiframeListener;
 	libfreenect2::FrameMap frameMap;
@@ -36,7 +36,7 @@ class KinectFreenect2Device final : public KinectDevice
 		~KinectFreenect2Device();
 
 	private:
-		void ThreadFunc(std::condition_variable& cv, std::mutex& m, std::exception_ptr& exceptionPtr) override;
+		void ThreadFunc() override;
 
 		static ColorFrameData RetrieveColorFrame(const libfreenect2::Frame* frame);
 		static DepthFrameData RetrieveDepthFrame(const libfreenect2::Frame* frame);
@@ -0,0 +1,110 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include "NetDevice.hpp"
+#include <obs-kinect-core/WorkerPool.hpp>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <algorithm>
+
+NetDevice::NetDevice(std::string host, std::uint16_t port, const KinectNetworkReceiver::ServerInfo& serverInfo) :
+m_host(std::move(host)),
+m_jitterDelay(30),
+m_port(port)
+{
+	SetSupportedSources(serverInfo.supportedSources);
+	SetUniqueName("Network " + serverInfo.deviceName + " (" + m_host + ":" + std::to_string(m_port) + ")");
+
+	RegisterIntParameter("net_jitter_delay", m_jitterDelay.load(), [](long long a, long long b)
+	{
+		return std::max(a, b);
+	});
+}
+
+NetDevice::~NetDevice()
+{
+	StopCapture(); //< Ensure thread has joined before destroying parameters
+}
+
+obs_properties_t* NetDevice::CreateProperties() const
+{
+	obs_properties_t* props = obs_properties_create();
+
+	obs_property_t* p = obs_properties_add_int_slider(props, "net_jitter_delay", Translate("ObsKinectNet.JitterDelay"), 0, 500, 5);
+	obs_property_int_set_suffix(p, " ms");
+	obs_property_set_long_description(p, Translate("ObsKinectNet.JitterDelayDesc"));
+
+	return props;
+}
+
+void NetDevice::HandleIntParameterUpdate(const std::string& parameterName, long long value)
+{
+	if (parameterName == "net_jitter_delay")
+		m_jitterDelay.store(std::clamp(value, 0LL, 500LL));
+	else
+		errorlog("unhandled int parameter %s", parameterName.c_str());
+}
+
+void NetDevice::ThreadFunc()
+{
+	os_set_thread_name("NetDevice");
+
+	std::shared_ptr<WorkerPool> workerPool = WorkerPool::GetSharedPool();
+
+	NotifyCaptureStarted();
+
+	constexpr std::uint32_t WaitTimeout = 100; //< ms
+
+	KinectNetworkReceiver receiver(m_host, m_port, std::uint64_t(m_jitterDelay.load()) * 1'000'000, workerPool.get());
+	std::uint64_t nextStats = os_gettime_ns() + StatsInterval;
+
+	while (IsRunning())
+	{
+		if (auto sourceFlagUpdate = GetSourceFlagsUpdate())
+			receiver.SetEnabledSources(sourceFlagUpdate.value());
+
+		receiver.SetJitterDelay(std::uint64_t(m_jitterDelay.load()) * 1'000'000);
+
+		if (KinectFramePtr framePtr = receiver.WaitForFrame(WaitTimeout))
+			UpdateFrame(std::move(framePtr));
+
+		std::uint64_t now = os_gettime_ns();
+		if (now >= nextStats)
+		{
+			KinectNetworkReceiver::Stats stats = receiver.PopStats();
+			if (stats.receivedFrames > 0)
+			{
+				double seconds = double(StatsInterval + (now - nextStats)) / 1'000'000'000.0;
+				debuglog("%s: %.1f fps (%llu dropped), %.2f MB/s (compression %.2fx), decode %.2f ms/frame, latency %.1f ms (max %.1f ms), rtt %.2f ms",
+				         GetUniqueName().c_str(),
+				         stats.receivedFrames / seconds,
+				         static_cast<unsigned long long>(stats.droppedFrames),
+				         stats.receivedBytes / seconds / 1'000'000.0,
+				         (stats.receivedBytes > 0) ? double(stats.rawBytes) / stats.receivedBytes : 0.0,
+				         double(stats.decodeTime) / stats.receivedFrames / 1'000'000.0,
+				         (stats.latencyCount > 0) ? double(stats.latencySum) / stats.latencyCount / 1'000'000.0 : 0.0,
+				         stats.maxLatency / 1'000'000.0,
+				         stats.roundTripTime / 1'000'000.0);
+			}
+
+			nextStats = now + StatsInterval;
+		}
+	}
+
+	infolog("exiting thread");
+}
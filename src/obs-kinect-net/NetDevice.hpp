@@ -0,0 +1,51 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_NETDEVICE
+#define OBS_KINECT_PLUGIN_NETDEVICE
+
+#include "NetHelper.hpp"
+#include <obs-kinect-core/KinectDevice.hpp>
+#include <obs-kinect-core/KinectNetworkReceiver.hpp>
+#include <atomic>
+#include <string>
+
+// Receives the frames of a device served by a remote capture host (see KinectNetworkSender)
+// Only the enabled streams are requested from the sender, the connection is only kept open while capturing.
+class NetDevice final : public KinectDevice
+{
+	public:
+		NetDevice(std::string host, std::uint16_t port, const KinectNetworkReceiver::ServerInfo& serverInfo);
+		~NetDevice();
+
+		obs_properties_t* CreateProperties() const override;
+
+		static constexpr std::uint64_t StatsInterval = 10'000'000'000; //< ns
+
+	private:
+		void HandleIntParameterUpdate(const std::string& parameterName, long long value) override;
+		void ThreadFunc() override;
+
+		std::string m_host;
+		std::atomic<long long> m_jitterDelay; //< ms
+		std::uint16_t m_port;
+};
+
+#endif
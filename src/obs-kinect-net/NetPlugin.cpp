@@ -0,0 +1,82 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include "NetPlugin.hpp"
+#include "NetDevice.hpp"
+#include <obs-kinect-core/KinectNetworkFormat.hpp>
+#include <obs-kinect-core/KinectNetworkReceiver.hpp>
+#include <cstdlib>
+#include <string_view>
+
+std::string NetPlugin::GetUniqueName() const
+{
+	return "Network";
+}
+
+std::vector<std::unique_ptr<KinectDevice>> NetPlugin::Refresh() const
+{
+	std::vector<std::unique_ptr<KinectDevice>> devices;
+
+	const char* hostList = std::getenv("OBS_KINECT_NET_HOSTS");
+	if (!hostList)
+		return devices;
+
+	std::string_view remaining(hostList);
+	while (!remaining.empty())
+	{
+		std::size_t separator = remaining.find(',');
+		std::string entry(remaining.substr(0, separator));
+		remaining = (separator != remaining.npos) ? remaining.substr(separator + 1) : std::string_view();
+
+		if (entry.empty())
+			continue;
+
+		// host, host:port, [ipv6] or [ipv6]:port
+		std::string host = entry;
+		std::uint16_t port = KinectNetworkFormat::DefaultPort;
+		std::size_t portSeparator = entry.npos;
+
+		if (entry.front() == '[')
+		{
+			std::size_t bracketEnd = entry.find(']');
+			host = entry.substr(1, bracketEnd - 1);
+			if (bracketEnd != entry.npos && bracketEnd + 1 < entry.size() && entry[bracketEnd + 1] == ':')
+				portSeparator = bracketEnd + 1;
+		}
+		else if (std::size_t separatorPos = entry.find(':'); separatorPos != entry.npos && separatorPos == entry.rfind(':'))
+		{
+			host = entry.substr(0, separatorPos);
+			portSeparator = separatorPos;
+		}
+
+		if (portSeparator != entry.npos)
+			port = static_cast<std::uint16_t>(std::strtoul(entry.c_str() + portSeparator + 1, nullptr, 10));
+
+		try
+		{
+			KinectNetworkReceiver::ServerInfo serverInfo = KinectNetworkReceiver::Probe(host, port, ProbeTimeout);
+			devices.emplace_back(std::make_unique<NetDevice>(host, port, serverInfo));
+		}
+		catch (const std::exception& e)
+		{
+			warnlog("failed to probe %s: %s", entry.c_str(), e.what());
+		}
+	}
+
+	return devices;
+}
@@ -0,0 +1,237 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include <obs-kinect-core/KinectNetworkReceiver.hpp>
+#include <obs-kinect-core/KinectNetworkSender.hpp>
+#include <obs-kinect-core/KinectRecording.hpp>
+#include <obs-kinect-core/WorkerPool.hpp>
+#include <util/platform.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Streams frames through a KinectNetworkSender and a KinectNetworkReceiver over loopback and reports throughput and latency
+// Usage: obs-kinect-netbench [recording.kinectrec|-] [fps] [frame count] [jitter delay ms]
+// Without a recording, synthetic 1080p color, depth and body index frames are used.
+
+namespace
+{
+	constexpr std::uint32_t DepthWidth = 512;
+	constexpr std::uint32_t DepthHeight = 424;
+
+	KinectFramePtr BuildSyntheticFrame(std::uint64_t frameIndex)
+	{
+		constexpr std::uint32_t ColorWidth = 1920;
+		constexpr std::uint32_t ColorHeight = 1080;
+
+		KinectFramePtr frame = std::make_shared<KinectFrame>();
+		frame->frameIndex = frameIndex;
+
+		// Horizontal gradient with a moving square, so color doesn't compress to nothing
+		std::uint32_t squareX = static_cast<std::uint32_t>(frameIndex * 16 % (ColorWidth - 200));
+
+		auto& colorFrame = frame->colorFrame.emplace();
+		colorFrame.width = ColorWidth;
+		colorFrame.height = ColorHeight;
+		colorFrame.pitch = ColorWidth * 4;
+		colorFrame.format = GS_BGRA;
+		colorFrame.memory.resize(std::size_t(colorFrame.pitch) * ColorHeight);
+		for (std::uint32_t y = 0; y < ColorHeight; ++y)
+		{
+			std::uint8_t* row = &colorFrame.memory[y * colorFrame.pitch];
+			for (std::uint32_t x = 0; x < ColorWidth; ++x)
+			{
+				bool square = (x >= squareX && x < squareX + 200 && y >= 400 && y < 600);
+				row[x * 4 + 0] = (square) ? 40 : static_cast<std::uint8_t>(x * 255 / ColorWidth);
+				row[x * 4 + 1] = (square) ? 200 : static_cast<std::uint8_t>(y * 255 / ColorHeight);
+				row[x * 4 + 2] = static_cast<std::uint8_t>((x ^ y) & 0x1F);
+				row[x * 4 + 3] = 255;
+			}
+		}
+		colorFrame.ptr.reset(colorFrame.memory.data());
+
+		std::uint32_t playerX = static_cast<std::uint32_t>(frameIndex * 4 % (DepthWidth - 100));
+
+		auto& depthFrame = frame->depthFrame.emplace();
+		depthFrame.width = DepthWidth;
+		depthFrame.height = DepthHeight;
+		depthFrame.pitch = DepthWidth * sizeof(std::uint16_t);
+		depthFrame.memory.resize(std::size_t(depthFrame.pitch) * DepthHeight);
+
+		auto& bodyFrame = frame->bodyIndexFrame.emplace();
+		bodyFrame.width = DepthWidth;
+		bodyFrame.height = DepthHeight;
+		bodyFrame.pitch = DepthWidth;
+		bodyFrame.memory.resize(std::size_t(bodyFrame.pitch) * DepthHeight);
+
+		std::uint16_t* depthPixels = reinterpret_cast<std::uint16_t*>(depthFrame.memory.data());
+		for (std::uint32_t y = 0; y < DepthHeight; ++y)
+		{
+			for (std::uint32_t x = 0; x < DepthWidth; ++x)
+			{
+				bool player = (x >= playerX && x < playerX + 100 && y >= 100);
+				depthPixels[y * DepthWidth + x] = (x < 8) ? 0 : static_cast<std::uint16_t>((player) ? 1500 + (x - playerX) : 3000 + x);
+				bodyFrame.memory[y * DepthWidth + x] = (player) ? 0 : 0xFF;
+			}
+		}
+
+		depthFrame.ptr.reset(depthPixels);
+		bodyFrame.ptr.reset(bodyFrame.memory.data());
+
+		return frame;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string recordingPath = (argc >= 2) ? argv[1] : "-";
+	std::uint32_t fps = (argc >= 3) ? static_cast<std::uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 30;
+	std::size_t frameCount = (argc >= 4) ? std::strtoul(argv[3], nullptr, 10) : 300;
+	std::uint64_t jitterDelay = (argc >= 5) ? std::strtoull(argv[4], nullptr, 10) * 1'000'000 : 0;
+
+	try
+	{
+		// Frames are prepared beforehand so the producer only measures the network path
+		std::vector<KinectFramePtr> frames;
+		SourceFlags sources;
+		if (recordingPath != "-")
+		{
+			auto recording = std::make_shared<KinectRecording>(recordingPath);
+			sources = recording->GetSourceFlags();
+			for (std::size_t i = 0; i < recording->GetFrameCount(); ++i)
+				frames.push_back(recording->ReadFrame(i, sources));
+		}
+		else
+		{
+			sources = Source_Body | Source_Color | Source_Depth;
+			for (std::uint64_t i = 0; i < 30; ++i)
+				frames.push_back(BuildSyntheticFrame(i));
+		}
+
+		if (frames.empty())
+			throw std::runtime_error("no frame to send");
+
+		fps = std::max<std::uint32_t>(fps, 1);
+
+		KinectNetworkSender sender(0, "netbench", sources);
+
+		std::shared_ptr<WorkerPool> workerPool = WorkerPool::GetSharedPool();
+		KinectNetworkReceiver receiver("127.0.0.1", sender.GetPort(), jitterDelay, workerPool.get());
+		receiver.SetEnabledSources(sources);
+
+		// Wait for the connection
+		for (std::size_t i = 0; i < 100 && !receiver.IsConnected(); ++i)
+			os_sleep_ms(10);
+
+		if (!receiver.IsConnected())
+			throw std::runtime_error("failed to connect to the sender");
+
+		std::atomic_bool producing(true);
+		std::thread producer([&]
+		{
+			std::uint64_t frameInterval = 1'000'000'000ULL / fps;
+			std::uint64_t nextFrame = os_gettime_ns();
+			for (std::size_t i = 0; i < frameCount; ++i)
+			{
+				// A copy of the frame description is published (data is shared), as published frames are never modified
+				KinectFramePtr frame = std::make_shared<KinectFrame>();
+				const KinectFrame& source = *frames[i % frames.size()];
+				auto CopyView = [](auto& target, const auto& sourceData)
+				{
+					if (!sourceData)
+						return;
+
+					auto& data = target.emplace();
+					data.width = sourceData->width;
+					data.height = sourceData->height;
+					data.pitch = sourceData->pitch;
+					data.ptr.reset(sourceData->ptr.get());
+				};
+
+				CopyView(frame->backgroundRemovalFrame, source.backgroundRemovalFrame);
+				CopyView(frame->bodyIndexFrame, source.bodyIndexFrame);
+				CopyView(frame->colorFrame, source.colorFrame);
+				CopyView(frame->colorMappedBodyFrame, source.colorMappedBodyFrame);
+				CopyView(frame->colorMappedDepthFrame, source.colorMappedDepthFrame);
+				CopyView(frame->depthFrame, source.depthFrame);
+				CopyView(frame->depthMappingFrame, source.depthMappingFrame);
+				CopyView(frame->infraredFrame, source.infraredFrame);
+				if (frame->colorFrame)
+					frame->colorFrame->format = source.colorFrame->format;
+
+				frame->storage = frames[i % frames.size()];
+				frame->frameIndex = i;
+				frame->timestamp = os_gettime_ns();
+
+				sender.Publish(std::move(frame));
+
+				nextFrame += frameInterval;
+				os_sleepto_ns(nextFrame);
+			}
+
+			producing = false;
+		});
+
+		std::uint64_t start = os_gettime_ns();
+		std::uint64_t playedFrames = 0;
+		std::uint64_t idleSince = 0;
+		for (;;)
+		{
+			if (receiver.WaitForFrame(100))
+			{
+				playedFrames++;
+				idleSince = 0;
+				continue;
+			}
+
+			// Stop once no frame came for a while after the producer is done
+			if (!producing)
+			{
+				if (idleSince == 0)
+					idleSince = os_gettime_ns();
+				else if (os_gettime_ns() - idleSince > 500'000'000)
+					break;
+			}
+		}
+		producer.join();
+
+		double seconds = double(os_gettime_ns() - start) / 1'000'000'000.0;
+		KinectNetworkReceiver::Stats stats = receiver.PopStats();
+
+		auto ToMs = [](double ns) { return ns / 1'000'000.0; };
+
+		std::printf("%s: %zu frames at %u fps, jitter delay %.1f ms, %zu worker(s)\n", (recordingPath != "-") ? recordingPath.c_str() : "synthetic", frameCount, fps, ToMs(double(jitterDelay)), workerPool->GetWorkerCount());
+		std::printf("received %llu frames, played %llu, dropped %llu\n", static_cast<unsigned long long>(stats.receivedFrames), static_cast<unsigned long long>(playedFrames), static_cast<unsigned long long>(stats.droppedFrames));
+		std::printf("throughput: %.2f MB/s on the wire, %.2f MB/s decoded (ratio %.2f)\n", double(stats.receivedBytes) / seconds / (1024.0 * 1024.0), double(stats.rawBytes) / seconds / (1024.0 * 1024.0), (stats.receivedBytes > 0) ? double(stats.rawBytes) / double(stats.receivedBytes) : 0.0);
+		std::printf("decode: %.2f ms/frame\n", (stats.receivedFrames > 0) ? ToMs(double(stats.decodeTime) / double(stats.receivedFrames)) : 0.0);
+		std::printf("latency (capture to playout): avg %.2f ms, max %.2f ms, round trip %.3f ms\n", (stats.latencyCount > 0) ? ToMs(double(stats.latencySum) / double(stats.latencyCount)) : 0.0, ToMs(double(stats.maxLatency)), ToMs(double(stats.roundTripTime)));
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
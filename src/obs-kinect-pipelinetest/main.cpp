@@ -0,0 +1,640 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-headless/HeadlessObs.hpp>
+#include <obs-module.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Drives Kinect sources on synthetic devices through obs-headless and checks what each processed frame costs
+// Usage: obs-kinect-pipelinetest <data folder> [--bench]
+// <data folder> is data/obs-plugins/obs-kinect, obs-kinect and obs-kinect-synthetic are loaded from the executable folder
+// (and the working directory, which must be the executable folder for the synthetic backend to be found).
+// Every frame processed by a source (a tick where it uploaded something) must upload the expected amount of bytes and run
+// the expected number of passes, every tick must render with the expected number of passes and no upload, and nothing may
+// be allocated once the pipeline is warmed up. --bench also prints the time spent updating and rendering.
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr std::size_t MaxReportedFailures = 5; //< per source
+	constexpr std::size_t MinMeasuredFrameCount = 10;
+	constexpr std::size_t TickCount = 90;
+	constexpr std::size_t WarmupFrameCount = 3;
+	constexpr Clock::duration TickPeriod = std::chrono::microseconds(16'667);
+
+	// Synthetic devices output 640x480 RGBA color and 512x424 depth/infrared/body index
+	constexpr std::uint64_t BodyIndexBytes = 512 * 424;               //< GS_R8
+	constexpr std::uint64_t ColorBytes = 640 * 480 * 4;               //< GS_RGBA
+	constexpr std::uint64_t ColorMappedDepthBytes = 640 * 480 * 2;    //< GS_R16 (depth mapped on the CPU)
+	constexpr std::uint64_t DepthBytes = 512 * 424 * 2;               //< GS_R16 (depth and infrared)
+	constexpr std::uint64_t DepthMappingBytes = 640 * 480 * 4 * 2;    //< GS_RG32F
+
+	constexpr std::size_t BlurPassCount = 3;
+	constexpr std::size_t MaskPassCount = 1 + BlurPassCount * 2; //< greenscreen filter then horizontal and vertical blur passes
+
+	struct FrameCost
+	{
+		std::uint64_t uploadedBytes = 0;
+		std::size_t passCount = 0;
+
+		bool operator==(const FrameCost& cost) const
+		{
+			return uploadedBytes == cost.uploadedBytes && passCount == cost.passCount;
+		}
+	};
+
+	struct RenderCost
+	{
+		std::size_t passCount = 0;
+		std::size_t renderTargetBeginCount = 0;
+	};
+
+	struct SourceDesc
+	{
+		std::string name;
+		std::string id;
+		std::function<void(obs_data_t* settings)> setup;
+		std::optional<std::size_t> filterParent; //< index of the source this filter is added to
+		std::optional<std::uint64_t> asyncFrameBytes; //< size of each async frame, for CPU sources
+		std::vector<FrameCost> frameCosts; //< accepted costs of a frame processed in video_tick
+		RenderCost renderCost; //< cost of each tick in video_render
+	};
+
+	struct Scenario
+	{
+		std::string name;
+		std::vector<SourceDesc> sources;
+		std::optional<FrameCost> sharedMaskCost; //< cost of the frames producing a mask shared by the scenario sources, at most one per device frame
+	};
+
+	struct SourceStats
+	{
+		std::size_t asyncFrameCount = 0;
+		std::size_t expectedFrameCount = 0;
+		std::size_t measuredFrameCount = 0;
+		std::size_t measuredTickCount = 0;
+		std::size_t processedFrameCount = 0;
+		Clock::duration renderTime = Clock::duration::zero();
+		Clock::duration updateTime = Clock::duration::zero();
+		std::vector<std::string> failures;
+		std::size_t failureCount = 0;
+
+		void Fail(std::string failure)
+		{
+			if (failureCount++ < MaxReportedFailures)
+				failures.push_back(std::move(failure));
+		}
+	};
+
+	struct TickCost
+	{
+		FrameCost update;
+		RenderCost render;
+		std::uint64_t renderUploadedBytes = 0;
+		std::vector<std::string> allocations;
+		std::vector<std::uint64_t> asyncFrameBytes;
+	};
+
+	void SetupDevice(obs_data_t* settings)
+	{
+		obs_data_set_string(settings, "device", "Synthetic_Synthetic #0"); //< registry names are prefixed by the plugin name
+		obs_data_set_int(settings, "synthetic_color_resolution", 0);
+		obs_data_set_int(settings, "synthetic_framerate", 30);
+	}
+
+	void SetupGreenscreen(obs_data_t* settings, int type, bool gpuDepthMapping)
+	{
+		obs_data_set_bool(settings, "greenscreen_enabled", true);
+		obs_data_set_bool(settings, "greenscreen_gpudepthmapping", gpuDepthMapping);
+		obs_data_set_int(settings, "greenscreen_blurpasses", static_cast<long long>(BlurPassCount));
+		obs_data_set_int(settings, "greenscreen_effect", 0); //< remove background
+		obs_data_set_int(settings, "greenscreen_maxdirtydepth", 0);
+		obs_data_set_int(settings, "greenscreen_morphology", 0);
+		obs_data_set_int(settings, "greenscreen_temporalframes", 1);
+		obs_data_set_int(settings, "greenscreen_type", type);
+	}
+
+	std::vector<Scenario> BuildScenarios()
+	{
+		constexpr int BodyFilter = 0;
+		constexpr int DepthFilter = 1;
+
+		constexpr int ColorSource = 0;
+		constexpr int DepthSource = 1;
+		constexpr int InfraredSource = 2;
+
+		auto Source = [](std::string name, std::string id, std::function<void(obs_data_t*)> setup)
+		{
+			SourceDesc source;
+			source.name = std::move(name);
+			source.id = std::move(id);
+			source.setup = [setup = std::move(setup)](obs_data_t* settings)
+			{
+				SetupDevice(settings);
+				if (setup)
+					setup(settings);
+			};
+
+			return source;
+		};
+
+		auto Greenscreen = [](int sourceType, int filterType, bool gpuDepthMapping)
+		{
+			return [=](obs_data_t* settings)
+			{
+				obs_data_set_int(settings, "source", sourceType);
+				SetupGreenscreen(settings, filterType, gpuDepthMapping);
+			};
+		};
+
+		auto SourceType = [](int sourceType)
+		{
+			return [=](obs_data_t* settings)
+			{
+				obs_data_set_int(settings, "source", sourceType);
+			};
+		};
+
+		const RenderCost drawCost = { 1, 0 };
+		const FrameCost colorMaskCost = { DepthBytes + ColorBytes + DepthMappingBytes, MaskPassCount + 1 };
+
+		std::vector<Scenario> scenarios;
+
+		{
+			Scenario& scenario = scenarios.emplace_back();
+			scenario.name = "color";
+
+			SourceDesc& source = scenario.sources.emplace_back(Source("color", "kinect_source", SourceType(ColorSource)));
+			source.frameCosts = { { ColorBytes, 0 } };
+			source.renderCost = drawCost;
+		}
+
+		{
+			Scenario& scenario = scenarios.emplace_back();
+			scenario.name = "color with depth greenscreen";
+
+			SourceDesc& source = scenario.sources.emplace_back(Source("greenscreen", "kinect_source", Greenscreen(ColorSource, DepthFilter, true)));
+			source.frameCosts = { colorMaskCost };
+			source.renderCost = drawCost;
+		}
+
+		{
+			Scenario& scenario = scenarios.emplace_back();
+			scenario.name = "color with body greenscreen";
+
+			SourceDesc& source = scenario.sources.emplace_back(Source("greenscreen", "kinect_source", Greenscreen(ColorSource, BodyFilter, true)));
+			source.frameCosts = { { BodyIndexBytes + ColorBytes + DepthMappingBytes, MaskPassCount + 1 } };
+			source.renderCost = drawCost;
+		}
+
+		{
+			Scenario& scenario = scenarios.emplace_back();
+			scenario.name = "color with depth greenscreen mapped on the CPU";
+
+			SourceDesc& source = scenario.sources.emplace_back(Source("greenscreen", "kinect_source", Greenscreen(ColorSource, DepthFilter, false)));
+			source.frameCosts = { { ColorBytes + ColorMappedDepthBytes, MaskPassCount + 1 } };
+			source.renderCost = drawCost;
+		}
+
+		{
+			Scenario& scenario = scenarios.emplace_back();
+			scenario.name = "depth";
+
+			SourceDesc& source = scenario.sources.emplace_back(Source("depth", "kinect_source", SourceType(DepthSource)));
+			source.frameCosts = { { DepthBytes, 1 } }; //< depth to color conversion
+			source.renderCost = drawCost;
+		}
+
+		{
+			Scenario& scenario = scenarios.emplace_back();
+			scenario.name = "infrared";
+
+			SourceDesc& source = scenario.sources.emplace_back(Source("infrared", "kinect_source", SourceType(InfraredSource)));
+			source.frameCosts = { { DepthBytes, 1 } }; //< infrared to color conversion
+			source.renderCost = drawCost;
+		}
+
+		{
+			// Both sources use the same mask settings, only one of them must produce the mask of each frame
+			Scenario& scenario = scenarios.emplace_back();
+			scenario.name = "two sources sharing a greenscreen mask";
+			scenario.sharedMaskCost = colorMaskCost;
+
+			const FrameCost consumerCost = { ColorBytes, 1 }; //< background effect only
+
+			for (const char* name : { "greenscreen A", "greenscreen B" })
+			{
+				SourceDesc& source = scenario.sources.emplace_back(Source(name, "kinect_source", Greenscreen(ColorSource, DepthFilter, true)));
+				source.frameCosts = { colorMaskCost, consumerCost };
+				source.renderCost = drawCost;
+			}
+		}
+
+		{
+			// The filter renders its parent to a render target and applies the mask to it (alpha mask then draw)
+			Scenario& scenario = scenarios.emplace_back();
+			scenario.name = "mask filter on a color source";
+
+			SourceDesc& parent = scenario.sources.emplace_back(Source("color", "kinect_source", SourceType(ColorSource)));
+			parent.frameCosts = { { ColorBytes, 0 } };
+			parent.renderCost = drawCost;
+
+			SourceDesc& filter = scenario.sources.emplace_back(Source("mask filter", "kinect_mask_filter", [](obs_data_t* settings) { SetupGreenscreen(settings, DepthFilter, true); }));
+			filter.filterParent = 0;
+			filter.frameCosts = { { DepthBytes + DepthMappingBytes, MaskPassCount } };
+			filter.renderCost = { 2, 2 };
+		}
+
+		{
+			// Frames are processed by the CPU compositor and output as async video, which libobs uploads
+			Scenario& scenario = scenarios.emplace_back();
+			scenario.name = "CPU color with depth greenscreen";
+
+			SourceDesc& source = scenario.sources.emplace_back(Source("greenscreen", "kinect_source_cpu", Greenscreen(ColorSource, DepthFilter, true)));
+			source.asyncFrameBytes = ColorBytes;
+		}
+
+		return scenarios;
+	}
+
+	std::string ToString(const FrameCost& cost)
+	{
+		return std::to_string(cost.uploadedBytes) + " bytes uploaded and " + std::to_string(cost.passCount) + " passes";
+	}
+
+	std::string ToString(const RenderCost& cost)
+	{
+		return std::to_string(cost.passCount) + " passes and " + std::to_string(cost.renderTargetBeginCount) + " render targets";
+	}
+
+	std::map<const obs_source_t*, TickCost> SplitCommands(const std::vector<HeadlessCommand>& commands, bool renderPhase, std::vector<std::string>& errors)
+	{
+		std::map<const obs_source_t*, TickCost> costs;
+		for (const HeadlessCommand& command : commands)
+		{
+			TickCost& cost = costs[command.source];
+
+			switch (command.type)
+			{
+				case HeadlessCommandType::AsyncVideoOutput:
+					cost.asyncFrameBytes.push_back(command.byteCount);
+					break;
+
+				case HeadlessCommandType::EffectCreate:
+				case HeadlessCommandType::RenderTargetCreate:
+				case HeadlessCommandType::TextureCreate:
+					cost.allocations.push_back(std::string(HeadlessObs::ToString(command.type)) + " " + ((command.type == HeadlessCommandType::EffectCreate) ? command.name : std::to_string(command.width) + "x" + std::to_string(command.height)));
+					if (renderPhase)
+						cost.renderUploadedBytes += command.byteCount;
+					else
+						cost.update.uploadedBytes += command.byteCount;
+					break;
+
+				case HeadlessCommandType::Error:
+					errors.push_back(command.name);
+					break;
+
+				case HeadlessCommandType::RenderTargetBegin:
+					if (renderPhase)
+						cost.render.renderTargetBeginCount++;
+					break;
+
+				case HeadlessCommandType::TechniquePass:
+					if (renderPhase)
+						cost.render.passCount++;
+					else
+						cost.update.passCount++;
+					break;
+
+				case HeadlessCommandType::TextureUpload:
+					if (renderPhase)
+						cost.renderUploadedBytes += command.byteCount;
+					else
+						cost.update.uploadedBytes += command.byteCount;
+					break;
+
+				case HeadlessCommandType::Clear:
+				case HeadlessCommandType::Draw:
+				case HeadlessCommandType::RenderTargetDestroy:
+				case HeadlessCommandType::TextureDestroy:
+					break;
+			}
+		}
+
+		return costs;
+	}
+
+	bool RunScenario(const Scenario& scenario, bool bench)
+	{
+		std::vector<obs_source_t*> sources;
+		std::vector<SourceStats> stats(scenario.sources.size());
+		std::vector<std::string> errors;
+
+		for (const SourceDesc& sourceDesc : scenario.sources)
+		{
+			obs_data_t* settings = obs_data_create();
+			sourceDesc.setup(settings);
+
+			obs_source_t* source = obs_source_create(sourceDesc.id.c_str(), sourceDesc.name.c_str(), settings, nullptr);
+			obs_data_release(settings);
+
+			if (!source)
+				throw std::runtime_error("failed to create " + sourceDesc.name + " (" + sourceDesc.id + ")");
+
+			if (sourceDesc.filterParent)
+				obs_source_filter_add(sources[*sourceDesc.filterParent], source);
+			else
+				obs_source_inc_showing(source);
+
+			sources.push_back(source);
+		}
+
+		SplitCommands(HeadlessObs::FetchCommands(), false, errors);
+
+		auto GetSourceIndex = [&](const obs_source_t* source) -> std::optional<std::size_t>
+		{
+			auto it = std::find(sources.begin(), sources.end(), source);
+			if (it == sources.end())
+				return std::nullopt;
+
+			return static_cast<std::size_t>(std::distance(sources.begin(), it));
+		};
+
+		std::size_t sharedMaskFrameCount = 0;
+
+		Clock::time_point nextTick = Clock::now();
+		for (std::size_t tick = 0; tick < TickCount; ++tick)
+		{
+			// Pipelines are warmed up once every source processed a few frames as expected (devices may not output all streams at first)
+			bool warmedUp = true;
+			for (std::size_t i = 0; i < scenario.sources.size(); ++i)
+			{
+				std::size_t frameCount = (scenario.sources[i].asyncFrameBytes) ? stats[i].asyncFrameCount : stats[i].expectedFrameCount;
+				if (frameCount < WarmupFrameCount)
+					warmedUp = false;
+			}
+
+			Clock::time_point updateStart = Clock::now();
+			HeadlessObs::RunTickCallbacks(std::chrono::duration<float>(TickPeriod).count());
+			for (obs_source_t* source : sources)
+				obs_source_video_tick(source, std::chrono::duration<float>(TickPeriod).count());
+
+			Clock::duration updateTime = Clock::now() - updateStart;
+
+			std::map<const obs_source_t*, TickCost> updateCosts = SplitCommands(HeadlessObs::FetchCommands(), false, errors);
+
+			Clock::time_point renderStart = Clock::now();
+			obs_enter_graphics();
+			for (std::size_t i = 0; i < sources.size(); ++i)
+			{
+				if (!scenario.sources[i].filterParent)
+					obs_source_video_render(sources[i]);
+			}
+			obs_leave_graphics();
+
+			Clock::duration renderTime = Clock::now() - renderStart;
+
+			std::map<const obs_source_t*, TickCost> renderCosts = SplitCommands(HeadlessObs::FetchCommands(), true, errors);
+
+			for (const auto& [source, cost] : updateCosts)
+			{
+				if (!source)
+					errors.push_back("commands issued outside of any source");
+				else if (!GetSourceIndex(source))
+					errors.push_back("commands issued by an unknown source");
+			}
+
+			for (std::size_t i = 0; i < sources.size(); ++i)
+			{
+				const SourceDesc& sourceDesc = scenario.sources[i];
+				SourceStats& sourceStats = stats[i];
+
+				TickCost updateCost;
+				if (auto it = updateCosts.find(sources[i]); it != updateCosts.end())
+					updateCost = it->second;
+
+				TickCost renderCost;
+				if (auto it = renderCosts.find(sources[i]); it != renderCosts.end())
+					renderCost = it->second;
+
+				// Async frames are output by a worker thread whenever they are ready
+				updateCost.asyncFrameBytes.insert(updateCost.asyncFrameBytes.end(), renderCost.asyncFrameBytes.begin(), renderCost.asyncFrameBytes.end());
+				for (std::uint64_t frameBytes : updateCost.asyncFrameBytes)
+				{
+					if (!sourceDesc.asyncFrameBytes)
+						sourceStats.Fail("unexpected async frame");
+					else if (frameBytes != *sourceDesc.asyncFrameBytes)
+						sourceStats.Fail("tick " + std::to_string(tick) + ": async frame of " + std::to_string(frameBytes) + " bytes, expected " + std::to_string(*sourceDesc.asyncFrameBytes));
+
+					sourceStats.asyncFrameCount++;
+				}
+
+				bool processedFrame = (updateCost.update.uploadedBytes > 0 || updateCost.update.passCount > 0);
+				bool expectedCost = (std::find(sourceDesc.frameCosts.begin(), sourceDesc.frameCosts.end(), updateCost.update) != sourceDesc.frameCosts.end());
+				if (processedFrame)
+				{
+					sourceStats.processedFrameCount++;
+					if (expectedCost)
+						sourceStats.expectedFrameCount++;
+				}
+
+				if (!warmedUp)
+					continue;
+
+				for (const std::string& allocation : updateCost.allocations)
+					sourceStats.Fail("tick " + std::to_string(tick) + ": " + allocation + " after warmup");
+
+				for (const std::string& allocation : renderCost.allocations)
+					sourceStats.Fail("tick " + std::to_string(tick) + ": " + allocation + " while rendering after warmup");
+
+				if (processedFrame)
+				{
+					sourceStats.measuredFrameCount++;
+					sourceStats.updateTime += updateTime;
+
+					if (!expectedCost)
+						sourceStats.Fail("tick " + std::to_string(tick) + ": frame processed with " + ToString(updateCost.update));
+
+					if (scenario.sharedMaskCost && updateCost.update == *scenario.sharedMaskCost)
+						sharedMaskFrameCount++;
+				}
+
+				sourceStats.measuredTickCount++;
+				sourceStats.renderTime += renderTime;
+
+				if (renderCost.renderUploadedBytes > 0)
+					sourceStats.Fail("tick " + std::to_string(tick) + ": " + std::to_string(renderCost.renderUploadedBytes) + " bytes uploaded while rendering");
+
+				if (renderCost.render.passCount != sourceDesc.renderCost.passCount || renderCost.render.renderTargetBeginCount != sourceDesc.renderCost.renderTargetBeginCount)
+					sourceStats.Fail("tick " + std::to_string(tick) + ": rendered with " + ToString(renderCost.render) + ", expected " + ToString(sourceDesc.renderCost));
+			}
+
+			nextTick += TickPeriod;
+			std::this_thread::sleep_until(nextTick);
+		}
+
+		for (std::size_t i = sources.size(); i-- > 0;)
+		{
+			if (scenario.sources[i].filterParent)
+				obs_source_filter_remove(sources[*scenario.sources[i].filterParent], sources[i]);
+			else
+				obs_source_dec_showing(sources[i]);
+
+			obs_source_release(sources[i]);
+		}
+
+		SplitCommands(HeadlessObs::FetchCommands(), false, errors);
+
+		bool success = true;
+		std::printf("%s\n", scenario.name.c_str());
+
+		std::size_t maxMeasuredFrameCount = 0;
+		for (std::size_t i = 0; i < scenario.sources.size(); ++i)
+		{
+			const SourceDesc& sourceDesc = scenario.sources[i];
+			SourceStats& sourceStats = stats[i];
+
+			if (sourceDesc.asyncFrameBytes)
+			{
+				if (sourceStats.asyncFrameCount < MinMeasuredFrameCount)
+					sourceStats.Fail("only " + std::to_string(sourceStats.asyncFrameCount) + " async frames output");
+
+				if (sourceStats.processedFrameCount > 0)
+					sourceStats.Fail(std::to_string(sourceStats.processedFrameCount) + " frames used the graphics API");
+			}
+			else if (sourceStats.measuredFrameCount < MinMeasuredFrameCount)
+				sourceStats.Fail("only " + std::to_string(sourceStats.measuredFrameCount) + " frames measured");
+
+			maxMeasuredFrameCount = std::max(maxMeasuredFrameCount, sourceStats.measuredFrameCount);
+
+			std::printf("  %-16s %3zu frames", sourceDesc.name.c_str(), (sourceDesc.asyncFrameBytes) ? sourceStats.asyncFrameCount : sourceStats.processedFrameCount);
+			if (bench && sourceStats.measuredFrameCount > 0)
+			{
+				auto ToMs = [](Clock::duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+				std::printf(", %.3f ms updating (ticks with a new frame) and %.3f ms rendering per tick (whole scenario)", ToMs(sourceStats.updateTime) / sourceStats.measuredFrameCount, ToMs(sourceStats.renderTime) / sourceStats.measuredTickCount);
+			}
+
+			if (sourceStats.failureCount > 0)
+			{
+				success = false;
+				std::printf(" FAILED\n");
+				for (const std::string& failure : sourceStats.failures)
+					std::printf("    %s\n", failure.c_str());
+
+				if (sourceStats.failureCount > sourceStats.failures.size())
+					std::printf("    (%zu more)\n", sourceStats.failureCount - sourceStats.failures.size());
+			}
+			else
+				std::printf(" ok\n");
+		}
+
+		if (scenario.sharedMaskCost && sharedMaskFrameCount > maxMeasuredFrameCount)
+		{
+			success = false;
+			std::printf("  FAILED: %zu masks produced for %zu frames\n", sharedMaskFrameCount, maxMeasuredFrameCount);
+		}
+
+		for (const std::string& error : errors)
+		{
+			success = false;
+			std::printf("  FAILED: %s\n", error.c_str());
+		}
+
+		if (std::size_t liveObjectCount = HeadlessObs::GetLiveObjectCount(); liveObjectCount > 0)
+		{
+			success = false;
+			std::printf("  FAILED: %zu textures and render targets leaked\n", liveObjectCount);
+		}
+
+		return success;
+	}
+
+	int RunTests(const std::string& executablePath, const std::string& dataFolder, bool bench)
+	{
+		std::size_t separator = executablePath.find_last_of("/\\");
+		std::string moduleFolder = (separator != std::string::npos) ? executablePath.substr(0, separator + 1) : "./";
+
+		if (!obs_startup("en-US", nullptr, nullptr))
+			throw std::runtime_error("failed to start obs-headless");
+
+		std::string modulePath = moduleFolder + "obs-kinect";
+
+		obs_module_t* module;
+		if (int err = obs_open_module(&module, modulePath.c_str(), dataFolder.c_str()); err != MODULE_SUCCESS)
+			throw std::runtime_error("failed to open " + modulePath + " (error " + std::to_string(err) + ")");
+
+		if (!obs_init_module(module))
+			throw std::runtime_error("failed to initialize obs-kinect");
+
+		obs_post_load_modules();
+
+		std::size_t failureCount = 0;
+		std::vector<Scenario> scenarios = BuildScenarios();
+		for (const Scenario& scenario : scenarios)
+		{
+			if (!RunScenario(scenario, bench))
+				failureCount++;
+		}
+
+		obs_shutdown();
+
+		std::printf("%zu/%zu scenarios passed\n", scenarios.size() - failureCount, scenarios.size());
+
+		return (failureCount == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "usage: %s <data folder> [--bench]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		bool bench = false;
+		for (int i = 2; i < argc; ++i)
+		{
+			if (std::strcmp(argv[i], "--bench") == 0)
+				bench = true;
+			else
+				throw std::runtime_error(std::string("unknown option ") + argv[i]);
+		}
+
+		return RunTests(argv[0], argv[1], bench);
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+}
@@ -0,0 +1,140 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "PlaybackDevice.hpp"
+#include <obs-kinect-core/KinectRecording.hpp>
+#include <util/threading.h>
+
+PlaybackDevice::PlaybackDevice(std::shared_ptr<KinectRecording> recording) :
+m_recording(std::move(recording)),
+m_loop(true),
+m_realtime(true)
+{
+	const std::string& filePath = m_recording->GetFilePath();
+	std::size_t separatorPos = filePath.find_last_of("/\\");
+	std::string fileName = (separatorPos != std::string::npos) ? filePath.substr(separatorPos + 1) : filePath;
+
+	SetSupportedSources(m_recording->GetSourceFlags());
+	SetUniqueName("Recording " + fileName + " (" + m_recording->GetDeviceName() + ")");
+
+	auto OrBool = [](bool a, bool b)
+	{
+		return a || b;
+	};
+
+	RegisterBoolParameter("playback_loop", true, OrBool);
+	RegisterBoolParameter("playback_realtime", true, OrBool);
+}
+
+PlaybackDevice::~PlaybackDevice()
+{
+	StopCapture(); //< Ensure thread has joined before releasing the recording
+}
+
+obs_properties_t* PlaybackDevice::CreateProperties() const
+{
+	obs_properties_t* props = obs_properties_create();
+
+	obs_properties_add_bool(props, "playback_loop", Translate("ObsKinectPlayback.Loop"));
+
+	obs_property_t* p = obs_properties_add_bool(props, "playback_realtime", Translate("ObsKinectPlayback.Realtime"));
+	obs_property_set_long_description(p, Translate("ObsKinectPlayback.RealtimeDesc"));
+
+	return props;
+}
+
+void PlaybackDevice::HandleBoolParameterUpdate(const std::string& parameterName, bool value)
+{
+	if (parameterName == "playback_loop")
+		m_loop.store(value);
+	else if (parameterName == "playback_realtime")
+		m_realtime.store(value);
+	else
+		errorlog("unhandled bool parameter %s", parameterName.c_str());
+}
+
+void PlaybackDevice::ThreadFunc()
+{
+	os_set_thread_name("PlaybackDevice");
+
+	NotifyCaptureStarted();
+
+	constexpr std::uint64_t MaxLateness = 1'000'000'000ULL;
+
+	SourceFlags enabledSourceFlags = 0;
+	std::size_t frameCount = m_recording->GetFrameCount();
+	std::size_t frameIndex = 0;
+	std::uint64_t playbackStart = os_gettime_ns();
+
+	while (IsRunning())
+	{
+		if (auto sourceFlagUpdate = GetSourceFlagsUpdate())
+			enabledSourceFlags = sourceFlagUpdate.value();
+
+		if (frameCount == 0 || enabledSourceFlags == 0)
+		{
+			os_sleep_ms(10);
+			continue;
+		}
+
+		if (frameIndex >= frameCount)
+		{
+			if (!m_loop.load())
+			{
+				os_sleep_ms(10);
+				continue;
+			}
+
+			frameIndex = 0;
+			playbackStart = os_gettime_ns();
+		}
+
+		try
+		{
+			std::uint64_t firstTimestamp = m_recording->GetFrameTimestamp(0);
+			std::uint64_t frameTimestamp = m_recording->GetFrameTimestamp(frameIndex);
+			std::uint64_t recordingTime = (frameTimestamp > firstTimestamp) ? frameTimestamp - firstTimestamp : 0;
+
+			std::uint64_t now = os_gettime_ns();
+			std::uint64_t presentationTime = playbackStart + recordingTime;
+			if (!m_realtime.load() || presentationTime + MaxLateness < now)
+			{
+				// Output frames as fast as possible, or rebase the clock when we're way too late (instead of bursting frames)
+				playbackStart = now - recordingTime;
+				presentationTime = now;
+			}
+			else
+				os_sleepto_ns(presentationTime);
+
+			KinectFramePtr framePtr = m_recording->ReadFrame(frameIndex, enabledSourceFlags);
+			framePtr->timestamp = presentationTime;
+
+			UpdateFrame(std::move(framePtr));
+		}
+		catch (const std::exception& e)
+		{
+			errorlog("%s", e.what());
+
+			// Force sleep to prevent log spamming
+			os_sleep_ms(100);
+		}
+
+		frameIndex++;
+	}
+
+	infolog("exiting thread");
+}
@@ -0,0 +1,48 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_PLAYBACKDEVICE
+#define OBS_KINECT_PLUGIN_PLAYBACKDEVICE
+
+#include "PlaybackHelper.hpp"
+#include <obs-kinect-core/KinectDevice.hpp>
+#include <atomic>
+#include <memory>
+
+class KinectRecording;
+
+// Plays a recording back at its original pace, frames are views into the recording mapping
+class PlaybackDevice final : public KinectDevice
+{
+	public:
+		PlaybackDevice(std::shared_ptr<KinectRecording> recording);
+		~PlaybackDevice();
+
+		obs_properties_t* CreateProperties() const override;
+
+	private:
+		void HandleBoolParameterUpdate(const std::string& parameterName, bool value) override;
+		void ThreadFunc() override;
+
+		std::shared_ptr<KinectRecording> m_recording;
+		std::atomic_bool m_loop;
+		std::atomic_bool m_realtime;
+};
+
+#endif
@@ -0,0 +1,31 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_HELPER_PLAYBACK
+#define OBS_KINECT_PLUGIN_HELPER_PLAYBACK
+
+#ifdef OBS_KINECT_PLUGIN_HELPER
+#error "This file must be included before Helper.hpp"
+#endif
+
+#define logprefix "[obs-kinect] [playback] "
+
+#include <obs-kinect-core/Helper.hpp>
+
+#endif
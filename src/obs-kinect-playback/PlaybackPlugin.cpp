@@ -0,0 +1,80 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "PlaybackPlugin.hpp"
+#include "PlaybackDevice.hpp"
+#include <obs-kinect-core/KinectRecorder.hpp>
+#include <obs-kinect-core/KinectRecording.hpp>
+#include <algorithm>
+#include <cstring>
+
+std::string PlaybackPlugin::GetUniqueName() const
+{
+	return "Playback";
+}
+
+std::vector<std::unique_ptr<KinectDevice>> PlaybackPlugin::Refresh() const
+{
+	std::vector<std::unique_ptr<KinectDevice>> devices;
+
+	std::vector<std::string> filePaths;
+	try
+	{
+		std::string directory = KinectRecorder::GetRecordingDirectory();
+
+		os_dir_t* dir = os_opendir(directory.c_str());
+		if (!dir)
+			return devices;
+
+		std::size_t extensionLength = std::strlen(KinectRecordingFormat::FileExtension);
+		while (struct os_dirent* entry = os_readdir(dir))
+		{
+			if (entry->directory)
+				continue;
+
+			std::size_t nameLength = std::strlen(entry->d_name);
+			if (nameLength <= extensionLength || std::strcmp(entry->d_name + nameLength - extensionLength, KinectRecordingFormat::FileExtension) != 0)
+				continue;
+
+			filePaths.push_back(directory + "/" + entry->d_name);
+		}
+
+		os_closedir(dir);
+	}
+	catch (const std::exception& e)
+	{
+		warnlog("failed to list recordings: %s", e.what());
+		return devices;
+	}
+
+	// Keep device order stable between refreshes
+	std::sort(filePaths.begin(), filePaths.end());
+
+	for (const std::string& filePath : filePaths)
+	{
+		try
+		{
+			devices.emplace_back(std::make_unique<PlaybackDevice>(std::make_shared<KinectRecording>(filePath)));
+		}
+		catch (const std::exception& e)
+		{
+			warnlog("failed to open recording %s: %s", filePath.c_str(), e.what());
+		}
+	}
+
+	return devices;
+}
@@ -659,7 +659,7 @@ void KinectSdk10Device::StartElevationThread()
 	m_elevationThread = std::thread(&KinectSdk10Device::ElevationThreadFunc, this);
 }
 
-void KinectSdk10Device::ThreadFunc(std::condition_variable& cv, std::mutex& m, std::exception_ptr& /*exceptionPtr*/)
+void KinectSdk10Device::ThreadFunc()
 {
 	os_set_thread_name("KinectDeviceSdk10");
 
@@ -726,7 +726,16 @@ void KinectSdk10Device::ThreadFunc(std::condition_variable& cv, std::mutex& m, s
 			}
 		}
 
-		if (forceReset || newFrameSourcesTypes != enabledFrameSourceTypes)
+		if (newFrameSourcesTypes == 0)
+		{
+			// Device is kept alive, stop streaming
+			openedSensor.reset();
+
+			colorStream = INVALID_HANDLE_VALUE;
+			depthStream = INVALID_HANDLE_VALUE;
+			irStream = INVALID_HANDLE_VALUE;
+		}
+		else if (forceReset || newFrameSourcesTypes != enabledFrameSourceTypes)
 		{
 			openedSensor.reset(); //< Close sensor first (Kinectv1 doesn't support multiple NuiInitialize)
 
@@ -819,10 +828,7 @@ void KinectSdk10Device::ThreadFunc(std::condition_variable& cv, std::mutex& m, s
 		infolog("Kinect active sources: %s", EnabledSourceToString(enabledSourceFlags).c_str());
 	};
 
-	{
-		std::unique_lock<std::mutex> lk(m);
-		cv.notify_all();
-	} // m & cv no longer exists from here
+	NotifyCaptureStarted();
 
 	constexpr std::uint64_t KinectMaxFramerate = 30;
 
@@ -42,7 +42,7 @@ class KinectSdk10Device final : public KinectDevice
 		void HandleIntParameterUpdate(const std::string& parameterName, long long value) override;
 		void RegisterParameters();
 		void StartElevationThread();
-		void ThreadFunc(std::condition_variable& cv, std::mutex& m, std::exception_ptr& exceptionPtr) override;
+		void ThreadFunc() override;
 
 		DepthMappingFrameData BuildDepthMappingFrame(INuiSensor* sensor, const ColorFrameData& colorFrame, const DepthFrameData& depthFrame, std::vector<std::uint8_t>& tempMemory);
 
@@ -54,78 +54,9 @@ KinectSdk20Device::KinectSdk20Device()
 	});
 
 #if HAS_NUISENSOR_LIB
+	// The NuiSensor handle is only initialized when the device gets opened (see OpenDevice)
 	std::array<NUISENSOR_DEVICE_INFO, 16> devices;
-	ULONG deviceFound = NuiSensor_FindAllDevices(devices.data(), ULONG(devices.size()));
-	if (deviceFound > 0)
-	{
-		auto DeviceToString = [](const NUISENSOR_DEVICE_INFO& deviceInfo) -> std::string
-		{
-			std::array<char, MAX_PATH * 4> devicePath;
-			std::size_t length = os_wcs_to_utf8(deviceInfo.DevicePath, 0, devicePath.data(), devicePath.size());
-			if (length == 0)
-				return "<Error>";
-
-			return std::string(devicePath.data(), length);
-		};
-
-		if (deviceFound > 1)
-		{
-			if (!m_openedKinectSensor)
-			{
-				if (FAILED(m_kinectSensor->Open()))
-					throw std::runtime_error("failed to open Kinect sensor");
-
-				m_openedKinectSensor.reset(m_kinectSensor.get());
-			}
-
-			// Multiple Kinect v2 found, find the right one by using the serial number
-			std::array<wchar_t, 256> wideId = { L"<failed to get id>" };
-			HRESULT serialResult = m_openedKinectSensor->get_UniqueKinectId(UINT(wideId.size()), wideId.data());
-			if (SUCCEEDED(serialResult))
-			{
-				std::size_t serialLength = std::wcslen(wideId.data());
-				for (ULONG i = 0; i < deviceFound; ++i)
-				{
-					NUISENSOR_HANDLE deviceHandle;
-					if (!NuiSensor_InitializeEx(&deviceHandle, devices[i].DevicePath))
-					{
-						errorlog("failed to initialize device #%u %s", i, DeviceToString(devices[i]).c_str());
-						continue;
-					}
-
-					m_nuiHandle.reset(deviceHandle);
-
-					NUISENSOR_SERIAL_NUMBER serial;
-					if (!NuiSensor_GetSerialNumber(deviceHandle, &serial))
-					{
-						errorlog("failed to retrieve serial number of device #%u (%s)", i, DeviceToString(devices[i]).c_str());
-						continue;
-					}
-
-					// Even though NUISENSOR_SERIAL_NUMBER returns an array of byte, it seems to be an array of wchar_t that can be compared using memcmp
-					if (std::memcmp(serial.Data, wideId.data(), std::min(sizeof(serial.Data) / sizeof(BYTE), serialLength * sizeof(wchar_t))) == 0)
-					{
-						// Found it!
-						break;
-					}
-
-					m_nuiHandle.reset();
-				}
-			}
-			else
-				errorlog("failed to retrieve Kinect serial");
-		}
-		else
-		{
-			NUISENSOR_HANDLE deviceHandle;
-			if (NuiSensor_InitializeEx(&deviceHandle, devices[0].DevicePath))
-				m_nuiHandle.reset(deviceHandle);
-			else
-				errorlog("failed to initialize device #0 %s", DeviceToString(devices[0]).c_str());
-		}
-	}
-
-	if (m_nuiHandle)
+	if (NuiSensor_FindAllDevices(devices.data(), ULONG(devices.size())) > 0)
 	{
 		auto MaxDouble = [](double a, double b)
 		{
@@ -153,7 +84,7 @@ KinectSdk20Device::KinectSdk20Device()
 		RegisterIntParameter("sdk20_led_privacy_intensity", 100, MaxInt);
 	}
 	else
-		warnlog("failed to open a NuiSensor handle to the Kinect, some functionnality (such as exposure mode control) will be disabled");
+		warnlog("failed to find the Kinect using NuiSensor, some functionnality (such as exposure mode control) will be disabled");
 #else
 	warnlog("obs-kinect-sdk20 backend has been built without NuiSensorLib support, some functionnality (such as exposure mode control) will be disabled");
 #endif
@@ -161,21 +92,12 @@ KinectSdk20Device::KinectSdk20Device()
 
 KinectSdk20Device::~KinectSdk20Device()
 {
+	StopCapture(); //< Ensure idle release has been cancelled before closing the device
+
 	// Reset service priority on exit
 	SetServicePriority(ProcessPriority::Normal);
 
-#if HAS_NUISENSOR_LIB
-	// Reset exposure and white mode to automatic
-	if (m_nuiHandle)
-	{
-		NuiSensorColorCameraSettings cameraSettings;
-		cameraSettings.AddCommand(NUISENSOR_RGB_COMMAND_SET_EXPOSURE_MODE, 0); //< 0 = fully auto
-		cameraSettings.AddCommand(NUISENSOR_RGB_COMMAND_SET_WHITE_BALANCE_MODE, 1); //< 1 = auto
-
-		if (!cameraSettings.Execute(m_nuiHandle.get()))
-			warnlog("failed to reset camera color settings");
-	}
-#endif
+	CloseDevice();
 }
 
 obs_properties_t* KinectSdk20Device::CreateProperties() const
@@ -243,6 +165,15 @@ obs_properties_t* KinectSdk20Device::CreateProperties() const
 
 	obs_properties_add_button2(props, "sdk20_dump", Translate("ObsKinect.DumpCameraSettings"), [](obs_properties_t* /*props*/, obs_property_t* /*property*/, void* data)
 	{
+		const KinectSdk20Device* device = static_cast<const KinectSdk20Device*>(data);
+
+		std::lock_guard<std::mutex> lock(device->m_nuiHandleLock);
+		if (!device->m_nuiHandle)
+		{
+			warnlog("device is not opened, it has to be used by a source to dump its settings");
+			return false;
+		}
+
 		struct CameraSetting
 		{
 			const char* str;
@@ -268,7 +199,7 @@ obs_properties_t* KinectSdk20Device::CreateProperties() const
 		for (const CameraSetting& setting : settings)
 			cameraSettings.AddCommand(setting.command);
 
-		if (cameraSettings.Execute(static_cast<NUISENSOR_HANDLE>(data)))
+		if (cameraSettings.Execute(device->m_nuiHandle.get()))
 		{
 			std::ostringstream ss;
 			ss << "Color settings dump:\n";
@@ -297,7 +228,7 @@ obs_properties_t* KinectSdk20Device::CreateProperties() const
 			errorlog("failed to retrieve camera settings");
 
 		return true;
-	}, m_nuiHandle.get());
+	}, const_cast<KinectSdk20Device*>(this));
 #endif
 
 	return props;
@@ -645,9 +576,32 @@ auto KinectSdk20Device::RetrieveInfraredFrame(IMultiSourceFrame* multiSourceFram
 	return frameData;
 }
 
+void KinectSdk20Device::CloseDevice()
+{
+#if HAS_NUISENSOR_LIB
+	std::lock_guard<std::mutex> lock(m_nuiHandleLock);
+
+	// Reset exposure and white mode to automatic
+	if (m_nuiHandle)
+	{
+		NuiSensorColorCameraSettings cameraSettings;
+		cameraSettings.AddCommand(NUISENSOR_RGB_COMMAND_SET_EXPOSURE_MODE, 0); //< 0 = fully auto
+		cameraSettings.AddCommand(NUISENSOR_RGB_COMMAND_SET_WHITE_BALANCE_MODE, 1); //< 1 = auto
+
+		if (!cameraSettings.Execute(m_nuiHandle.get()))
+			warnlog("failed to reset camera color settings");
+
+		m_nuiHandle.reset();
+	}
+#endif
+}
+
 void KinectSdk20Device::HandleDoubleParameterUpdate(const std::string& parameterName, double value)
 {
 #if HAS_NUISENSOR_LIB
+	if (!m_nuiHandle)
+		return;
+
 	NuiSensorColorCameraSettings cameraSettings;
 
 	float fValue = float(value);
@@ -690,6 +644,8 @@ void KinectSdk20Device::HandleIntParameterUpdate(const std::string& parameterNam
 	if (parameterName == "sdk20_service_priority")
 		SetServicePriority(static_cast<ProcessPriority>(value));
 #if HAS_NUISENSOR_LIB
+	else if (!m_nuiHandle)
+		return; //< handle failed to initialize when opening the device
 	else if (parameterName == "sdk20_exposure_mode")
 	{
 		ExposureControl exposureMode = static_cast<ExposureControl>(value);
@@ -794,7 +750,91 @@ void KinectSdk20Device::HandleIntParameterUpdate(const std::string& parameterNam
 		errorlog("unhandled parameter %s", parameterName.c_str());
 }
 
-void KinectSdk20Device::ThreadFunc(std::condition_variable& cv, std::mutex& m, std::exception_ptr& error)
+void KinectSdk20Device::OpenDevice()
+{
+#if HAS_NUISENSOR_LIB
+	std::array<NUISENSOR_DEVICE_INFO, 16> devices;
+	ULONG deviceFound = NuiSensor_FindAllDevices(devices.data(), ULONG(devices.size()));
+	if (deviceFound == 0)
+		return;
+
+	NuiSensorHandle nuiHandle;
+
+	auto DeviceToString = [](const NUISENSOR_DEVICE_INFO& deviceInfo) -> std::string
+	{
+		std::array<char, MAX_PATH * 4> devicePath;
+		std::size_t length = os_wcs_to_utf8(deviceInfo.DevicePath, 0, devicePath.data(), devicePath.size());
+		if (length == 0)
+			return "<Error>";
+
+		return std::string(devicePath.data(), length);
+	};
+
+	if (deviceFound > 1)
+	{
+		if (!m_openedKinectSensor)
+		{
+			if (FAILED(m_kinectSensor->Open()))
+				throw std::runtime_error("failed to open Kinect sensor");
+
+			m_openedKinectSensor.reset(m_kinectSensor.get());
+		}
+
+		// Multiple Kinect v2 found, find the right one by using the serial number
+		std::array<wchar_t, 256> wideId = { L"<failed to get id>" };
+		HRESULT serialResult = m_openedKinectSensor->get_UniqueKinectId(UINT(wideId.size()), wideId.data());
+		if (SUCCEEDED(serialResult))
+		{
+			std::size_t serialLength = std::wcslen(wideId.data());
+			for (ULONG i = 0; i < deviceFound; ++i)
+			{
+				NUISENSOR_HANDLE deviceHandle;
+				if (!NuiSensor_InitializeEx(&deviceHandle, devices[i].DevicePath))
+				{
+					errorlog("failed to initialize device #%u %s", i, DeviceToString(devices[i]).c_str());
+					continue;
+				}
+
+				nuiHandle.reset(deviceHandle);
+
+				NUISENSOR_SERIAL_NUMBER serial;
+				if (!NuiSensor_GetSerialNumber(deviceHandle, &serial))
+				{
+					errorlog("failed to retrieve serial number of device #%u (%s)", i, DeviceToString(devices[i]).c_str());
+					continue;
+				}
+
+				// Even though NUISENSOR_SERIAL_NUMBER returns an array of byte, it seems to be an array of wchar_t that can be compared using memcmp
+				if (std::memcmp(serial.Data, wideId.data(), std::min(sizeof(serial.Data) / sizeof(BYTE), serialLength * sizeof(wchar_t))) == 0)
+				{
+					// Found it!
+					break;
+				}
+
+				nuiHandle.reset();
+			}
+		}
+		else
+			errorlog("failed to retrieve Kinect serial");
+	}
+	else
+	{
+		NUISENSOR_HANDLE deviceHandle;
+		if (NuiSensor_InitializeEx(&deviceHandle, devices[0].DevicePath))
+			nuiHandle.reset(deviceHandle);
+		else
+			errorlog("failed to initialize device #0 %s", DeviceToString(devices[0]).c_str());
+	}
+
+	if (!nuiHandle)
+		warnlog("failed to open a NuiSensor handle to the Kinect, some functionnality (such as exposure mode control) will be disabled");
+
+	std::lock_guard<std::mutex> lock(m_nuiHandleLock);
+	m_nuiHandle = std::move(nuiHandle);
+#endif
+}
+
+void KinectSdk20Device::ThreadFunc()
 {
 	os_set_thread_name("KinectDeviceSdk20");
 
@@ -818,7 +858,9 @@ void KinectSdk20Device::ThreadFunc(std::condition_variable& cv, std::mutex& m, s
 		if (enabledSources & Source_Infrared)
 			newFrameSourcesTypes |= FrameSourceTypes_Infrared;
 
-		if (!multiSourceFrameReader || newFrameSourcesTypes != enabledFrameSourceTypes)
+		if (newFrameSourcesTypes == 0)
+			multiSourceFrameReader.reset(); //< device is kept alive, stop streaming
+		else if (!multiSourceFrameReader || newFrameSourcesTypes != enabledFrameSourceTypes)
 		{
 			IMultiSourceFrameReader* pMultiSourceFrameReader;
 			if (FAILED(m_openedKinectSensor->OpenMultiSourceFrameReader(newFrameSourcesTypes, &pMultiSourceFrameReader)))
@@ -833,41 +875,28 @@ void KinectSdk20Device::ThreadFunc(std::condition_variable& cv, std::mutex& m, s
 		infolog("Kinect active sources: %s", EnabledSourceToString(enabledSourceFlags).c_str());
 	};
 
-	try
+	if (!m_openedKinectSensor)
 	{
-		if (!m_openedKinectSensor)
-		{
-			if (FAILED(m_kinectSensor->Open()))
-				throw std::runtime_error("failed to open Kinect sensor");
+		if (FAILED(m_kinectSensor->Open()))
+			throw std::runtime_error("failed to open Kinect sensor");
 
-			m_openedKinectSensor.reset(m_kinectSensor.get());
-		}
-
-		std::array<wchar_t, 256> wideId = { L"<failed to get id>" };
-		m_openedKinectSensor->get_UniqueKinectId(UINT(wideId.size()), wideId.data());
+		m_openedKinectSensor.reset(m_kinectSensor.get());
+	}
 
-		std::array<char, wideId.size()> id;
+	std::array<wchar_t, 256> wideId = { L"<failed to get id>" };
+	m_openedKinectSensor->get_UniqueKinectId(UINT(wideId.size()), wideId.data());
 
-		const char* sensorId;
-		if (os_wcs_to_utf8(wideId.data(), 0, id.data(), id.size()) > 0)
-			sensorId = id.data();
-		else
-			sensorId = "<failed to get id>";
+	std::array<char, wideId.size()> id;
 
-		infolog("found kinect sensor (serial: %s)", sensorId);
-	}
-	catch (const std::exception&)
-	{
-		error = std::current_exception();
-	}
+	const char* sensorId;
+	if (os_wcs_to_utf8(wideId.data(), 0, id.data(), id.size()) > 0)
+		sensorId = id.data();
+	else
+		sensorId = "<failed to get id>";
 
-	{
-		std::unique_lock<std::mutex> lk(m);
-		cv.notify_all();
-	} // m & cv no longer exists from here
+	infolog("found kinect sensor (serial: %s)", sensorId);
 
-	if (error)
-		return;
+	NotifyCaptureStarted();
 
 	constexpr std::uint64_t MaxKinectFPS = 30;
 
@@ -914,9 +943,18 @@ void KinectSdk20Device::ThreadFunc(std::condition_variable& cv, std::mutex& m, s
 
 		ReleasePtr<IMultiSourceFrame> multiSourceFrame(pMultiSourceFrame);
 
+		// Kinect frames relative time doesn't use the os_gettime_ns clock, use the acquisition time as capture time
+		std::uint64_t timestamp = os_gettime_ns();
+
+		// No access will process this frame, skip retrieving and mapping it
+		if (!IsFrameNeeded(timestamp))
+			continue;
+
 		try
 		{
 			KinectFramePtr framePtr = std::make_shared<KinectFrame>();
+			framePtr->timestamp = timestamp;
+
 			if (enabledSourceFlags & Source_Body)
 				framePtr->bodyIndexFrame = RetrieveBodyIndexFrame(multiSourceFrame.get());
 
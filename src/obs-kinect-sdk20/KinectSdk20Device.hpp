@@ -39,9 +39,11 @@ class KinectSdk20Device final : public KinectDevice
 		static void SetServicePriority(ProcessPriority priority);
 
 	private:
+		void CloseDevice() override;
 		void HandleDoubleParameterUpdate(const std::string& parameterName, double value) override;
 		void HandleIntParameterUpdate(const std::string& parameterName, long long value) override;
-		void ThreadFunc(std::condition_variable& cv, std::mutex& m, std::exception_ptr& exceptionPtr) override;
+		void OpenDevice() override;
+		void ThreadFunc() override;
 
 		static BodyIndexFrameData RetrieveBodyIndexFrame(IMultiSourceFrame* multiSourceFrame);
 		static ColorFrameData RetrieveColorFrame(IMultiSourceFrame* multiSourceFrame);
@@ -54,7 +56,8 @@ class KinectSdk20Device final : public KinectDevice
 		ClosePtr<IKinectSensor> m_openedKinectSensor;
 
 #if HAS_NUISENSOR_LIB
-		NuiSensorHandle m_nuiHandle;
+		NuiSensorHandle m_nuiHandle; //< only initialized while the device is used (see OpenDevice)
+		mutable std::mutex m_nuiHandleLock; //< protects m_nuiHandle opening/closing against properties
 #endif
 
 		static ProcessPriority s_servicePriority;
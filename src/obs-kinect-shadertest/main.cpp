@@ -0,0 +1,717 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect-core/WorkerPool.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareGaussianBlur.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareGreenScreenFilter.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareTextureLerp.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareVisibilityMask.hpp>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Checks software shaders against golden images or GPU captures and measures them, all on synthetic depth/body/color frames
+// Usage: obs-kinect-shadertest <golden folder> [--update] [--tolerance <max difference>]
+//        obs-kinect-shadertest --gpu <capture folder> [--tolerance <max difference>]
+//        obs-kinect-shadertest --export-inputs <folder>
+//        obs-kinect-shadertest --bench [iteration count] [thread count]
+// Golden images are binary PGM (single channel) and PAM (RGBA) files written by --update from the software shaders output:
+// they catch regressions of the software shaders but don't prove they match the GPU effects (see golden/README.md).
+// Compilers contracting float operations (FMA) may round a few values differently, --tolerance 1 accepts them.
+// --gpu compares with outputs of the .effect files rendered on inputs written by --export-inputs, stages without capture are skipped.
+// GPU bilinear weights precision is implementation-defined, tolerance defaults to 1 in this mode.
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct Image
+	{
+		gs_color_format format = GS_UNKNOWN;
+		std::uint32_t width = 0;
+		std::uint32_t height = 0;
+		std::uint32_t pitch = 0;
+		std::vector<std::uint8_t> pixels;
+
+		SoftwareTexture GetTexture() const
+		{
+			SoftwareTexture texture;
+			texture.ptr = pixels.data();
+			texture.format = format;
+			texture.width = width;
+			texture.height = height;
+			texture.pitch = pitch;
+
+			return texture;
+		}
+	};
+
+	std::uint32_t GetBytesPerPixel(gs_color_format format)
+	{
+		switch (format)
+		{
+			case GS_R8:    return 1;
+			case GS_R16:   return 2;
+			case GS_RG32F: return 8;
+			case GS_RGBA:
+			case GS_BGRA:  return 4;
+
+			default:
+				throw std::runtime_error("unsupported image format");
+		}
+	}
+
+	template<typename F>
+	Image BuildImage(gs_color_format format, std::uint32_t width, std::uint32_t height, F&& func)
+	{
+		Image image;
+		image.format = format;
+		image.width = width;
+		image.height = height;
+		image.pitch = width * GetBytesPerPixel(format);
+		image.pixels.resize(std::size_t(image.pitch) * height);
+
+		for (std::uint32_t y = 0; y < height; ++y)
+		{
+			std::uint8_t* row = &image.pixels[y * image.pitch];
+			for (std::uint32_t x = 0; x < width; ++x)
+				func(x, y, &row[x * GetBytesPerPixel(format)]);
+		}
+
+		return image;
+	}
+
+	Image CopyTexture(const SoftwareTexture& texture)
+	{
+		Image image;
+		image.format = texture.format;
+		image.width = texture.width;
+		image.height = texture.height;
+		image.pitch = texture.width * GetBytesPerPixel(texture.format);
+		image.pixels.resize(std::size_t(image.pitch) * texture.height);
+
+		for (std::uint32_t y = 0; y < texture.height; ++y)
+			std::memcpy(&image.pixels[y * image.pitch], &texture.ptr[y * texture.pitch], image.pitch);
+
+		return image;
+	}
+
+	// Scene seen by a depth camera: a background wall, a player and a few invalid depth pixels
+	// Inputs only use integer math and basic float operations, so they are the same with every compiler
+	struct SyntheticInputs
+	{
+		Image background;
+		Image backgroundSmall;
+		Image bodyIndex;
+		Image colorBGRA;
+		Image colorRGBA;
+		Image colorToDepth;
+		Image depth;
+		Image visibilityMask;
+	};
+
+	bool IsInEllipse(std::int64_t x, std::int64_t y, std::int64_t centerX, std::int64_t centerY, std::int64_t radiusX, std::int64_t radiusY)
+	{
+		std::int64_t dx = x - centerX;
+		std::int64_t dy = y - centerY;
+
+		return dx * dx * radiusY * radiusY + dy * dy * radiusX * radiusX <= radiusX * radiusX * radiusY * radiusY;
+	}
+
+	SyntheticInputs BuildSyntheticInputs(std::uint32_t depthWidth, std::uint32_t depthHeight, std::uint32_t colorWidth, std::uint32_t colorHeight)
+	{
+		SyntheticInputs inputs;
+
+		inputs.depth = BuildImage(GS_R16, depthWidth, depthHeight, [&](std::uint32_t x, std::uint32_t y, std::uint8_t* pixel)
+		{
+			std::uint16_t depth;
+			if ((x * 7 + y * 13) % 29 == 0)
+				depth = 0;
+			else if (IsInEllipse(x, y, depthWidth / 2, depthHeight * 11 / 20, depthWidth / 5, depthHeight * 7 / 20))
+				depth = static_cast<std::uint16_t>(950 + y * 100 / depthHeight); //< player, within the default depth range
+			else if (IsInEllipse(x, y, depthWidth / 5, depthHeight / 3, depthWidth / 12, depthHeight / 10))
+				depth = 1180; //< object at the edge of the fade distance
+			else
+				depth = static_cast<std::uint16_t>(2500 + x * 400 / depthWidth); //< wall
+
+			std::memcpy(pixel, &depth, sizeof(depth));
+		});
+
+		// Body is slightly larger than the player depth silhouette, so body and depth techniques differ
+		inputs.bodyIndex = BuildImage(GS_R8, depthWidth, depthHeight, [&](std::uint32_t x, std::uint32_t y, std::uint8_t* pixel)
+		{
+			*pixel = (IsInEllipse(x, y, depthWidth / 2, depthHeight * 11 / 20, depthWidth * 9 / 40, depthHeight * 3 / 8)) ? 0 : 255;
+		});
+
+		auto ColorPattern = [&](std::uint32_t x, std::uint32_t y, std::uint8_t* rgba)
+		{
+			rgba[0] = static_cast<std::uint8_t>(x * 255 / (colorWidth - 1));
+			rgba[1] = static_cast<std::uint8_t>(y * 255 / (colorHeight - 1));
+			rgba[2] = (((x / 8) + (y / 8)) & 1) ? 200 : 40;
+			rgba[3] = 255;
+		};
+
+		inputs.colorRGBA = BuildImage(GS_RGBA, colorWidth, colorHeight, ColorPattern);
+		inputs.colorBGRA = BuildImage(GS_BGRA, colorWidth, colorHeight, [&](std::uint32_t x, std::uint32_t y, std::uint8_t* pixel)
+		{
+			std::uint8_t rgba[4];
+			ColorPattern(x, y, rgba);
+
+			pixel[0] = rgba[2];
+			pixel[1] = rgba[1];
+			pixel[2] = rgba[0];
+			pixel[3] = rgba[3];
+		});
+
+		// Color camera sees a bit more than the depth camera, pixels outside of the depth view are invalid (-inf, as the SDKs do)
+		inputs.colorToDepth = BuildImage(GS_RG32F, colorWidth, colorHeight, [&](std::uint32_t x, std::uint32_t y, std::uint8_t* pixel)
+		{
+			float coords[2];
+			if (x < colorWidth / 16 || x >= colorWidth - colorWidth / 16)
+			{
+				coords[0] = -std::numeric_limits<float>::infinity();
+				coords[1] = -std::numeric_limits<float>::infinity();
+			}
+			else
+			{
+				coords[0] = float(x - colorWidth / 16) * depthWidth / float(colorWidth - colorWidth / 8) + 0.25f;
+				coords[1] = float(y) * depthHeight / float(colorHeight) + 0.5f;
+			}
+
+			std::memcpy(pixel, coords, sizeof(coords));
+		});
+
+		auto BackgroundPattern = [](std::uint32_t x, std::uint32_t y, std::uint8_t* rgba)
+		{
+			rgba[0] = 30;
+			rgba[1] = static_cast<std::uint8_t>(120 + (x % 16) * 8);
+			rgba[2] = static_cast<std::uint8_t>(200 - (y % 50) * 2);
+			rgba[3] = 255;
+		};
+
+		inputs.background = BuildImage(GS_RGBA, colorWidth, colorHeight, BackgroundPattern);
+		inputs.backgroundSmall = BuildImage(GS_RGBA, colorWidth / 2, colorHeight / 2, BackgroundPattern);
+
+		// Visibility mask image: left third hidden, a forced visible rectangle and a half-transparent hiding area
+		std::uint32_t maskWidth = colorWidth / 2;
+		std::uint32_t maskHeight = colorHeight / 2;
+		inputs.visibilityMask = BuildImage(GS_RGBA, maskWidth, maskHeight, [&](std::uint32_t x, std::uint32_t y, std::uint8_t* rgba)
+		{
+			if (x < maskWidth / 3)
+			{
+				rgba[0] = 0;
+				rgba[3] = 255;
+			}
+			else if (x > maskWidth * 3 / 4 && y < maskHeight / 2)
+			{
+				rgba[0] = 255;
+				rgba[3] = 255;
+			}
+			else if (y > maskHeight * 3 / 4)
+			{
+				rgba[0] = 0;
+				rgba[3] = 128;
+			}
+			else
+			{
+				rgba[0] = 0;
+				rgba[3] = 0;
+			}
+
+			rgba[1] = 0;
+			rgba[2] = 0;
+		});
+
+		return inputs;
+	}
+
+	struct Stage
+	{
+		std::string name;
+		std::function<SoftwareTexture()> func;
+	};
+
+	// Runs every technique on the synthetic inputs, like KinectSource chains them
+	// Each shader instance owns its output memory, so outputs used by later stages come from dedicated instances
+	class ShaderPipeline
+	{
+		public:
+			ShaderPipeline(const SyntheticInputs& inputs, WorkerPool* workerPool) :
+			m_inputs(inputs),
+			m_colorBlur(GS_RGBA, workerPool),
+			m_maskBlur(GS_R8, workerPool),
+			m_filter(workerPool),
+			m_depthDirectFilter(workerPool),
+			m_depthMappedFilter(workerPool),
+			m_lerp(GS_RGBA, workerPool),
+			m_scaledLerp(GS_RGBA, workerPool),
+			m_visibilityMask(workerPool)
+			{
+				m_background = m_inputs.background.GetTexture();
+				m_backgroundSmall = m_inputs.backgroundSmall.GetTexture();
+				m_bodyIndex = m_inputs.bodyIndex.GetTexture();
+				m_colorBGRA = m_inputs.colorBGRA.GetTexture();
+				m_colorRGBA = m_inputs.colorRGBA.GetTexture();
+				m_colorToDepth = m_inputs.colorToDepth.GetTexture();
+				m_depth = m_inputs.depth.GetTexture();
+				m_visibilityImage = m_inputs.visibilityMask.GetTexture();
+
+				BuildStages();
+			}
+
+			const std::vector<Stage>& GetStages() const
+			{
+				return m_stages;
+			}
+
+		private:
+			template<typename Params>
+			Params BuildParams(bool depthCorrection)
+			{
+				Params params;
+				params.colorToDepthTexture = (depthCorrection) ? &m_colorToDepth : nullptr;
+
+				if constexpr (!std::is_same_v<Params, SoftwareGreenScreenFilter::DepthFilterParams>)
+					params.bodyIndexTexture = &m_bodyIndex;
+
+				if constexpr (!std::is_same_v<Params, SoftwareGreenScreenFilter::BodyFilterParams>)
+				{
+					params.depthTexture = &m_depth;
+					params.progressiveDepth = 100.f;
+					params.maxDepth = 1200.f;
+					params.minDepth = 1.f;
+				}
+
+				return params;
+			}
+
+			// With depth correction the mask is in color space, without it's in depth space
+			template<typename Params>
+			void AddFilterStage(const char* name, SoftwareGreenScreenFilter& filter, bool depthCorrection, SoftwareTexture* output = nullptr)
+			{
+				m_stages.push_back({ name, [this, &filter, depthCorrection, output]
+				{
+					const SoftwareTexture& target = (depthCorrection) ? m_colorRGBA : m_depth;
+
+					SoftwareTexture mask = filter.Filter(target.width, target.height, BuildParams<Params>(depthCorrection));
+					if (output)
+						*output = mask;
+
+					return mask;
+				}});
+			}
+
+			void BuildStages()
+			{
+				using BodyParams = SoftwareGreenScreenFilter::BodyFilterParams;
+				using BodyOrDepthParams = SoftwareGreenScreenFilter::BodyOrDepthFilterParams;
+				using BodyWithinDepthParams = SoftwareGreenScreenFilter::BodyWithinDepthFilterParams;
+				using DepthParams = SoftwareGreenScreenFilter::DepthFilterParams;
+
+				AddFilterStage<BodyParams>("greenscreen_body_mapped", m_filter, true);
+				AddFilterStage<BodyParams>("greenscreen_body_direct", m_filter, false);
+				AddFilterStage<BodyOrDepthParams>("greenscreen_bodyordepth_mapped", m_filter, true);
+				AddFilterStage<BodyOrDepthParams>("greenscreen_bodyordepth_direct", m_filter, false);
+				AddFilterStage<BodyWithinDepthParams>("greenscreen_bodywithindepth_mapped", m_filter, true);
+				AddFilterStage<BodyWithinDepthParams>("greenscreen_bodywithindepth_direct", m_filter, false);
+				AddFilterStage<DepthParams>("greenscreen_depth_mapped", m_depthMappedFilter, true, &m_depthMappedMask);
+				AddFilterStage<DepthParams>("greenscreen_depth_direct", m_depthDirectFilter, false, &m_depthDirectMask);
+
+				m_stages.push_back({ "blur_mask", [this] { return m_blurredMask = m_maskBlur.Blur(m_depthMappedMask, 3); } });
+				m_stages.push_back({ "blur_color", [this] { return m_colorBlur.Blur(m_colorBGRA, 2); } });
+				m_stages.push_back({ "visibility_mask", [this] { return m_visibleMask = m_visibilityMask.Mask(m_blurredMask, m_visibilityImage); } });
+				m_stages.push_back({ "lerp", [this] { return m_lerp.Lerp(m_background, m_colorRGBA, m_visibleMask); } });
+				m_stages.push_back({ "lerp_scaled", [this] { return m_scaledLerp.Lerp(m_backgroundSmall, m_colorRGBA, m_depthDirectMask); } });
+			}
+
+			const SyntheticInputs& m_inputs;
+			std::vector<Stage> m_stages;
+			SoftwareGaussianBlur m_colorBlur;
+			SoftwareGaussianBlur m_maskBlur;
+			SoftwareGreenScreenFilter m_filter;
+			SoftwareGreenScreenFilter m_depthDirectFilter;
+			SoftwareGreenScreenFilter m_depthMappedFilter;
+			SoftwareTexture m_background;
+			SoftwareTexture m_backgroundSmall;
+			SoftwareTexture m_blurredMask;
+			SoftwareTexture m_bodyIndex;
+			SoftwareTexture m_colorBGRA;
+			SoftwareTexture m_colorRGBA;
+			SoftwareTexture m_colorToDepth;
+			SoftwareTexture m_depth;
+			SoftwareTexture m_depthDirectMask;
+			SoftwareTexture m_depthMappedMask;
+			SoftwareTexture m_visibilityImage;
+			SoftwareTexture m_visibleMask;
+			SoftwareTextureLerp m_lerp;
+			SoftwareTextureLerp m_scaledLerp;
+			SoftwareVisibilityMask m_visibilityMask;
+	};
+
+	std::string GetGoldenPath(const std::string& folder, const std::string& stageName, gs_color_format format)
+	{
+		switch (format)
+		{
+			case GS_R8:
+			case GS_R16:   return folder + "/" + stageName + ".pgm";
+			case GS_RG32F: return folder + "/" + stageName + ".pfm";
+			default:       return folder + "/" + stageName + ".pam";
+		}
+	}
+
+	void WriteImage(const std::string& filePath, const Image& image)
+	{
+		std::string header;
+		std::vector<std::uint8_t> pixels;
+		if (image.format == GS_R8)
+			header = "P5\n" + std::to_string(image.width) + " " + std::to_string(image.height) + "\n255\n";
+		else if (image.format == GS_RGBA)
+			header = "P7\nWIDTH " + std::to_string(image.width) + "\nHEIGHT " + std::to_string(image.height) + "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+		else if (image.format == GS_R16)
+		{
+			// Only used for exported inputs, 16 bits PGM values are big-endian
+			header = "P5\n" + std::to_string(image.width) + " " + std::to_string(image.height) + "\n65535\n";
+			pixels.resize(image.pixels.size());
+			for (std::size_t i = 0; i < pixels.size(); i += 2)
+			{
+				std::uint16_t value;
+				std::memcpy(&value, &image.pixels[i], sizeof(value));
+
+				pixels[i] = static_cast<std::uint8_t>(value >> 8);
+				pixels[i + 1] = static_cast<std::uint8_t>(value & 0xFF);
+			}
+		}
+		else if (image.format == GS_RG32F)
+		{
+			// Only used for exported inputs, PFM has three channels (blue is zero), rows go from bottom to top and a negative scale means little-endian floats
+			header = "PF\n" + std::to_string(image.width) + " " + std::to_string(image.height) + "\n-1.0\n";
+			pixels.resize(std::size_t(image.width) * image.height * 3 * sizeof(float));
+			for (std::uint32_t y = 0; y < image.height; ++y)
+			{
+				const std::uint8_t* inputRow = &image.pixels[(image.height - 1 - y) * image.pitch];
+				std::uint8_t* outputRow = &pixels[std::size_t(y) * image.width * 3 * sizeof(float)];
+				for (std::uint32_t x = 0; x < image.width; ++x)
+				{
+					float rgb[3] = { 0.f, 0.f, 0.f };
+					std::memcpy(rgb, &inputRow[x * 2 * sizeof(float)], 2 * sizeof(float));
+					std::memcpy(&outputRow[x * sizeof(rgb)], rgb, sizeof(rgb));
+				}
+			}
+		}
+		else
+			throw std::runtime_error("unsupported golden image format");
+
+		const std::vector<std::uint8_t>& content = (pixels.empty()) ? image.pixels : pixels;
+
+		std::unique_ptr<FILE, decltype(&std::fclose)> file(std::fopen(filePath.c_str(), "wb"), &std::fclose);
+		if (!file)
+			throw std::runtime_error("failed to open " + filePath + " for writing");
+
+		if (std::fwrite(header.data(), 1, header.size(), file.get()) != header.size() || std::fwrite(content.data(), 1, content.size(), file.get()) != content.size())
+			throw std::runtime_error("failed to write " + filePath);
+	}
+
+	// Reads files written by WriteImage (header fields are whitespace-separated tokens)
+	std::optional<Image> ReadImage(const std::string& filePath)
+	{
+		std::unique_ptr<FILE, decltype(&std::fclose)> file(std::fopen(filePath.c_str(), "rb"), &std::fclose);
+		if (!file)
+			return std::nullopt;
+
+		auto ReadToken = [&]
+		{
+			std::string token;
+			int c;
+			while ((c = std::fgetc(file.get())) != EOF && std::isspace(c));
+
+			for (; c != EOF && !std::isspace(c); c = std::fgetc(file.get()))
+				token.push_back(static_cast<char>(c));
+
+			return token;
+		};
+
+		Image image;
+
+		std::string magic = ReadToken();
+		if (magic == "P5")
+		{
+			image.format = GS_R8;
+			image.width = std::stoul(ReadToken());
+			image.height = std::stoul(ReadToken());
+			ReadToken(); //< maxval
+		}
+		else if (magic == "P7")
+		{
+			image.format = GS_RGBA;
+			for (std::string token = ReadToken(); token != "ENDHDR"; token = ReadToken())
+			{
+				if (token.empty())
+					throw std::runtime_error(filePath + " has an invalid header");
+
+				if (token == "WIDTH")
+					image.width = std::stoul(ReadToken());
+				else if (token == "HEIGHT")
+					image.height = std::stoul(ReadToken());
+			}
+		}
+		else
+			throw std::runtime_error(filePath + " is not a golden image");
+
+		image.pitch = image.width * GetBytesPerPixel(image.format);
+		image.pixels.resize(std::size_t(image.pitch) * image.height);
+		if (std::fread(image.pixels.data(), 1, image.pixels.size(), file.get()) != image.pixels.size())
+			throw std::runtime_error(filePath + " is truncated");
+
+		return image;
+	}
+
+	struct Comparison
+	{
+		std::size_t mismatchCount = 0;
+		unsigned int maxDifference = 0;
+	};
+
+	std::optional<Comparison> CompareImages(const Image& reference, const Image& image)
+	{
+		if (reference.format != image.format || reference.width != image.width || reference.height != image.height)
+			return std::nullopt;
+
+		Comparison comparison;
+		for (std::size_t i = 0; i < reference.pixels.size(); ++i)
+		{
+			unsigned int difference = static_cast<unsigned int>(std::abs(int(reference.pixels[i]) - int(image.pixels[i])));
+			if (difference > 0)
+			{
+				comparison.mismatchCount++;
+				comparison.maxDifference = std::max(comparison.maxDifference, difference);
+			}
+		}
+
+		return comparison;
+	}
+
+	// Inputs of the GPU effects, color is only exported as RGBA (software shaders are tested with both channel orders)
+	int ExportInputs(const std::string& folder)
+	{
+		SyntheticInputs inputs = BuildSyntheticInputs(96, 72, 128, 72);
+
+		const std::pair<const char*, const Image*> images[] = {
+			{ "input_background", &inputs.background },
+			{ "input_background_small", &inputs.backgroundSmall },
+			{ "input_body_index", &inputs.bodyIndex },
+			{ "input_color", &inputs.colorRGBA },
+			{ "input_color_to_depth", &inputs.colorToDepth },
+			{ "input_depth", &inputs.depth },
+			{ "input_visibility_mask", &inputs.visibilityMask }
+		};
+
+		for (const auto& [name, image] : images)
+		{
+			std::string path = GetGoldenPath(folder, name, image->format);
+			WriteImage(path, *image);
+			std::printf("%s\n", path.c_str());
+		}
+
+		return EXIT_SUCCESS;
+	}
+
+	int RunTests(const std::string& goldenFolder, bool update, bool gpuCaptures, unsigned int tolerance)
+	{
+		SyntheticInputs inputs = BuildSyntheticInputs(96, 72, 128, 72);
+
+		// Row bands processed by worker threads must give the exact same result
+		WorkerPool workerPool(3);
+		ShaderPipeline pipeline(inputs, nullptr);
+		ShaderPipeline threadedPipeline(inputs, &workerPool);
+
+		const std::vector<Stage>& stages = pipeline.GetStages();
+		const std::vector<Stage>& threadedStages = threadedPipeline.GetStages();
+
+		std::size_t failureCount = 0;
+		std::size_t skipCount = 0;
+		for (std::size_t i = 0; i < stages.size(); ++i)
+		{
+			const Stage& stage = stages[i];
+			Image output = CopyTexture(stage.func());
+			Image threadedOutput = CopyTexture(threadedStages[i].func());
+
+			std::string goldenPath = GetGoldenPath(goldenFolder, stage.name, output.format);
+
+			std::string result;
+			if (update)
+			{
+				WriteImage(goldenPath, output);
+				result = "updated";
+			}
+			else if (std::optional<Image> golden = ReadImage(goldenPath))
+			{
+				std::optional<Comparison> comparison = CompareImages(*golden, output);
+				if (!comparison)
+					result = "FAILED (size or format mismatch)";
+				else if (comparison->maxDifference > tolerance)
+					result = "FAILED (" + std::to_string(comparison->mismatchCount) + " values differ, up to " + std::to_string(comparison->maxDifference) + ")";
+				else if (comparison->mismatchCount > 0)
+					result = "ok (" + std::to_string(comparison->mismatchCount) + " values within tolerance)";
+				else
+					result = "ok";
+			}
+			else if (gpuCaptures)
+			{
+				result = "skipped (no GPU capture)";
+				skipCount++;
+			}
+			else
+				result = "FAILED (missing " + goldenPath + ")";
+
+			if (threadedOutput.pixels != output.pixels)
+				result = "FAILED (multithreaded output differs)";
+
+			if (result.compare(0, 6, "FAILED") == 0)
+				failureCount++;
+
+			std::printf("%-36s %s\n", stage.name.c_str(), result.c_str());
+		}
+
+		std::printf("%zu/%zu stages passed\n", stages.size() - failureCount - skipCount, stages.size() - skipCount);
+
+		// A capture folder without any capture is most likely a wrong path
+		if (skipCount == stages.size())
+			return EXIT_FAILURE;
+
+		return (failureCount == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	int RunBenchmark(std::size_t iterationCount, std::size_t threadCount)
+	{
+		// Kinect v2 depth and 1080p color
+		SyntheticInputs inputs = BuildSyntheticInputs(512, 424, 1920, 1080);
+
+		std::optional<WorkerPool> workerPool;
+		if (threadCount > 1)
+			workerPool.emplace(threadCount - 1);
+
+		ShaderPipeline pipeline(inputs, (workerPool) ? &*workerPool : nullptr);
+		const std::vector<Stage>& stages = pipeline.GetStages();
+
+		std::vector<Clock::duration> totalTimes(stages.size(), Clock::duration::zero());
+		std::vector<Clock::duration> minTimes(stages.size(), Clock::duration::max());
+		std::vector<std::uint64_t> pixelCounts(stages.size(), 0);
+
+		// First iteration warms up work memory and isn't measured
+		for (std::size_t iteration = 0; iteration <= iterationCount; ++iteration)
+		{
+			for (std::size_t i = 0; i < stages.size(); ++i)
+			{
+				Clock::time_point start = Clock::now();
+				SoftwareTexture output = stages[i].func();
+				Clock::duration duration = Clock::now() - start;
+
+				if (iteration == 0)
+				{
+					pixelCounts[i] = std::uint64_t(output.width) * output.height;
+					continue;
+				}
+
+				totalTimes[i] += duration;
+				minTimes[i] = std::min(minTimes[i], duration);
+			}
+		}
+
+		auto ToMs = [](Clock::duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+
+		std::printf("%zu iterations, %zu thread(s)\n", iterationCount, std::max<std::size_t>(threadCount, 1));
+		std::printf("%-36s %10s %10s %12s\n", "stage", "avg (ms)", "min (ms)", "MPix/s");
+		for (std::size_t i = 0; i < stages.size(); ++i)
+		{
+			double averageMs = ToMs(totalTimes[i]) / iterationCount;
+			double megaPixelsPerSecond = (averageMs > 0.0) ? pixelCounts[i] / (averageMs * 1000.0) : 0.0;
+
+			std::printf("%-36s %10.3f %10.3f %12.1f\n", stages[i].name.c_str(), averageMs, ToMs(minTimes[i]), megaPixelsPerSecond);
+		}
+
+		return EXIT_SUCCESS;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "usage: %s <golden folder> [--update] [--tolerance <max difference>]\n", argv[0]);
+		std::fprintf(stderr, "       %s --gpu <capture folder> [--tolerance <max difference>]\n", argv[0]);
+		std::fprintf(stderr, "       %s --export-inputs <folder>\n", argv[0]);
+		std::fprintf(stderr, "       %s --bench [iteration count] [thread count]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		if (std::strcmp(argv[1], "--bench") == 0)
+		{
+			std::size_t iterationCount = (argc >= 3) ? std::strtoul(argv[2], nullptr, 10) : 20;
+			std::size_t threadCount = (argc >= 4) ? std::strtoul(argv[3], nullptr, 10) : 1;
+
+			return RunBenchmark(std::max<std::size_t>(iterationCount, 1), threadCount);
+		}
+
+		if (std::strcmp(argv[1], "--export-inputs") == 0)
+		{
+			if (argc < 3)
+				throw std::runtime_error("missing input folder");
+
+			return ExportInputs(argv[2]);
+		}
+
+		bool gpuCaptures = (std::strcmp(argv[1], "--gpu") == 0);
+		if (gpuCaptures && argc < 3)
+			throw std::runtime_error("missing capture folder");
+
+		int firstOption = (gpuCaptures) ? 3 : 2;
+		std::string folder = argv[firstOption - 1];
+
+		bool update = false;
+		unsigned int tolerance = (gpuCaptures) ? 1 : 0;
+		for (int i = firstOption; i < argc; ++i)
+		{
+			if (std::strcmp(argv[i], "--update") == 0 && !gpuCaptures)
+				update = true;
+			else if (std::strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+				tolerance = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+			else
+				throw std::runtime_error(std::string("unknown option ") + argv[i]);
+		}
+
+		return RunTests(folder, update, gpuCaptures, tolerance);
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+}
@@ -0,0 +1,219 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include "SharedMemoryDevice.hpp"
+#include <obs-kinect-core/KinectSharedMemoryFormat.hpp>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <cstring>
+#include <stdexcept>
+
+SharedMemoryDevice::SharedMemoryDevice(std::string segmentName, const std::string& deviceName, SourceFlags supportedSources) :
+m_segmentName(std::move(segmentName))
+{
+	SetSupportedSources(supportedSources);
+	SetUniqueName("Shared " + deviceName + " (" + m_segmentName + ")");
+}
+
+std::optional<SharedMemorySegment> SharedMemoryDevice::OpenSegment(const std::string& segmentName)
+{
+	using namespace KinectSharedMemoryFormat;
+
+	std::optional<SharedMemorySegment> segment = SharedMemorySegment::Open(segmentName);
+	if (!segment || segment->GetSize() < sizeof(SegmentHeader))
+		return {};
+
+	const SegmentHeader* header = reinterpret_cast<const SegmentHeader*>(segment->GetData());
+	if (header->magic.load(std::memory_order_acquire) != Magic)
+		return {}; //< being created
+
+	if (header->version != Version)
+		throw std::runtime_error("unsupported version " + std::to_string(header->version));
+
+	if (header->slotCount == 0 || header->slotSize < KinectRecordingFormat::AlignPayload(sizeof(SlotHeader)) || SlotOffset(header->slotSize, header->slotCount) > segment->GetSize())
+		throw std::runtime_error("corrupted header");
+
+	if (header->state.load(std::memory_order_acquire) != std::uint32_t(SegmentState::Active) || !SharedMemorySegment::IsProcessAlive(header->writerProcessId))
+		return {};
+
+	return segment;
+}
+
+KinectFramePtr SharedMemoryDevice::ReadFrame(const SharedMemorySegment& segment, std::uint32_t publishIndex, SourceFlags enabledSources)
+{
+	using namespace KinectRecordingFormat;
+	using namespace KinectSharedMemoryFormat;
+
+	constexpr std::size_t MaxAttempts = 4;
+
+	const SegmentHeader* header = reinterpret_cast<const SegmentHeader*>(segment.GetData());
+	const std::uint8_t* slotData = segment.GetData() + SlotOffset(header->slotSize, publishIndex % header->slotCount);
+	const SlotHeader* slotHeader = reinterpret_cast<const SlotHeader*>(slotData);
+
+	for (std::size_t attempt = 0; attempt < MaxAttempts; ++attempt)
+	{
+		// Seqlock read: copy everything then check the slot wasn't written meanwhile
+		std::uint32_t sequence = slotHeader->sequence.load(std::memory_order_acquire);
+		if (sequence & 1)
+		{
+			os_sleep_ms(0);
+			continue;
+		}
+
+		KinectFramePtr framePtr = std::make_shared<KinectFrame>();
+		framePtr->frameIndex = slotHeader->frameIndex;
+		framePtr->timestamp = slotHeader->timestamp;
+
+		std::uint32_t streamCount = slotHeader->streamCount;
+		bool valid = (streamCount <= std::size_t(StreamType::Count));
+		for (std::uint32_t i = 0; valid && i < streamCount; ++i)
+		{
+			StreamHeader streamHeader;
+			std::memcpy(&streamHeader, &slotHeader->streams[i], sizeof(StreamHeader));
+
+			if (streamHeader.type >= StreamType::Count || streamHeader.payloadOffset > header->slotSize || streamHeader.payloadSize > header->slotSize - streamHeader.payloadOffset ||
+			    streamHeader.payloadSize < std::uint64_t(streamHeader.pitch) * streamHeader.height)
+			{
+				valid = false;
+				break;
+			}
+
+			if ((enabledSources & ToSourceFlag(streamHeader.type)) == 0)
+				continue;
+
+			auto FillFrameData = [&](auto& frameData) -> auto&
+			{
+				auto& data = frameData.emplace();
+				data.width = streamHeader.width;
+				data.height = streamHeader.height;
+				data.pitch = streamHeader.pitch;
+				data.memory.resize(static_cast<std::size_t>(streamHeader.payloadSize));
+				std::memcpy(data.memory.data(), slotData + streamHeader.payloadOffset, data.memory.size());
+				data.ptr.reset(reinterpret_cast<decltype(data.ptr.get())>(data.memory.data()));
+
+				return data;
+			};
+
+			switch (streamHeader.type)
+			{
+				case StreamType::BackgroundRemoval: FillFrameData(framePtr->backgroundRemovalFrame); break;
+				case StreamType::BodyIndex:         FillFrameData(framePtr->bodyIndexFrame); break;
+				case StreamType::Color:             FillFrameData(framePtr->colorFrame).format = static_cast<gs_color_format>(streamHeader.format); break;
+				case StreamType::ColorMappedBody:   FillFrameData(framePtr->colorMappedBodyFrame); break;
+				case StreamType::ColorMappedDepth:  FillFrameData(framePtr->colorMappedDepthFrame); break;
+				case StreamType::Depth:             FillFrameData(framePtr->depthFrame); break;
+				case StreamType::DepthMapping:      FillFrameData(framePtr->depthMappingFrame); break;
+				case StreamType::Infrared:          FillFrameData(framePtr->infraredFrame); break;
+
+				case StreamType::Count:
+					break;
+			}
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slotHeader->sequence.load(std::memory_order_relaxed) != sequence)
+			continue; //< slot has been overwritten while we were reading it
+
+		if (!valid)
+			throw std::runtime_error("corrupted slot");
+
+		return framePtr;
+	}
+
+	return nullptr; //< publisher is going faster than us, skip this frame
+}
+
+void SharedMemoryDevice::ThreadFunc()
+{
+	using namespace KinectSharedMemoryFormat;
+
+	os_set_thread_name("SharedMemoryDevice");
+
+	NotifyCaptureStarted();
+
+	constexpr std::uint32_t WaitTimeout = 100; //< ms
+
+	std::optional<SharedMemorySegment> segment;
+	SourceFlags enabledSourceFlags = 0;
+	std::uint32_t lastPublishCount = 0;
+
+	while (IsRunning())
+	{
+		if (auto sourceFlagUpdate = GetSourceFlagsUpdate())
+			enabledSourceFlags = sourceFlagUpdate.value();
+
+		try
+		{
+			if (!segment)
+			{
+				// Publisher may have stopped or be recreating its segment
+				segment = OpenSegment(m_segmentName);
+				if (!segment)
+				{
+					os_sleep_ms(WaitTimeout);
+					continue;
+				}
+
+				lastPublishCount = reinterpret_cast<const SegmentHeader*>(segment->GetData())->publishCount.load(std::memory_order_acquire);
+			}
+
+			SegmentHeader* header = reinterpret_cast<SegmentHeader*>(segment->GetData());
+			if (header->state.load(std::memory_order_acquire) != std::uint32_t(SegmentState::Active))
+			{
+				segment.reset();
+				continue;
+			}
+
+			std::uint32_t publishCount = header->publishCount.load(std::memory_order_acquire);
+			if (publishCount == lastPublishCount)
+			{
+				// Pairs with the publisher store/load (see KinectSharedMemoryPublisher::Publish), the fence also orders the
+				// increment before the publishCount read done by the wait (in the kernel for futexes)
+				header->waiterCount.fetch_add(1, std::memory_order_seq_cst);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				SharedMemorySegment::WaitForChange(header->publishCount, lastPublishCount, WaitTimeout);
+				header->waiterCount.fetch_sub(1, std::memory_order_acq_rel);
+
+				// Publisher may have died without closing its segment
+				if (header->publishCount.load(std::memory_order_acquire) == lastPublishCount && !SharedMemorySegment::IsProcessAlive(header->writerProcessId))
+					segment.reset();
+
+				continue;
+			}
+
+			lastPublishCount = publishCount;
+			if (enabledSourceFlags == 0)
+				continue;
+
+			// Only the latest frame matters
+			if (KinectFramePtr framePtr = ReadFrame(*segment, publishCount - 1, enabledSourceFlags))
+				UpdateFrame(std::move(framePtr));
+		}
+		catch (const std::exception& e)
+		{
+			errorlog("%s", e.what());
+			segment.reset();
+
+			// Force sleep to prevent log spamming
+			os_sleep_ms(100);
+		}
+	}
+
+	infolog("exiting thread");
+}
@@ -0,0 +1,48 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_SHAREDMEMORYDEVICE
+#define OBS_KINECT_PLUGIN_SHAREDMEMORYDEVICE
+
+#include "SharedMemoryHelper.hpp"
+#include <obs-kinect-core/KinectDevice.hpp>
+#include <obs-kinect-core/SharedMemorySegment.hpp>
+#include <optional>
+#include <string>
+
+// Reads the frames another process publishes through shared memory (see KinectSharedMemoryFormat)
+// The publisher process owns the device, only the streams it has enabled are available.
+class SharedMemoryDevice final : public KinectDevice
+{
+	public:
+		SharedMemoryDevice(std::string segmentName, const std::string& deviceName, SourceFlags supportedSources);
+		~SharedMemoryDevice() = default;
+
+		// Opens a segment if it exists and belongs to a running publisher
+		static std::optional<SharedMemorySegment> OpenSegment(const std::string& segmentName);
+
+	private:
+		KinectFramePtr ReadFrame(const SharedMemorySegment& segment, std::uint32_t publishIndex, SourceFlags enabledSources);
+		void ThreadFunc() override;
+
+		std::string m_segmentName;
+};
+
+#endif
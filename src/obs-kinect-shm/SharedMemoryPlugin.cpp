@@ -0,0 +1,62 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include "SharedMemoryPlugin.hpp"
+#include "SharedMemoryDevice.hpp"
+#include <obs-kinect-core/KinectSharedMemoryFormat.hpp>
+#include <cstring>
+
+std::string SharedMemoryPlugin::GetUniqueName() const
+{
+	return "SharedMemory";
+}
+
+std::vector<std::unique_ptr<KinectDevice>> SharedMemoryPlugin::Refresh() const
+{
+	using namespace KinectSharedMemoryFormat;
+
+	std::vector<std::unique_ptr<KinectDevice>> devices;
+
+	std::uint64_t processId = SharedMemorySegment::GetCurrentProcessId();
+	for (std::uint32_t i = 0; i < MaxPublishers; ++i)
+	{
+		std::string segmentName = GetSegmentName(i);
+
+		try
+		{
+			std::optional<SharedMemorySegment> segment = SharedMemoryDevice::OpenSegment(segmentName);
+			if (!segment)
+				continue;
+
+			const SegmentHeader* header = reinterpret_cast<const SegmentHeader*>(segment->GetData());
+
+			// Devices of this process are already available directly
+			if (header->writerProcessId == processId)
+				continue;
+
+			std::string deviceName(header->deviceName, strnlen(header->deviceName, sizeof(header->deviceName)));
+			devices.emplace_back(std::make_unique<SharedMemoryDevice>(segmentName, deviceName, static_cast<SourceFlags>(header->supportedSources)));
+		}
+		catch (const std::exception& e)
+		{
+			warnlog("failed to open %s: %s", segmentName.c_str(), e.what());
+		}
+	}
+
+	return devices;
+}
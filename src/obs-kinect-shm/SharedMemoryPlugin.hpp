@@ -0,0 +1,45 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_SHAREDMEMORYPLUGIN
+#define OBS_KINECT_PLUGIN_SHAREDMEMORYPLUGIN
+
+#include "SharedMemoryHelper.hpp"
+#include <obs-kinect-core/Enums.hpp>
+#include <obs-kinect-core/KinectPluginImpl.hpp>
+
+// Exposes the devices shared by other processes (see KinectSharedMemoryPublisher)
+class SharedMemoryPlugin : public KinectPluginImpl
+{
+	public:
+		SharedMemoryPlugin() = default;
+		SharedMemoryPlugin(const SharedMemoryPlugin&) = delete;
+		SharedMemoryPlugin(SharedMemoryPlugin&&) = delete;
+		~SharedMemoryPlugin() = default;
+
+		std::string GetUniqueName() const override;
+
+		std::vector<std::unique_ptr<KinectDevice>> Refresh() const override;
+
+		SharedMemoryPlugin& operator=(const SharedMemoryPlugin&) = delete;
+		SharedMemoryPlugin& operator=(SharedMemoryPlugin&&) = delete;
+};
+
+#endif
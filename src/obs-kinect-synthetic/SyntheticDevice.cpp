@@ -0,0 +1,449 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "SyntheticDevice.hpp"
+#include <obs-kinect-core/WorkerPool.hpp>
+#include <util/threading.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	constexpr std::uint32_t InvalidDepthBorder = 8; //< Leftmost depth columns have no data, like on real sensors
+	constexpr std::uint8_t NoPlayer = 0xFF;
+}
+
+SyntheticDevice::SyntheticDevice(std::size_t deviceIndex) :
+m_deviceIndex(deviceIndex),
+m_colorResolution(SyntheticColorResolution::R1920x1080),
+m_framerate(30),
+m_motionSpeed(100)
+{
+	SetSupportedSources(Source_Body | Source_Color | Source_ColorMappedBody | Source_ColorMappedDepth | Source_ColorToDepthMapping | Source_Depth | Source_Infrared);
+	SetUniqueName("Synthetic #" + std::to_string(deviceIndex));
+
+	auto MaxInt = [](long long a, long long b)
+	{
+		return std::max(a, b);
+	};
+
+	RegisterIntParameter("synthetic_color_resolution", static_cast<long long>(m_colorResolution.load()), MaxInt);
+	RegisterIntParameter("synthetic_framerate", m_framerate.load(), MaxInt);
+	RegisterIntParameter("synthetic_motion_speed", m_motionSpeed.load(), MaxInt);
+}
+
+SyntheticDevice::~SyntheticDevice()
+{
+	StopCapture(); //< Ensure thread has joined before destroying parameters
+}
+
+obs_properties_t* SyntheticDevice::CreateProperties() const
+{
+	obs_property_t* p;
+
+	obs_properties_t* props = obs_properties_create();
+
+	p = obs_properties_add_list(props, "synthetic_color_resolution", Translate("ObsKinectSynthetic.ColorResolution"), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(p, Translate("ObsKinectSynthetic.ColorResolution_640x480"),   static_cast<int>(SyntheticColorResolution::R640x480));
+	obs_property_list_add_int(p, Translate("ObsKinectSynthetic.ColorResolution_1280x720"),  static_cast<int>(SyntheticColorResolution::R1280x720));
+	obs_property_list_add_int(p, Translate("ObsKinectSynthetic.ColorResolution_1920x1080"), static_cast<int>(SyntheticColorResolution::R1920x1080));
+	obs_property_list_add_int(p, Translate("ObsKinectSynthetic.ColorResolution_2560x1440"), static_cast<int>(SyntheticColorResolution::R2560x1440));
+	obs_property_list_add_int(p, Translate("ObsKinectSynthetic.ColorResolution_3840x2160"), static_cast<int>(SyntheticColorResolution::R3840x2160));
+	obs_property_list_add_int(p, Translate("ObsKinectSynthetic.ColorResolution_4096x3072"), static_cast<int>(SyntheticColorResolution::R4096x3072));
+
+	obs_properties_add_int_slider(props, "synthetic_framerate", Translate("ObsKinectSynthetic.Framerate"), 1, 120, 1);
+	obs_properties_add_int_slider(props, "synthetic_motion_speed", Translate("ObsKinectSynthetic.MotionSpeed"), 0, 400, 5);
+
+	return props;
+}
+
+void SyntheticDevice::HandleIntParameterUpdate(const std::string& parameterName, long long value)
+{
+	if (parameterName == "synthetic_color_resolution")
+	{
+		if (value < static_cast<long long>(SyntheticColorResolution::R640x480) || value > static_cast<long long>(SyntheticColorResolution::R4096x3072))
+		{
+			errorlog("invalid color resolution %lld", value);
+			return;
+		}
+
+		m_colorResolution.store(static_cast<SyntheticColorResolution>(value));
+	}
+	else if (parameterName == "synthetic_framerate")
+		m_framerate.store(std::clamp(value, 1LL, 120LL));
+	else if (parameterName == "synthetic_motion_speed")
+		m_motionSpeed.store(std::max(value, 0LL));
+	else
+		errorlog("unhandled int parameter %s", parameterName.c_str());
+}
+
+void SyntheticDevice::ThreadFunc()
+{
+	os_set_thread_name("SyntheticDevice");
+
+	std::shared_ptr<WorkerPool> workerPool = WorkerPool::GetSharedPool();
+
+	NotifyCaptureStarted();
+
+	Scene scene;
+	std::optional<SyntheticColorResolution> sceneResolution;
+
+	std::vector<std::uint8_t> bodyBuffer(DepthWidth * DepthHeight);
+	std::vector<std::uint16_t> depthBuffer(DepthWidth * DepthHeight);
+
+	SourceFlags enabledSourceFlags = 0;
+	std::uint64_t sceneFrame = 0;
+	std::uint64_t now = os_gettime_ns();
+
+	while (IsRunning())
+	{
+		if (auto sourceFlagUpdate = GetSourceFlagsUpdate())
+			enabledSourceFlags = sourceFlagUpdate.value();
+
+		if (enabledSourceFlags == 0)
+		{
+			os_sleep_ms(10);
+			now = os_gettime_ns();
+			continue;
+		}
+
+		try
+		{
+			SyntheticColorResolution colorResolution = m_colorResolution.load();
+			if (!sceneResolution || *sceneResolution != colorResolution)
+			{
+				BuildScene(scene, colorResolution);
+				sceneResolution = colorResolution;
+			}
+
+			long long framerate = m_framerate.load();
+			PlayerState player = ComputePlayerState(sceneFrame++, m_deviceIndex, framerate, m_motionSpeed.load());
+
+			KinectFramePtr framePtr = std::make_shared<KinectFrame>();
+			framePtr->timestamp = now;
+
+			// Depth space, body index and depth are generated together as the color-mapped streams sample them
+			if (enabledSourceFlags & (Source_Body | Source_ColorMappedBody | Source_ColorMappedDepth | Source_Depth | Source_Infrared))
+			{
+				for (std::uint32_t y = 0; y < DepthHeight; ++y)
+				{
+					float beginU;
+					float endU;
+					bool hasPlayer = GetPlayerSpan(player, (y + 0.5f) / DepthHeight, beginU, endU);
+
+					std::uint8_t* bodyPtr = &bodyBuffer[y * DepthWidth];
+					std::uint16_t* depthPtr = &depthBuffer[y * DepthWidth];
+					for (std::uint32_t x = 0; x < DepthWidth; ++x)
+					{
+						float u = (x + 0.5f) / DepthWidth;
+						if (x < InvalidDepthBorder)
+						{
+							bodyPtr[x] = NoPlayer;
+							depthPtr[x] = 0;
+						}
+						else if (hasPlayer && u >= beginU && u < endU)
+						{
+							bodyPtr[x] = 0;
+							depthPtr[x] = player.depth;
+						}
+						else
+						{
+							bodyPtr[x] = NoPlayer;
+							depthPtr[x] = GetWallDepth(x);
+						}
+					}
+				}
+			}
+
+			if (enabledSourceFlags & Source_Body)
+			{
+				BodyIndexFrameData& frameData = framePtr->bodyIndexFrame.emplace();
+				frameData.width = DepthWidth;
+				frameData.height = DepthHeight;
+				frameData.pitch = DepthWidth;
+				frameData.memory = bodyBuffer;
+				frameData.ptr.reset(frameData.memory.data());
+			}
+
+			if (enabledSourceFlags & Source_Depth)
+			{
+				DepthFrameData& frameData = framePtr->depthFrame.emplace();
+				frameData.width = DepthWidth;
+				frameData.height = DepthHeight;
+				frameData.pitch = DepthWidth * sizeof(std::uint16_t);
+				frameData.memory.resize(depthBuffer.size() * sizeof(std::uint16_t));
+				std::memcpy(frameData.memory.data(), depthBuffer.data(), frameData.memory.size());
+				frameData.ptr.reset(reinterpret_cast<std::uint16_t*>(frameData.memory.data()));
+			}
+
+			if (enabledSourceFlags & Source_Infrared)
+			{
+				InfraredFrameData& frameData = framePtr->infraredFrame.emplace();
+				frameData.width = DepthWidth;
+				frameData.height = DepthHeight;
+				frameData.pitch = DepthWidth * sizeof(std::uint16_t);
+				frameData.memory.resize(depthBuffer.size() * sizeof(std::uint16_t));
+
+				std::uint16_t* irPtr = reinterpret_cast<std::uint16_t*>(frameData.memory.data());
+				for (std::uint32_t y = 0; y < DepthHeight; ++y)
+				{
+					for (std::uint32_t x = 0; x < DepthWidth; ++x)
+					{
+						std::uint16_t depth = depthBuffer[y * DepthWidth + x];
+						if (depth == 0)
+						{
+							*irPtr++ = 0;
+							continue;
+						}
+
+						// Reflected intensity falls off with squared distance, with a light pattern to show details
+						float intensity = 1.5e10f / (float(depth) * float(depth));
+						if (((x >> 4) ^ (y >> 4)) & 1)
+							intensity *= 1.25f;
+
+						*irPtr++ = static_cast<std::uint16_t>(std::min(intensity, 65535.f));
+					}
+				}
+
+				frameData.ptr.reset(reinterpret_cast<std::uint16_t*>(frameData.memory.data()));
+			}
+
+			// Color space streams may be huge (up to 4096x3072), split them in row bands
+			if (enabledSourceFlags & Source_Color)
+			{
+				ColorFrameData& frameData = framePtr->colorFrame.emplace();
+				frameData.width = scene.colorWidth;
+				frameData.height = scene.colorHeight;
+				frameData.pitch = scene.colorWidth * 4;
+				frameData.format = GS_RGBA;
+				frameData.memory.resize(scene.colorBackground.size());
+
+				std::uint8_t* colorPtr = frameData.memory.data();
+				workerPool->ParallelFor(scene.colorHeight, [&](std::uint32_t begin, std::uint32_t end)
+				{
+					for (std::uint32_t y = begin; y < end; ++y)
+					{
+						std::uint8_t* rowPtr = &colorPtr[y * frameData.pitch];
+						std::memcpy(rowPtr, &scene.colorBackground[y * frameData.pitch], frameData.pitch);
+
+						float v = (y + 0.5f) / scene.colorHeight;
+
+						float beginU;
+						float endU;
+						if (!GetPlayerSpan(player, v, beginU, endU))
+							continue;
+
+						// Shade the player so it looks rounded
+						float dy = (v - player.centerY) / player.radiusY;
+						float shade = 0.6f + 0.4f * std::sqrt(std::max(1.f - dy * dy, 0.f));
+
+						std::uint8_t r = static_cast<std::uint8_t>(player.color[0] * shade);
+						std::uint8_t g = static_cast<std::uint8_t>(player.color[1] * shade);
+						std::uint8_t b = static_cast<std::uint8_t>(player.color[2] * shade);
+
+						auto ToColumn = [&](float u)
+						{
+							return static_cast<std::uint32_t>(std::clamp(std::ceil(u * scene.colorWidth - 0.5f), 0.f, float(scene.colorWidth)));
+						};
+
+						std::uint32_t endX = ToColumn(endU);
+						for (std::uint32_t x = ToColumn(beginU); x < endX; ++x)
+						{
+							rowPtr[x * 4 + 0] = r;
+							rowPtr[x * 4 + 1] = g;
+							rowPtr[x * 4 + 2] = b;
+							rowPtr[x * 4 + 3] = 0xFF;
+						}
+					}
+				});
+
+				frameData.ptr.reset(frameData.memory.data());
+			}
+
+			if (enabledSourceFlags & Source_ColorMappedBody)
+			{
+				BodyIndexFrameData& frameData = framePtr->colorMappedBodyFrame.emplace();
+				frameData.width = scene.colorWidth;
+				frameData.height = scene.colorHeight;
+				frameData.pitch = scene.colorWidth;
+				frameData.memory.resize(scene.colorWidth * scene.colorHeight);
+
+				std::uint8_t* bodyPtr = frameData.memory.data();
+				workerPool->ParallelFor(scene.colorHeight, [&](std::uint32_t begin, std::uint32_t end)
+				{
+					for (std::uint32_t y = begin; y < end; ++y)
+					{
+						const std::uint8_t* depthRowPtr = &bodyBuffer[scene.depthRows[y] * DepthWidth];
+						std::uint8_t* rowPtr = &bodyPtr[y * frameData.pitch];
+						for (std::uint32_t x = 0; x < scene.colorWidth; ++x)
+							rowPtr[x] = depthRowPtr[scene.depthColumns[x]];
+					}
+				});
+
+				frameData.ptr.reset(frameData.memory.data());
+			}
+
+			if (enabledSourceFlags & Source_ColorMappedDepth)
+			{
+				DepthFrameData& frameData = framePtr->colorMappedDepthFrame.emplace();
+				frameData.width = scene.colorWidth;
+				frameData.height = scene.colorHeight;
+				frameData.pitch = scene.colorWidth * sizeof(std::uint16_t);
+				frameData.memory.resize(scene.colorWidth * scene.colorHeight * sizeof(std::uint16_t));
+
+				std::uint16_t* depthPtr = reinterpret_cast<std::uint16_t*>(frameData.memory.data());
+				workerPool->ParallelFor(scene.colorHeight, [&](std::uint32_t begin, std::uint32_t end)
+				{
+					for (std::uint32_t y = begin; y < end; ++y)
+					{
+						const std::uint16_t* depthRowPtr = &depthBuffer[scene.depthRows[y] * DepthWidth];
+						std::uint16_t* rowPtr = &depthPtr[y * scene.colorWidth];
+						for (std::uint32_t x = 0; x < scene.colorWidth; ++x)
+							rowPtr[x] = depthRowPtr[scene.depthColumns[x]];
+					}
+				});
+
+				frameData.ptr.reset(depthPtr);
+			}
+
+			if (enabledSourceFlags & Source_ColorToDepthMapping)
+			{
+				DepthMappingFrameData& frameData = framePtr->depthMappingFrame.emplace();
+				frameData.width = scene.colorWidth;
+				frameData.height = scene.colorHeight;
+				frameData.pitch = scene.colorWidth * sizeof(DepthMappingFrameData::DepthCoordinates);
+				frameData.memory = scene.depthMapping;
+				frameData.ptr.reset(reinterpret_cast<DepthMappingFrameData::DepthCoordinates*>(frameData.memory.data()));
+			}
+
+			UpdateFrame(std::move(framePtr));
+
+			now += 1'000'000'000ULL / static_cast<std::uint64_t>(framerate);
+
+			// Drop late frames instead of bursting when generation takes longer than the frame period
+			std::uint64_t currentTime = os_gettime_ns();
+			if (now > currentTime)
+				os_sleepto_ns(now);
+			else
+				now = currentTime;
+		}
+		catch (const std::exception& e)
+		{
+			errorlog("%s", e.what());
+
+			// Force sleep to prevent log spamming
+			os_sleep_ms(100);
+			now = os_gettime_ns();
+		}
+	}
+
+	infolog("exiting thread");
+}
+
+void SyntheticDevice::BuildScene(Scene& scene, SyntheticColorResolution resolution)
+{
+	switch (resolution)
+	{
+		case SyntheticColorResolution::R640x480:   scene.colorWidth = 640;  scene.colorHeight = 480;  break;
+		case SyntheticColorResolution::R1280x720:  scene.colorWidth = 1280; scene.colorHeight = 720;  break;
+		case SyntheticColorResolution::R1920x1080: scene.colorWidth = 1920; scene.colorHeight = 1080; break;
+		case SyntheticColorResolution::R2560x1440: scene.colorWidth = 2560; scene.colorHeight = 1440; break;
+		case SyntheticColorResolution::R3840x2160: scene.colorWidth = 3840; scene.colorHeight = 2160; break;
+		case SyntheticColorResolution::R4096x3072: scene.colorWidth = 4096; scene.colorHeight = 3072; break;
+
+		default:
+			throw std::runtime_error("unhandled color resolution");
+	}
+
+	// Background is a gradient with a checkerboard, scaled with the resolution so every mode shows the same scene
+	std::uint32_t cellSize = std::max(scene.colorWidth / 32, 1U);
+
+	scene.colorBackground.resize(scene.colorWidth * scene.colorHeight * 4);
+	std::uint8_t* colorPtr = scene.colorBackground.data();
+	for (std::uint32_t y = 0; y < scene.colorHeight; ++y)
+	{
+		for (std::uint32_t x = 0; x < scene.colorWidth; ++x)
+		{
+			std::uint8_t shade = (((x / cellSize) ^ (y / cellSize)) & 1) ? 20 : 0;
+
+			*colorPtr++ = static_cast<std::uint8_t>(40 + 80 * x / scene.colorWidth + shade);
+			*colorPtr++ = static_cast<std::uint8_t>(60 + 60 * y / scene.colorHeight + shade);
+			*colorPtr++ = static_cast<std::uint8_t>(90 + shade);
+			*colorPtr++ = 0xFF;
+		}
+	}
+
+	// Color and depth cameras share the same field of view
+	scene.depthColumns.resize(scene.colorWidth);
+	for (std::uint32_t x = 0; x < scene.colorWidth; ++x)
+		scene.depthColumns[x] = std::min(static_cast<std::uint32_t>((x + 0.5f) * DepthWidth / scene.colorWidth), DepthWidth - 1);
+
+	scene.depthRows.resize(scene.colorHeight);
+	for (std::uint32_t y = 0; y < scene.colorHeight; ++y)
+		scene.depthRows[y] = std::min(static_cast<std::uint32_t>((y + 0.5f) * DepthHeight / scene.colorHeight), DepthHeight - 1);
+
+	scene.depthMapping.resize(scene.colorWidth * scene.colorHeight * sizeof(DepthMappingFrameData::DepthCoordinates));
+	DepthMappingFrameData::DepthCoordinates* mappingPtr = reinterpret_cast<DepthMappingFrameData::DepthCoordinates*>(scene.depthMapping.data());
+	for (std::uint32_t y = 0; y < scene.colorHeight; ++y)
+	{
+		for (std::uint32_t x = 0; x < scene.colorWidth; ++x)
+		{
+			mappingPtr->x = (x + 0.5f) * DepthWidth / scene.colorWidth - 0.5f;
+			mappingPtr->y = (y + 0.5f) * DepthHeight / scene.colorHeight - 0.5f;
+			mappingPtr++;
+		}
+	}
+}
+
+auto SyntheticDevice::ComputePlayerState(std::uint64_t sceneFrame, std::size_t deviceIndex, long long framerate, long long motionSpeed) -> PlayerState
+{
+	// Scene time is derived from the frame number so that a given frame always has the same content
+	double t = double(sceneFrame) / double(framerate) * double(motionSpeed) / 100.0 + double(deviceIndex) * 1.7;
+
+	PlayerState player;
+	player.centerX = static_cast<float>(0.5 + 0.3 * std::sin(0.6 * t));
+	player.centerY = static_cast<float>(0.55 + 0.03 * std::sin(2.1 * t));
+	player.radiusX = static_cast<float>(0.12 + 0.02 * std::sin(1.3 * t));
+	player.radiusY = 0.38f;
+	player.depth = static_cast<std::uint16_t>(1400.0 + 400.0 * (0.5 + 0.5 * std::sin(0.35 * t)));
+	player.color[0] = static_cast<std::uint8_t>(150.0 + 100.0 * std::sin(0.2 * t));
+	player.color[1] = static_cast<std::uint8_t>(150.0 + 100.0 * std::sin(0.2 * t + 2.094));
+	player.color[2] = static_cast<std::uint8_t>(150.0 + 100.0 * std::sin(0.2 * t + 4.189));
+
+	return player;
+}
+
+bool SyntheticDevice::GetPlayerSpan(const PlayerState& player, float v, float& beginU, float& endU)
+{
+	float dy = (v - player.centerY) / player.radiusY;
+	if (dy <= -1.f || dy >= 1.f)
+		return false;
+
+	float halfWidth = player.radiusX * std::sqrt(1.f - dy * dy);
+	beginU = player.centerX - halfWidth;
+	endU = player.centerX + halfWidth;
+
+	return true;
+}
+
+std::uint16_t SyntheticDevice::GetWallDepth(std::uint32_t x)
+{
+	// Slightly slanted wall
+	return static_cast<std::uint16_t>(2600 + 600 * x / DepthWidth);
+}
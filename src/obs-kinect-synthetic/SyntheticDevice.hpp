@@ -0,0 +1,86 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_SYNTHETICDEVICE
+#define OBS_KINECT_PLUGIN_SYNTHETICDEVICE
+
+#include "SyntheticHelper.hpp"
+#include <obs-kinect-core/KinectDevice.hpp>
+#include <atomic>
+#include <vector>
+
+enum class SyntheticColorResolution
+{
+	R640x480   = 0,
+	R1280x720  = 1,
+	R1920x1080 = 2,
+	R2560x1440 = 3,
+	R3840x2160 = 4,
+	R4096x3072 = 5
+};
+
+// Procedural device: a moving player in front of a wall, rendered in every stream the plugin knows
+// Frame content only depends on the frame number and parameters, never on timing
+class SyntheticDevice final : public KinectDevice
+{
+	public:
+		SyntheticDevice(std::size_t deviceIndex);
+		~SyntheticDevice();
+
+		obs_properties_t* CreateProperties() const override;
+
+		static constexpr std::uint32_t DepthWidth = 512;
+		static constexpr std::uint32_t DepthHeight = 424;
+
+	private:
+		struct Scene
+		{
+			std::uint32_t colorWidth = 0;
+			std::uint32_t colorHeight = 0;
+			std::vector<std::uint8_t> colorBackground;
+			std::vector<std::uint8_t> depthMapping;
+			std::vector<std::uint32_t> depthColumns; //< depth column of each color column
+			std::vector<std::uint32_t> depthRows;    //< depth row of each color row
+		};
+
+		struct PlayerState
+		{
+			float centerX;
+			float centerY;
+			float radiusX;
+			float radiusY;
+			std::uint16_t depth;
+			std::uint8_t color[3];
+		};
+
+		void HandleIntParameterUpdate(const std::string& parameterName, long long value) override;
+		void ThreadFunc() override;
+
+		static void BuildScene(Scene& scene, SyntheticColorResolution resolution);
+		static PlayerState ComputePlayerState(std::uint64_t sceneFrame, std::size_t deviceIndex, long long framerate, long long motionSpeed);
+		static bool GetPlayerSpan(const PlayerState& player, float v, float& beginU, float& endU);
+		static std::uint16_t GetWallDepth(std::uint32_t x);
+
+		std::size_t m_deviceIndex;
+		std::atomic<SyntheticColorResolution> m_colorResolution;
+		std::atomic<long long> m_framerate;
+		std::atomic<long long> m_motionSpeed;
+};
+
+#endif
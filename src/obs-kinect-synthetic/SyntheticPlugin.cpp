@@ -0,0 +1,49 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "SyntheticPlugin.hpp"
+#include "SyntheticDevice.hpp"
+#include <cstdlib>
+
+std::string SyntheticPlugin::GetUniqueName() const
+{
+	return "Synthetic";
+}
+
+std::vector<std::unique_ptr<KinectDevice>> SyntheticPlugin::Refresh() const
+{
+	std::vector<std::unique_ptr<KinectDevice>> devices;
+
+	// Load tests may need more than one device
+	std::size_t deviceCount = 1;
+	if (const char* countStr = std::getenv("OBS_KINECT_SYNTHETIC_DEVICES"))
+		deviceCount = std::strtoul(countStr, nullptr, 10);
+
+	for (std::size_t i = 0; i < deviceCount; ++i)
+	{
+		try
+		{
+			devices.emplace_back(std::make_unique<SyntheticDevice>(i));
+		}
+		catch (const std::exception& e)
+		{
+			warnlog("failed to create synthetic device #%zu: %s", i, e.what());
+		}
+	}
+
+	return devices;
+}
@@ -0,0 +1,44 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_SYNTHETICPLUGIN
+#define OBS_KINECT_PLUGIN_SYNTHETICPLUGIN
+
+#include "SyntheticHelper.hpp"
+#include <obs-kinect-core/Enums.hpp>
+#include <obs-kinect-core/KinectPluginImpl.hpp>
+
+// Exposes procedural devices, used to run the whole pipeline without any Kinect or vendor SDK
+class SyntheticPlugin : public KinectPluginImpl
+{
+	public:
+		SyntheticPlugin() = default;
+		SyntheticPlugin(const SyntheticPlugin&) = delete;
+		SyntheticPlugin(SyntheticPlugin&&) = delete;
+		~SyntheticPlugin() = default;
+
+		std::string GetUniqueName() const override;
+
+		std::vector<std::unique_ptr<KinectDevice>> Refresh() const override;
+
+		SyntheticPlugin& operator=(const SyntheticPlugin&) = delete;
+		SyntheticPlugin& operator=(SyntheticPlugin&&) = delete;
+};
+
+#endif
@@ -0,0 +1,585 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect/CpuCompositor.hpp>
+#include <obs-kinect-core/KinectDerivedDataCache.hpp>
+#include <obs-kinect-core/WorkerPool.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareSampling.hpp>
+#include <obs-kinect/ObsProfileScope.hpp>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <cassert>
+#include <stdexcept>
+#include <type_traits>
+
+namespace
+{
+	template<typename T>
+	struct AlwaysFalse : std::false_type {};
+
+	template<typename T>
+	SoftwareTexture ToSoftwareTexture(const T& frameData, gs_color_format format)
+	{
+		SoftwareTexture texture;
+		texture.ptr = reinterpret_cast<const std::uint8_t*>(frameData.ptr.get());
+		texture.format = format;
+		texture.width = frameData.width;
+		texture.height = frameData.height;
+		texture.pitch = frameData.pitch;
+
+		return texture;
+	}
+}
+
+CpuCompositor::CpuCompositor(obs_source_t* source) :
+m_workerPool(WorkerPool::GetSharedPool()),
+m_filterBlur(GS_R8, m_workerPool.get()),
+m_greenScreenFilter(m_workerPool.get()),
+m_visibilityMask(m_workerPool.get()),
+m_filterType(KinectSource::GreenScreenSettings{}.filterType),
+m_source(source),
+m_clearRequested(false),
+m_running(true)
+{
+	m_thread = std::thread(&CpuCompositor::ThreadFunc, this);
+}
+
+CpuCompositor::~CpuCompositor()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+	m_cv.notify_one();
+
+	m_thread.join();
+}
+
+void CpuCompositor::Clear()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_clearRequested = true;
+		m_pendingFrame.reset();
+		m_pendingParams.reset();
+	}
+	m_cv.notify_one();
+}
+
+void CpuCompositor::Submit(KinectFrameConstPtr frame, Params params)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pendingFrame = std::move(frame);
+		m_pendingParams = std::move(params);
+	}
+	m_cv.notify_one();
+}
+
+SoftwareTexture CpuCompositor::CleanupMask(const SoftwareTexture& mask, const Params& params)
+{
+	const KinectSource::GreenScreenSettings& greenScreen = params.greenScreen;
+
+	bool morphologyEnabled = (greenScreen.morphologyOperation != MorphologyOperation::None);
+	bool temporalEnabled = (greenScreen.temporalFrameCount > 1);
+	if (!temporalEnabled)
+		m_temporalFilter.Reset();
+
+	if (!morphologyEnabled && !temporalEnabled)
+		return mask;
+
+	SoftwareTexture cleanedMask = PrepareRenderTarget(m_maskMemory, GS_R8, mask.width, mask.height);
+
+	const std::uint8_t* maskPtr = mask.ptr;
+	std::uint32_t maskPitch = mask.pitch;
+
+	if (morphologyEnabled)
+	{
+		ObsProfileScope profile("CpuCompositor: mask morphology");
+
+		m_maskMorphology.Apply(greenScreen.morphologyOperation, greenScreen.morphologyRadius, maskPtr, maskPitch, m_maskMemory.data(), cleanedMask.pitch, mask.width, mask.height);
+		maskPtr = m_maskMemory.data();
+		maskPitch = cleanedMask.pitch;
+	}
+
+	if (temporalEnabled)
+	{
+		ObsProfileScope profile("CpuCompositor: temporal mask filter");
+
+		// Same factor as GreenscreenMaskProducer::ComputeTemporalHistoryFactor
+		float frameCount = float(greenScreen.temporalFrameCount);
+		float historyFactor = (frameCount - 1.f) / (frameCount + 1.f);
+
+		m_temporalFilter.Apply(historyFactor, greenScreen.temporalResetThreshold, maskPtr, maskPitch, m_maskMemory.data(), cleanedMask.pitch, mask.width, mask.height);
+	}
+
+	return cleanedMask;
+}
+
+SoftwareTexture CpuCompositor::ComputeFilter(const KinectFrame& frame, const Params& params, std::uint32_t width, std::uint32_t height)
+{
+	const KinectSource::GreenScreenSettings& greenScreen = params.greenScreen;
+
+	if (greenScreen.filterType != m_filterType)
+	{
+		// Mask history is no longer relevant
+		m_temporalFilter.Reset();
+		m_filterType = greenScreen.filterType;
+	}
+
+	if (greenScreen.filterType == KinectSource::GreenScreenFilterType::Dedicated)
+	{
+		if (!frame.backgroundRemovalFrame)
+			return {};
+
+		return CleanupMask(ToSoftwareTexture(*frame.backgroundRemovalFrame, GS_R8), params);
+	}
+
+	bool requireBody = KinectSource::DoesRequireBodyFrame(greenScreen.filterType);
+	bool requireDepth = KinectSource::DoesRequireDepthFrame(greenScreen.filterType);
+	bool softwareDepthMapping = (!greenScreen.gpuDepthMapping || greenScreen.maxDirtyDepth > 0);
+
+	// Mapped data snapshots, must outlive the textures pointing to them
+	KinectDerivedDataCache::MappedBodyIndex mappedBodyIndex;
+	KinectDerivedDataCache::MappedDepth mappedDepth;
+
+	SoftwareTexture bodyIndexTexture;
+	SoftwareTexture depthMappingTexture;
+	SoftwareTexture depthTexture;
+
+	if (params.sourceType == KinectSource::SourceType::Color && !frame.colorMappedDepthFrame)
+	{
+		if (!frame.depthMappingFrame)
+			return {};
+
+		const DepthMappingFrameData& depthMappingFrame = *frame.depthMappingFrame;
+
+		if (softwareDepthMapping)
+		{
+			if (!frame.colorFrame || !frame.depthFrame)
+				return {};
+
+			ObsProfileScope profile("CpuCompositor: software depth mapping");
+
+			const ColorFrameData& colorFrame = *frame.colorFrame;
+
+			assert(params.derivedDataCache);
+
+			if (requireDepth)
+			{
+				mappedDepth = params.derivedDataCache->GetMappedDepth(frame, greenScreen.maxDirtyDepth);
+
+				depthTexture.ptr = reinterpret_cast<const std::uint8_t*>(mappedDepth->data());
+				depthTexture.format = GS_R16;
+				depthTexture.width = colorFrame.width;
+				depthTexture.height = colorFrame.height;
+				depthTexture.pitch = colorFrame.width * sizeof(std::uint16_t);
+			}
+
+			if (requireBody)
+			{
+				if (!frame.bodyIndexFrame)
+					return {};
+
+				mappedBodyIndex = params.derivedDataCache->GetMappedBodyIndex(frame, greenScreen.maxDirtyDepth);
+
+				bodyIndexTexture.ptr = mappedBodyIndex->data();
+				bodyIndexTexture.format = GS_R8;
+				bodyIndexTexture.width = colorFrame.width;
+				bodyIndexTexture.height = colorFrame.height;
+				bodyIndexTexture.pitch = colorFrame.width;
+			}
+		}
+		else
+		{
+			depthMappingTexture = ToSoftwareTexture(depthMappingFrame, GS_RG32F);
+		}
+	}
+
+	if (!depthTexture && requireDepth)
+	{
+		if (params.sourceType == KinectSource::SourceType::Color && frame.colorMappedDepthFrame)
+		{
+			depthTexture = ToSoftwareTexture(*frame.colorMappedDepthFrame, GS_R16);
+			depthTexture.pitch = depthTexture.width * sizeof(std::uint16_t);
+		}
+		else if (frame.depthFrame)
+			depthTexture = ToSoftwareTexture(*frame.depthFrame, GS_R16);
+		else
+			return {};
+	}
+
+	if (!bodyIndexTexture && requireBody)
+	{
+		if (!frame.bodyIndexFrame)
+			return {};
+
+		bodyIndexTexture = ToSoftwareTexture(*frame.bodyIndexFrame, GS_R8);
+	}
+
+	const SoftwareTexture* colorToDepth = (depthMappingTexture) ? &depthMappingTexture : nullptr;
+
+	SoftwareTexture filterTexture;
+	{
+		ObsProfileScope profile("CpuCompositor: greenscreen filter");
+
+		switch (greenScreen.filterType)
+		{
+			case KinectSource::GreenScreenFilterType::Body:
+			{
+				SoftwareGreenScreenFilter::BodyFilterParams filterParams;
+				filterParams.bodyIndexTexture = &bodyIndexTexture;
+				filterParams.colorToDepthTexture = colorToDepth;
+
+				filterTexture = m_greenScreenFilter.Filter(width, height, filterParams);
+				break;
+			}
+
+			case KinectSource::GreenScreenFilterType::BodyOrDepth:
+			{
+				SoftwareGreenScreenFilter::BodyOrDepthFilterParams filterParams;
+				filterParams.bodyIndexTexture = &bodyIndexTexture;
+				filterParams.colorToDepthTexture = colorToDepth;
+				filterParams.depthTexture = &depthTexture;
+				filterParams.maxDepth = greenScreen.depthMax;
+				filterParams.minDepth = greenScreen.depthMin;
+				filterParams.progressiveDepth = greenScreen.fadeDist;
+
+				filterTexture = m_greenScreenFilter.Filter(width, height, filterParams);
+				break;
+			}
+
+			case KinectSource::GreenScreenFilterType::BodyWithinDepth:
+			{
+				SoftwareGreenScreenFilter::BodyWithinDepthFilterParams filterParams;
+				filterParams.bodyIndexTexture = &bodyIndexTexture;
+				filterParams.colorToDepthTexture = colorToDepth;
+				filterParams.depthTexture = &depthTexture;
+				filterParams.maxDepth = greenScreen.depthMax;
+				filterParams.minDepth = greenScreen.depthMin;
+				filterParams.progressiveDepth = greenScreen.fadeDist;
+
+				filterTexture = m_greenScreenFilter.Filter(width, height, filterParams);
+				break;
+			}
+
+			case KinectSource::GreenScreenFilterType::Depth:
+			{
+				SoftwareGreenScreenFilter::DepthFilterParams filterParams;
+				filterParams.colorToDepthTexture = colorToDepth;
+				filterParams.depthTexture = &depthTexture;
+				filterParams.maxDepth = greenScreen.depthMax;
+				filterParams.minDepth = greenScreen.depthMin;
+				filterParams.progressiveDepth = greenScreen.fadeDist;
+
+				filterTexture = m_greenScreenFilter.Filter(width, height, filterParams);
+				break;
+			}
+
+			case KinectSource::GreenScreenFilterType::Dedicated:
+				break; //< Already handled in a branch
+		}
+	}
+
+	if (!filterTexture)
+		return {};
+
+	filterTexture = CleanupMask(filterTexture, params);
+
+	if (greenScreen.blurPassCount > 0)
+	{
+		ObsProfileScope profile("CpuCompositor: mask blur");
+		filterTexture = m_filterBlur.Blur(filterTexture, greenScreen.blurPassCount);
+	}
+
+	SoftwareTexture visibilityMask = m_visibilityMaskImage.Update(params.visibilityMaskPath, frame.timestamp);
+	if (visibilityMask)
+	{
+		ObsProfileScope profile("CpuCompositor: visibility mask");
+		filterTexture = m_visibilityMask.Mask(filterTexture, visibilityMask);
+	}
+
+	return filterTexture;
+}
+
+SoftwareTexture CpuCompositor::ConvertToColor(const std::uint16_t* values, std::uint32_t width, std::uint32_t height, std::uint32_t pitch, float averageValue, float standardDeviation)
+{
+	// Same as color_multiplier.effect
+	float colorMultiplier = float(1.0 / (double(averageValue) * double(standardDeviation)));
+
+	SoftwareTexture renderTarget = PrepareRenderTarget(m_convertMemory, GS_RGBA, width, height);
+
+	const std::uint8_t* input = reinterpret_cast<const std::uint8_t*>(values);
+	ForEachRowBand(m_workerPool.get(), height, [&](std::uint32_t beginRow, std::uint32_t endRow)
+	{
+		for (std::uint32_t y = beginRow; y < endRow; ++y)
+		{
+			const std::uint8_t* inputRow = &input[y * pitch];
+			std::uint8_t* output = &m_convertMemory[y * renderTarget.pitch];
+
+			for (std::uint32_t x = 0; x < width; ++x)
+			{
+				std::uint16_t value;
+				std::memcpy(&value, &inputRow[x * sizeof(std::uint16_t)], sizeof(value));
+
+				std::uint8_t color = ToUnorm8(value / 65535.f * colorMultiplier);
+				output[x * 4 + 0] = color;
+				output[x * 4 + 1] = color;
+				output[x * 4 + 2] = color;
+				output[x * 4 + 3] = 255;
+			}
+		}
+	});
+
+	return renderTarget;
+}
+
+void CpuCompositor::Output(const SoftwareTexture& texture, std::uint64_t timestamp)
+{
+	obs_source_frame outputFrame = {};
+	switch (texture.format)
+	{
+		case GS_RGBA: outputFrame.format = VIDEO_FORMAT_RGBA; break;
+		case GS_BGRA: outputFrame.format = VIDEO_FORMAT_BGRA; break;
+		case GS_BGRX: outputFrame.format = VIDEO_FORMAT_BGRX; break;
+
+		default:
+			throw std::runtime_error("unsupported output format");
+	}
+
+	// Frame content is copied by libobs
+	outputFrame.data[0] = const_cast<std::uint8_t*>(texture.ptr);
+	outputFrame.linesize[0] = texture.pitch;
+	outputFrame.width = texture.width;
+	outputFrame.height = texture.height;
+	outputFrame.timestamp = timestamp;
+
+	obs_source_output_video(m_source, &outputFrame);
+}
+
+void CpuCompositor::Process(const KinectFrame& frame, const Params& params)
+{
+	ObsProfileScope profile("CpuCompositor::Process");
+
+	auto ComputeConversionValues = [&](auto getDynamicValues, const auto& settings)
+	{
+		if (settings.dynamic)
+		{
+			assert(params.derivedDataCache);
+
+			KinectDerivedDataCache::DynamicValues dynValues = (params.derivedDataCache.get()->*getDynamicValues)(frame);
+			return std::make_pair(float(dynValues.average), float(dynValues.standardDeviation));
+		}
+		else
+			return std::make_pair(settings.averageValue, settings.standardDeviation);
+	};
+
+	// Fetch/compute color texture
+	SoftwareTexture sourceTexture;
+	switch (params.sourceType)
+	{
+		case KinectSource::SourceType::Color:
+		{
+			if (!frame.colorFrame)
+				return;
+
+			sourceTexture = ToSoftwareTexture(*frame.colorFrame, frame.colorFrame->format);
+			break;
+		}
+
+		case KinectSource::SourceType::Depth:
+		{
+			if (!frame.depthFrame)
+				return;
+
+			const DepthFrameData& depthFrame = *frame.depthFrame;
+
+			auto [averageValue, standardDeviation] = ComputeConversionValues(&KinectDerivedDataCache::GetDepthDynamicValues, params.depthToColor);
+			sourceTexture = ConvertToColor(depthFrame.ptr.get(), depthFrame.width, depthFrame.height, depthFrame.pitch, averageValue, standardDeviation);
+			break;
+		}
+
+		case KinectSource::SourceType::Infrared:
+		{
+			if (!frame.infraredFrame)
+				return;
+
+			const InfraredFrameData& irFrame = *frame.infraredFrame;
+
+			auto [averageValue, standardDeviation] = ComputeConversionValues(&KinectDerivedDataCache::GetInfraredDynamicValues, params.infraredToColor);
+			sourceTexture = ConvertToColor(irFrame.ptr.get(), irFrame.width, irFrame.height, irFrame.pitch, averageValue, standardDeviation);
+			break;
+		}
+	}
+
+	if (!sourceTexture)
+		return;
+
+	if (!params.greenScreen.enabled)
+	{
+		Output(sourceTexture, frame.timestamp);
+		return;
+	}
+
+	SoftwareTexture filterTexture = ComputeFilter(frame, params, sourceTexture.width, sourceTexture.height);
+	if (!filterTexture)
+		return;
+
+	// Keep the color channel order of the source to benefit from fast paths
+	gs_color_format colorFormat = (sourceTexture.format == GS_BGRA || sourceTexture.format == GS_BGRX) ? GS_BGRA : GS_RGBA;
+	if (!m_colorKernels || m_colorKernels->colorFormat != colorFormat)
+		m_colorKernels.emplace(colorFormat, m_workerPool.get());
+
+	ObsProfileScope effectProfile("CpuCompositor: greenscreen effect");
+
+	SoftwareTexture finalTexture = std::visit([&](auto&& config) -> SoftwareTexture
+	{
+		using C = std::decay_t<decltype(config)>;
+
+		if constexpr (std::is_same_v<C, BlurBackgroundEffect::Config>)
+		{
+			if (config.backgroundBlurPassCount == 0)
+				return sourceTexture;
+
+			SoftwareTexture from = m_colorKernels->backgroundBlur.Blur(sourceTexture, config.backgroundBlurPassCount);
+			SoftwareTexture to = sourceTexture;
+			if (config.reversed)
+				std::swap(from, to);
+
+			return m_colorKernels->textureLerp.Lerp(from, to, filterTexture);
+		}
+		else if constexpr (std::is_same_v<C, RemoveBackgroundEffect::Config>)
+		{
+			return m_colorKernels->alphaMask.Filter(sourceTexture, filterTexture);
+		}
+		else if constexpr (std::is_same_v<C, ReplaceBackgroundEffect::Config>)
+		{
+			SoftwareTexture replacementTexture = m_replacementImage.Update(config.replacementTexturePath, frame.timestamp);
+			if (!replacementTexture)
+				return sourceTexture;
+
+			return m_colorKernels->textureLerp.Lerp(replacementTexture, sourceTexture, filterTexture);
+		}
+		else
+			static_assert(AlwaysFalse<C>::value, "non-exhaustive visitor");
+
+	}, params.greenScreen.effectConfig);
+
+	Output(finalTexture, frame.timestamp);
+}
+
+void CpuCompositor::ResetHistory()
+{
+	m_temporalFilter.Reset();
+}
+
+void CpuCompositor::ThreadFunc()
+{
+	os_set_thread_name("KinectCpuCompositor");
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		m_cv.wait(lock, [&] { return !m_running || m_clearRequested || m_pendingFrame; });
+		if (!m_running)
+			break;
+
+		bool clear = m_clearRequested;
+		m_clearRequested = false;
+
+		KinectFrameConstPtr frame = std::move(m_pendingFrame);
+		std::optional<Params> params = std::move(m_pendingParams);
+		m_pendingFrame.reset();
+		m_pendingParams.reset();
+
+		lock.unlock();
+
+		if (clear)
+		{
+			ResetHistory();
+			obs_source_output_video(m_source, nullptr);
+		}
+
+		if (frame && params)
+		{
+			try
+			{
+				Process(*frame, *params);
+			}
+			catch (const std::exception& e)
+			{
+				warnlog("an error occurred: %s", e.what());
+			}
+		}
+
+		lock.lock();
+	}
+}
+
+CpuCompositor::ColorKernels::ColorKernels(gs_color_format format, WorkerPool* workerPool) :
+colorFormat(format),
+alphaMask(format, workerPool),
+backgroundBlur(format, workerPool),
+textureLerp(format, workerPool)
+{
+}
+
+SoftwareTexture CpuCompositor::SoftwareImage::Update(const std::string& filePath, std::uint64_t timestamp)
+{
+	if (path != filePath)
+	{
+		path = filePath;
+		lastTick = 0;
+
+		if (!path.empty())
+		{
+			// Only decode the image, as no texture is needed
+			imageFile.reset(new gs_image_file_t);
+			gs_image_file_init(imageFile.get(), path.data());
+		}
+		else
+			imageFile.reset();
+	}
+
+	if (!imageFile || !imageFile->loaded)
+		return {};
+
+	const std::uint8_t* imageData = imageFile->texture_data;
+	if (imageFile->is_animated_gif)
+	{
+		if (lastTick == 0)
+			lastTick = timestamp;
+
+		gs_image_file_tick(imageFile.get(), timestamp - lastTick);
+		lastTick = timestamp;
+
+		if (imageFile->animation_frame_cache && imageFile->animation_frame_cache[imageFile->cur_frame])
+			imageData = imageFile->animation_frame_cache[imageFile->cur_frame];
+	}
+
+	if (!imageData)
+		return {};
+
+	SoftwareTexture texture;
+	texture.ptr = imageData;
+	texture.format = imageFile->format;
+	texture.width = imageFile->cx;
+	texture.height = imageFile->cy;
+	texture.pitch = imageFile->cx * GetSoftwareBytesPerPixel(imageFile->format);
+
+	return texture;
+}
@@ -0,0 +1,123 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_CPUCOMPOSITOR
+#define OBS_KINECT_PLUGIN_CPUCOMPOSITOR
+
+#include <obs-kinect-core/KinectFrame.hpp>
+#include <obs-kinect-core/MaskMorphology.hpp>
+#include <obs-kinect-core/TemporalMaskFilter.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareAlphaMask.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareGaussianBlur.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareGreenScreenFilter.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareTextureLerp.hpp>
+#include <obs-kinect-core/SoftwareShaders/SoftwareVisibilityMask.hpp>
+#include <obs-kinect/KinectSource.hpp>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+class KinectDerivedDataCache;
+class WorkerPool;
+
+// Runs the whole KinectSource pipeline on the CPU (on its own thread) and outputs the result as async video frames
+class CpuCompositor
+{
+	public:
+		struct Params
+		{
+			KinectSource::DepthToColorSettings depthToColor;
+			std::shared_ptr<KinectDerivedDataCache> derivedDataCache; //< from the device the frame comes from
+			KinectSource::GreenScreenSettings greenScreen;
+			KinectSource::InfraredToColorSettings infraredToColor;
+			KinectSource::SourceType sourceType = KinectSource::SourceType::Color;
+			std::string visibilityMaskPath;
+		};
+
+		CpuCompositor(obs_source_t* source);
+		CpuCompositor(const CpuCompositor&) = delete;
+		CpuCompositor(CpuCompositor&&) = delete;
+		~CpuCompositor();
+
+		// Stops displaying anything and forgets about previous frames
+		void Clear();
+
+		// Only the latest submitted frame is processed, older pending frames are dropped
+		void Submit(KinectFrameConstPtr frame, Params params);
+
+		CpuCompositor& operator=(const CpuCompositor&) = delete;
+		CpuCompositor& operator=(CpuCompositor&&) = delete;
+
+	private:
+		// CPU-side image file (texture is never created)
+		struct SoftwareImage
+		{
+			SoftwareTexture Update(const std::string& path, std::uint64_t timestamp);
+
+			ObsImageFilePtr imageFile;
+			std::string path;
+			std::uint64_t lastTick = 0;
+		};
+
+		// Kernels outputting the final color format
+		struct ColorKernels
+		{
+			ColorKernels(gs_color_format format, WorkerPool* workerPool);
+
+			gs_color_format colorFormat;
+			SoftwareAlphaMask alphaMask;
+			SoftwareGaussianBlur backgroundBlur;
+			SoftwareTextureLerp textureLerp;
+		};
+
+		SoftwareTexture CleanupMask(const SoftwareTexture& mask, const Params& params);
+		SoftwareTexture ComputeFilter(const KinectFrame& frame, const Params& params, std::uint32_t width, std::uint32_t height);
+		SoftwareTexture ConvertToColor(const std::uint16_t* values, std::uint32_t width, std::uint32_t height, std::uint32_t pitch, float averageValue, float standardDeviation);
+		void Output(const SoftwareTexture& texture, std::uint64_t timestamp);
+		void Process(const KinectFrame& frame, const Params& params);
+		void ResetHistory();
+		void ThreadFunc();
+
+		std::condition_variable m_cv;
+		std::mutex m_mutex;
+		std::optional<ColorKernels> m_colorKernels;
+		std::optional<Params> m_pendingParams;
+		std::shared_ptr<WorkerPool> m_workerPool;
+		std::thread m_thread;
+		std::vector<std::uint8_t> m_convertMemory;
+		std::vector<std::uint8_t> m_maskMemory;
+		KinectFrameConstPtr m_pendingFrame;
+		MaskMorphology m_maskMorphology;
+		SoftwareGaussianBlur m_filterBlur;
+		SoftwareGreenScreenFilter m_greenScreenFilter;
+		SoftwareImage m_replacementImage;
+		SoftwareImage m_visibilityMaskImage;
+		SoftwareVisibilityMask m_visibilityMask;
+		TemporalMaskFilter m_temporalFilter;
+		KinectSource::GreenScreenFilterType m_filterType;
+		obs_source_t* m_source;
+		bool m_clearRequested;
+		bool m_running;
+};
+
+#endif
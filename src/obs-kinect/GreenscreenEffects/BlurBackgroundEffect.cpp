@@ -30,13 +30,14 @@ gs_texture_t* BlurBackgroundEffect::Apply(const Config& config, gs_texture_t* so
 	if (config.backgroundBlurPassCount == 0)
 		return sourceTexture;
 	
-	gs_texture_t* blurredBackground = m_backgroundBlur.Blur(sourceTexture, config.backgroundBlurPassCount);
-	gs_texture_t* from = blurredBackground;
+	RenderTarget blurredBackground = m_backgroundBlur.Blur(sourceTexture, config.backgroundBlurPassCount);
+	gs_texture_t* from = blurredBackground.GetTexture();
 	gs_texture_t* to = sourceTexture;
 	if (config.reversed)
 		std::swap(from, to);
 
-	return m_textureLerp.Lerp(from, to, filterTexture);
+	m_outputTarget = m_textureLerp.Lerp(from, to, filterTexture);
+	return m_outputTarget.GetTexture();
 }
 
 obs_properties_t* BlurBackgroundEffect::BuildProperties()
@@ -47,6 +47,7 @@ class BlurBackgroundEffect
 
 	private:
 		GaussianBlurShader m_backgroundBlur;
+		RenderTarget m_outputTarget;
 		TextureLerpShader m_textureLerp;
 };
 
@@ -22,7 +22,8 @@
 
 gs_texture_t* RemoveBackgroundEffect::Apply(const Config& /*config*/, gs_texture_t* sourceTexture, gs_texture_t* filterTexture)
 {
-	return m_alphaMaskFilter.Filter(sourceTexture, filterTexture);
+	m_outputTarget = m_alphaMaskFilter.Filter(sourceTexture, filterTexture);
+	return m_outputTarget.GetTexture();
 }
 
 obs_properties_t* RemoveBackgroundEffect::BuildProperties()
@@ -43,6 +43,7 @@ class RemoveBackgroundEffect
 
 	private:
 		AlphaMaskShader m_alphaMaskFilter;
+		RenderTarget m_outputTarget;
 };
 
 #endif
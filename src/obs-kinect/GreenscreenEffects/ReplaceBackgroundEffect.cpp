@@ -55,7 +55,8 @@ gs_texture_t* ReplaceBackgroundEffect::Apply(const Config& config, gs_texture_t*
 	m_lastTextureTick = now;
 
 	// Do the lerp
-	return m_textureLerp.Lerp(m_imageFile->texture, sourceTexture, filterTexture);
+	m_outputTarget = m_textureLerp.Lerp(m_imageFile->texture, sourceTexture, filterTexture);
+	return m_outputTarget.GetTexture();
 }
 
 obs_properties_t* ReplaceBackgroundEffect::BuildProperties()
@@ -49,6 +49,7 @@ class ReplaceBackgroundEffect
 		std::string m_texturePath;
 		std::uint64_t m_lastTextureTick;
 		ObsImageFilePtr m_imageFile;
+		RenderTarget m_outputTarget;
 		TextureLerpShader m_textureLerp;
 };
 
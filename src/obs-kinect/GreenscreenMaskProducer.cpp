@@ -0,0 +1,467 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include <obs-kinect/GreenscreenMaskProducer.hpp>
+#include <obs-kinect-core/KinectDerivedDataCache.hpp>
+#include <obs-kinect-core/KinectDevice.hpp>
+#include <obs-kinect/ObsProfileScope.hpp>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+
+namespace
+{
+	std::mutex s_producerMutex;
+	std::map<GreenscreenMaskProducer::Key, std::weak_ptr<GreenscreenMaskProducer>> s_producers;
+
+	auto TieKey(const GreenscreenMaskProducer::Key& key)
+	{
+		return std::tie(key.deviceName, key.sourceType, key.filterType, key.morphologyOperation, key.gpuDepthMapping, key.blurPassCount, key.morphologyRadius, key.temporalFrameCount, key.temporalResetThreshold, key.height, key.width, key.depthMax, key.depthMin, key.fadeDist, key.maxDirtyDepth, key.visibilityMaskPath);
+	}
+}
+
+GreenscreenMaskProducer::GreenscreenMaskProducer(Key key) :
+m_key(std::move(key)),
+m_filterBlur(GS_R8),
+m_mask(nullptr),
+m_lastTextureTick(0),
+m_maskFrameIndex(KinectDevice::InvalidFrameIndex)
+{
+	if (!m_key.visibilityMaskPath.empty())
+	{
+		m_visibilityMaskImage.reset(new gs_image_file_t);
+		gs_image_file_init(m_visibilityMaskImage.get(), m_key.visibilityMaskPath.c_str());
+
+		ObsGraphics gfx;
+		gs_image_file_init_texture(m_visibilityMaskImage.get());
+	}
+}
+
+auto GreenscreenMaskProducer::GetKey() const -> const Key&
+{
+	return m_key;
+}
+
+gs_texture_t* GreenscreenMaskProducer::GetMask(std::uint64_t frameIndex) const
+{
+	if (m_maskFrameIndex != frameIndex)
+		return nullptr;
+
+	return m_mask;
+}
+
+gs_texture_t* GreenscreenMaskProducer::Produce(const KinectFrame& frame, KinectDerivedDataCache& derivedDataCache, gs_texture_t* sourceDepthTexture)
+{
+	// Previous mask is no longer needed, give its target back to the pool before rendering the new one
+	m_maskTarget.Reset();
+	m_mask = nullptr;
+	m_maskFrameIndex = KinectDevice::InvalidFrameIndex;
+
+	gs_texture_t* mask;
+	if (m_key.filterType == KinectSource::GreenScreenFilterType::Dedicated)
+	{
+		if (!frame.backgroundRemovalFrame)
+			return nullptr;
+
+		mask = ProduceDedicated(*frame.backgroundRemovalFrame);
+	}
+	else
+	{
+		FilterInputs inputs;
+		if (!UploadFilterInputs(frame, derivedDataCache, sourceDepthTexture, inputs))
+			return nullptr;
+
+		mask = ProduceFiltered(inputs);
+		if (!mask)
+			return nullptr;
+
+		if (m_visibilityMaskImage && m_visibilityMaskImage->texture)
+		{
+			// Update animated textures, if any
+			std::uint64_t now = obs_get_video_frame_time();
+			if (m_lastTextureTick == 0)
+				m_lastTextureTick = now;
+
+			if (gs_image_file_tick(m_visibilityMaskImage.get(), now - m_lastTextureTick))
+				gs_image_file_update_texture(m_visibilityMaskImage.get());
+
+			m_lastTextureTick = now;
+
+			ObsProfileScope profile("GreenscreenMaskProducer: visibility mask (GPU submission)");
+			m_maskTarget = m_visibilityMaskEffect.Mask(mask, m_visibilityMaskImage->texture);
+			mask = m_maskTarget.GetTexture();
+		}
+	}
+
+	m_mask = mask;
+	m_maskFrameIndex = frame.frameIndex;
+
+	return m_mask;
+}
+
+std::shared_ptr<GreenscreenMaskProducer> GreenscreenMaskProducer::Acquire(Key key)
+{
+	std::lock_guard<std::mutex> lock(s_producerMutex);
+
+	// Forget about producers no longer used by any source
+	for (auto it = s_producers.begin(); it != s_producers.end();)
+	{
+		if (it->second.expired())
+			it = s_producers.erase(it);
+		else
+			++it;
+	}
+
+	std::weak_ptr<GreenscreenMaskProducer>& producerRef = s_producers[key];
+
+	std::shared_ptr<GreenscreenMaskProducer> producer = producerRef.lock();
+	if (!producer)
+	{
+		producer = std::make_shared<GreenscreenMaskProducer>(std::move(key));
+		producerRef = producer;
+	}
+
+	return producer;
+}
+
+auto GreenscreenMaskProducer::BuildKey(const std::string& deviceName, std::uint32_t width, std::uint32_t height, KinectSource::SourceType sourceType, const KinectSource::GreenScreenSettings& settings, const std::string& visibilityMaskPath) -> Key
+{
+	Key key;
+	key.deviceName = deviceName;
+	key.height = height;
+	key.width = width;
+	key.sourceType = sourceType;
+	key.filterType = settings.filterType;
+	key.morphologyOperation = settings.morphologyOperation;
+	key.morphologyRadius = settings.morphologyRadius;
+	key.temporalFrameCount = settings.temporalFrameCount;
+	key.temporalResetThreshold = settings.temporalResetThreshold;
+
+	// Settings which don't apply to the dedicated filter are left to their default values, so they don't prevent sharing
+	if (settings.filterType != KinectSource::GreenScreenFilterType::Dedicated)
+	{
+		key.blurPassCount = settings.blurPassCount;
+		key.depthMax = settings.depthMax;
+		key.depthMin = settings.depthMin;
+		key.fadeDist = settings.fadeDist;
+		key.gpuDepthMapping = settings.gpuDepthMapping;
+		key.maxDirtyDepth = settings.maxDirtyDepth;
+		key.visibilityMaskPath = visibilityMaskPath;
+	}
+
+	return key;
+}
+
+void GreenscreenMaskProducer::ForgetDevice(const std::string& deviceName)
+{
+	std::lock_guard<std::mutex> lock(s_producerMutex);
+
+	for (auto it = s_producers.begin(); it != s_producers.end();)
+	{
+		if (it->first.deviceName == deviceName)
+			it = s_producers.erase(it);
+		else
+			++it;
+	}
+}
+
+float GreenscreenMaskProducer::ComputeTemporalHistoryFactor() const
+{
+	// Exponential moving average spanning N frames (alpha = 2 / (N + 1))
+	float frameCount = float(m_key.temporalFrameCount);
+	return (frameCount - 1.f) / (frameCount + 1.f);
+}
+
+gs_texture_t* GreenscreenMaskProducer::ProduceDedicated(const BackgroundRemovalFrameData& backgroundRemovalFrame)
+{
+	auto UpdateTexture = [&](std::uint32_t pitch, const std::uint8_t* content)
+	{
+		std::uint32_t width = backgroundRemovalFrame.width;
+		std::uint32_t height = backgroundRemovalFrame.height;
+
+		gs_texture_t* texPtr = m_backgroundRemovalTexture.get();
+		if (!texPtr || width != gs_texture_get_width(texPtr) || height != gs_texture_get_height(texPtr))
+		{
+			std::vector<std::uint8_t> packedMemory;
+			if (pitch != width)
+			{
+				packedMemory.resize(std::size_t(width) * height);
+				for (std::uint32_t y = 0; y < height; ++y)
+					std::memcpy(&packedMemory[y * width], &content[y * pitch], width);
+
+				content = packedMemory.data();
+			}
+
+			m_backgroundRemovalTexture.reset(gs_texture_create(width, height, GS_R8, 1, &content, GS_DYNAMIC));
+			if (!m_backgroundRemovalTexture)
+				throw std::runtime_error("failed to create texture");
+		}
+		else
+		{
+			std::uint8_t* ptr;
+			std::uint32_t texPitch;
+			if (!gs_texture_map(texPtr, &ptr, &texPitch))
+				throw std::runtime_error("failed to map texture");
+
+			for (std::uint32_t y = 0; y < height; ++y)
+				std::memcpy(ptr + y * texPitch, &content[y * pitch], width);
+
+			gs_texture_unmap(texPtr);
+		}
+	};
+
+	bool morphologyEnabled = (m_key.morphologyOperation != MorphologyOperation::None);
+	bool temporalEnabled = (m_key.temporalFrameCount > 1);
+
+	if (morphologyEnabled || temporalEnabled)
+	{
+		// Dedicated mask comes from the CPU, clean it up before uploading it
+		m_backgroundRemovalMemory.resize(backgroundRemovalFrame.width * backgroundRemovalFrame.height);
+
+		const std::uint8_t* maskPtr = backgroundRemovalFrame.ptr.get();
+		std::uint32_t maskPitch = backgroundRemovalFrame.pitch;
+
+		if (morphologyEnabled)
+		{
+			ObsProfileScope profile("GreenscreenMaskProducer: mask morphology (CPU)");
+
+			m_backgroundRemovalMorphology.Apply(m_key.morphologyOperation, m_key.morphologyRadius, maskPtr, maskPitch, m_backgroundRemovalMemory.data(), backgroundRemovalFrame.width, backgroundRemovalFrame.width, backgroundRemovalFrame.height);
+			maskPtr = m_backgroundRemovalMemory.data();
+			maskPitch = backgroundRemovalFrame.width;
+		}
+
+		if (temporalEnabled)
+		{
+			ObsProfileScope profile("GreenscreenMaskProducer: temporal mask filter (CPU)");
+
+			m_backgroundRemovalTemporalFilter.Apply(ComputeTemporalHistoryFactor(), m_key.temporalResetThreshold, maskPtr, maskPitch, m_backgroundRemovalMemory.data(), backgroundRemovalFrame.width, backgroundRemovalFrame.width, backgroundRemovalFrame.height);
+		}
+
+		UpdateTexture(backgroundRemovalFrame.width, m_backgroundRemovalMemory.data());
+	}
+	else
+		UpdateTexture(backgroundRemovalFrame.pitch, backgroundRemovalFrame.ptr.get());
+
+	return m_backgroundRemovalTexture.get();
+}
+
+gs_texture_t* GreenscreenMaskProducer::ProduceFiltered(const FilterInputs& inputs)
+{
+	std::uint32_t width = m_key.width;
+	std::uint32_t height = m_key.height;
+
+	// Intermediate targets are given back to the pool as soon as the next step has been rendered
+	{
+		ObsProfileScope profile("GreenscreenMaskProducer: greenscreen filter (GPU submission)");
+
+		switch (m_key.filterType)
+		{
+			case KinectSource::GreenScreenFilterType::Body:
+			{
+				GreenScreenFilterShader::BodyFilterParams filterParams;
+				filterParams.bodyIndexTexture = inputs.bodyIndexTexture;
+				filterParams.colorToDepthTexture = inputs.depthMappingTexture;
+
+				m_maskTarget = m_greenScreenFilterEffect.Filter(width, height, filterParams);
+				break;
+			}
+
+			case KinectSource::GreenScreenFilterType::BodyOrDepth:
+			{
+				GreenScreenFilterShader::BodyOrDepthFilterParams filterParams;
+				filterParams.bodyIndexTexture = inputs.bodyIndexTexture;
+				filterParams.colorToDepthTexture = inputs.depthMappingTexture;
+				filterParams.depthTexture = inputs.depthTexture;
+				filterParams.maxDepth = m_key.depthMax;
+				filterParams.minDepth = m_key.depthMin;
+				filterParams.progressiveDepth = m_key.fadeDist;
+
+				m_maskTarget = m_greenScreenFilterEffect.Filter(width, height, filterParams);
+				break;
+			}
+
+			case KinectSource::GreenScreenFilterType::BodyWithinDepth:
+			{
+				GreenScreenFilterShader::BodyWithinDepthFilterParams filterParams;
+				filterParams.bodyIndexTexture = inputs.bodyIndexTexture;
+				filterParams.colorToDepthTexture = inputs.depthMappingTexture;
+				filterParams.depthTexture = inputs.depthTexture;
+				filterParams.maxDepth = m_key.depthMax;
+				filterParams.minDepth = m_key.depthMin;
+				filterParams.progressiveDepth = m_key.fadeDist;
+
+				m_maskTarget = m_greenScreenFilterEffect.Filter(width, height, filterParams);
+				break;
+			}
+
+			case KinectSource::GreenScreenFilterType::Depth:
+			{
+				GreenScreenFilterShader::DepthFilterParams filterParams;
+				filterParams.colorToDepthTexture = inputs.depthMappingTexture;
+				filterParams.depthTexture = inputs.depthTexture;
+				filterParams.maxDepth = m_key.depthMax;
+				filterParams.minDepth = m_key.depthMin;
+				filterParams.progressiveDepth = m_key.fadeDist;
+
+				m_maskTarget = m_greenScreenFilterEffect.Filter(width, height, filterParams);
+				break;
+			}
+
+			case KinectSource::GreenScreenFilterType::Dedicated:
+				break; //< Handled by ProduceDedicated
+		}
+	}
+
+	gs_texture_t* mask = m_maskTarget.GetTexture();
+	if (!mask)
+		return nullptr;
+
+	if (m_key.morphologyOperation != MorphologyOperation::None)
+	{
+		ObsProfileScope profile("GreenscreenMaskProducer: mask morphology (GPU submission)");
+
+		m_maskTarget = m_filterMorphology.Apply(mask, m_key.morphologyOperation, m_key.morphologyRadius);
+		mask = m_maskTarget.GetTexture();
+		if (!mask)
+			return nullptr;
+	}
+
+	if (m_key.temporalFrameCount > 1)
+	{
+		ObsProfileScope profile("GreenscreenMaskProducer: temporal mask filter (GPU submission)");
+
+		mask = m_filterTemporal.Filter(mask, ComputeTemporalHistoryFactor(), m_key.temporalResetThreshold);
+		m_maskTarget.Reset(); //< Temporal filter renders to its own history
+		if (!mask)
+			return nullptr;
+	}
+
+	if (m_key.blurPassCount > 0)
+	{
+		ObsProfileScope profile("GreenscreenMaskProducer: mask blur (GPU submission)");
+		m_maskTarget = m_filterBlur.Blur(mask, m_key.blurPassCount);
+		mask = m_maskTarget.GetTexture();
+	}
+
+	return mask;
+}
+
+bool GreenscreenMaskProducer::UploadFilterInputs(const KinectFrame& frame, KinectDerivedDataCache& derivedDataCache, gs_texture_t* sourceDepthTexture, FilterInputs& inputs)
+{
+	bool requireBody = KinectSource::DoesRequireBodyFrame(m_key.filterType);
+	bool requireDepth = KinectSource::DoesRequireDepthFrame(m_key.filterType);
+
+	bool isDepthColorMapped = frame.colorMappedDepthFrame.has_value();
+	bool softwareDepthMapping = (m_key.sourceType == KinectSource::SourceType::Color) && (!m_key.gpuDepthMapping || m_key.maxDirtyDepth > 0);
+
+	if (requireDepth && !softwareDepthMapping && !isDepthColorMapped)
+	{
+		if (sourceDepthTexture)
+			inputs.depthTexture = sourceDepthTexture;
+		else
+		{
+			if (!frame.depthFrame)
+				return false;
+
+			const DepthFrameData& depthFrame = *frame.depthFrame;
+			KinectSource::UpdateTexture(m_depthTexture, GS_R16, depthFrame.width, depthFrame.height, depthFrame.pitch, depthFrame.ptr.get());
+			inputs.depthTexture = m_depthTexture.get();
+		}
+	}
+
+	// All green screen types (except depth/dedicated) require body index texture
+	if (requireBody && !softwareDepthMapping)
+	{
+		if (!frame.bodyIndexFrame)
+			return false;
+
+		const BodyIndexFrameData& bodyIndexFrame = *frame.bodyIndexFrame;
+		KinectSource::UpdateTexture(m_bodyIndexTexture, GS_R8, bodyIndexFrame.width, bodyIndexFrame.height, bodyIndexFrame.pitch, bodyIndexFrame.ptr.get());
+		inputs.bodyIndexTexture = m_bodyIndexTexture.get();
+	}
+
+	if (m_key.sourceType != KinectSource::SourceType::Color)
+		return true;
+
+	// Handle CPU|GPU depth mapping + dirty depth values
+	if (frame.colorMappedDepthFrame)
+	{
+		const DepthFrameData& mappedDepthFrame = *frame.colorMappedDepthFrame;
+
+		KinectSource::UpdateTexture(m_depthTexture, GS_R16, mappedDepthFrame.width, mappedDepthFrame.height, mappedDepthFrame.width * sizeof(std::uint16_t), mappedDepthFrame.ptr.get());
+		inputs.depthMappingTexture = nullptr;
+		inputs.depthTexture = m_depthTexture.get();
+	}
+	else if (!frame.depthMappingFrame)
+		return false;
+	else if (softwareDepthMapping)
+	{
+		if (!frame.colorFrame || !frame.depthFrame)
+			return false;
+
+		ObsProfileScope profile("GreenscreenMaskProducer: software depth mapping");
+
+		const ColorFrameData& colorFrame = *frame.colorFrame;
+
+		// Mapping is shared with other producers of the device using the same settings
+		KinectDerivedDataCache::MappedDepth mappedDepth = derivedDataCache.GetMappedDepth(frame, m_key.maxDirtyDepth);
+
+		KinectSource::UpdateTexture(m_depthMappingTexture, GS_R16, colorFrame.width, colorFrame.height, colorFrame.width * sizeof(std::uint16_t), mappedDepth->data());
+		inputs.depthMappingTexture = nullptr;
+		inputs.depthTexture = m_depthMappingTexture.get();
+
+		if (requireBody)
+		{
+			if (!frame.bodyIndexFrame)
+				return false;
+
+			// Map body info as well
+			KinectDerivedDataCache::MappedBodyIndex mappedBodyIndex = derivedDataCache.GetMappedBodyIndex(frame, m_key.maxDirtyDepth);
+
+			KinectSource::UpdateTexture(m_bodyIndexTexture, GS_R8, colorFrame.width, colorFrame.height, colorFrame.width * sizeof(std::uint8_t), mappedBodyIndex->data());
+			inputs.bodyIndexTexture = m_bodyIndexTexture.get();
+		}
+		// Unused mapping memory is reclaimed by the cache
+	}
+	else
+	{
+		const DepthMappingFrameData& depthMappingFrame = *frame.depthMappingFrame;
+
+		KinectSource::UpdateTexture(m_depthMappingTexture, GS_RG32F, depthMappingFrame.width, depthMappingFrame.height, depthMappingFrame.pitch, depthMappingFrame.ptr.get());
+		inputs.depthMappingTexture = m_depthMappingTexture.get();
+	}
+
+	return true;
+}
+
+bool GreenscreenMaskProducer::Key::operator==(const Key& key) const
+{
+	return TieKey(*this) == TieKey(key);
+}
+
+bool GreenscreenMaskProducer::Key::operator!=(const Key& key) const
+{
+	return !operator==(key);
+}
+
+bool GreenscreenMaskProducer::Key::operator<(const Key& key) const
+{
+	return TieKey(*this) < TieKey(key);
+}
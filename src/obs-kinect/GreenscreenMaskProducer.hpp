@@ -0,0 +1,128 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_GREENSCREENMASKPRODUCER
+#define OBS_KINECT_PLUGIN_GREENSCREENMASKPRODUCER
+
+#include <obs-kinect-core/KinectFrame.hpp>
+#include <obs-kinect-core/MaskMorphology.hpp>
+#include <obs-kinect-core/TemporalMaskFilter.hpp>
+#include <obs-kinect/KinectSource.hpp>
+#include <obs-kinect/RenderTargetPool.hpp>
+#include <obs-kinect/Shaders/GaussianBlurShader.hpp>
+#include <obs-kinect/Shaders/GreenScreenFilterShader.hpp>
+#include <obs-kinect/Shaders/MorphologyShader.hpp>
+#include <obs-kinect/Shaders/TemporalFilterShader.hpp>
+#include <obs-kinect/Shaders/VisibilityMaskShader.hpp>
+#include <obs-module.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class KinectDerivedDataCache;
+
+// Runs the GPU greenscreen mask chain (filter, morphology, temporal filter, blur and visibility mask)
+// Producers are shared by all sources (and mask filters) of a device using the same mask settings, which allows them to upload the frames
+// and compute a mask only once per frame and to run only their own background effect (must be used with the graphics context).
+class GreenscreenMaskProducer
+{
+	public:
+		struct Key;
+
+		GreenscreenMaskProducer(Key key);
+		GreenscreenMaskProducer(const GreenscreenMaskProducer&) = delete;
+		GreenscreenMaskProducer(GreenscreenMaskProducer&&) = delete;
+		~GreenscreenMaskProducer() = default;
+
+		const Key& GetKey() const;
+		gs_texture_t* GetMask(std::uint64_t frameIndex) const; //< nullptr if the mask of this frame hasn't been produced yet
+
+		gs_texture_t* Produce(const KinectFrame& frame, KinectDerivedDataCache& derivedDataCache, gs_texture_t* sourceDepthTexture = nullptr); //< sourceDepthTexture: depth frame already uploaded by the caller, if any
+
+		GreenscreenMaskProducer& operator=(const GreenscreenMaskProducer&) = delete;
+		GreenscreenMaskProducer& operator=(GreenscreenMaskProducer&&) = delete;
+
+		// Returns the producer currently used for this key, or a new one
+		static std::shared_ptr<GreenscreenMaskProducer> Acquire(Key key);
+		static Key BuildKey(const std::string& deviceName, std::uint32_t width, std::uint32_t height, KinectSource::SourceType sourceType, const KinectSource::GreenScreenSettings& settings, const std::string& visibilityMaskPath);
+
+		// Producers of a removed device are kept by their sources until they release it, a device added back under the same name gets new ones
+		static void ForgetDevice(const std::string& deviceName);
+
+		// Every setting affecting the mask (but not the effect applied using it)
+		struct Key
+		{
+			std::string deviceName; //< registry name, device addresses may be reused after a refresh
+			KinectSource::SourceType sourceType = KinectSource::SourceType::Color;
+			KinectSource::GreenScreenFilterType filterType = KinectSource::GreenScreenFilterType::Depth;
+			MorphologyOperation morphologyOperation = MorphologyOperation::None;
+			bool gpuDepthMapping = true;
+			std::size_t blurPassCount = 0;
+			std::size_t morphologyRadius = 0;
+			std::size_t temporalFrameCount = 1;
+			float temporalResetThreshold = 0.f;
+			std::uint32_t height = 0; //< mask size, accesses with a different output size get different frames
+			std::uint32_t width = 0;
+			std::uint16_t depthMax = 0;
+			std::uint16_t depthMin = 0;
+			std::uint16_t fadeDist = 0;
+			std::uint8_t maxDirtyDepth = 0;
+			std::string visibilityMaskPath;
+
+			bool operator==(const Key& key) const;
+			bool operator!=(const Key& key) const;
+			bool operator<(const Key& key) const;
+		};
+
+	private:
+		struct FilterInputs
+		{
+			gs_texture_t* bodyIndexTexture = nullptr;
+			gs_texture_t* depthMappingTexture = nullptr;
+			gs_texture_t* depthTexture = nullptr;
+		};
+
+		float ComputeTemporalHistoryFactor() const;
+		gs_texture_t* ProduceDedicated(const BackgroundRemovalFrameData& backgroundRemovalFrame);
+		gs_texture_t* ProduceFiltered(const FilterInputs& inputs);
+		bool UploadFilterInputs(const KinectFrame& frame, KinectDerivedDataCache& derivedDataCache, gs_texture_t* sourceDepthTexture, FilterInputs& inputs);
+
+		Key m_key;
+		std::vector<std::uint8_t> m_backgroundRemovalMemory;
+		GaussianBlurShader m_filterBlur;
+		GreenScreenFilterShader m_greenScreenFilterEffect;
+		MaskMorphology m_backgroundRemovalMorphology;
+		MorphologyShader m_filterMorphology;
+		TemporalFilterShader m_filterTemporal;
+		TemporalMaskFilter m_backgroundRemovalTemporalFilter;
+		VisibilityMaskShader m_visibilityMaskEffect;
+		ObsImageFilePtr m_visibilityMaskImage;
+		ObsTexturePtr m_backgroundRemovalTexture;
+		ObsTexturePtr m_bodyIndexTexture;
+		ObsTexturePtr m_depthMappingTexture;
+		ObsTexturePtr m_depthTexture;
+		RenderTarget m_maskTarget;
+		gs_texture_t* m_mask;
+		std::uint64_t m_lastTextureTick;
+		std::uint64_t m_maskFrameIndex;
+};
+
+#endif
@@ -16,24 +16,66 @@
 ******************************************************************************/
 
 #include <obs-kinect/KinectDeviceRegistry.hpp>
+#include <obs-kinect/GreenscreenMaskProducer.hpp>
+#include <obs-kinect/KinectMaskFilter.hpp>
 #include <obs-kinect/KinectSource.hpp>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <limits>
 
-void KinectDeviceRegistry::ForEachDevice(const Callback& callback) const
+KinectDeviceRegistry::~KinectDeviceRegistry()
 {
-	for (const auto& pluginData : m_plugins)
+	std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+	// Plugins can't be interrupted, wait for them before unloading
+	for (auto& pluginDataPtr : m_plugins)
 	{
-		const std::string& pluginName = pluginData.plugin.GetUniqueName();
-		for (const auto& deviceData : pluginData.devices)
+		if (pluginDataPtr->taskThread.joinable())
+			pluginDataPtr->taskThread.join();
+
+		// Hotplug callbacks reference plugin data which is destroyed before the plugin
+		if (pluginDataPtr->isLoaded)
+			pluginDataPtr->plugin.SetHotplugCallback({});
+	}
+}
+
+void KinectDeviceRegistry::ForEachDevice(const Callback& callback)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+	if (ProcessTaskResults())
+		RefreshSourcesWithoutDevice();
+
+	m_iterationCounter++;
+	for (const auto& pluginDataPtr : m_plugins)
+	{
+		// Plugin name is only known once it has been loaded
+		if (!pluginDataPtr->isLoaded)
+			continue;
+
+		const std::string& pluginName = pluginDataPtr->plugin.GetUniqueName();
+		for (const auto& deviceData : pluginDataPtr->devices)
 		{
 			if (!callback(pluginName, deviceData.uniqueName, *deviceData.device))
+			{
+				m_iterationCounter--;
 				return;
+			}
 		}
 	}
+	m_iterationCounter--;
 }
 
-KinectDevice* KinectDeviceRegistry::GetDevice(const std::string& deviceName) const
+KinectDevice* KinectDeviceRegistry::GetDevice(const std::string& deviceName)
 {
+	std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+	if (ProcessTaskResults())
+		RefreshSourcesWithoutDevice();
+
 	auto it = m_deviceByName.find(deviceName);
 	if (it == m_deviceByName.end())
 		return nullptr;
@@ -41,52 +83,310 @@ KinectDevice* KinectDeviceRegistry::GetDevice(const std::string& deviceName) con
 	return it->second;
 }
 
+void KinectDeviceRegistry::ProcessHotplugEvents()
+{
+	std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+	bool hasNewDevices = ProcessTaskResults();
+
+	for (auto& pluginDataPtr : m_plugins)
+	{
+		PluginData& pluginData = *pluginDataPtr;
+
+		// A plugin already refreshing will be refreshed again on the next call
+		if (pluginData.isLoaded && !pluginData.isTaskRunning && pluginData.hotplugPending.exchange(false))
+			StartTask(pluginData, false);
+	}
+
+	if (hasNewDevices)
+		RefreshSourcesWithoutDevice();
+}
+
 void KinectDeviceRegistry::Refresh()
 {
-	for (KinectSource* source : m_sources)
-		source->ClearDeviceAccess();
+	std::lock_guard<std::recursive_mutex> lock(m_lock);
 
-	m_deviceByName.clear();
+	ProcessTaskResults();
 
-	for (auto& pluginData : m_plugins)
+	for (auto& pluginDataPtr : m_plugins)
 	{
-		pluginData.devices.clear();
+		PluginData& pluginData = *pluginDataPtr;
+		if (pluginData.isLoaded && !pluginData.isTaskRunning)
+		{
+			pluginData.hotplugPending = false;
+			StartTask(pluginData, false);
+		}
+	}
+
+	WaitForPlugins();
+}
 
-		for (auto& devicePtr : pluginData.plugin.Refresh())
+void KinectDeviceRegistry::RegisterPlugin(std::string path)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+	auto& pluginDataPtr = m_plugins.emplace_back(std::make_unique<PluginData>());
+	pluginDataPtr->path = std::move(path);
+
+	StartTask(*pluginDataPtr, true);
+}
+
+void KinectDeviceRegistry::SetDeviceServiceSettings(const std::string& deviceName, const KinectDevice::ServiceSettings& serviceSettings)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+	m_serviceSettings[deviceName] = serviceSettings;
+
+	auto it = m_deviceByName.find(deviceName);
+	if (it != m_deviceByName.end())
+		it->second->SetServiceSettings(serviceSettings);
+}
+
+void KinectDeviceRegistry::WaitForPlugins()
+{
+	std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+	for (;;)
+	{
+		ProcessTaskResults();
+
+		std::uint64_t now = os_gettime_ns();
+		std::uint64_t nextDeadline = std::numeric_limits<std::uint64_t>::max();
+		for (auto& pluginDataPtr : m_plugins)
 		{
-			auto& deviceData = pluginData.devices.emplace_back();
-			deviceData.device = std::move(devicePtr);
-			deviceData.uniqueName = pluginData.plugin.GetUniqueName() + "_" + deviceData.device->GetUniqueName();
+			PluginData& pluginData = *pluginDataPtr;
+			if (!pluginData.isTaskRunning || pluginData.hasTimedOut)
+				continue;
+
+			std::uint64_t deadline = pluginData.taskStartTime + TaskTimeout;
+			if (now >= deadline)
+			{
+				warnlog("%s is taking too long to enumerate its devices, they will be added when it's done", pluginData.path.c_str());
+				pluginData.hasTimedOut = true;
+				continue;
+			}
 
-			assert(m_deviceByName.find(deviceData.uniqueName) == m_deviceByName.end());
-			m_deviceByName.emplace(deviceData.uniqueName, deviceData.device.get());
+			nextDeadline = std::min(nextDeadline, deadline);
 		}
+
+		if (nextDeadline == std::numeric_limits<std::uint64_t>::max())
+			break;
+
+		std::unique_lock<std::mutex> taskLock(m_taskMutex);
+		m_taskCv.wait_for(taskLock, std::chrono::nanoseconds(nextDeadline - now), [&]
+		{
+			return std::any_of(m_plugins.begin(), m_plugins.end(), [](const auto& pluginDataPtr)
+			{
+				return pluginDataPtr->isTaskRunning && pluginDataPtr->taskResult.has_value();
+			});
+		});
 	}
 
-	for (KinectSource* source : m_sources)
-		source->RefreshDeviceAccess();
+	RefreshSourcesWithoutDevice();
 }
 
-bool KinectDeviceRegistry::RegisterPlugin(const std::string& path)
+bool KinectDeviceRegistry::ProcessTaskResults()
 {
-	KinectPlugin newPlugin;
-	if (!newPlugin.Open(path))
+	if (m_iterationCounter > 0)
 		return false;
 
-	auto& pluginEntry = m_plugins.emplace_back();
-	pluginEntry.plugin = std::move(newPlugin);
+	bool hasNewDevices = false;
+	for (auto& pluginDataPtr : m_plugins)
+	{
+		PluginData& pluginData = *pluginDataPtr;
+		if (!pluginData.isTaskRunning)
+			continue;
+
+		std::optional<TaskResult> result;
+		{
+			std::unique_lock<std::mutex> lock(m_taskMutex);
+			if (!pluginData.taskResult)
+				continue;
+
+			result = std::move(pluginData.taskResult);
+			pluginData.taskResult.reset();
+		}
+
+		pluginData.taskThread.join();
+		pluginData.isTaskRunning = false;
+
+		if (!pluginData.isLoaded && pluginData.plugin.IsOpen())
+		{
+			pluginData.isLoaded = true;
+			pluginData.plugin.SetHotplugCallback([hotplugPending = &pluginData.hotplugPending]
+			{
+				*hotplugPending = true;
+			});
+		}
+
+		if (!result->success)
+			continue;
+
+		if (pluginData.hasTimedOut)
+			infolog("%s finished enumerating its devices", pluginData.path.c_str());
 
-	return true;
+		if (UpdateDevices(pluginData, std::move(result->devices)))
+			hasNewDevices = true;
+	}
+
+	return hasNewDevices;
+}
+
+void KinectDeviceRegistry::RefreshSourcesWithoutDevice()
+{
+	// Refreshing access to a device restarts it, leave sources which already have one alone
+	auto RefreshWithoutDevice = [](auto& users)
+	{
+		for (auto* user : users)
+		{
+			if (!user->m_deviceAccess)
+				user->RefreshDeviceAccess();
+		}
+	};
+
+	m_iterationCounter++;
+	RefreshWithoutDevice(m_sources);
+	RefreshWithoutDevice(m_maskFilters);
+	m_iterationCounter--;
+}
+
+void KinectDeviceRegistry::RegisterMaskFilter(KinectMaskFilter* maskFilter)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+	assert(m_maskFilters.find(maskFilter) == m_maskFilters.end());
+	m_maskFilters.insert(maskFilter);
 }
 
 void KinectDeviceRegistry::RegisterSource(KinectSource* source)
 {
+	std::lock_guard<std::recursive_mutex> lock(m_lock);
+
 	assert(m_sources.find(source) == m_sources.end());
 	m_sources.insert(source);
 }
 
+void KinectDeviceRegistry::StartTask(PluginData& pluginData, bool openPlugin)
+{
+	assert(!pluginData.isTaskRunning);
+
+	pluginData.hasTimedOut = false;
+	pluginData.isTaskRunning = true;
+	pluginData.taskStartTime = os_gettime_ns();
+	pluginData.taskThread = std::thread([this, &pluginData, openPlugin]
+	{
+		os_set_thread_name("KinectPluginLoader");
+
+		TaskResult result;
+		result.success = false;
+
+		try
+		{
+			// Plugins missing from this build fail to open, this isn't an error
+			if (!openPlugin || pluginData.plugin.Open(pluginData.path))
+			{
+				result.devices = pluginData.plugin.Refresh();
+				result.success = true;
+			}
+		}
+		catch (const std::exception& e)
+		{
+			warnlog("%s: failed to retrieve devices: %s", pluginData.path.c_str(), e.what());
+			result.devices.clear();
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(m_taskMutex);
+			pluginData.taskResult = std::move(result);
+		}
+		m_taskCv.notify_all();
+	});
+}
+
+void KinectDeviceRegistry::UnregisterMaskFilter(KinectMaskFilter* maskFilter)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+	assert(m_maskFilters.find(maskFilter) != m_maskFilters.end());
+	m_maskFilters.erase(maskFilter);
+}
+
 void KinectDeviceRegistry::UnregisterSource(KinectSource* source)
 {
+	std::lock_guard<std::recursive_mutex> lock(m_lock);
+
 	assert(m_sources.find(source) != m_sources.end());
 	m_sources.erase(source);
 }
+
+bool KinectDeviceRegistry::UpdateDevices(PluginData& pluginData, std::vector<std::unique_ptr<KinectDevice>> devices)
+{
+	// Devices still present are kept as they may be in use, the newly enumerated instance is discarded
+	std::vector<PluginData::Device> previousDevices = std::move(pluginData.devices);
+	pluginData.devices.clear();
+
+	bool hasNewDevices = false;
+	for (auto& devicePtr : devices)
+	{
+		std::string uniqueName = pluginData.plugin.GetUniqueName() + "_" + devicePtr->GetUniqueName();
+
+		auto it = std::find_if(previousDevices.begin(), previousDevices.end(), [&](const PluginData::Device& deviceData) { return deviceData.uniqueName == uniqueName; });
+		if (it != previousDevices.end())
+		{
+			pluginData.devices.push_back(std::move(*it));
+			previousDevices.erase(it);
+			continue;
+		}
+
+		if (m_deviceByName.find(uniqueName) != m_deviceByName.end())
+		{
+			warnlog("%s: device %s has been enumerated twice, ignoring it", pluginData.path.c_str(), uniqueName.c_str());
+			continue;
+		}
+
+		infolog("new device %s", uniqueName.c_str());
+
+		auto& deviceData = pluginData.devices.emplace_back();
+		deviceData.device = std::move(devicePtr);
+		deviceData.uniqueName = std::move(uniqueName);
+
+		m_deviceByName.emplace(deviceData.uniqueName, deviceData.device.get());
+
+		if (auto settingsIt = m_serviceSettings.find(deviceData.uniqueName); settingsIt != m_serviceSettings.end())
+			deviceData.device->SetServiceSettings(settingsIt->second);
+
+		hasNewDevices = true;
+	}
+
+	if (!previousDevices.empty())
+	{
+		for (const auto& deviceData : previousDevices)
+		{
+			infolog("device %s is no longer available", deviceData.uniqueName.c_str());
+			m_deviceByName.erase(deviceData.uniqueName);
+
+			GreenscreenMaskProducer::ForgetDevice(deviceData.uniqueName);
+		}
+
+		// Sources (and mask filters) must release removed devices before they get destroyed
+		auto RefreshRemovedDevices = [&](auto& users)
+		{
+			for (auto* user : users)
+			{
+				if (!user->m_deviceAccess)
+					continue;
+
+				const KinectDevice* device = &user->m_deviceAccess->GetDevice();
+				if (std::any_of(previousDevices.begin(), previousDevices.end(), [&](const PluginData::Device& deviceData) { return deviceData.device.get() == device; }))
+					user->RefreshDeviceAccess();
+			}
+		};
+
+		m_iterationCounter++;
+		RefreshRemovedDevices(m_sources);
+		RefreshRemovedDevices(m_maskFilters);
+		m_iterationCounter--;
+	}
+
+	return hasNewDevices;
+}
@@ -23,15 +23,27 @@
 #include <obs-kinect-core/Enums.hpp>
 #include <obs-kinect-core/KinectDevice.hpp>
 #include <obs-kinect/KinectPlugin.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+class KinectMaskFilter;
 class KinectSource;
 
+// Plugins are loaded and enumerate their devices on their own thread (some SDKs open every device or scan USB to do so),
+// their devices are added to the registry as their results arrive.
+// Refreshing only adds/removes devices which changed, devices still present are kept (along with their sources accesses).
 class KinectDeviceRegistry
 {
+	friend KinectMaskFilter;
 	friend KinectSource;
 
 	public:
@@ -40,22 +52,46 @@ class KinectDeviceRegistry
 		KinectDeviceRegistry() = default;
 		KinectDeviceRegistry(const KinectDeviceRegistry&) = delete;
 		KinectDeviceRegistry(KinectDeviceRegistry&&) = delete;
-		~KinectDeviceRegistry() = default;
+		~KinectDeviceRegistry();
 
-		void ForEachDevice(const Callback& callback) const;
+		void ForEachDevice(const Callback& callback);
 
-		KinectDevice* GetDevice(const std::string& deviceName) const;
+		KinectDevice* GetDevice(const std::string& deviceName);
+
+		void ProcessHotplugEvents(); //< refreshes plugins which reported a device being plugged/unplugged, called once per frame by the module tick callback
 
 		void Refresh();
 
-		bool RegisterPlugin(const std::string& path);
+		void RegisterPlugin(std::string path); //< starts loading the plugin in background, see WaitForPlugins
+
+		void SetDeviceServiceSettings(const std::string& deviceName, const KinectDevice::ServiceSettings& serviceSettings); //< kept for devices which are not (yet) enumerated
+
+		// Waits until every pending plugin has finished loading/enumerating or has run for longer than TaskTimeout
+		// Plugins still running after that will have their devices added once they're done
+		void WaitForPlugins();
 
 		KinectDeviceRegistry& operator=(const KinectDeviceRegistry&) = delete;
 		KinectDeviceRegistry& operator=(KinectDeviceRegistry&&) = delete;
 
+		static constexpr std::uint64_t TaskTimeout = 5'000'000'000ULL; //< in nanoseconds
+
 	private:
+		struct PluginData;
+
+		bool ProcessTaskResults(); //< returns true if devices were added
+		void RefreshSourcesWithoutDevice();
+		void RegisterMaskFilter(KinectMaskFilter* maskFilter);
 		void RegisterSource(KinectSource* source);
+		void StartTask(PluginData& pluginData, bool openPlugin);
+		void UnregisterMaskFilter(KinectMaskFilter* maskFilter);
 		void UnregisterSource(KinectSource* source);
+		bool UpdateDevices(PluginData& pluginData, std::vector<std::unique_ptr<KinectDevice>> devices); //< returns true if devices were added
+
+		struct TaskResult
+		{
+			std::vector<std::unique_ptr<KinectDevice>> devices;
+			bool success;
+		};
 
 		struct PluginData
 		{
@@ -65,13 +101,27 @@ class KinectDeviceRegistry
 				std::unique_ptr<KinectDevice> device;
 			};
 
-			KinectPlugin plugin;
+			KinectPlugin plugin; //< must not be accessed while a task is running
+			std::optional<TaskResult> taskResult; //< protected by m_taskMutex
+			std::string path;
+			std::thread taskThread;
 			std::vector<Device> devices; //< Order matters
+			std::atomic_bool hotplugPending = false;
+			std::uint64_t taskStartTime = 0;
+			bool hasTimedOut = false;
+			bool isLoaded = false;
+			bool isTaskRunning = false;
 		};
 
+		std::condition_variable m_taskCv;
+		std::mutex m_taskMutex;
+		std::recursive_mutex m_lock; //< sources tick (graphics thread) and properties (UI thread) both use the registry
 		std::unordered_map<std::string, KinectDevice*> m_deviceByName;
+		std::unordered_map<std::string, KinectDevice::ServiceSettings> m_serviceSettings;
+		std::unordered_set<KinectMaskFilter*> m_maskFilters; //< mask filters access devices just like sources
 		std::unordered_set<KinectSource*> m_sources;
-		std::vector<PluginData> m_plugins;
+		std::vector<std::unique_ptr<PluginData>> m_plugins; //< Registration order, pointers as tasks keep a reference on their plugin data
+		unsigned int m_iterationCounter = 0; //< task results are not processed while devices are being iterated or sources refreshed
 };
 
 #endif
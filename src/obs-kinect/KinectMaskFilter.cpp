@@ -0,0 +1,267 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#include <obs-kinect/KinectMaskFilter.hpp>
+#include <obs-kinect-core/KinectDevice.hpp>
+#include <obs-kinect/GreenscreenMaskProducer.hpp>
+#include <obs-kinect/KinectDeviceRegistry.hpp>
+#include <obs-kinect/ObsProfileScope.hpp>
+
+KinectMaskFilter::KinectMaskFilter(std::shared_ptr<KinectDeviceRegistry> registry, obs_source_t* filter) :
+m_registry(std::move(registry)),
+m_renderTargetPool(RenderTargetPool::GetSharedPool()),
+m_filter(filter),
+m_lastFrameIndex(KinectDevice::InvalidFrameIndex),
+m_maskFrameIndex(KinectDevice::InvalidFrameIndex),
+m_isVisible(false),
+m_stopOnHide(false)
+{
+	m_greenScreenSettings.enabled = true;
+
+	m_registry->RegisterMaskFilter(this);
+}
+
+KinectMaskFilter::~KinectMaskFilter()
+{
+	m_registry->UnregisterMaskFilter(this);
+}
+
+void KinectMaskFilter::OnVisibilityUpdate(bool isVisible)
+{
+	if (!m_stopOnHide)
+		isVisible = true;
+
+	if (m_isVisible != isVisible)
+	{
+		m_isVisible = isVisible;
+		RefreshDeviceAccess();
+	}
+}
+
+void KinectMaskFilter::Render()
+{
+	obs_source_t* target = obs_filter_get_target(m_filter);
+
+	std::uint32_t width = obs_source_get_base_width(target);
+	std::uint32_t height = obs_source_get_base_height(target);
+
+	// Producer may have moved on to a more recent frame (in which case our mask is no longer valid)
+	gs_texture_t* maskTexture = (m_maskProducer) ? m_maskProducer->GetMask(m_maskFrameIndex) : nullptr;
+	if (!maskTexture || width == 0 || height == 0)
+	{
+		obs_source_skip_video_filter(m_filter);
+		return;
+	}
+
+	// Render filtered source to a texture so the effect can read it (mask is stretched to its size)
+	RenderTarget sourceTarget = m_renderTargetPool->Acquire(width, height, GS_RGBA);
+
+	gs_texrender_t* sourceTexRender = sourceTarget.GetTexRender();
+	gs_texrender_reset(sourceTexRender);
+	if (!gs_texrender_begin(sourceTexRender, width, height))
+	{
+		obs_source_skip_video_filter(m_filter);
+		return;
+	}
+
+	vec4 black = { 0.f, 0.f, 0.f, 0.f };
+	gs_clear(GS_CLEAR_COLOR, &black, 0.f, 0);
+	gs_ortho(0.0f, float(width), 0.0f, float(height), -100.0f, 100.0f);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+	obs_source_video_render(target);
+
+	gs_blend_state_pop();
+	gs_texrender_end(sourceTexRender);
+
+	gs_texture_t* finalTexture = std::visit([&](auto&& effect) -> gs_texture_t*
+	{
+		using E = std::decay_t<decltype(effect)>;
+		using C = typename E::Config;
+
+		return effect.Apply(std::get<C>(m_effectConfig), sourceTarget.GetTexture(), maskTexture);
+	}, m_greenscreenEffect);
+
+	if (!finalTexture)
+	{
+		obs_source_skip_video_filter(m_filter);
+		return;
+	}
+
+	gs_effect_t* defaultEffect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	gs_eparam_t* image = gs_effect_get_param_by_name(defaultEffect, "image");
+	gs_technique_t* tech = gs_effect_get_technique(defaultEffect, "Draw");
+
+	gs_effect_set_texture(image, finalTexture);
+
+	gs_blend_state_push();
+	gs_reset_blend_state();
+
+	gs_technique_begin(tech);
+	gs_technique_begin_pass(tech, 0);
+	gs_draw_sprite(finalTexture, 0, width, height);
+	gs_technique_end_pass(tech);
+	gs_technique_end(tech);
+
+	gs_blend_state_pop();
+}
+
+void KinectMaskFilter::ShouldStopOnHide(bool shouldStop)
+{
+	m_stopOnHide = shouldStop;
+	if (!m_stopOnHide && !m_deviceAccess)
+		RefreshDeviceAccess();
+}
+
+void KinectMaskFilter::Update(float /*seconds*/)
+{
+	if (m_deviceAccess && m_deviceAccess->GetDevice().GetCaptureState() == CaptureState::Failed)
+	{
+		// Error has already been logged by the device thread, don't try again until devices or settings are refreshed
+		warnlog("failed to start %s, releasing it", m_deviceName.c_str());
+		ReleaseDeviceAccess();
+	}
+
+	if (!m_deviceAccess || m_deviceAccess->GetDevice().GetCaptureState() != CaptureState::Running)
+		return;
+
+	try
+	{
+		auto frameData = m_deviceAccess->GetLastFrame();
+		if (!frameData || frameData->frameIndex == m_lastFrameIndex)
+			return;
+
+		// Mask is computed in color space, color is only required for its size
+		if (!frameData->colorFrame)
+			return;
+
+		ObsProfileScope profile("KinectMaskFilter::Update");
+
+		m_lastFrameIndex = frameData->frameIndex;
+
+		ObsGraphics obsGfx;
+
+		const ColorFrameData& colorFrame = *frameData->colorFrame;
+
+		GreenscreenMaskProducer::Key maskKey = GreenscreenMaskProducer::BuildKey(m_deviceName, colorFrame.width, colorFrame.height, KinectSource::SourceType::Color, m_greenScreenSettings, m_visibilityMaskPath);
+		if (!m_maskProducer || m_maskProducer->GetKey() != maskKey)
+			m_maskProducer = GreenscreenMaskProducer::Acquire(std::move(maskKey));
+
+		// Another source (or filter) of the device may already have produced this mask
+		if (!m_maskProducer->GetMask(frameData->frameIndex) && !m_maskProducer->Produce(*frameData, *m_deviceAccess->GetDerivedDataCache()))
+			return;
+
+		m_maskFrameIndex = frameData->frameIndex;
+	}
+	catch (const std::exception& e)
+	{
+		warnlog("an error occurred: %s", e.what());
+	}
+}
+
+void KinectMaskFilter::UpdateDevice(std::string deviceName)
+{
+	if (m_deviceName == deviceName)
+		return;
+
+	m_deviceName = std::move(deviceName);
+	RefreshDeviceAccess();
+}
+
+void KinectMaskFilter::UpdateDeviceParameters(obs_data_t* settings)
+{
+	if (m_deviceAccess)
+		m_deviceAccess->UpdateDeviceParameters(settings);
+}
+
+void KinectMaskFilter::UpdateGreenScreen(KinectSource::GreenScreenSettings greenScreen)
+{
+	// Mask producer only produces the mask, effect is applied here
+	m_effectConfig = greenScreen.effectConfig;
+
+	std::visit([&](auto&& effect)
+	{
+		using C = std::decay_t<decltype(effect)>;
+		using E = typename C::Effect;
+
+		if (!std::holds_alternative<E>(m_greenscreenEffect))
+			m_greenscreenEffect.emplace<E>();
+
+	}, m_effectConfig);
+
+	m_greenScreenSettings = std::move(greenScreen);
+	m_greenScreenSettings.enabled = true;
+
+	if (m_deviceAccess)
+		m_deviceAccess->SetEnabledSourceFlags(ComputeEnabledSourceFlags(m_deviceAccess->GetDevice()));
+}
+
+void KinectMaskFilter::UpdateVisibilityMaskFile(const std::string_view& filePath)
+{
+	// Image is loaded by the mask producer
+	m_visibilityMaskPath = filePath;
+}
+
+SourceFlags KinectMaskFilter::ComputeEnabledSourceFlags(const KinectDevice& device) const
+{
+	return Source_Color | KinectSource::ComputeGreenScreenSourceFlags(device, KinectSource::SourceType::Color, m_greenScreenSettings);
+}
+
+std::optional<KinectDeviceAccess> KinectMaskFilter::OpenAccess(KinectDevice& device)
+{
+	obs_data_t* settings = obs_source_get_settings(m_filter);
+	auto ReleaseSettings = [](obs_data_t* settings) { obs_data_release(settings); };
+	std::unique_ptr<obs_data_t, decltype(ReleaseSettings)> unlockRect(settings, ReleaseSettings);
+
+	try
+	{
+		KinectDeviceAccess deviceAccess = device.AcquireAccess(ComputeEnabledSourceFlags(device));
+		deviceAccess.UpdateDeviceParameters(settings);
+
+		return std::make_optional(std::move(deviceAccess));
+	}
+	catch (const std::exception& e)
+	{
+		warnlog("failed to access kinect device: %s", e.what());
+		return {};
+	}
+}
+
+void KinectMaskFilter::RefreshDeviceAccess()
+{
+	if (m_isVisible)
+	{
+		KinectDevice* device = m_registry->GetDevice(m_deviceName);
+		if (device)
+			m_deviceAccess = OpenAccess(*device);
+		else
+			ReleaseDeviceAccess();
+	}
+	else
+		ReleaseDeviceAccess();
+}
+
+void KinectMaskFilter::ReleaseDeviceAccess()
+{
+	m_deviceAccess.reset();
+	m_maskProducer.reset();
+	m_lastFrameIndex = KinectDevice::InvalidFrameIndex;
+	m_maskFrameIndex = KinectDevice::InvalidFrameIndex;
+}
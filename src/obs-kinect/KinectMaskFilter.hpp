@@ -0,0 +1,87 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_KINECTMASKFILTER
+#define OBS_KINECT_PLUGIN_KINECTMASKFILTER
+
+#include <obs-kinect-core/KinectDeviceAccess.hpp>
+#include <obs-kinect/GreenscreenEffects.hpp>
+#include <obs-kinect/KinectSource.hpp>
+#include <obs-kinect/RenderTargetPool.hpp>
+#include <obs-module.h>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+class GreenscreenMaskProducer;
+class KinectDeviceRegistry;
+
+// Applies the greenscreen mask of a Kinect device to any source (typically another camera aligned with the Kinect)
+// The mask comes from the mask producer of the device, and is therefore shared with Kinect sources of the device using the same mask settings
+class KinectMaskFilter
+{
+	friend KinectDeviceRegistry;
+
+	public:
+		KinectMaskFilter(std::shared_ptr<KinectDeviceRegistry> registry, obs_source_t* filter);
+		KinectMaskFilter(const KinectMaskFilter&) = delete;
+		KinectMaskFilter(KinectMaskFilter&&) = delete;
+		~KinectMaskFilter();
+
+		void OnVisibilityUpdate(bool isVisible);
+
+		void Render();
+
+		void ShouldStopOnHide(bool shouldStop);
+
+		void Update(float seconds);
+		void UpdateDevice(std::string deviceName);
+		void UpdateDeviceParameters(obs_data_t* settings);
+		void UpdateGreenScreen(KinectSource::GreenScreenSettings greenScreen);
+		void UpdateVisibilityMaskFile(const std::string_view& filePath);
+
+		KinectMaskFilter& operator=(const KinectMaskFilter&) = delete;
+		KinectMaskFilter& operator=(KinectMaskFilter&&) = delete;
+
+	private:
+		SourceFlags ComputeEnabledSourceFlags(const KinectDevice& device) const;
+		std::optional<KinectDeviceAccess> OpenAccess(KinectDevice& device);
+		void RefreshDeviceAccess();
+		void ReleaseDeviceAccess();
+
+		std::optional<KinectDeviceAccess> m_deviceAccess;
+		std::shared_ptr<GreenscreenMaskProducer> m_maskProducer;
+		std::shared_ptr<KinectDeviceRegistry> m_registry;
+		std::shared_ptr<RenderTargetPool> m_renderTargetPool;
+		std::string m_deviceName;
+		std::string m_visibilityMaskPath;
+		GreenscreenEffectConfigs m_effectConfig;
+		GreenscreenEffects m_greenscreenEffect;
+		KinectSource::GreenScreenSettings m_greenScreenSettings;
+		obs_source_t* m_filter;
+		std::uint64_t m_lastFrameIndex;
+		std::uint64_t m_maskFrameIndex;
+		bool m_isVisible;
+		bool m_stopOnHide;
+};
+
+#endif
@@ -84,3 +84,10 @@ std::vector<std::unique_ptr<KinectDevice>> KinectPlugin::Refresh() const
 
 	return m_impl->Refresh();
 }
+
+void KinectPlugin::SetHotplugCallback(KinectPluginImpl::HotplugCallback callback)
+{
+	assert(IsOpen());
+
+	m_impl->SetHotplugCallback(std::move(callback));
+}
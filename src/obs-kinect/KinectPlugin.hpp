@@ -46,6 +46,8 @@ class KinectPlugin
 
 		std::vector<std::unique_ptr<KinectDevice>> Refresh() const;
 
+		void SetHotplugCallback(KinectPluginImpl::HotplugCallback callback);
+
 		KinectPlugin& operator=(const KinectPlugin&) = delete;
 		KinectPlugin& operator=(KinectPlugin&&) noexcept = default;
 
@@ -16,27 +16,38 @@
 ******************************************************************************/
 
 #include <obs-kinect/KinectSource.hpp>
+#include <obs-kinect-core/KinectDerivedDataCache.hpp>
 #include <obs-kinect-core/KinectDevice.hpp>
+#include <obs-kinect-core/KinectRecorder.hpp>
+#include <obs-kinect/CpuCompositor.hpp>
+#include <obs-kinect/GreenscreenMaskProducer.hpp>
 #include <obs-kinect/KinectDeviceRegistry.hpp>
+#include <obs-kinect/ObsProfileScope.hpp>
 #include <util/platform.h>
 #include <algorithm>
 #include <array>
 #include <cstring>
-#include <numeric>
 #include <optional>
 
-KinectSource::KinectSource(std::shared_ptr<KinectDeviceRegistry> registry, const obs_source_t* source) :
-m_filterBlur(GS_RGBA),
+KinectSource::KinectSource(std::shared_ptr<KinectDeviceRegistry> registry, obs_source_t* source, ProcessingMode processingMode) :
 m_registry(std::move(registry)),
+m_processingMode(processingMode),
 m_sourceType(SourceType::Color),
 m_source(source),
 m_height(0),
+m_maxFrameRate(0),
+m_outputHeight(0),
+m_outputWidth(0),
 m_width(0),
+m_idleReleaseDelay(KinectDevice::DefaultIdleReleaseDelay),
+m_keepAliveDelay(KinectDevice::DefaultKeepAliveDelay),
 m_lastFrameIndex(KinectDevice::InvalidFrameIndex),
-m_lastTextureTick(0),
 m_isVisible(false),
 m_stopOnHide(false)
 {
+	if (m_processingMode == ProcessingMode::CPU)
+		m_cpuCompositor = std::make_unique<CpuCompositor>(source);
+
 	m_registry->RegisterSource(this);
 }
 
@@ -66,7 +77,34 @@ void KinectSource::OnVisibilityUpdate(bool isVisible)
 		RefreshDeviceAccess();
 
 		if (!m_isVisible)
-			m_finalTexture.reset(); //< Free some memory
+		{
+			// Free some memory
+			m_finalTexture.reset();
+			m_sourceTarget.Reset();
+		}
+	}
+}
+
+void KinectSource::SaveReplayBuffer()
+{
+	KinectDevice* device = m_registry->GetDevice(m_deviceName);
+	if (!device || !device->HasReplayBuffer())
+	{
+		warnlog("no replay buffer to save");
+		return;
+	}
+
+	try
+	{
+		std::string filePath = KinectRecorder::BuildFilePath(device->GetUniqueName() + "_replay");
+		if (device->SaveReplayBuffer(filePath))
+			infolog("saving %s replay buffer to %s", device->GetUniqueName().c_str(), filePath.c_str());
+		else
+			warnlog("%s replay buffer is already being saved", device->GetUniqueName().c_str());
+	}
+	catch (const std::exception& e)
+	{
+		errorlog("failed to save replay buffer: %s", e.what());
 	}
 }
 
@@ -114,25 +152,51 @@ void KinectSource::UpdateInfraredToColor(InfraredToColorSettings infraredToColor
 	m_infraredToColorSettings = infraredToColor;
 }
 
-void KinectSource::UpdateVisibilityMaskFile(const std::string_view& filePath)
+void KinectSource::UpdateIdleReleaseDelay(std::uint64_t idleReleaseDelay)
 {
-	if (m_visibilityMaskPath != filePath)
-	{
-		if (!filePath.empty())
-		{
-			if (!m_visibilityMaskImage)
-				m_visibilityMaskImage.reset(new gs_image_file_t);
+	m_idleReleaseDelay = idleReleaseDelay;
 
-			gs_image_file_init(m_visibilityMaskImage.get(), filePath.data());
+	if (m_deviceAccess)
+		m_deviceAccess->SetIdleReleaseDelay(m_idleReleaseDelay);
+}
 
-			ObsGraphics gfx;
-			gs_image_file_init_texture(m_visibilityMaskImage.get());
-		}
-		else
-			m_visibilityMaskImage.reset();
+void KinectSource::UpdateKeepAliveDelay(std::uint64_t keepAliveDelay)
+{
+	m_keepAliveDelay = keepAliveDelay;
 
-		m_visibilityMaskPath = filePath;
-	}
+	if (m_deviceAccess)
+		m_deviceAccess->SetKeepAliveDelay(m_keepAliveDelay);
+}
+
+void KinectSource::UpdateMaxFrameRate(std::uint32_t maxFrameRate)
+{
+	m_maxFrameRate = maxFrameRate;
+
+	if (m_deviceAccess)
+		m_deviceAccess->SetMaxFrameRate(m_maxFrameRate);
+}
+
+void KinectSource::UpdateOutputSize(std::uint32_t width, std::uint32_t height)
+{
+	m_outputHeight = height;
+	m_outputWidth = width;
+
+	if (m_deviceAccess)
+		m_deviceAccess->SetOutputSize(m_outputWidth, m_outputHeight);
+}
+
+void KinectSource::UpdateServiceSettings(const KinectDevice::ServiceSettings& serviceSettings)
+{
+	m_serviceSettings = serviceSettings;
+
+	if (!m_deviceName.empty())
+		m_registry->SetDeviceServiceSettings(m_deviceName, m_serviceSettings);
+}
+
+void KinectSource::UpdateVisibilityMaskFile(const std::string_view& filePath)
+{
+	// Image is loaded by the mask producer (or by the CPU compositor)
+	m_visibilityMaskPath = filePath;
 }
 
 void KinectSource::ShouldStopOnHide(bool shouldStop)
@@ -142,6 +206,34 @@ void KinectSource::ShouldStopOnHide(bool shouldStop)
 		RefreshDeviceAccess();
 }
 
+void KinectSource::ToggleRecording()
+{
+	KinectDevice* device = m_registry->GetDevice(m_deviceName);
+	if (!device)
+	{
+		warnlog("no device to record");
+		return;
+	}
+
+	if (device->IsRecording())
+	{
+		device->StopRecording();
+		return;
+	}
+
+	try
+	{
+		std::string filePath = KinectRecorder::BuildFilePath(device->GetUniqueName());
+		device->StartRecording(filePath);
+
+		infolog("recording %s to %s", device->GetUniqueName().c_str(), filePath.c_str());
+	}
+	catch (const std::exception& e)
+	{
+		errorlog("failed to start recording: %s", e.what());
+	}
+}
+
 void KinectSource::Render()
 {
 	if (!m_finalTexture)
@@ -172,42 +264,15 @@ void KinectSource::Render()
 
 void KinectSource::Update(float /*seconds*/)
 {
-	auto UpdateTexture = [](ObsTexturePtr& texture, gs_color_format format, std::uint32_t width, std::uint32_t height, std::uint32_t pitch, const void* content)
+	if (m_deviceAccess && m_deviceAccess->GetDevice().GetCaptureState() == CaptureState::Failed)
 	{
-		gs_texture_t* texPtr = texture.get();
-		const std::uint8_t* contentInput = static_cast<const std::uint8_t*>(content);
-		if (!texPtr || format != gs_texture_get_color_format(texPtr) || width != gs_texture_get_width(texPtr) || height != gs_texture_get_height(texPtr))
-		{
-			texture.reset(gs_texture_create(width, height, format, 1, &contentInput, GS_DYNAMIC));
-			if (!texture)
-				throw std::runtime_error("failed to create texture");
-		}
-		else
-		{
-			uint8_t* ptr;
-			uint32_t texPitch;
-			if (!gs_texture_map(texPtr, &ptr, &texPitch))
-				throw std::runtime_error("failed to map texture");
-
-			if (pitch == texPitch)
-				std::memcpy(ptr, content, pitch * height);
-			else
-			{
-				std::uint32_t bestPitch = std::min(pitch, texPitch);
-				for (std::size_t y = 0; y < height; ++y)
-				{
-					const std::uint8_t* input = &contentInput[y * pitch];
-					std::uint8_t* output = ptr + y * texPitch;
-
-					std::memcpy(output, input, bestPitch);
-				}
-			}
-
-			gs_texture_unmap(texPtr);
-		}
-	};
+		// Error has already been logged by the device thread, don't try again until devices or settings are refreshed
+		warnlog("failed to start %s, releasing it", m_deviceName.c_str());
+		ReleaseDeviceAccess();
+	}
 
-	if (!m_deviceAccess)
+	// Nothing is rendered while the device is starting (see KinectDevice::StartCapture)
+	if (!m_deviceAccess || m_deviceAccess->GetDevice().GetCaptureState() != CaptureState::Running)
 	{
 		m_height = 0;
 		m_width = 0;
@@ -220,18 +285,27 @@ void KinectSource::Update(float /*seconds*/)
 		if (!frameData || frameData->frameIndex == m_lastFrameIndex)
 			return;
 
-		// Update animated textures, if any
-		std::uint64_t now = obs_get_video_frame_time();
-		if (m_lastTextureTick == 0)
-			m_lastTextureTick = now;
-
-		if (m_visibilityMaskImage && m_visibilityMaskImage->texture && gs_image_file_tick(m_visibilityMaskImage.get(), now - m_lastTextureTick))
+		if (m_processingMode == ProcessingMode::CPU)
 		{
-			ObsGraphics gfx;
-			gs_image_file_update_texture(m_visibilityMaskImage.get());
+			m_lastFrameIndex = frameData->frameIndex;
+
+			CpuCompositor::Params params;
+			params.depthToColor = m_depthToColorSettings;
+			params.derivedDataCache = m_deviceAccess->GetDerivedDataCache();
+			params.greenScreen = m_greenScreenSettings;
+			params.infraredToColor = m_infraredToColorSettings;
+			params.sourceType = m_sourceType;
+			params.visibilityMaskPath = m_visibilityMaskPath;
+
+			m_cpuCompositor->Submit(std::move(frameData), std::move(params));
+			return;
 		}
 
+		ObsProfileScope profile("KinectSource::Update");
+
 		// Process frame
+		KinectDerivedDataCache& derivedDataCache = *m_deviceAccess->GetDerivedDataCache();
+
 		m_height = 0;
 		m_width = 0;
 
@@ -239,10 +313,8 @@ void KinectSource::Update(float /*seconds*/)
 
 		ObsGraphics obsGfx;
 
-		bool isDepthColorMapped = frameData->colorMappedDepthFrame.has_value();
-		bool softwareDepthMapping = (!m_greenScreenSettings.gpuDepthMapping || m_greenScreenSettings.maxDirtyDepth > 0);
-
-		if ((m_greenScreenSettings.enabled && DoesRequireDepthFrame(m_greenScreenSettings.filterType) && !softwareDepthMapping && !isDepthColorMapped) || m_sourceType == SourceType::Depth)
+		// Greenscreen uploads depth only when producing the mask, which another source of the device may already have done (see below)
+		if (m_sourceType == SourceType::Depth)
 		{
 			if (!frameData->depthFrame)
 				return;
@@ -261,7 +333,6 @@ void KinectSource::Update(float /*seconds*/)
 					return;
 
 				const ColorFrameData& colorFrame = *frameData->colorFrame;
-
 				UpdateTexture(m_colorTexture, colorFrame.format, colorFrame.width, colorFrame.height, colorFrame.pitch, colorFrame.ptr.get());
 				sourceTexture = m_colorTexture.get();
 				break;
@@ -276,10 +347,7 @@ void KinectSource::Update(float /*seconds*/)
 				float standardDeviation;
 				if (m_depthToColorSettings.dynamic)
 				{
-					const std::uint16_t* depthValues = reinterpret_cast<const std::uint16_t*>(depthFrame.ptr.get());
-					std::size_t depthValueCount = depthFrame.width * depthFrame.height;
-
-					DynamicValues dynValues = ComputeDynamicValues(depthValues, depthValueCount);
+					KinectDerivedDataCache::DynamicValues dynValues = derivedDataCache.GetDepthDynamicValues(*frameData);
 					averageValue = float(dynValues.average);
 					standardDeviation = float(dynValues.standardDeviation);
 				}
@@ -289,7 +357,8 @@ void KinectSource::Update(float /*seconds*/)
 					standardDeviation = m_depthToColorSettings.standardDeviation;
 				}
 
-				sourceTexture = m_depthIRConvertEffect.Convert(depthFrame.width, depthFrame.height, m_depthTexture.get(), averageValue, standardDeviation);
+				m_sourceTarget = m_depthIRConvertEffect.Convert(depthFrame.width, depthFrame.height, m_depthTexture.get(), averageValue, standardDeviation);
+				sourceTexture = m_sourceTarget.GetTexture();
 				break;
 			}
 
@@ -304,10 +373,7 @@ void KinectSource::Update(float /*seconds*/)
 				float standardDeviation;
 				if (m_infraredToColorSettings.dynamic)
 				{
-					const std::uint16_t* irValues = reinterpret_cast<const std::uint16_t*>(irFrame.ptr.get());
-					std::size_t irValueCount = irFrame.width * irFrame.height;
-
-					DynamicValues dynValues = ComputeDynamicValues(irValues, irValueCount);
+					KinectDerivedDataCache::DynamicValues dynValues = derivedDataCache.GetInfraredDynamicValues(*frameData);
 					averageValue = float(dynValues.average);
 					standardDeviation = float(dynValues.standardDeviation);
 				}
@@ -318,7 +384,8 @@ void KinectSource::Update(float /*seconds*/)
 				}
 
 				UpdateTexture(m_infraredTexture, GS_R16, irFrame.width, irFrame.height, irFrame.pitch, irFrame.ptr.get());
-				sourceTexture = m_depthIRConvertEffect.Convert(irFrame.width, irFrame.height, m_infraredTexture.get(), averageValue, standardDeviation);
+				m_sourceTarget = m_depthIRConvertEffect.Convert(irFrame.width, irFrame.height, m_infraredTexture.get(), averageValue, standardDeviation);
+				sourceTexture = m_sourceTarget.GetTexture();
 				break;
 			}
 
@@ -335,258 +402,25 @@ void KinectSource::Update(float /*seconds*/)
 		// Apply greenscreen effected if enabled
 		if (m_greenScreenSettings.enabled)
 		{
-			// All green screen types (except depth/dedicated) require body index texture
-			if (!softwareDepthMapping && DoesRequireBodyFrame(m_greenScreenSettings.filterType))
-			{
-				if (!frameData->bodyIndexFrame)
-					return;
+			// Masks are shared with the other sources of the device using the same mask settings, only the effect is source-specific
+			GreenscreenMaskProducer::Key maskKey = GreenscreenMaskProducer::BuildKey(m_deviceName, m_width, m_height, m_sourceType, m_greenScreenSettings, m_visibilityMaskPath);
+			if (!m_maskProducer || m_maskProducer->GetKey() != maskKey)
+				m_maskProducer = GreenscreenMaskProducer::Acquire(std::move(maskKey));
 
-				const BodyIndexFrameData& bodyIndexFrame = *frameData->bodyIndexFrame;
-				UpdateTexture(m_bodyIndexTexture, GS_R8, bodyIndexFrame.width, bodyIndexFrame.height, bodyIndexFrame.pitch, bodyIndexFrame.ptr.get());
-			}
-
-			// Handle CPU|GPU depth mapping + dirty depth values
-			gs_texture_t* bodyIndexTexture = m_bodyIndexTexture.get();
-			gs_texture_t* depthMappingTexture = nullptr;
-			gs_texture_t* depthTexture = m_depthTexture.get();
-
-			if (m_sourceType == SourceType::Color)
-			{
-				if (!frameData->depthMappingFrame && !frameData->colorMappedDepthFrame)
-					return;
-
-				if (frameData->colorMappedDepthFrame)
-				{
-					const DepthFrameData& mappedDepthFrame = *frameData->colorMappedDepthFrame;
-
-					UpdateTexture(m_depthTexture, GS_R16, mappedDepthFrame.width, mappedDepthFrame.height, mappedDepthFrame.width * sizeof(std::uint16_t), mappedDepthFrame.ptr.get());
-					depthMappingTexture = nullptr;
-					depthTexture = m_depthTexture.get();
-				}
-				else
-				{
-					const DepthMappingFrameData& depthMappingFrame = *frameData->depthMappingFrame;
-
-					if (softwareDepthMapping)
-					{
-						if (!frameData->colorFrame || !frameData->depthFrame)
-							return;
-
-						const ColorFrameData& colorFrame = *frameData->colorFrame;
-						const DepthFrameData& depthFrame = *frameData->depthFrame;
-
-						constexpr float InvalidDepth = -std::numeric_limits<float>::infinity();
-
-						const DepthMappingFrameData::DepthCoordinates* depthMapping = reinterpret_cast<const DepthMappingFrameData::DepthCoordinates*>(depthMappingFrame.ptr.get());
-
-						constexpr std::uint16_t InvalidDepthOutput = 0;
-
-						m_depthMappingMemory.resize(colorFrame.width * colorFrame.height * sizeof(std::uint16_t), InvalidDepthOutput);
-						m_depthMappingDirtyCounter.resize(colorFrame.width * colorFrame.height, 0);
-						std::uint16_t* depthOutput = reinterpret_cast<std::uint16_t*>(m_depthMappingMemory.data());
-
-						for (std::size_t y = 0; y < colorFrame.height; ++y)
-						{
-							for (std::size_t x = 0; x < colorFrame.width; ++x)
-							{
-								std::uint8_t& dirtyCounter = m_depthMappingDirtyCounter[y * colorFrame.width + x];
-								std::uint16_t* output = &depthOutput[y * colorFrame.width + x];
-								const auto& depthCoordinates = depthMapping[y * depthMappingFrame.width + x];
-								if (depthCoordinates.x == InvalidDepth || depthCoordinates.y == InvalidDepth)
-								{
-									if (++dirtyCounter > m_greenScreenSettings.maxDirtyDepth)
-										*output = InvalidDepthOutput;
-
-									continue;
-								}
-
-								int dX = static_cast<int>(depthCoordinates.x + 0.5f);
-								int dY = static_cast<int>(depthCoordinates.y + 0.5f);
-
-								if (dX < 0 || dX >= int(depthFrame.width) ||
-									dY < 0 || dY >= int(depthFrame.height))
-								{
-									if (++dirtyCounter > m_greenScreenSettings.maxDirtyDepth)
-										*output = InvalidDepthOutput;
-
-									continue;
-								}
-
-								*output = depthFrame.ptr[depthFrame.width * dY + dX];
-								dirtyCounter = 0;
-							}
-						}
-
-						UpdateTexture(m_depthMappingTexture, GS_R16, colorFrame.width, colorFrame.height, colorFrame.width * sizeof(std::uint16_t), m_depthMappingMemory.data());
-						depthMappingTexture = nullptr;
-						depthTexture = m_depthMappingTexture.get();
-
-						if (DoesRequireBodyFrame(m_greenScreenSettings.filterType))
-						{
-							if (!frameData->bodyIndexFrame)
-								return;
-
-							// Map body info as well
-							const BodyIndexFrameData& bodyIndexFrame = *frameData->bodyIndexFrame;
-
-							const std::uint8_t* bodyPixels = reinterpret_cast<const std::uint8_t*>(bodyIndexFrame.ptr.get());
-
-							constexpr std::uint8_t InvalidBodyIndexOutput = 255;
-
-							m_bodyMappingMemory.resize(colorFrame.width * colorFrame.height * sizeof(std::uint8_t), InvalidBodyIndexOutput);
-							m_bodyMappingDirtyCounter.resize(colorFrame.width * colorFrame.height, 0);
-							std::uint8_t* bodyIndexOutput = m_bodyMappingMemory.data();
-
-							for (std::size_t y = 0; y < colorFrame.height; ++y)
-							{
-								for (std::size_t x = 0; x < colorFrame.width; ++x)
-								{
-									std::uint8_t& dirtyCounter = m_bodyMappingDirtyCounter[y * colorFrame.width + x];
-									std::uint8_t* output = &bodyIndexOutput[y * colorFrame.width + x];
-									const auto& depthCoordinates = depthMapping[y * depthMappingFrame.width + x];
-									if (depthCoordinates.x == InvalidDepth || depthCoordinates.y == InvalidDepth)
-									{
-										if (++dirtyCounter > m_greenScreenSettings.maxDirtyDepth)
-											*output = InvalidBodyIndexOutput;
-
-										continue;
-									}
-
-									int dX = static_cast<int>(depthCoordinates.x + 0.5f);
-									int dY = static_cast<int>(depthCoordinates.y + 0.5f);
-
-									if (dX < 0 || dX >= int(depthFrame.width) ||
-										dY < 0 || dY >= int(depthFrame.height))
-									{
-										if (++dirtyCounter > m_greenScreenSettings.maxDirtyDepth)
-											*output = InvalidBodyIndexOutput;
-
-										continue;
-									}
-
-									*output = bodyPixels[depthFrame.width * dY + dX];
-									dirtyCounter = 0;
-								}
-							}
-
-							UpdateTexture(m_bodyIndexTexture, GS_R8, colorFrame.width, colorFrame.height, colorFrame.width * sizeof(std::uint8_t), m_bodyMappingMemory.data());
-							bodyIndexTexture = m_bodyIndexTexture.get();
-						}
-						else
-						{
-							// Reclaim some memory
-							m_bodyMappingMemory.clear();
-							m_bodyMappingMemory.shrink_to_fit();
-
-							m_bodyMappingDirtyCounter.clear();
-							m_bodyMappingDirtyCounter.shrink_to_fit();
-						}
-					}
-					else
-					{
-						// Reclaim some memory
-						m_bodyMappingMemory.clear();
-						m_bodyMappingMemory.shrink_to_fit();
-
-						m_bodyMappingDirtyCounter.clear();
-						m_bodyMappingDirtyCounter.shrink_to_fit();
-
-						m_depthMappingMemory.clear();
-						m_depthMappingMemory.shrink_to_fit();
-
-						m_depthMappingDirtyCounter.clear();
-						m_depthMappingDirtyCounter.shrink_to_fit();
-
-						UpdateTexture(m_depthMappingTexture, GS_RG32F, depthMappingFrame.width, depthMappingFrame.height, depthMappingFrame.pitch, depthMappingFrame.ptr.get());
-						depthMappingTexture = m_depthMappingTexture.get();
-					}
-				}
-			}
-
-			// Apply green screen filtering
-			gs_texture_t* filterTexture = nullptr;
-			if (m_greenScreenSettings.filterType == GreenScreenFilterType::Dedicated)
+			gs_texture_t* filterTexture = m_maskProducer->GetMask(frameData->frameIndex);
+			if (!filterTexture)
 			{
-				if (!frameData->backgroundRemovalFrame)
-					return;
-
-				const BackgroundRemovalFrameData& backgroundRemovalFrame = *frameData->backgroundRemovalFrame;
-				UpdateTexture(m_backgroundRemovalTexture, GS_R8, backgroundRemovalFrame.width, backgroundRemovalFrame.height, backgroundRemovalFrame.pitch, backgroundRemovalFrame.ptr.get());
-
-				filterTexture = m_backgroundRemovalTexture.get();
-			}
-			else
-			{
-				m_backgroundRemovalTexture.reset(); //< Release some memory
-
-				switch (m_greenScreenSettings.filterType)
-				{
-					case GreenScreenFilterType::Body:
-					{
-						GreenScreenFilterShader::BodyFilterParams filterParams;
-						filterParams.bodyIndexTexture = bodyIndexTexture;
-						filterParams.colorToDepthTexture = depthMappingTexture;
-
-						filterTexture = m_greenScreenFilterEffect.Filter(m_width, m_height, filterParams);
-						break;
-					}
-
-					case GreenScreenFilterType::BodyOrDepth:
-					{
-						GreenScreenFilterShader::BodyOrDepthFilterParams filterParams;
-						filterParams.bodyIndexTexture = bodyIndexTexture;
-						filterParams.colorToDepthTexture = depthMappingTexture;
-						filterParams.depthTexture = depthTexture;
-						filterParams.maxDepth = m_greenScreenSettings.depthMax;
-						filterParams.minDepth = m_greenScreenSettings.depthMin;
-						filterParams.progressiveDepth = m_greenScreenSettings.fadeDist;
-
-						filterTexture = m_greenScreenFilterEffect.Filter(m_width, m_height, filterParams);
-						break;
-					}
-
-					case GreenScreenFilterType::BodyWithinDepth:
-					{
-						GreenScreenFilterShader::BodyWithinDepthFilterParams filterParams;
-						filterParams.bodyIndexTexture = bodyIndexTexture;
-						filterParams.colorToDepthTexture = depthMappingTexture;
-						filterParams.depthTexture = depthTexture;
-						filterParams.maxDepth = m_greenScreenSettings.depthMax;
-						filterParams.minDepth = m_greenScreenSettings.depthMin;
-						filterParams.progressiveDepth = m_greenScreenSettings.fadeDist;
-
-						filterTexture = m_greenScreenFilterEffect.Filter(m_width, m_height, filterParams);
-						break;
-					}
-
-					case GreenScreenFilterType::Depth:
-					{
-						GreenScreenFilterShader::DepthFilterParams filterParams;
-						filterParams.colorToDepthTexture = depthMappingTexture;
-						filterParams.depthTexture = depthTexture;
-						filterParams.maxDepth = m_greenScreenSettings.depthMax;
-						filterParams.minDepth = m_greenScreenSettings.depthMin;
-						filterParams.progressiveDepth = m_greenScreenSettings.fadeDist;
-
-						filterTexture = m_greenScreenFilterEffect.Filter(m_width, m_height, filterParams);
-						break;
-					}
-
-					case GreenScreenFilterType::Dedicated:
-						break; //< Already handled in a branch
-				}
+				// Depth sources already uploaded the depth frame
+				gs_texture_t* depthTexture = (m_sourceType == SourceType::Depth) ? m_depthTexture.get() : nullptr;
 
+				filterTexture = m_maskProducer->Produce(*frameData, derivedDataCache, depthTexture);
 				if (!filterTexture)
 					return;
-
-				if (m_greenScreenSettings.blurPassCount > 0)
-					filterTexture = m_filterBlur.Blur(filterTexture, m_greenScreenSettings.blurPassCount);
-
-				if (m_visibilityMaskImage && m_visibilityMaskImage->texture)
-					filterTexture = m_visibilityMaskEffect.Mask(filterTexture, m_visibilityMaskImage->texture);
 			}
 
 			// Present processed texture
+			ObsProfileScope effectProfile("KinectSource: greenscreen effect (GPU submission)");
+
 			m_finalTexture.reset(std::visit([&](auto&& effect) -> gs_texture_t*
 			{
 				using E = std::decay_t<decltype(effect)>;
@@ -610,6 +444,9 @@ void KinectSource::UpdateDevice(std::string deviceName)
 		return;
 
 	m_deviceName = std::move(deviceName);
+	if (!m_deviceName.empty())
+		m_registry->SetDeviceServiceSettings(m_deviceName, m_serviceSettings);
+
 	RefreshDeviceAccess();
 }
 
@@ -619,6 +456,46 @@ void KinectSource::UpdateDeviceParameters(obs_data_t* settings)
 		m_deviceAccess->UpdateDeviceParameters(settings);
 }
 
+SourceFlags KinectSource::ComputeGreenScreenSourceFlags(const KinectDevice& device, SourceType sourceType, const GreenScreenSettings& greenScreen)
+{
+	SourceFlags flags = 0;
+
+	// If device supports depth to color mapping, use it for color source
+	bool colorMapped = (sourceType == SourceType::Color);
+	bool hasDepthToColorMapping = (device.GetSupportedSources() & Source_ColorToDepthMapping);
+
+	if (DoesRequireBodyFrame(greenScreen.filterType))
+	{
+		if (colorMapped)
+		{
+			if (hasDepthToColorMapping)
+				flags |= Source_Body | Source_ColorToDepthMapping;
+			else
+				flags |= Source_ColorMappedBody;
+		}
+		else
+			flags |= Source_Body;
+	}
+
+	if (DoesRequireDepthFrame(greenScreen.filterType))
+	{
+		if (colorMapped)
+		{
+			if (hasDepthToColorMapping)
+				flags |= Source_Depth | Source_ColorToDepthMapping;
+			else
+				flags |= Source_ColorMappedDepth;
+		}
+		else
+			flags |= Source_Depth;
+	}
+
+	if (greenScreen.filterType == GreenScreenFilterType::Dedicated)
+		flags |= Source_BackgroundRemoval;
+
+	return flags;
+}
+
 bool KinectSource::DoesRequireBodyFrame(GreenScreenFilterType greenscreenType)
 {
 	switch (greenscreenType)
@@ -653,9 +530,39 @@ bool KinectSource::DoesRequireDepthFrame(GreenScreenFilterType greenscreenType)
 	return false;
 }
 
-void KinectSource::ClearDeviceAccess()
+void KinectSource::UpdateTexture(ObsTexturePtr& texture, gs_color_format format, std::uint32_t width, std::uint32_t height, std::uint32_t pitch, const void* content)
 {
-	m_deviceAccess.reset();
+	gs_texture_t* texPtr = texture.get();
+	const std::uint8_t* contentInput = static_cast<const std::uint8_t*>(content);
+	if (!texPtr || format != gs_texture_get_color_format(texPtr) || width != gs_texture_get_width(texPtr) || height != gs_texture_get_height(texPtr))
+	{
+		texture.reset(gs_texture_create(width, height, format, 1, &contentInput, GS_DYNAMIC));
+		if (!texture)
+			throw std::runtime_error("failed to create texture");
+	}
+	else
+	{
+		uint8_t* ptr;
+		uint32_t texPitch;
+		if (!gs_texture_map(texPtr, &ptr, &texPitch))
+			throw std::runtime_error("failed to map texture");
+
+		if (pitch == texPitch)
+			std::memcpy(ptr, content, pitch * height);
+		else
+		{
+			std::uint32_t bestPitch = std::min(pitch, texPitch);
+			for (std::size_t y = 0; y < height; ++y)
+			{
+				const std::uint8_t* input = &contentInput[y * pitch];
+				std::uint8_t* output = ptr + y * texPitch;
+
+				std::memcpy(output, input, bestPitch);
+			}
+		}
+
+		gs_texture_unmap(texPtr);
+	}
 }
 
 SourceFlags KinectSource::ComputeEnabledSourceFlags() const
@@ -682,40 +589,7 @@ SourceFlags KinectSource::ComputeEnabledSourceFlags(const KinectDevice& device)
 	}
 
 	if (m_greenScreenSettings.enabled)
-	{
-		// If device supports depth to color mapping, use it for color source
-		bool colorMapped = (m_sourceType == SourceType::Color);
-		bool hasDepthToColorMapping = (device.GetSupportedSources() & Source_ColorToDepthMapping);
-
-		if (DoesRequireBodyFrame(m_greenScreenSettings.filterType))
-		{
-			if (colorMapped)
-			{
-				if (hasDepthToColorMapping)
-					flags |= Source_Body | Source_ColorToDepthMapping;
-				else
-					flags |= Source_ColorMappedBody;
-			}
-			else
-				flags |= Source_Body;
-		}
-
-		if (DoesRequireDepthFrame(m_greenScreenSettings.filterType))
-		{
-			if (colorMapped)
-			{
-				if (hasDepthToColorMapping)
-					flags |= Source_Depth | Source_ColorToDepthMapping;
-				else
-					flags |= Source_ColorMappedDepth;
-			}
-			else
-				flags |= Source_Depth;
-		}
-
-		if (m_greenScreenSettings.filterType == GreenScreenFilterType::Dedicated)
-			flags |= Source_BackgroundRemoval;
-	}
+		flags |= ComputeGreenScreenSourceFlags(device, m_sourceType, m_greenScreenSettings);
 
 	return flags;
 }
@@ -730,6 +604,10 @@ std::optional<KinectDeviceAccess> KinectSource::OpenAccess(KinectDevice& device)
 	{
 		KinectDeviceAccess deviceAccess = device.AcquireAccess(ComputeEnabledSourceFlags(device));
 		deviceAccess.UpdateDeviceParameters(settings);
+		deviceAccess.SetIdleReleaseDelay(m_idleReleaseDelay);
+		deviceAccess.SetKeepAliveDelay(m_keepAliveDelay);
+		deviceAccess.SetMaxFrameRate(m_maxFrameRate);
+		deviceAccess.SetOutputSize(m_outputWidth, m_outputHeight);
 
 		return std::make_optional(std::move(deviceAccess));
 	}
@@ -742,38 +620,26 @@ std::optional<KinectDeviceAccess> KinectSource::OpenAccess(KinectDevice& device)
 
 void KinectSource::RefreshDeviceAccess()
 {
-	auto Clear = [&] {
-		m_deviceAccess.reset();
-		m_finalTexture.reset();
-		m_lastFrameIndex = KinectDevice::InvalidFrameIndex;
-	};
-
 	if (m_isVisible)
 	{
 		KinectDevice* device = m_registry->GetDevice(m_deviceName);
 		if (device)
 			m_deviceAccess = OpenAccess(*device);
 		else
-			Clear();
+			ReleaseDeviceAccess();
 	}
 	else
-		Clear();
+		ReleaseDeviceAccess();
 }
 
-auto KinectSource::ComputeDynamicValues(const std::uint16_t* values, std::size_t valueCount) -> DynamicValues
+void KinectSource::ReleaseDeviceAccess()
 {
-	constexpr std::uint16_t MaxValue = std::numeric_limits<std::uint16_t>::max();
-
-	unsigned long long average = std::accumulate(values, values + valueCount, 0LL) / valueCount;
-	unsigned long long varianceAcc = std::accumulate(values, values + valueCount, 0LL, [average](unsigned long long init, unsigned long long delta)
-	{
-		return init + (delta - average) * (delta - average); // underflow allowed (will overflow back to the right value)
-	});
-
-	double variance = double(varianceAcc) / valueCount;
-
-	double averageValue = double(average) / MaxValue;
-	double standardDeviation = std::sqrt(variance / MaxValue);
+	m_deviceAccess.reset();
+	m_finalTexture.reset();
+	m_sourceTarget.Reset();
+	m_maskProducer.reset();
+	m_lastFrameIndex = KinectDevice::InvalidFrameIndex;
 
-	return { averageValue, standardDeviation };
+	if (m_cpuCompositor)
+		m_cpuCompositor->Clear();
 }
@@ -23,12 +23,10 @@
 #include <obs-kinect-core/Enums.hpp>
 #include <obs-kinect-core/Helper.hpp>
 #include <obs-kinect-core/KinectDeviceAccess.hpp>
+#include <obs-kinect-core/MaskMorphology.hpp>
 #include <obs-kinect/GreenscreenEffects.hpp>
 #include <obs-kinect/Shaders/AlphaMaskShader.hpp>
 #include <obs-kinect/Shaders/ConvertDepthIRToColorShader.hpp>
-#include <obs-kinect/Shaders/VisibilityMaskShader.hpp>
-#include <obs-kinect/Shaders/GaussianBlurShader.hpp>
-#include <obs-kinect/Shaders/GreenScreenFilterShader.hpp>
 #include <obs-kinect/Shaders/TextureLerpShader.hpp>
 #include <obs-module.h>
 #include <atomic>
@@ -39,21 +37,25 @@
 #include <thread>
 #include <vector>
 
+class CpuCompositor;
+class GreenscreenMaskProducer;
 class KinectDevice;
 class KinectDeviceRegistry;
 
 class KinectSource
 {
+	friend CpuCompositor;
 	friend KinectDeviceRegistry;
 
 	public:
 		enum class GreenScreenFilterType;
+		enum class ProcessingMode;
 		enum class SourceType;
 		struct DepthToColorSettings;
 		struct GreenScreenSettings;
 		struct InfraredToColorSettings;
 
-		KinectSource(std::shared_ptr<KinectDeviceRegistry> registry, const obs_source_t* source);
+		KinectSource(std::shared_ptr<KinectDeviceRegistry> registry, obs_source_t* source, ProcessingMode processingMode);
 		~KinectSource();
 
 		std::uint32_t GetHeight() const;
@@ -63,16 +65,25 @@ class KinectSource
 
 		void Render();
 
+		void SaveReplayBuffer();
+
 		void SetSourceType(SourceType sourceType);
 
 		void ShouldStopOnHide(bool shouldStop);
 
+		void ToggleRecording();
+
 		void Update(float seconds);
 		void UpdateDevice(std::string deviceName);
 		void UpdateDeviceParameters(obs_data_t* settings);
 		void UpdateDepthToColor(DepthToColorSettings depthToColor);
 		void UpdateGreenScreen(GreenScreenSettings greenScreen);
+		void UpdateIdleReleaseDelay(std::uint64_t idleReleaseDelay);
 		void UpdateInfraredToColor(InfraredToColorSettings infraredToColor);
+		void UpdateKeepAliveDelay(std::uint64_t keepAliveDelay);
+		void UpdateMaxFrameRate(std::uint32_t maxFrameRate);
+		void UpdateOutputSize(std::uint32_t width, std::uint32_t height);
+		void UpdateServiceSettings(const KinectDevice::ServiceSettings& serviceSettings); //< device-wide, the last updated source using a device configures it
 		void UpdateVisibilityMaskFile(const std::string_view& filePath);
 
 		enum class GreenScreenFilterType
@@ -84,6 +95,12 @@ class KinectSource
 			Depth = 1            //< Requires Source_Depth (| Source_ColorToDepthMapping if color source is used)
 		};
 
+		enum class ProcessingMode
+		{
+			GPU, //< Frames are processed using shaders and rendered by the source
+			CPU  //< Frames are processed on a separate thread and output as async video
+		};
+
 		enum class SourceType
 		{
 			Color = 0,   //< Requires Source_Color
@@ -102,9 +119,13 @@ class KinectSource
 		{
 			GreenscreenEffectConfigs effectConfig;
 			GreenScreenFilterType filterType = GreenScreenFilterType::Depth;
+			MorphologyOperation morphologyOperation = MorphologyOperation::None;
 			bool enabled = true;
 			bool gpuDepthMapping = true;
 			std::size_t blurPassCount = 3;
+			std::size_t morphologyRadius = 1;
+			std::size_t temporalFrameCount = 1; //< 1 = no temporal filtering
+			float temporalResetThreshold = 0.5f;
 			std::uint16_t depthMax = 1200;
 			std::uint16_t depthMin = 1;
 			std::uint16_t fadeDist = 100;
@@ -118,55 +139,47 @@ class KinectSource
 			float standardDeviation = 3.f;
 		};
 
+		static SourceFlags ComputeGreenScreenSourceFlags(const KinectDevice& device, SourceType sourceType, const GreenScreenSettings& greenScreen);
 		static bool DoesRequireBodyFrame(GreenScreenFilterType greenscreenType);
 		static bool DoesRequireDepthFrame(GreenScreenFilterType greenscreenType);
+		static void UpdateTexture(ObsTexturePtr& texture, gs_color_format format, std::uint32_t width, std::uint32_t height, std::uint32_t pitch, const void* content); //< creates or reuses a dynamic texture
 
 	private:
-		struct DynamicValues
-		{
-			double average;
-			double standardDeviation;
-		};
-
-		void ClearDeviceAccess();
 		SourceFlags ComputeEnabledSourceFlags() const;
 		SourceFlags ComputeEnabledSourceFlags(const KinectDevice& device) const;
 		std::optional<KinectDeviceAccess> OpenAccess(KinectDevice& device);
 		void RefreshDeviceAccess();
-
-		static DynamicValues ComputeDynamicValues(const std::uint16_t* values, std::size_t valueCount);
+		void ReleaseDeviceAccess();
 
 		std::optional<KinectDeviceAccess> m_deviceAccess;
 		std::shared_ptr<KinectDeviceRegistry> m_registry;
-		std::vector<std::uint8_t> m_bodyMappingMemory;
-		std::vector<std::uint8_t> m_bodyMappingDirtyCounter;
-		std::vector<std::uint8_t> m_depthMappingMemory;
-		std::vector<std::uint8_t> m_depthMappingDirtyCounter;
+		std::shared_ptr<GreenscreenMaskProducer> m_maskProducer;
+		std::unique_ptr<CpuCompositor> m_cpuCompositor;
 		ConvertDepthIRToColorShader m_depthIRConvertEffect;
-		GaussianBlurShader m_filterBlur;
-		GreenScreenFilterShader m_greenScreenFilterEffect;
 		GreenscreenEffects m_greenscreenEffect;
 		DepthToColorSettings m_depthToColorSettings;
 		GreenScreenSettings m_greenScreenSettings;
 		InfraredToColorSettings m_infraredToColorSettings;
+		ProcessingMode m_processingMode;
 		TextureLerpShader m_textureLerpEffect;
 		ObserverPtr<gs_texture_t> m_finalTexture;
-		ObsTexturePtr m_backgroundRemovalTexture;
-		ObsTexturePtr m_bodyIndexTexture;
+		RenderTarget m_sourceTarget;
 		ObsTexturePtr m_colorTexture;
-		ObsTexturePtr m_depthMappingTexture;
 		ObsTexturePtr m_depthTexture;
 		ObsTexturePtr m_infraredTexture;
 		SourceType m_sourceType;
-		ObsImageFilePtr m_visibilityMaskImage;
-		VisibilityMaskShader m_visibilityMaskEffect;
-		const obs_source_t* m_source;
+		obs_source_t* m_source;
+		KinectDevice::ServiceSettings m_serviceSettings;
 		std::string m_deviceName;
 		std::string m_visibilityMaskPath;
 		std::uint32_t m_height;
+		std::uint32_t m_maxFrameRate;
+		std::uint32_t m_outputHeight;
+		std::uint32_t m_outputWidth;
 		std::uint32_t m_width;
+		std::uint64_t m_idleReleaseDelay;
+		std::uint64_t m_keepAliveDelay;
 		std::uint64_t m_lastFrameIndex;
-		std::uint64_t m_lastTextureTick;
 		bool m_isVisible;
 		bool m_stopOnHide;
 };
@@ -0,0 +1,35 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_OBSPROFILESCOPE
+#define OBS_KINECT_PLUGIN_OBSPROFILESCOPE
+
+#include <util/profiler.h>
+
+// Times the enclosed CPU work in the OBS profiler, name must be a static string as libobs profiler identifies entries by pointer
+// Around rendering, this only measures the submission of GPU commands (scopes are named accordingly), not their execution
+struct ObsProfileScope
+{
+	ObsProfileScope(const char* name) : m_name(name) { profile_start(m_name); }
+	~ObsProfileScope() { profile_end(m_name); }
+
+	const char* m_name;
+};
+
+#endif
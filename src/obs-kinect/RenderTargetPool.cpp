@@ -0,0 +1,193 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect/RenderTargetPool.hpp>
+#include <obs-kinect-core/Helper.hpp>
+#include <util/platform.h>
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+RenderTarget::RenderTarget(std::shared_ptr<RenderTargetPool> pool, gs_texrender_t* texRender) :
+m_pool(std::move(pool)),
+m_texRender(texRender)
+{
+}
+
+RenderTarget::RenderTarget(RenderTarget&& target) noexcept :
+m_pool(std::move(target.m_pool)),
+m_texRender(target.m_texRender)
+{
+	target.m_texRender = nullptr;
+}
+
+RenderTarget::~RenderTarget()
+{
+	Reset();
+}
+
+gs_texrender_t* RenderTarget::GetTexRender() const
+{
+	return m_texRender;
+}
+
+gs_texture_t* RenderTarget::GetTexture() const
+{
+	return (m_texRender) ? gs_texrender_get_texture(m_texRender) : nullptr;
+}
+
+void RenderTarget::Reset()
+{
+	if (m_texRender)
+	{
+		m_pool->Release(m_texRender);
+		m_texRender = nullptr;
+	}
+
+	m_pool.reset();
+}
+
+RenderTarget::operator bool() const
+{
+	return m_texRender != nullptr;
+}
+
+RenderTarget& RenderTarget::operator=(RenderTarget&& target) noexcept
+{
+	if (this != &target)
+	{
+		Reset();
+
+		m_pool = std::move(target.m_pool);
+		m_texRender = target.m_texRender;
+		target.m_texRender = nullptr;
+	}
+
+	return *this;
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+	// Every RenderTarget holds a reference to the pool, so no target can be active at this point
+	ObsGraphics gfx;
+
+	for (Entry& entry : m_entries)
+	{
+		assert(!entry.isActive);
+		gs_texrender_destroy(entry.texRender);
+	}
+}
+
+RenderTarget RenderTargetPool::Acquire(std::uint32_t width, std::uint32_t height, gs_color_format format)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Trim(os_gettime_ns());
+
+	m_stats.acquireCount++;
+
+	for (Entry& entry : m_entries)
+	{
+		if (!entry.isActive && entry.width == width && entry.height == height && entry.format == format)
+		{
+			entry.isActive = true;
+			m_stats.activeTargetCount++;
+			m_stats.idleTargetCount--;
+
+			return RenderTarget(shared_from_this(), entry.texRender);
+		}
+	}
+
+	gs_texrender_t* texRender = gs_texrender_create(format, GS_ZS_NONE);
+	if (!texRender)
+		throw std::runtime_error("failed to create render target");
+
+	Entry& entry = m_entries.emplace_back();
+	entry.format = format;
+	entry.height = height;
+	entry.isActive = true;
+	entry.releaseTime = 0;
+	entry.texRender = texRender;
+	entry.width = width;
+
+	m_stats.activeTargetCount++;
+	m_stats.createCount++;
+	m_stats.memoryUsage += ComputeMemoryUsage(entry);
+
+	debuglog("created %ux%u render target (%zu targets, %zu KiB)", width, height, m_entries.size(), m_stats.memoryUsage / 1024);
+
+	return RenderTarget(shared_from_this(), texRender);
+}
+
+auto RenderTargetPool::GetStats() const -> Stats
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+std::shared_ptr<RenderTargetPool> RenderTargetPool::GetSharedPool()
+{
+	static std::mutex sharedPoolMutex;
+	static std::weak_ptr<RenderTargetPool> sharedPool;
+
+	std::lock_guard<std::mutex> lock(sharedPoolMutex);
+
+	std::shared_ptr<RenderTargetPool> pool = sharedPool.lock();
+	if (!pool)
+	{
+		pool = std::make_shared<RenderTargetPool>();
+		sharedPool = pool;
+	}
+
+	return pool;
+}
+
+void RenderTargetPool::Release(gs_texrender_t* texRender)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto it = std::find_if(m_entries.begin(), m_entries.end(), [&](const Entry& entry) { return entry.texRender == texRender; });
+	assert(it != m_entries.end() && it->isActive);
+
+	// No graphics call here as targets may be released outside of the graphics context, destruction happens when trimming
+	it->isActive = false;
+	it->releaseTime = os_gettime_ns();
+
+	m_stats.activeTargetCount--;
+	m_stats.idleTargetCount++;
+}
+
+void RenderTargetPool::Trim(std::uint64_t now)
+{
+	auto it = std::remove_if(m_entries.begin(), m_entries.end(), [&](const Entry& entry)
+	{
+		if (entry.isActive || now - entry.releaseTime < MaxIdleTime)
+			return false;
+
+		gs_texrender_destroy(entry.texRender);
+
+		m_stats.idleTargetCount--;
+		m_stats.memoryUsage -= ComputeMemoryUsage(entry);
+		return true;
+	});
+
+	m_entries.erase(it, m_entries.end());
+}
+
+std::size_t RenderTargetPool::ComputeMemoryUsage(const Entry& entry)
+{
+	return std::size_t(entry.width) * entry.height * gs_get_format_bpp(entry.format) / 8;
+}
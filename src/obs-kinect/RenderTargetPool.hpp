@@ -0,0 +1,116 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_RENDERTARGETPOOL
+#define OBS_KINECT_PLUGIN_RENDERTARGETPOOL
+
+#include <obs-module.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class RenderTargetPool;
+
+// Render target borrowed from a RenderTargetPool, goes back to the pool when destroyed
+class RenderTarget
+{
+	friend RenderTargetPool;
+
+	public:
+		RenderTarget() = default;
+		RenderTarget(const RenderTarget&) = delete;
+		RenderTarget(RenderTarget&& target) noexcept;
+		~RenderTarget();
+
+		gs_texrender_t* GetTexRender() const;
+		gs_texture_t* GetTexture() const;
+
+		void Reset();
+
+		explicit operator bool() const;
+
+		RenderTarget& operator=(const RenderTarget&) = delete;
+		RenderTarget& operator=(RenderTarget&& target) noexcept;
+
+	private:
+		RenderTarget(std::shared_ptr<RenderTargetPool> pool, gs_texrender_t* texRender);
+
+		std::shared_ptr<RenderTargetPool> m_pool;
+		gs_texrender_t* m_texRender = nullptr;
+};
+
+// Module-wide pool of texrenders, sorted by size and format
+// Shaders borrow their targets only while their output is used, which allows following steps of the chain to reuse them
+class RenderTargetPool : public std::enable_shared_from_this<RenderTargetPool>
+{
+	friend RenderTarget;
+
+	public:
+		struct Stats;
+
+		RenderTargetPool() = default;
+		RenderTargetPool(const RenderTargetPool&) = delete;
+		RenderTargetPool(RenderTargetPool&&) = delete;
+		~RenderTargetPool();
+
+		// Must be called with the graphics context, the target has to be rendered with the same size
+		RenderTarget Acquire(std::uint32_t width, std::uint32_t height, gs_color_format format);
+
+		Stats GetStats() const;
+
+		RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+		RenderTargetPool& operator=(RenderTargetPool&&) = delete;
+
+		static std::shared_ptr<RenderTargetPool> GetSharedPool();
+
+		static constexpr std::uint64_t MaxIdleTime = 2'000'000'000; //< Idle targets are destroyed after this delay (in nanoseconds)
+
+		struct Stats
+		{
+			std::size_t activeTargetCount = 0;
+			std::size_t idleTargetCount = 0;
+			std::size_t memoryUsage = 0; //< Approximative memory used by all targets, in bytes
+			std::uint64_t acquireCount = 0;
+			std::uint64_t createCount = 0;
+		};
+
+	private:
+		struct Entry
+		{
+			gs_texrender_t* texRender;
+			gs_color_format format;
+			std::uint32_t width;
+			std::uint32_t height;
+			std::uint64_t releaseTime;
+			bool isActive;
+		};
+
+		void Release(gs_texrender_t* texRender);
+		void Trim(std::uint64_t now);
+
+		static std::size_t ComputeMemoryUsage(const Entry& entry);
+
+		mutable std::mutex m_mutex;
+		std::vector<Entry> m_entries;
+		Stats m_stats;
+};
+
+#endif
@@ -20,6 +20,8 @@
 #ifndef OBS_KINECT_PLUGIN_ALPHAMASKSHADER
 #define OBS_KINECT_PLUGIN_ALPHAMASKSHADER
 
+#include <obs-kinect/RenderTargetPool.hpp>
+#include <obs-kinect/Shaders/EffectCache.hpp>
 #include <obs-module.h>
 #include <cstddef>
 
@@ -27,16 +29,16 @@ class AlphaMaskShader
 {
 	public:
 		AlphaMaskShader();
-		~AlphaMaskShader();
+		~AlphaMaskShader() = default;
 
-		gs_texture_t* Filter(gs_texture_t* color, gs_texture_t* mask);
+		RenderTarget Filter(gs_texture_t* color, gs_texture_t* mask);
 
 	private:
-		gs_effect_t* m_effect;
+		ObsEffectPtr m_effect;
+		std::shared_ptr<RenderTargetPool> m_renderTargetPool;
 		gs_eparam_t* m_params_ColorImage;
 		gs_eparam_t* m_params_MaskImage;
 		gs_technique_t* m_tech_Draw;
-		gs_texrender_t* m_workTexture;
 };
 
 #endif
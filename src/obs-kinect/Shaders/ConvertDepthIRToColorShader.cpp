@@ -22,44 +22,24 @@
 
 ConvertDepthIRToColorShader::ConvertDepthIRToColorShader()
 {
-	ObsMemoryPtr<char> effectFilename(obs_module_file("color_multiplier.effect"));
+	m_effect = EffectCache::Acquire("color_multiplier.effect");
+	m_renderTargetPool = RenderTargetPool::GetSharedPool();
 
 	ObsGraphics gfx;
 
-	char* errStr = nullptr;
-	m_effect = gs_effect_create_from_file(effectFilename.get(), &errStr);
-	ObsMemoryPtr<char> errStrOwner(errStr);
-
-	if (m_effect)
-	{
-		m_params_ColorImage = gs_effect_get_param_by_name(m_effect, "ColorImage");
-		m_params_ColorMultiplier = gs_effect_get_param_by_name(m_effect, "ColorMultiplier");
-		m_tech_Draw = gs_effect_get_technique(m_effect, "Draw");
-
-		m_workTexture = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
-	}
-	else
-	{
-		std::string err("failed to create effect: ");
-		err.append((errStr) ? errStr : "shader error");
-
-		throw std::runtime_error(err);
-	}
+	m_params_ColorImage = gs_effect_get_param_by_name(m_effect.get(), "ColorImage");
+	m_params_ColorMultiplier = gs_effect_get_param_by_name(m_effect.get(), "ColorMultiplier");
+	m_tech_Draw = gs_effect_get_technique(m_effect.get(), "Draw");
 }
 
-ConvertDepthIRToColorShader::~ConvertDepthIRToColorShader()
+RenderTarget ConvertDepthIRToColorShader::Convert(std::uint32_t width, std::uint32_t height, gs_texture_t* source, float averageValue, float standardDeviation)
 {
-	ObsGraphics gfx;
+	RenderTarget renderTarget = m_renderTargetPool->Acquire(width, height, GS_RGBA);
 
-	gs_effect_destroy(m_effect);
-	gs_texrender_destroy(m_workTexture);
-}
-
-gs_texture_t* ConvertDepthIRToColorShader::Convert(std::uint32_t width, std::uint32_t height, gs_texture_t* source, float averageValue, float standardDeviation)
-{
-	gs_texrender_reset(m_workTexture);
-	if (!gs_texrender_begin(m_workTexture, width, height))
-		return nullptr;
+	gs_texrender_t* workTexture = renderTarget.GetTexRender();
+	gs_texrender_reset(workTexture);
+	if (!gs_texrender_begin(workTexture, width, height))
+		return {};
 
 	vec4 black = { 0.f, 0.f, 0.f, 0.f };
 	gs_clear(GS_CLEAR_COLOR, &black, 0.f, 0);
@@ -74,7 +54,7 @@ gs_texture_t* ConvertDepthIRToColorShader::Convert(std::uint32_t width, std::uin
 	gs_technique_end_pass(m_tech_Draw);
 	gs_technique_end(m_tech_Draw);
 
-	gs_texrender_end(m_workTexture);
+	gs_texrender_end(workTexture);
 
-	return gs_texrender_get_texture(m_workTexture);
+	return renderTarget;
 }
@@ -20,6 +20,8 @@
 #ifndef OBS_KINECT_PLUGIN_CONVERTDEPTHIRTOCOLORSHADER
 #define OBS_KINECT_PLUGIN_CONVERTDEPTHIRTOCOLORSHADER
 
+#include <obs-kinect/RenderTargetPool.hpp>
+#include <obs-kinect/Shaders/EffectCache.hpp>
 #include <obs-module.h>
 #include <cstdint>
 
@@ -27,16 +29,16 @@ class ConvertDepthIRToColorShader
 {
 	public:
 		ConvertDepthIRToColorShader();
-		~ConvertDepthIRToColorShader();
+		~ConvertDepthIRToColorShader() = default;
 
-		gs_texture_t* Convert(std::uint32_t width, std::uint32_t height, gs_texture_t* source, float averageValue, float standardDeviation);
+		RenderTarget Convert(std::uint32_t width, std::uint32_t height, gs_texture_t* source, float averageValue, float standardDeviation);
 
 	private:
-		gs_effect_t* m_effect;
+		ObsEffectPtr m_effect;
+		std::shared_ptr<RenderTargetPool> m_renderTargetPool;
 		gs_eparam_t* m_params_ColorImage;
 		gs_eparam_t* m_params_ColorMultiplier;
 		gs_technique_t* m_tech_Draw;
-		gs_texrender_t* m_workTexture;
 };
 
 #endif
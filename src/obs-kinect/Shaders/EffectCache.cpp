@@ -0,0 +1,80 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect/Shaders/EffectCache.hpp>
+#include <obs-kinect-core/Helper.hpp>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+	std::mutex s_effectMutex;
+	std::unordered_map<std::string, std::weak_ptr<gs_effect_t>> s_effects;
+
+	ObsEffectPtr FindEffect(const std::string& effectName)
+	{
+		auto it = s_effects.find(effectName);
+		if (it == s_effects.end())
+			return nullptr;
+
+		return it->second.lock();
+	}
+}
+
+ObsEffectPtr EffectCache::Acquire(const std::string& effectName)
+{
+	{
+		std::lock_guard<std::mutex> lock(s_effectMutex);
+		if (ObsEffectPtr effect = FindEffect(effectName))
+			return effect;
+	}
+
+	// Compile without holding the lock, as entering the graphics context may wait on a thread trying to acquire an effect
+	ObsMemoryPtr<char> effectFilename(obs_module_file(effectName.data()));
+
+	gs_effect_t* effectPtr;
+	char* errStr = nullptr;
+	{
+		ObsGraphics gfx;
+		effectPtr = gs_effect_create_from_file(effectFilename.get(), &errStr);
+	}
+	ObsMemoryPtr<char> errStrOwner(errStr);
+
+	if (!effectPtr)
+	{
+		std::string err("failed to create effect: ");
+		err.append((errStr) ? errStr : "shader error");
+
+		throw std::runtime_error(err);
+	}
+
+	ObsEffectPtr effect(effectPtr, [](gs_effect_t* effect)
+	{
+		ObsGraphics gfx;
+		gs_effect_destroy(effect);
+	});
+
+	std::lock_guard<std::mutex> lock(s_effectMutex);
+
+	// Another thread may have compiled the same effect in the meantime, keep only one of them
+	if (ObsEffectPtr existingEffect = FindEffect(effectName))
+		return existingEffect;
+
+	s_effects[effectName] = effect;
+	return effect;
+}
@@ -0,0 +1,41 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_EFFECTCACHE
+#define OBS_KINECT_PLUGIN_EFFECTCACHE
+
+#include <obs-module.h>
+#include <memory>
+#include <string>
+
+using ObsEffectPtr = std::shared_ptr<gs_effect_t>;
+
+// Module-wide cache of compiled effects, shared by all shader instances
+// An effect is compiled on first use and destroyed when its last user releases it
+class EffectCache
+{
+	public:
+		EffectCache() = delete;
+		~EffectCache() = delete;
+
+		// Returns the compiled effect from the module data folder, throws if compilation fails
+		static ObsEffectPtr Acquire(const std::string& effectName);
+};
+
+#endif
@@ -20,57 +20,40 @@
 #include <string>
 #include <stdexcept>
 
-GaussianBlurShader::GaussianBlurShader(gs_color_format colorFormat)
+GaussianBlurShader::GaussianBlurShader(gs_color_format colorFormat) :
+m_colorFormat(colorFormat)
 {
-	ObsMemoryPtr<char> effectFilename(obs_module_file("gaussian_blur.effect"));
+	m_effect = EffectCache::Acquire("gaussian_blur.effect");
+	m_renderTargetPool = RenderTargetPool::GetSharedPool();
 
 	ObsGraphics gfx;
 
-	char* errStr = nullptr;
-	m_effect = gs_effect_create_from_file(effectFilename.get(), &errStr);
-	ObsMemoryPtr<char> errStrOwner(errStr);
-
-	if (m_effect)
-	{
-		m_blurEffect_Filter = gs_effect_get_param_by_name(m_effect, "Filter");
-		m_blurEffect_Image = gs_effect_get_param_by_name(m_effect, "Image");
-		m_blurEffect_InvImageSize = gs_effect_get_param_by_name(m_effect, "InvImageSize");
-		m_blurEffect_DrawTech = gs_effect_get_technique(m_effect, "Draw");
-
-		m_workTextureA = gs_texrender_create(colorFormat, GS_ZS_NONE);
-		m_workTextureB = gs_texrender_create(colorFormat, GS_ZS_NONE);
-	}
-	else
-	{
-		std::string err("failed to create effect: ");
-		err.append((errStr) ? errStr : "shader error");
-
-		throw std::runtime_error(err);
-	}
+	m_blurEffect_Filter = gs_effect_get_param_by_name(m_effect.get(), "Filter");
+	m_blurEffect_Image = gs_effect_get_param_by_name(m_effect.get(), "Image");
+	m_blurEffect_InvImageSize = gs_effect_get_param_by_name(m_effect.get(), "InvImageSize");
+	m_blurEffect_DrawTech = gs_effect_get_technique(m_effect.get(), "Draw");
 }
 
-GaussianBlurShader::~GaussianBlurShader()
-{
-	ObsGraphics gfx;
-
-	gs_effect_destroy(m_effect);
-	gs_texrender_destroy(m_workTextureA);
-	gs_texrender_destroy(m_workTextureB);
-}
-
-gs_texture_t* GaussianBlurShader::Blur(gs_texture_t* source, std::size_t count)
+RenderTarget GaussianBlurShader::Blur(gs_texture_t* source, std::size_t count)
 {
 	std::uint32_t width = gs_texture_get_width(source);
 	std::uint32_t height = gs_texture_get_height(source);
 
+	// A is only needed during the blur and goes back to the pool when returning
+	RenderTarget renderTargetA = m_renderTargetPool->Acquire(width, height, m_colorFormat);
+	RenderTarget renderTargetB = m_renderTargetPool->Acquire(width, height, m_colorFormat);
+
+	gs_texrender_t* workTextureA = renderTargetA.GetTexRender();
+	gs_texrender_t* workTextureB = renderTargetB.GetTexRender();
+
 	vec2 filter;
 	vec2 invTextureSize = { 1.f / width, 1.f / height };
 
 	for (std::size_t blurIndex = 0; blurIndex < count; ++blurIndex)
 	{
-		gs_texrender_reset(m_workTextureA);
-		if (!gs_texrender_begin(m_workTextureA, width, height))
-			return nullptr;
+		gs_texrender_reset(workTextureA);
+		if (!gs_texrender_begin(workTextureA, width, height))
+			return {};
 
 		gs_ortho(0.0f, float(width), 0.0f, float(height), -100.0f, 100.0f);
 
@@ -79,7 +62,7 @@ gs_texture_t* GaussianBlurShader::Blur(gs_texture_t* source, std::size_t count)
 
 		gs_effect_set_vec2(m_blurEffect_Filter, &filter);
 		gs_effect_set_vec2(m_blurEffect_InvImageSize, &invTextureSize);
-		gs_effect_set_texture(m_blurEffect_Image, (blurIndex == 0) ? source : gs_texrender_get_texture(m_workTextureB));
+		gs_effect_set_texture(m_blurEffect_Image, (blurIndex == 0) ? source : gs_texrender_get_texture(workTextureB));
 
 		gs_technique_begin(m_blurEffect_DrawTech);
 		gs_technique_begin_pass(m_blurEffect_DrawTech, 0);
@@ -87,11 +70,11 @@ gs_texture_t* GaussianBlurShader::Blur(gs_texture_t* source, std::size_t count)
 		gs_technique_end_pass(m_blurEffect_DrawTech);
 		gs_technique_end(m_blurEffect_DrawTech);
 
-		gs_texrender_end(m_workTextureA);
+		gs_texrender_end(workTextureA);
 
-		gs_texrender_reset(m_workTextureB);
-		if (!gs_texrender_begin(m_workTextureB, width, height))
-			return nullptr;
+		gs_texrender_reset(workTextureB);
+		if (!gs_texrender_begin(workTextureB, width, height))
+			return {};
 			
 		gs_ortho(0.0f, float(width), 0.0f, float(height), -100.0f, 100.0f);
 
@@ -100,7 +83,7 @@ gs_texture_t* GaussianBlurShader::Blur(gs_texture_t* source, std::size_t count)
 
 		gs_effect_set_vec2(m_blurEffect_Filter, &filter);
 		gs_effect_set_vec2(m_blurEffect_InvImageSize, &invTextureSize);
-		gs_effect_set_texture(m_blurEffect_Image, gs_texrender_get_texture(m_workTextureA));
+		gs_effect_set_texture(m_blurEffect_Image, gs_texrender_get_texture(workTextureA));
 
 		gs_technique_begin(m_blurEffect_DrawTech);
 		gs_technique_begin_pass(m_blurEffect_DrawTech, 0);
@@ -108,8 +91,8 @@ gs_texture_t* GaussianBlurShader::Blur(gs_texture_t* source, std::size_t count)
 		gs_technique_end_pass(m_blurEffect_DrawTech);
 		gs_technique_end(m_blurEffect_DrawTech);
 
-		gs_texrender_end(m_workTextureB);
+		gs_texrender_end(workTextureB);
 	}
 
-	return gs_texrender_get_texture(m_workTextureB);
+	return renderTargetB;
 }
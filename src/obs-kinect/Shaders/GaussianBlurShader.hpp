@@ -20,6 +20,8 @@
 #ifndef OBS_KINECT_PLUGIN_GAUSSIANBLURSHADER
 #define OBS_KINECT_PLUGIN_GAUSSIANBLURSHADER
 
+#include <obs-kinect/RenderTargetPool.hpp>
+#include <obs-kinect/Shaders/EffectCache.hpp>
 #include <obs-module.h>
 #include <cstddef>
 
@@ -27,18 +29,18 @@ class GaussianBlurShader
 {
 	public:
 		GaussianBlurShader(gs_color_format colorFormat);
-		~GaussianBlurShader();
+		~GaussianBlurShader() = default;
 
-		gs_texture_t* Blur(gs_texture_t* source, std::size_t count);
+		RenderTarget Blur(gs_texture_t* source, std::size_t count);
 
 	private:
-		gs_effect_t* m_effect;
+		ObsEffectPtr m_effect;
+		std::shared_ptr<RenderTargetPool> m_renderTargetPool;
 		gs_eparam_t* m_blurEffect_Filter;
 		gs_eparam_t* m_blurEffect_Image;
 		gs_eparam_t* m_blurEffect_InvImageSize;
 		gs_technique_t* m_blurEffect_DrawTech;
-		gs_texrender_t* m_workTextureA;
-		gs_texrender_t* m_workTextureB;
+		gs_color_format m_colorFormat;
 };
 
 #endif
@@ -22,119 +22,103 @@
 
 GreenScreenFilterShader::GreenScreenFilterShader()
 {
-	ObsMemoryPtr<char> effectFilename(obs_module_file("greenscreen_filter.effect"));
+	m_effect = EffectCache::Acquire("greenscreen_filter.effect");
+	m_renderTargetPool = RenderTargetPool::GetSharedPool();
 
 	ObsGraphics gfx;
 
-	char* errStr = nullptr;
-	m_effect = gs_effect_create_from_file(effectFilename.get(), &errStr);
-	ObsMemoryPtr<char> errStrOwner(errStr);
-
-	if (m_effect)
-	{
-		m_params_BodyIndexImage = gs_effect_get_param_by_name(m_effect, "BodyIndexImage");
-		m_params_DepthImage = gs_effect_get_param_by_name(m_effect, "DepthImage");
-		m_params_DepthMappingImage = gs_effect_get_param_by_name(m_effect, "DepthMappingImage");
-		m_params_InvDepthImageSize = gs_effect_get_param_by_name(m_effect, "InvDepthImageSize");
-		m_params_InvDepthProgressive = gs_effect_get_param_by_name(m_effect, "InvDepthProgressive");
-		m_params_MaxDepth = gs_effect_get_param_by_name(m_effect, "MaxDepth");
-		m_params_MinDepth = gs_effect_get_param_by_name(m_effect, "MinDepth");
-
-		m_tech_BodyOnlyWithDepthCorrection = gs_effect_get_technique(m_effect, "BodyOnlyWithDepthCorrection");
-		m_tech_BodyOnlyWithoutDepthCorrection = gs_effect_get_technique(m_effect, "BodyOnlyWithoutDepthCorrection");
-
-		m_tech_BodyOrDepthWithDepthCorrection = gs_effect_get_technique(m_effect, "BodyOrDepthWithDepthCorrection");
-		m_tech_BodyOrDepthWithoutDepthCorrection = gs_effect_get_technique(m_effect, "BodyOrDepthWithoutDepthCorrection");
-
-		m_tech_BodyWithinDepthWithDepthCorrection = gs_effect_get_technique(m_effect, "BodyWithinDepthWithDepthCorrection");
-		m_tech_BodyWithinDepthWithoutDepthCorrection = gs_effect_get_technique(m_effect, "BodyWithinDepthWithoutDepthCorrection");
-
-		m_tech_DepthOnlyWithDepthCorrection = gs_effect_get_technique(m_effect, "DepthOnlyWithDepthCorrection");
-		m_tech_DepthOnlyWithoutDepthCorrection = gs_effect_get_technique(m_effect, "DepthOnlyWithoutDepthCorrection");
-
-		m_workTexture = gs_texrender_create(GS_R8, GS_ZS_NONE);
-	}
-	else
-	{
-		std::string err("failed to create effect: ");
-		err.append((errStr) ? errStr : "shader error");
-
-		throw std::runtime_error(err);
-	}
-}
+	m_params_BodyIndexImage = gs_effect_get_param_by_name(m_effect.get(), "BodyIndexImage");
+	m_params_DepthImage = gs_effect_get_param_by_name(m_effect.get(), "DepthImage");
+	m_params_DepthMappingImage = gs_effect_get_param_by_name(m_effect.get(), "DepthMappingImage");
+	m_params_InvDepthImageSize = gs_effect_get_param_by_name(m_effect.get(), "InvDepthImageSize");
+	m_params_InvDepthProgressive = gs_effect_get_param_by_name(m_effect.get(), "InvDepthProgressive");
+	m_params_MaxDepth = gs_effect_get_param_by_name(m_effect.get(), "MaxDepth");
+	m_params_MinDepth = gs_effect_get_param_by_name(m_effect.get(), "MinDepth");
 
-GreenScreenFilterShader::~GreenScreenFilterShader()
-{
-	ObsGraphics gfx;
+	m_tech_BodyOnlyWithDepthCorrection = gs_effect_get_technique(m_effect.get(), "BodyOnlyWithDepthCorrection");
+	m_tech_BodyOnlyWithoutDepthCorrection = gs_effect_get_technique(m_effect.get(), "BodyOnlyWithoutDepthCorrection");
 
-	gs_effect_destroy(m_effect);
-	gs_texrender_destroy(m_workTexture);
+	m_tech_BodyOrDepthWithDepthCorrection = gs_effect_get_technique(m_effect.get(), "BodyOrDepthWithDepthCorrection");
+	m_tech_BodyOrDepthWithoutDepthCorrection = gs_effect_get_technique(m_effect.get(), "BodyOrDepthWithoutDepthCorrection");
+
+	m_tech_BodyWithinDepthWithDepthCorrection = gs_effect_get_technique(m_effect.get(), "BodyWithinDepthWithDepthCorrection");
+	m_tech_BodyWithinDepthWithoutDepthCorrection = gs_effect_get_technique(m_effect.get(), "BodyWithinDepthWithoutDepthCorrection");
+
+	m_tech_DepthOnlyWithDepthCorrection = gs_effect_get_technique(m_effect.get(), "DepthOnlyWithDepthCorrection");
+	m_tech_DepthOnlyWithoutDepthCorrection = gs_effect_get_technique(m_effect.get(), "DepthOnlyWithoutDepthCorrection");
 }
 
-gs_texture_t* GreenScreenFilterShader::Filter(std::uint32_t width, std::uint32_t height, const BodyFilterParams& params)
+RenderTarget GreenScreenFilterShader::Filter(std::uint32_t width, std::uint32_t height, const BodyFilterParams& params)
 {
-	if (!Begin(width, height))
-		return nullptr;
+	RenderTarget renderTarget = Begin(width, height);
+	if (!renderTarget)
+		return {};
 
 	SetBodyParams(params);
 
 	gs_technique_t* technique = (params.colorToDepthTexture) ? m_tech_BodyOnlyWithDepthCorrection : m_tech_BodyOnlyWithoutDepthCorrection;
 
-	return Process(width, height, technique);
+	return Process(std::move(renderTarget), width, height, technique);
 }
 
-gs_texture_t* GreenScreenFilterShader::Filter(std::uint32_t width, std::uint32_t height, const BodyOrDepthFilterParams& params)
+RenderTarget GreenScreenFilterShader::Filter(std::uint32_t width, std::uint32_t height, const BodyOrDepthFilterParams& params)
 {
-	if (!Begin(width, height))
-		return nullptr;
+	RenderTarget renderTarget = Begin(width, height);
+	if (!renderTarget)
+		return {};
 
 	SetBodyParams(params);
 	SetDepthParams(params);
 
 	gs_technique_t* technique = (params.colorToDepthTexture) ? m_tech_BodyOrDepthWithDepthCorrection : m_tech_BodyOrDepthWithoutDepthCorrection;
 
-	return Process(width, height, technique);
+	return Process(std::move(renderTarget), width, height, technique);
 }
 
-gs_texture_t* GreenScreenFilterShader::Filter(std::uint32_t width, std::uint32_t height, const BodyWithinDepthFilterParams& params)
+RenderTarget GreenScreenFilterShader::Filter(std::uint32_t width, std::uint32_t height, const BodyWithinDepthFilterParams& params)
 {
-	if (!Begin(width, height))
-		return nullptr;
+	RenderTarget renderTarget = Begin(width, height);
+	if (!renderTarget)
+		return {};
 
 	SetBodyParams(params);
 	SetDepthParams(params);
 
 	gs_technique_t* technique = (params.colorToDepthTexture) ? m_tech_BodyWithinDepthWithDepthCorrection : m_tech_BodyWithinDepthWithoutDepthCorrection;
 
-	return Process(width, height, technique);
+	return Process(std::move(renderTarget), width, height, technique);
 }
 
-gs_texture_t* GreenScreenFilterShader::Filter(std::uint32_t width, std::uint32_t height, const DepthFilterParams& params)
+RenderTarget GreenScreenFilterShader::Filter(std::uint32_t width, std::uint32_t height, const DepthFilterParams& params)
 {
-	if (!Begin(width, height))
-		return nullptr;
+	RenderTarget renderTarget = Begin(width, height);
+	if (!renderTarget)
+		return {};
 
 	SetDepthParams(params);
 
 	gs_technique_t* technique = (params.colorToDepthTexture) ? m_tech_DepthOnlyWithDepthCorrection : m_tech_DepthOnlyWithoutDepthCorrection;
 
-	return Process(width, height, technique);
+	return Process(std::move(renderTarget), width, height, technique);
 }
 
-bool GreenScreenFilterShader::Begin(std::uint32_t width, std::uint32_t height)
+RenderTarget GreenScreenFilterShader::Begin(std::uint32_t width, std::uint32_t height)
 {
-	gs_texrender_reset(m_workTexture);
-	if (!gs_texrender_begin(m_workTexture, width, height))
-		return false;
+	RenderTarget renderTarget = m_renderTargetPool->Acquire(width, height, GS_R8);
+
+	gs_texrender_t* workTexture = renderTarget.GetTexRender();
+	gs_texrender_reset(workTexture);
+	if (!gs_texrender_begin(workTexture, width, height))
+		return {};
 
 	vec4 black = { 0.f, 0.f, 0.f, 1.f };
 	gs_clear(GS_CLEAR_COLOR, &black, 0.f, 0);
 	gs_ortho(0.0f, float(width), 0.0f, float(height), -100.0f, 100.0f);
 
-	return true;
+	return renderTarget;
 }
 
-gs_texture* GreenScreenFilterShader::Process(std::uint32_t width, std::uint32_t height, gs_technique_t* technique)
+RenderTarget GreenScreenFilterShader::Process(RenderTarget renderTarget, std::uint32_t width, std::uint32_t height, gs_technique_t* technique)
 {
 	gs_technique_begin(technique);
 	gs_technique_begin_pass(technique, 0);
@@ -142,7 +126,7 @@ gs_texture* GreenScreenFilterShader::Process(std::uint32_t width, std::uint32_t
 	gs_technique_end_pass(technique);
 	gs_technique_end(technique);
 
-	gs_texrender_end(m_workTexture);
+	gs_texrender_end(renderTarget.GetTexRender());
 
-	return gs_texrender_get_texture(m_workTexture);
+	return renderTarget;
 }
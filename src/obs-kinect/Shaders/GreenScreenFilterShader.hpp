@@ -20,6 +20,8 @@
 #ifndef OBS_KINECT_PLUGIN_GREENSCREENFILTERSHADER
 #define OBS_KINECT_PLUGIN_GREENSCREENFILTERSHADER
 
+#include <obs-kinect/RenderTargetPool.hpp>
+#include <obs-kinect/Shaders/EffectCache.hpp>
 #include <obs-module.h>
 #include <cstdint>
 
@@ -32,12 +34,12 @@ class GreenScreenFilterShader
 		struct BodyWithinDepthFilterParams;
 
 		GreenScreenFilterShader();
-		~GreenScreenFilterShader();
+		~GreenScreenFilterShader() = default;
 
-		gs_texture_t* Filter(std::uint32_t width, std::uint32_t height, const BodyFilterParams& params);
-		gs_texture_t* Filter(std::uint32_t width, std::uint32_t height, const BodyOrDepthFilterParams& params);
-		gs_texture_t* Filter(std::uint32_t width, std::uint32_t height, const BodyWithinDepthFilterParams& params);
-		gs_texture_t* Filter(std::uint32_t width, std::uint32_t height, const DepthFilterParams& params);
+		RenderTarget Filter(std::uint32_t width, std::uint32_t height, const BodyFilterParams& params);
+		RenderTarget Filter(std::uint32_t width, std::uint32_t height, const BodyOrDepthFilterParams& params);
+		RenderTarget Filter(std::uint32_t width, std::uint32_t height, const BodyWithinDepthFilterParams& params);
+		RenderTarget Filter(std::uint32_t width, std::uint32_t height, const DepthFilterParams& params);
 
 		struct BodyFilterParams
 		{
@@ -75,12 +77,13 @@ class GreenScreenFilterShader
 		};
 
 	private:
-		bool Begin(std::uint32_t width, std::uint32_t height);
-		gs_texture* Process(std::uint32_t width, std::uint32_t height, gs_technique_t* technique);
+		RenderTarget Begin(std::uint32_t width, std::uint32_t height);
+		RenderTarget Process(RenderTarget renderTarget, std::uint32_t width, std::uint32_t height, gs_technique_t* technique);
 		template<typename Params> void SetBodyParams(const Params& params);
 		template<typename Params> void SetDepthParams(const Params& params);
 
-		gs_effect_t* m_effect;
+		ObsEffectPtr m_effect;
+		std::shared_ptr<RenderTargetPool> m_renderTargetPool;
 		gs_eparam_t* m_params_BodyIndexImage;
 		gs_eparam_t* m_params_DepthImage;
 		gs_eparam_t* m_params_DepthMappingImage;
@@ -96,7 +99,6 @@ class GreenScreenFilterShader
 		gs_technique_t* m_tech_BodyWithinDepthWithoutDepthCorrection;
 		gs_technique_t* m_tech_DepthOnlyWithDepthCorrection;
 		gs_technique_t* m_tech_DepthOnlyWithoutDepthCorrection;
-		gs_texrender_t* m_workTexture;
 };
 
 #include <obs-kinect/Shaders/GreenScreenFilterShader.inl>
@@ -0,0 +1,155 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect/Shaders/MorphologyShader.hpp>
+#include <obs-kinect-core/Helper.hpp>
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <stdexcept>
+
+MorphologyShader::MorphologyShader()
+{
+	m_effect = EffectCache::Acquire("morphology.effect");
+	m_renderTargetPool = RenderTargetPool::GetSharedPool();
+
+	ObsGraphics gfx;
+
+	m_params_BlockSize = gs_effect_get_param_by_name(m_effect.get(), "BlockSize");
+	m_params_Dilate = gs_effect_get_param_by_name(m_effect.get(), "Dilate");
+	m_params_Filter = gs_effect_get_param_by_name(m_effect.get(), "Filter");
+	m_params_Image = gs_effect_get_param_by_name(m_effect.get(), "Image");
+	m_params_InvImageSize = gs_effect_get_param_by_name(m_effect.get(), "InvImageSize");
+	m_params_Offset = gs_effect_get_param_by_name(m_effect.get(), "Offset");
+	m_params_TargetSize = gs_effect_get_param_by_name(m_effect.get(), "TargetSize");
+	m_tech_Combine = gs_effect_get_technique(m_effect.get(), "Combine");
+	m_tech_Init = gs_effect_get_technique(m_effect.get(), "Init");
+	m_tech_Scan = gs_effect_get_technique(m_effect.get(), "Scan");
+}
+
+RenderTarget MorphologyShader::Apply(gs_texture_t* source, MorphologyOperation operation, std::size_t radius)
+{
+	radius = std::max<std::size_t>(radius, 1);
+
+	switch (operation)
+	{
+		case MorphologyOperation::None:
+			break;
+
+		case MorphologyOperation::Erode:
+			return Filter(source, false, radius);
+
+		case MorphologyOperation::Dilate:
+			return Filter(source, true, radius);
+
+		case MorphologyOperation::Open:
+		{
+			RenderTarget eroded = Filter(source, false, radius);
+			if (!eroded)
+				return {};
+
+			return Filter(eroded.GetTexture(), true, radius);
+		}
+
+		case MorphologyOperation::Close:
+		{
+			RenderTarget dilated = Filter(source, true, radius);
+			if (!dilated)
+				return {};
+
+			return Filter(dilated.GetTexture(), false, radius);
+		}
+	}
+
+	assert(!"unexpected morphology operation");
+	return {};
+}
+
+RenderTarget MorphologyShader::Filter(gs_texture_t* source, bool dilate, std::size_t radius)
+{
+	// Square structuring element is separable: horizontal pass, then vertical pass
+	RenderTarget horizontalTarget = FilterPass(source, dilate, radius, false);
+	if (!horizontalTarget)
+		return {};
+
+	return FilterPass(horizontalTarget.GetTexture(), dilate, radius, true);
+}
+
+RenderTarget MorphologyShader::FilterPass(gs_texture_t* source, bool dilate, std::size_t radius, bool vertical)
+{
+	std::uint32_t width = gs_texture_get_width(source);
+	std::uint32_t height = gs_texture_get_height(source);
+
+	// Block scans work on the line padded by radius on both sides (see morphology.effect)
+	std::uint32_t padding = static_cast<std::uint32_t>(2 * radius);
+	std::uint32_t scanWidth = (vertical) ? width : width + padding;
+	std::uint32_t scanHeight = (vertical) ? height + padding : height;
+
+	std::size_t blockSize = 2 * radius + 1;
+
+	auto RenderPass = [&](const RenderTarget& target, std::uint32_t targetWidth, std::uint32_t targetHeight, gs_technique_t* technique, gs_texture_t* input, float offset)
+	{
+		gs_texrender_t* texRender = target.GetTexRender();
+		gs_texrender_reset(texRender);
+		if (!gs_texrender_begin(texRender, targetWidth, targetHeight))
+			return false;
+
+		gs_ortho(0.0f, float(targetWidth), 0.0f, float(targetHeight), -100.0f, 100.0f);
+
+		vec2 filter = { (vertical) ? 0.f : 1.f, (vertical) ? 1.f : 0.f };
+		vec2 invImageSize = { 1.f / gs_texture_get_width(input), 1.f / gs_texture_get_height(input) };
+		vec2 targetSize = { float(targetWidth), float(targetHeight) };
+
+		gs_effect_set_bool(m_params_Dilate, dilate);
+		gs_effect_set_float(m_params_BlockSize, float(blockSize));
+		gs_effect_set_float(m_params_Offset, offset);
+		gs_effect_set_vec2(m_params_Filter, &filter);
+		gs_effect_set_vec2(m_params_InvImageSize, &invImageSize);
+		gs_effect_set_vec2(m_params_TargetSize, &targetSize);
+		gs_effect_set_texture(m_params_Image, input);
+
+		gs_technique_begin(technique);
+		gs_technique_begin_pass(technique, 0);
+		gs_draw_sprite(nullptr, 0, targetWidth, targetHeight);
+		gs_technique_end_pass(technique);
+		gs_technique_end(technique);
+
+		gs_texrender_end(texRender);
+
+		return true;
+	};
+
+	// Running min/max from the start (R) and the end (G) of each block, over 2, 4, 8, ... texels until the block is covered
+	RenderTarget scanTarget = m_renderTargetPool->Acquire(scanWidth, scanHeight, GS_R8G8);
+	if (!RenderPass(scanTarget, scanWidth, scanHeight, m_tech_Init, source, float(radius)))
+		return {};
+
+	for (std::size_t offset = 2; offset < blockSize; offset *= 2)
+	{
+		RenderTarget nextScanTarget = m_renderTargetPool->Acquire(scanWidth, scanHeight, GS_R8G8);
+		if (!RenderPass(nextScanTarget, scanWidth, scanHeight, m_tech_Scan, scanTarget.GetTexture(), float(offset)))
+			return {};
+
+		scanTarget = std::move(nextScanTarget);
+	}
+
+	RenderTarget outputTarget = m_renderTargetPool->Acquire(width, height, GS_R8);
+	if (!RenderPass(outputTarget, width, height, m_tech_Combine, scanTarget.GetTexture(), float(padding)))
+		return {};
+
+	return outputTarget;
+}
@@ -0,0 +1,57 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_MORPHOLOGYSHADER
+#define OBS_KINECT_PLUGIN_MORPHOLOGYSHADER
+
+#include <obs-kinect-core/MaskMorphology.hpp>
+#include <obs-kinect/RenderTargetPool.hpp>
+#include <obs-kinect/Shaders/EffectCache.hpp>
+#include <obs-module.h>
+#include <cstddef>
+
+// GPU counterpart of MaskMorphology (van Herk/Gil-Werman), cost per pixel grows with log2(radius)
+class MorphologyShader
+{
+	public:
+		MorphologyShader();
+		~MorphologyShader() = default;
+
+		// operation must not be MorphologyOperation::None
+		RenderTarget Apply(gs_texture_t* source, MorphologyOperation operation, std::size_t radius);
+
+	private:
+		RenderTarget Filter(gs_texture_t* source, bool dilate, std::size_t radius);
+		RenderTarget FilterPass(gs_texture_t* source, bool dilate, std::size_t radius, bool vertical);
+
+		ObsEffectPtr m_effect;
+		std::shared_ptr<RenderTargetPool> m_renderTargetPool;
+		gs_eparam_t* m_params_BlockSize;
+		gs_eparam_t* m_params_Dilate;
+		gs_eparam_t* m_params_Filter;
+		gs_eparam_t* m_params_Image;
+		gs_eparam_t* m_params_InvImageSize;
+		gs_eparam_t* m_params_Offset;
+		gs_eparam_t* m_params_TargetSize;
+		gs_technique_t* m_tech_Combine;
+		gs_technique_t* m_tech_Init;
+		gs_technique_t* m_tech_Scan;
+};
+
+#endif
@@ -0,0 +1,97 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-kinect/Shaders/TemporalFilterShader.hpp>
+#include <obs-kinect-core/Helper.hpp>
+#include <algorithm>
+#include <string>
+#include <stdexcept>
+
+TemporalFilterShader::TemporalFilterShader() :
+m_historyIndex(0),
+m_hasHistory(false)
+{
+	m_effect = EffectCache::Acquire("temporal_filter.effect");
+
+	ObsGraphics gfx;
+
+	m_params_CurrentImage = gs_effect_get_param_by_name(m_effect.get(), "CurrentImage");
+	m_params_HistoryFactor = gs_effect_get_param_by_name(m_effect.get(), "HistoryFactor");
+	m_params_HistoryImage = gs_effect_get_param_by_name(m_effect.get(), "HistoryImage");
+	m_params_ResetThreshold = gs_effect_get_param_by_name(m_effect.get(), "ResetThreshold");
+	m_tech_Draw = gs_effect_get_technique(m_effect.get(), "Draw");
+
+	for (gs_texrender_t*& historyTexture : m_historyTextures)
+		historyTexture = gs_texrender_create(GS_R8, GS_ZS_NONE);
+}
+
+TemporalFilterShader::~TemporalFilterShader()
+{
+	ObsGraphics gfx;
+
+	for (gs_texrender_t* historyTexture : m_historyTextures)
+		gs_texrender_destroy(historyTexture);
+}
+
+gs_texture_t* TemporalFilterShader::Filter(gs_texture_t* mask, float historyFactor, float resetThreshold)
+{
+	std::uint32_t width = gs_texture_get_width(mask);
+	std::uint32_t height = gs_texture_get_height(mask);
+
+	gs_texrender_t* historyTexture = m_historyTextures[m_historyIndex];
+	gs_texture_t* history = (m_hasHistory) ? gs_texrender_get_texture(historyTexture) : nullptr;
+	if (!history || gs_texture_get_width(history) != width || gs_texture_get_height(history) != height)
+	{
+		// No usable history (first frame or resolution change), output current mask as-is
+		history = mask;
+		historyFactor = 0.f;
+	}
+
+	m_historyIndex = (m_historyIndex + 1) % m_historyTextures.size();
+	gs_texrender_t* outputTexture = m_historyTextures[m_historyIndex];
+
+	gs_texrender_reset(outputTexture);
+	if (!gs_texrender_begin(outputTexture, width, height))
+	{
+		m_hasHistory = false;
+		return nullptr;
+	}
+
+	gs_ortho(0.0f, float(width), 0.0f, float(height), -100.0f, 100.0f);
+
+	gs_effect_set_texture(m_params_CurrentImage, mask);
+	gs_effect_set_texture(m_params_HistoryImage, history);
+	gs_effect_set_float(m_params_HistoryFactor, historyFactor);
+	gs_effect_set_float(m_params_ResetThreshold, std::max(resetThreshold, 1.f / 255.f));
+
+	gs_technique_begin(m_tech_Draw);
+	gs_technique_begin_pass(m_tech_Draw, 0);
+	gs_draw_sprite(nullptr, 0, width, height);
+	gs_technique_end_pass(m_tech_Draw);
+	gs_technique_end(m_tech_Draw);
+
+	gs_texrender_end(outputTexture);
+
+	m_hasHistory = true;
+
+	return gs_texrender_get_texture(outputTexture);
+}
+
+void TemporalFilterShader::Reset()
+{
+	m_hasHistory = false;
+}
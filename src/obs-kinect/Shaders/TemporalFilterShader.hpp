@@ -0,0 +1,50 @@
+/******************************************************************************
+	Copyright (C) 2021 by Jérôme Leclercq <lynix680@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#ifndef OBS_KINECT_PLUGIN_TEMPORALFILTERSHADER
+#define OBS_KINECT_PLUGIN_TEMPORALFILTERSHADER
+
+#include <obs-kinect/Shaders/EffectCache.hpp>
+#include <obs-module.h>
+#include <array>
+#include <cstddef>
+
+class TemporalFilterShader
+{
+	public:
+		TemporalFilterShader();
+		~TemporalFilterShader();
+
+		gs_texture_t* Filter(gs_texture_t* mask, float historyFactor, float resetThreshold);
+
+		void Reset();
+
+	private:
+		ObsEffectPtr m_effect;
+		gs_eparam_t* m_params_CurrentImage;
+		gs_eparam_t* m_params_HistoryFactor;
+		gs_eparam_t* m_params_HistoryImage;
+		gs_eparam_t* m_params_ResetThreshold;
+		gs_technique_t* m_tech_Draw;
+		std::array<gs_texrender_t*, 2> m_historyTextures; //< last output is read while the new one is written
+		std::size_t m_historyIndex;
+		bool m_hasHistory;
+};
+
+#endif
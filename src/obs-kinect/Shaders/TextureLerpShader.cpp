@@ -22,48 +22,28 @@
 
 TextureLerpShader::TextureLerpShader()
 {
-	ObsMemoryPtr<char> effectFilename(obs_module_file("texture_lerp.effect"));
+	m_effect = EffectCache::Acquire("texture_lerp.effect");
+	m_renderTargetPool = RenderTargetPool::GetSharedPool();
 
 	ObsGraphics gfx;
 
-	char* errStr = nullptr;
-	m_effect = gs_effect_create_from_file(effectFilename.get(), &errStr);
-	ObsMemoryPtr<char> errStrOwner(errStr);
-
-	if (m_effect)
-	{
-		m_params_FactorImage = gs_effect_get_param_by_name(m_effect, "FactorImage");
-		m_params_FromImage = gs_effect_get_param_by_name(m_effect, "FromImage");
-		m_params_ToImage = gs_effect_get_param_by_name(m_effect, "ToImage");
-		m_tech_Draw = gs_effect_get_technique(m_effect, "Draw");
-
-		m_workTexture = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
-	}
-	else
-	{
-		std::string err("failed to create effect: ");
-		err.append((errStr) ? errStr : "shader error");
-
-		throw std::runtime_error(err);
-	}
+	m_params_FactorImage = gs_effect_get_param_by_name(m_effect.get(), "FactorImage");
+	m_params_FromImage = gs_effect_get_param_by_name(m_effect.get(), "FromImage");
+	m_params_ToImage = gs_effect_get_param_by_name(m_effect.get(), "ToImage");
+	m_tech_Draw = gs_effect_get_technique(m_effect.get(), "Draw");
 }
 
-TextureLerpShader::~TextureLerpShader()
-{
-	ObsGraphics gfx;
-
-	gs_effect_destroy(m_effect);
-	gs_texrender_destroy(m_workTexture);
-}
-
-gs_texture_t* TextureLerpShader::Lerp(gs_texture_t* from, gs_texture_t* to, gs_texture_t* factor)
+RenderTarget TextureLerpShader::Lerp(gs_texture_t* from, gs_texture_t* to, gs_texture_t* factor)
 {
 	std::uint32_t colorWidth = gs_texture_get_width(to);
 	std::uint32_t colorHeight = gs_texture_get_height(to);
 
-	gs_texrender_reset(m_workTexture);
-	if (!gs_texrender_begin(m_workTexture, colorWidth, colorHeight))
-		return nullptr;
+	RenderTarget renderTarget = m_renderTargetPool->Acquire(colorWidth, colorHeight, GS_RGBA);
+
+	gs_texrender_t* workTexture = renderTarget.GetTexRender();
+	gs_texrender_reset(workTexture);
+	if (!gs_texrender_begin(workTexture, colorWidth, colorHeight))
+		return {};
 
 	vec4 black = { 0.f, 0.f, 0.f, 0.f };
 	gs_clear(GS_CLEAR_COLOR, &black, 0.f, 0);
@@ -79,7 +59,7 @@ gs_texture_t* TextureLerpShader::Lerp(gs_texture_t* from, gs_texture_t* to, gs_t
 	gs_technique_end_pass(m_tech_Draw);
 	gs_technique_end(m_tech_Draw);
 
-	gs_texrender_end(m_workTexture);
+	gs_texrender_end(workTexture);
 
-	return gs_texrender_get_texture(m_workTexture);
+	return renderTarget;
 }
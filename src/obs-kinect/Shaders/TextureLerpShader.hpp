@@ -20,6 +20,8 @@
 #ifndef OBS_KINECT_PLUGIN_TEXTURELERPSHADER
 #define OBS_KINECT_PLUGIN_TEXTURELERPSHADER
 
+#include <obs-kinect/RenderTargetPool.hpp>
+#include <obs-kinect/Shaders/EffectCache.hpp>
 #include <obs-module.h>
 #include <cstddef>
 
@@ -27,17 +29,17 @@ class TextureLerpShader
 {
 	public:
 		TextureLerpShader();
-		~TextureLerpShader();
+		~TextureLerpShader() = default;
 
-		gs_texture_t* Lerp(gs_texture_t* from, gs_texture_t* to, gs_texture_t* factor);
+		RenderTarget Lerp(gs_texture_t* from, gs_texture_t* to, gs_texture_t* factor);
 
 	private:
-		gs_effect_t* m_effect;
+		ObsEffectPtr m_effect;
+		std::shared_ptr<RenderTargetPool> m_renderTargetPool;
 		gs_eparam_t* m_params_FactorImage;
 		gs_eparam_t* m_params_FromImage;
 		gs_eparam_t* m_params_ToImage;
 		gs_technique_t* m_tech_Draw;
-		gs_texrender_t* m_workTexture;
 };
 
 #endif
@@ -22,47 +22,27 @@
 
 VisibilityMaskShader::VisibilityMaskShader()
 {
-	ObsMemoryPtr<char> effectFilename(obs_module_file("visibility_mask.effect"));
+	m_effect = EffectCache::Acquire("visibility_mask.effect");
+	m_renderTargetPool = RenderTargetPool::GetSharedPool();
 
 	ObsGraphics gfx;
 
-	char* errStr = nullptr;
-	m_effect = gs_effect_create_from_file(effectFilename.get(), &errStr);
-	ObsMemoryPtr<char> errStrOwner(errStr);
-
-	if (m_effect)
-	{
-		m_params_FilterImage = gs_effect_get_param_by_name(m_effect, "FilterImage");
-		m_params_MaskImage = gs_effect_get_param_by_name(m_effect, "MaskImage");
-		m_tech_Draw = gs_effect_get_technique(m_effect, "Draw");
-
-		m_workTexture = gs_texrender_create(GS_R8, GS_ZS_NONE);
-	}
-	else
-	{
-		std::string err("failed to create effect: ");
-		err.append((errStr) ? errStr : "shader error");
-
-		throw std::runtime_error(err);
-	}
+	m_params_FilterImage = gs_effect_get_param_by_name(m_effect.get(), "FilterImage");
+	m_params_MaskImage = gs_effect_get_param_by_name(m_effect.get(), "MaskImage");
+	m_tech_Draw = gs_effect_get_technique(m_effect.get(), "Draw");
 }
 
-VisibilityMaskShader::~VisibilityMaskShader()
-{
-	ObsGraphics gfx;
-
-	gs_effect_destroy(m_effect);
-	gs_texrender_destroy(m_workTexture);
-}
-
-gs_texture_t* VisibilityMaskShader::Mask(gs_texture_t* filter, gs_texture_t* mask)
+RenderTarget VisibilityMaskShader::Mask(gs_texture_t* filter, gs_texture_t* mask)
 {
 	std::uint32_t colorWidth = gs_texture_get_width(filter);
 	std::uint32_t colorHeight = gs_texture_get_height(filter);
 
-	gs_texrender_reset(m_workTexture);
-	if (!gs_texrender_begin(m_workTexture, colorWidth, colorHeight))
-		return nullptr;
+	RenderTarget renderTarget = m_renderTargetPool->Acquire(colorWidth, colorHeight, GS_R8);
+
+	gs_texrender_t* workTexture = renderTarget.GetTexRender();
+	gs_texrender_reset(workTexture);
+	if (!gs_texrender_begin(workTexture, colorWidth, colorHeight))
+		return {};
 
 	vec4 black = { 0.f, 0.f, 0.f, 0.f };
 	gs_clear(GS_CLEAR_COLOR, &black, 0.f, 0);
@@ -77,7 +57,7 @@ gs_texture_t* VisibilityMaskShader::Mask(gs_texture_t* filter, gs_texture_t* mas
 	gs_technique_end_pass(m_tech_Draw);
 	gs_technique_end(m_tech_Draw);
 
-	gs_texrender_end(m_workTexture);
+	gs_texrender_end(workTexture);
 
-	return gs_texrender_get_texture(m_workTexture);
+	return renderTarget;
 }
@@ -20,6 +20,8 @@
 #ifndef OBS_KINECT_PLUGIN_VISIBILITYMASKSHADER
 #define OBS_KINECT_PLUGIN_VISIBILITYMASKSHADER
 
+#include <obs-kinect/RenderTargetPool.hpp>
+#include <obs-kinect/Shaders/EffectCache.hpp>
 #include <obs-module.h>
 #include <cstddef>
 
@@ -27,16 +29,16 @@ class VisibilityMaskShader
 {
 	public:
 		VisibilityMaskShader();
-		~VisibilityMaskShader();
+		~VisibilityMaskShader() = default;
 
-		gs_texture_t* Mask(gs_texture_t* filter, gs_texture_t* mask);
+		RenderTarget Mask(gs_texture_t* filter, gs_texture_t* mask);
 
 	private:
-		gs_effect_t* m_effect;
+		ObsEffectPtr m_effect;
+		std::shared_ptr<RenderTargetPool> m_renderTargetPool;
 		gs_eparam_t* m_params_FilterImage;
 		gs_eparam_t* m_params_MaskImage;
 		gs_technique_t* m_tech_Draw;
-		gs_texrender_t* m_workTexture;
 };
 
 #endif
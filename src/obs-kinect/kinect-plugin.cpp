@@ -16,6 +16,7 @@
 ******************************************************************************/
 
 #include <obs-kinect/KinectDeviceRegistry.hpp>
+#include <obs-kinect/KinectMaskFilter.hpp>
 #include <obs-kinect/KinectSource.hpp>
 #include <obs-module.h>
 #include <array>
@@ -121,7 +122,8 @@ void update_depthinfrared_visibility(obs_properties_t* props, obs_data_t* s)
 
 void update_greenscreen_availability(KinectDevice* device, obs_properties_t* props, obs_data_t* s)
 {
-	bool sourceVisible = get_property_visibility(props, "source");
+	// Mask filter has no source selection (always uses color)
+	bool sourceVisible = !obs_properties_get(props, "source") || get_property_visibility(props, "source");
 
 	SourceFlags source = 0;
 	switch (static_cast<KinectSource::SourceType>(obs_data_get_int(s, "source")))
@@ -155,7 +157,8 @@ void update_greenscreen_availability(KinectDevice* device, obs_properties_t* pro
 
 void update_greenscreen_visibility(obs_properties_t* props, obs_data_t* s)
 {
-	bool enabled = obs_data_get_bool(s, "greenscreen_enabled") && get_property_visibility(props, "greenscreen_enabled");
+	// Mask filter has no enable switch (greenscreen is always enabled)
+	bool enabled = !obs_properties_get(props, "greenscreen_enabled") || (obs_data_get_bool(s, "greenscreen_enabled") && get_property_visibility(props, "greenscreen_enabled"));
 	KinectSource::GreenScreenFilterType type = static_cast<KinectSource::GreenScreenFilterType>(obs_data_get_int(s, "greenscreen_type"));
 
 	set_property_visibility(props, "greenscreen", enabled);
@@ -172,6 +175,12 @@ void update_greenscreen_visibility(obs_properties_t* props, obs_data_t* s)
 	set_property_visibility(props, "greenscreen_blurpasses", blurSettingsVisible);
 	set_property_visibility(props, "greenscreen_gpudepthmapping", blurSettingsVisible);
 
+	MorphologyOperation morphologyOperation = static_cast<MorphologyOperation>(obs_data_get_int(s, "greenscreen_morphology"));
+	set_property_visibility(props, "greenscreen_morphologyradius", enabled && morphologyOperation != MorphologyOperation::None);
+
+	bool temporalEnabled = (obs_data_get_int(s, "greenscreen_temporalframes") > 1);
+	set_property_visibility(props, "greenscreen_temporalthreshold", enabled && temporalEnabled);
+
 	// Green screen effects
 	std::size_t activeEffect = std::min(static_cast<std::size_t>(obs_data_get_int(s, "greenscreen_effect")), s_greenscreenEffects.size() - 1);
 	for (std::size_t i = 0; i < s_greenscreenEffects.size(); ++i)
@@ -192,25 +201,8 @@ void update_device_list(obs_property_t* deviceList)
 	});
 }
 
-static void kinect_source_update(void* data, obs_data_t* settings)
+static KinectSource::GreenScreenSettings read_greenscreen_settings(obs_data_t* settings)
 {
-	KinectSource* kinectSource = static_cast<KinectSource*>(data);
-
-	const char* deviceName = obs_data_get_string(settings, "device");
-
-	kinectSource->UpdateDevice(deviceName);
-	kinectSource->UpdateDeviceParameters(settings);
-
-	kinectSource->SetSourceType(static_cast<KinectSource::SourceType>(obs_data_get_int(settings, "source")));
-	kinectSource->ShouldStopOnHide(obs_data_get_bool(settings, "invisible_shutdown"));
-
-	KinectSource::DepthToColorSettings depthToColor;
-	depthToColor.averageValue = float(obs_data_get_double(settings, "depth_average"));
-	depthToColor.dynamic = obs_data_get_bool(settings, "depth_dynamic");
-	depthToColor.standardDeviation = float(obs_data_get_double(settings, "depth_standard_deviation"));
-
-	kinectSource->UpdateDepthToColor(depthToColor);
-
 	KinectSource::GreenScreenSettings greenScreen;
 	greenScreen.blurPassCount = static_cast<std::size_t>(obs_data_get_int(settings, "greenscreen_blurpasses"));
 	greenScreen.enabled = obs_data_get_bool(settings, "greenscreen_enabled");
@@ -220,6 +212,10 @@ static void kinect_source_update(void* data, obs_data_t* settings)
 	greenScreen.maxDirtyDepth = static_cast<std::uint8_t>(obs_data_get_int(settings, "greenscreen_maxdirtydepth"));
 	greenScreen.gpuDepthMapping = obs_data_get_bool(settings, "greenscreen_gpudepthmapping");
 	greenScreen.filterType = static_cast<KinectSource::GreenScreenFilterType>(obs_data_get_int(settings, "greenscreen_type"));
+	greenScreen.morphologyOperation = static_cast<MorphologyOperation>(obs_data_get_int(settings, "greenscreen_morphology"));
+	greenScreen.morphologyRadius = static_cast<std::size_t>(obs_data_get_int(settings, "greenscreen_morphologyradius"));
+	greenScreen.temporalFrameCount = static_cast<std::size_t>(obs_data_get_int(settings, "greenscreen_temporalframes"));
+	greenScreen.temporalResetThreshold = static_cast<float>(obs_data_get_int(settings, "greenscreen_temporalthreshold")) / 100.f;
 
 	std::size_t activeEffect = std::min(static_cast<std::size_t>(obs_data_get_int(settings, "greenscreen_effect")), s_greenscreenEffects.size() - 1);
 	std::visit([&](auto&& arg)
@@ -231,7 +227,44 @@ static void kinect_source_update(void* data, obs_data_t* settings)
 
 	}, s_greenscreenEffects[activeEffect].value);
 
-	kinectSource->UpdateGreenScreen(std::move(greenScreen));
+	return greenScreen;
+}
+
+static void kinect_source_update(void* data, obs_data_t* settings)
+{
+	KinectSource* kinectSource = static_cast<KinectSource*>(data);
+
+	const char* deviceName = obs_data_get_string(settings, "device");
+
+	kinectSource->UpdateDevice(deviceName);
+	kinectSource->UpdateDeviceParameters(settings);
+	kinectSource->UpdateIdleReleaseDelay(static_cast<std::uint64_t>(obs_data_get_int(settings, "device_idle_release")) * 1'000'000'000ULL);
+	kinectSource->UpdateKeepAliveDelay(static_cast<std::uint64_t>(obs_data_get_int(settings, "device_keep_alive")) * 1'000'000ULL);
+	kinectSource->UpdateMaxFrameRate(static_cast<std::uint32_t>(obs_data_get_int(settings, "max_framerate")));
+
+	// Output size is stored as its height (16:9), 0 being native resolution
+	std::uint32_t outputHeight = static_cast<std::uint32_t>(obs_data_get_int(settings, "output_size"));
+	kinectSource->UpdateOutputSize(outputHeight * 16 / 9, outputHeight);
+
+	KinectDevice::ServiceSettings serviceSettings;
+	serviceSettings.networkPort = static_cast<std::uint16_t>(obs_data_get_int(settings, "network_port"));
+	serviceSettings.replayBufferDuration = static_cast<std::uint64_t>(obs_data_get_int(settings, "replay_buffer_duration")) * 1'000'000'000ULL;
+	serviceSettings.replayBufferMemory = static_cast<std::size_t>(obs_data_get_int(settings, "replay_buffer_memory")) * 1024 * 1024;
+	serviceSettings.shareFrames = obs_data_get_bool(settings, "device_share");
+
+	kinectSource->UpdateServiceSettings(serviceSettings);
+
+	kinectSource->SetSourceType(static_cast<KinectSource::SourceType>(obs_data_get_int(settings, "source")));
+	kinectSource->ShouldStopOnHide(obs_data_get_bool(settings, "invisible_shutdown"));
+
+	KinectSource::DepthToColorSettings depthToColor;
+	depthToColor.averageValue = float(obs_data_get_double(settings, "depth_average"));
+	depthToColor.dynamic = obs_data_get_bool(settings, "depth_dynamic");
+	depthToColor.standardDeviation = float(obs_data_get_double(settings, "depth_standard_deviation"));
+
+	kinectSource->UpdateDepthToColor(depthToColor);
+
+	kinectSource->UpdateGreenScreen(read_greenscreen_settings(settings));
 
 	KinectSource::InfraredToColorSettings infraredToColor;
 	infraredToColor.averageValue = float(obs_data_get_double(settings, "infrared_average"));
@@ -243,9 +276,9 @@ static void kinect_source_update(void* data, obs_data_t* settings)
 	kinectSource->UpdateVisibilityMaskFile(obs_data_get_string(settings, "greenscreen_visibilitymaskpath"));
 }
 
-static void* kinect_source_create(obs_data_t* settings, obs_source_t* source)
+static void* kinect_source_create(obs_data_t* settings, obs_source_t* source, KinectSource::ProcessingMode processingMode)
 {
-	KinectSource* kinect = new KinectSource(s_deviceRegistry, source);
+	KinectSource* kinect = new KinectSource(s_deviceRegistry, source, processingMode);
 	kinect_source_update(kinect, settings);
 
 	kinect->OnVisibilityUpdate(obs_source_showing(source));
@@ -259,6 +292,109 @@ static void kinect_source_destroy(void *data)
 	delete kinectSource;
 }
 
+static obs_properties_t* build_greenscreen_properties()
+{
+	obs_property_t* p;
+
+	obs_properties_t* greenscreenProps = obs_properties_create();
+
+	// Greenscreen filter type (body, depth, ...)
+	p = obs_properties_add_list(greenscreenProps, "greenscreen_type", obs_module_text("ObsKinect.GreenScreenType"), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	for (const GreenScreenType& greenscreen : s_greenscreenTypes)
+		obs_property_list_add_int(p, obs_module_text(greenscreen.text), static_cast<int>(greenscreen.value));
+
+	obs_property_set_modified_callback(p, [](obs_properties_t* props, obs_property_t*, obs_data_t* s)
+	{
+		update_greenscreen_visibility(props, s);
+		return true;
+	});
+
+	std::string filter = obs_module_text("BrowsePath.Images");
+	filter += " (*.bmp *.jpg *.jpeg *.tga *.gif *.png);;";
+	filter += obs_module_text("BrowsePath.AllFiles");
+	filter += " (*.*)";
+
+	obs_properties_add_path(greenscreenProps, "greenscreen_visibilitymaskpath", obs_module_text("ObsKinect.GreenScreenVisibilityMask"), OBS_PATH_FILE, filter.data(), nullptr);
+
+	// Greenscreen effect (remove background, blur background, ...)
+	p = obs_properties_add_list(greenscreenProps, "greenscreen_effect", obs_module_text("ObsKinect.GreenScreenEffect"), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	for (std::size_t i = 0; i < s_greenscreenEffects.size(); ++i)
+	{
+		const GreenScreenEffect& effectType = s_greenscreenEffects[i];
+		obs_property_list_add_int(p, obs_module_text(effectType.text), static_cast<long long>(i));
+
+		obs_properties_t* effectProperties;
+		std::visit([&](auto&& arg)
+		{
+			using T = std::decay_t<decltype(arg)>;
+			using E = typename T::Effect;
+
+			effectProperties = E::BuildProperties();
+
+		}, effectType.value);
+
+		if (effectProperties)
+			obs_properties_add_group(greenscreenProps, effectType.name, obs_module_text(effectType.text), OBS_GROUP_NORMAL, effectProperties);
+	}
+	
+	obs_property_set_modified_callback(p, [](obs_properties_t* props, obs_property_t*, obs_data_t* s)
+	{
+		update_greenscreen_visibility(props, s);
+		return true;
+	});
+
+	p = obs_properties_add_int_slider(greenscreenProps, "greenscreen_maxdist", obs_module_text("ObsKinect.GreenScreenMaxDist"), 0, 10000, 10);
+	obs_property_int_set_suffix(p, obs_module_text("ObsKinect.GreenScreenDistUnit"));
+
+	p = obs_properties_add_int_slider(greenscreenProps, "greenscreen_mindist", obs_module_text("ObsKinect.GreenScreenMinDist"), 0, 10000, 10);
+	obs_property_int_set_suffix(p, obs_module_text("ObsKinect.GreenScreenDistUnit"));
+
+	p = obs_properties_add_int_slider(greenscreenProps, "greenscreen_fadedist", obs_module_text("ObsKinect.GreenScreenFadeDist"), 0, 2000, 1);
+	obs_property_int_set_suffix(p, obs_module_text("ObsKinect.GreenScreenDistUnit"));
+
+	// Mask cleanup (erode, dilate, ...)
+	p = obs_properties_add_list(greenscreenProps, "greenscreen_morphology", obs_module_text("ObsKinect.GreenScreenMorphology"), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(p, obs_module_text("ObsKinect.GreenScreenMorphology_None"), static_cast<int>(MorphologyOperation::None));
+	obs_property_list_add_int(p, obs_module_text("ObsKinect.GreenScreenMorphology_Erode"), static_cast<int>(MorphologyOperation::Erode));
+	obs_property_list_add_int(p, obs_module_text("ObsKinect.GreenScreenMorphology_Dilate"), static_cast<int>(MorphologyOperation::Dilate));
+	obs_property_list_add_int(p, obs_module_text("ObsKinect.GreenScreenMorphology_Open"), static_cast<int>(MorphologyOperation::Open));
+	obs_property_list_add_int(p, obs_module_text("ObsKinect.GreenScreenMorphology_Close"), static_cast<int>(MorphologyOperation::Close));
+	obs_property_set_long_description(p, obs_module_text("ObsKinect.GreenScreenMorphologyDesc"));
+
+	obs_property_set_modified_callback(p, [](obs_properties_t* props, obs_property_t*, obs_data_t* s)
+	{
+		update_greenscreen_visibility(props, s);
+		return true;
+	});
+
+	p = obs_properties_add_int_slider(greenscreenProps, "greenscreen_morphologyradius", obs_module_text("ObsKinect.GreenScreenMorphologyRadius"), 1, 100, 1);
+	obs_property_int_set_suffix(p, obs_module_text("ObsKinect.GreenScreenPixelUnit"));
+
+	// Temporal stabilization
+	p = obs_properties_add_int_slider(greenscreenProps, "greenscreen_temporalframes", obs_module_text("ObsKinect.GreenScreenTemporalFrames"), 1, 15, 1);
+	obs_property_set_long_description(p, obs_module_text("ObsKinect.GreenScreenTemporalFramesDesc"));
+
+	obs_property_set_modified_callback(p, [](obs_properties_t* props, obs_property_t*, obs_data_t* s)
+	{
+		update_greenscreen_visibility(props, s);
+		return true;
+	});
+
+	p = obs_properties_add_int_slider(greenscreenProps, "greenscreen_temporalthreshold", obs_module_text("ObsKinect.GreenScreenTemporalThreshold"), 1, 100, 1);
+	obs_property_int_set_suffix(p, "%");
+	obs_property_set_long_description(p, obs_module_text("ObsKinect.GreenScreenTemporalThresholdDesc"));
+
+	obs_properties_add_int_slider(greenscreenProps, "greenscreen_blurpasses", obs_module_text("ObsKinect.GreenScreenBlurPassCount"), 0, 20, 1);
+
+	p = obs_properties_add_int_slider(greenscreenProps, "greenscreen_maxdirtydepth", obs_module_text("ObsKinect.GreenScreenMaxDirtyDepth"), 0, 30, 1);
+	obs_property_set_long_description(p, obs_module_text("ObsKinect.GreenScreenMaxDirtyDepthDesc"));
+
+	p = obs_properties_add_bool(greenscreenProps, "greenscreen_gpudepthmapping", obs_module_text("ObsKinect.GreenScreenGpuDepthMapping"));
+	obs_property_set_long_description(p, obs_module_text("ObsKinect.GreenScreenGpuDepthMappingDesc"));
+
+	return greenscreenProps;
+}
+
 static obs_properties_t* kinect_source_properties(void *unused)
 {
 	UNUSED_PARAMETER(unused);
@@ -268,6 +404,14 @@ static obs_properties_t* kinect_source_properties(void *unused)
 
 	obs_properties_add_bool(props, "invisible_shutdown", obs_module_text("ObsKinect.InvisibleShutdown"));
 
+	p = obs_properties_add_int(props, "device_keep_alive", obs_module_text("ObsKinect.KeepAliveDelay"), 0, 60'000, 100);
+	obs_property_int_set_suffix(p, " ms");
+	obs_property_set_long_description(p, obs_module_text("ObsKinect.KeepAliveDelayDesc"));
+
+	p = obs_properties_add_int(props, "device_idle_release", obs_module_text("ObsKinect.IdleReleaseDelay"), 0, 3600, 1);
+	obs_property_int_set_suffix(p, " s");
+	obs_property_set_long_description(p, obs_module_text("ObsKinect.IdleReleaseDelayDesc"));
+
 	// Device selection
 	p = obs_properties_add_list(props, "device", obs_module_text("ObsKinect.Device"), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
 
@@ -282,6 +426,31 @@ static obs_properties_t* kinect_source_properties(void *unused)
 		return true;
 	});
 
+	obs_properties_add_button(props, "device_record", obs_module_text("ObsKinect.ToggleRecording"), [](obs_properties_t* /*props*/, obs_property_t* /*property*/, void* data)
+	{
+		static_cast<KinectSource*>(data)->ToggleRecording();
+		return false;
+	});
+
+	p = obs_properties_add_bool(props, "device_share", obs_module_text("ObsKinect.ShareFrames"));
+	obs_property_set_long_description(p, obs_module_text("ObsKinect.ShareFramesDesc"));
+
+	p = obs_properties_add_int(props, "network_port", obs_module_text("ObsKinect.NetworkPort"), 0, 65535, 1);
+	obs_property_set_long_description(p, obs_module_text("ObsKinect.NetworkPortDesc"));
+
+	p = obs_properties_add_int_slider(props, "replay_buffer_memory", obs_module_text("ObsKinect.ReplayBufferMemory"), 0, 8192, 64);
+	obs_property_int_set_suffix(p, " MB");
+	obs_property_set_long_description(p, obs_module_text("ObsKinect.ReplayBufferMemoryDesc"));
+
+	p = obs_properties_add_int(props, "replay_buffer_duration", obs_module_text("ObsKinect.ReplayBufferDuration"), 1, 600, 1);
+	obs_property_int_set_suffix(p, " s");
+
+	obs_properties_add_button(props, "device_replay_save", obs_module_text("ObsKinect.SaveReplayBuffer"), [](obs_properties_t* /*props*/, obs_property_t* /*property*/, void* data)
+	{
+		static_cast<KinectSource*>(data)->SaveReplayBuffer();
+		return false;
+	});
+
 	s_deviceRegistry->ForEachDevice([&](const std::string& /*pluginName*/, const std::string& uniqueName, const KinectDevice& device)
 	{
 		obs_properties_t* deviceProperties = device.CreateProperties();
@@ -343,6 +512,17 @@ static obs_properties_t* kinect_source_properties(void *unused)
 		return true;
 	});
 
+	p = obs_properties_add_list(props, "output_size", obs_module_text("ObsKinect.OutputSize"), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(p, obs_module_text("ObsKinect.OutputSize_Native"), 0);
+	for (int height : { 2160, 1440, 1080, 720, 540, 360 })
+		obs_property_list_add_int(p, (std::to_string(height * 16 / 9) + "x" + std::to_string(height)).c_str(), height);
+
+	obs_property_set_long_description(p, obs_module_text("ObsKinect.OutputSizeDesc"));
+
+	p = obs_properties_add_int(props, "max_framerate", obs_module_text("ObsKinect.MaxFrameRate"), 0, 120, 1);
+	obs_property_int_set_suffix(p, " fps");
+	obs_property_set_long_description(p, obs_module_text("ObsKinect.MaxFrameRateDesc"));
+
 	// Depth/infrared to color settings
 	obs_properties_add_bool(props, "depth_dynamic", obs_module_text("ObsKinect.DepthDynamic"));
 	obs_properties_add_float_slider(props, "depth_average", obs_module_text("ObsKinect.DepthAverage"), 0.0, 1.0, 0.005);
@@ -360,73 +540,37 @@ static obs_properties_t* kinect_source_properties(void *unused)
 		return true;
 	});
 
-	obs_properties_t* greenscreenProps = obs_properties_create();
-
-	// Greenscreen filter type (body, depth, ...)
-	p = obs_properties_add_list(greenscreenProps, "greenscreen_type", obs_module_text("ObsKinect.GreenScreenType"), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
-	for (const GreenScreenType& greenscreen : s_greenscreenTypes)
-		obs_property_list_add_int(p, obs_module_text(greenscreen.text), static_cast<int>(greenscreen.value));
-
-	obs_property_set_modified_callback(p, [](obs_properties_t* props, obs_property_t*, obs_data_t* s)
-	{
-		update_greenscreen_visibility(props, s);
-		return true;
-	});
+	obs_properties_t* greenscreenProps = build_greenscreen_properties();
+	obs_properties_add_group(props, "greenscreen", obs_module_text("ObsKinect.GreenScreen"), OBS_GROUP_NORMAL, greenscreenProps);
 
-	std::string filter = obs_module_text("BrowsePath.Images");
-	filter += " (*.bmp *.jpg *.jpeg *.tga *.gif *.png);;";
-	filter += obs_module_text("BrowsePath.AllFiles");
-	filter += " (*.*)";
+	return props;
+}
 
-	obs_properties_add_path(greenscreenProps, "greenscreen_visibilitymaskpath", obs_module_text("ObsKinect.GreenScreenVisibilityMask"), OBS_PATH_FILE, filter.data(), nullptr);
+static void set_greenscreen_defaults(obs_data_t* settings)
+{
+	obs_data_set_default_bool(settings, "greenscreen_gpudepthmapping", true);
+	obs_data_set_default_int(settings, "greenscreen_blurpasses", 3);
+	obs_data_set_default_int(settings, "greenscreen_effect", 0);
+	obs_data_set_default_int(settings, "greenscreen_fadedist", 100);
+	obs_data_set_default_int(settings, "greenscreen_maxdist", 1200);
+	obs_data_set_default_int(settings, "greenscreen_mindist", 1);
+	obs_data_set_default_int(settings, "greenscreen_maxdirtydepth", 0);
+	obs_data_set_default_int(settings, "greenscreen_morphology", static_cast<int>(MorphologyOperation::None));
+	obs_data_set_default_int(settings, "greenscreen_morphologyradius", 1);
+	obs_data_set_default_int(settings, "greenscreen_temporalframes", 1);
+	obs_data_set_default_int(settings, "greenscreen_temporalthreshold", 50);
+	obs_data_set_default_int(settings, "greenscreen_type", static_cast<int>(KinectSource::GreenScreenFilterType::Depth));
 
-	// Greenscreen effect (remove background, blur background, ...)
-	p = obs_properties_add_list(greenscreenProps, "greenscreen_effect", obs_module_text("ObsKinect.GreenScreenEffect"), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
-	for (std::size_t i = 0; i < s_greenscreenEffects.size(); ++i)
+	for (const GreenScreenEffect& effectType : s_greenscreenEffects)
 	{
-		const GreenScreenEffect& effectType = s_greenscreenEffects[i];
-		obs_property_list_add_int(p, obs_module_text(effectType.text), static_cast<long long>(i));
-
-		obs_properties_t* effectProperties;
 		std::visit([&](auto&& arg)
 		{
 			using T = std::decay_t<decltype(arg)>;
 			using E = typename T::Effect;
 
-			effectProperties = E::BuildProperties();
-
+			E::SetDefaultValues(settings);
 		}, effectType.value);
-
-		if (effectProperties)
-			obs_properties_add_group(greenscreenProps, effectType.name, obs_module_text(effectType.text), OBS_GROUP_NORMAL, effectProperties);
 	}
-	
-	obs_property_set_modified_callback(p, [](obs_properties_t* props, obs_property_t*, obs_data_t* s)
-	{
-		update_greenscreen_visibility(props, s);
-		return true;
-	});
-
-	p = obs_properties_add_int_slider(greenscreenProps, "greenscreen_maxdist", obs_module_text("ObsKinect.GreenScreenMaxDist"), 0, 10000, 10);
-	obs_property_int_set_suffix(p, obs_module_text("ObsKinect.GreenScreenDistUnit"));
-
-	p = obs_properties_add_int_slider(greenscreenProps, "greenscreen_mindist", obs_module_text("ObsKinect.GreenScreenMinDist"), 0, 10000, 10);
-	obs_property_int_set_suffix(p, obs_module_text("ObsKinect.GreenScreenDistUnit"));
-
-	p = obs_properties_add_int_slider(greenscreenProps, "greenscreen_fadedist", obs_module_text("ObsKinect.GreenScreenFadeDist"), 0, 2000, 1);
-	obs_property_int_set_suffix(p, obs_module_text("ObsKinect.GreenScreenDistUnit"));
-
-	obs_properties_add_int_slider(greenscreenProps, "greenscreen_blurpasses", obs_module_text("ObsKinect.GreenScreenBlurPassCount"), 0, 20, 1);
-
-	p = obs_properties_add_int_slider(greenscreenProps, "greenscreen_maxdirtydepth", obs_module_text("ObsKinect.GreenScreenMaxDirtyDepth"), 0, 30, 1);
-	obs_property_set_long_description(p, obs_module_text("ObsKinect.GreenScreenMaxDirtyDepthDesc"));
-
-	p = obs_properties_add_bool(greenscreenProps, "greenscreen_gpudepthmapping", obs_module_text("ObsKinect.GreenScreenGpuDepthMapping"));
-	obs_property_set_long_description(p, obs_module_text("ObsKinect.GreenScreenGpuDepthMappingDesc"));
-
-	obs_properties_add_group(props, "greenscreen", obs_module_text("ObsKinect.GreenScreen"), OBS_GROUP_NORMAL, greenscreenProps);
-
-	return props;
 }
 
 static void kinect_source_defaults(obs_data_t* settings)
@@ -442,6 +586,14 @@ static void kinect_source_defaults(obs_data_t* settings)
 
 	obs_data_set_default_int(settings, "source", static_cast<int>(KinectSource::SourceType::Color));
 	obs_data_set_default_bool(settings, "invisible_shutdown", true);
+	obs_data_set_default_bool(settings, "device_share", false);
+	obs_data_set_default_int(settings, "device_idle_release", static_cast<int>(KinectDevice::DefaultIdleReleaseDelay / 1'000'000'000ULL));
+	obs_data_set_default_int(settings, "device_keep_alive", static_cast<int>(KinectDevice::DefaultKeepAliveDelay / 1'000'000ULL));
+	obs_data_set_default_int(settings, "max_framerate", 0);
+	obs_data_set_default_int(settings, "network_port", 0);
+	obs_data_set_default_int(settings, "output_size", 0);
+	obs_data_set_default_int(settings, "replay_buffer_duration", 30);
+	obs_data_set_default_int(settings, "replay_buffer_memory", 0);
 	obs_data_set_default_double(settings, "depth_average", 0.015);
 	obs_data_set_default_bool(settings, "depth_dynamic", false);
 	obs_data_set_default_double(settings, "depth_standard_deviation", 3);
@@ -449,14 +601,8 @@ static void kinect_source_defaults(obs_data_t* settings)
 	obs_data_set_default_bool(settings, "infrared_dynamic", false);
 	obs_data_set_default_double(settings, "infrared_standard_deviation", 3);
 	obs_data_set_default_bool(settings, "greenscreen_enabled", false);
-	obs_data_set_default_bool(settings, "greenscreen_gpudepthmapping", true);
-	obs_data_set_default_int(settings, "greenscreen_blurpasses", 3);
-	obs_data_set_default_int(settings, "greenscreen_effect", 0);
-	obs_data_set_default_int(settings, "greenscreen_fadedist", 100);
-	obs_data_set_default_int(settings, "greenscreen_maxdist", 1200);
-	obs_data_set_default_int(settings, "greenscreen_mindist", 1);
-	obs_data_set_default_int(settings, "greenscreen_maxdirtydepth", 0);
-	obs_data_set_default_int(settings, "greenscreen_type", static_cast<int>(KinectSource::GreenScreenFilterType::Depth));
+
+	set_greenscreen_defaults(settings);
 	
 	// Register default values
 	s_deviceRegistry->ForEachDevice([=](const std::string& /*pluginName*/, const std::string& /*uniqueName*/, const KinectDevice& device)
@@ -464,17 +610,6 @@ static void kinect_source_defaults(obs_data_t* settings)
 		device.SetDefaultValues(settings);
 		return true;
 	});
-
-	for (const GreenScreenEffect& effectType : s_greenscreenEffects)
-	{
-		std::visit([&](auto&& arg)
-		{
-			using T = std::decay_t<decltype(arg)>;
-			using E = typename T::Effect;
-
-			E::SetDefaultValues(settings);
-		}, effectType.value);
-	}
 }
 
 static void kinect_video_render(void* data, gs_effect_t* /*effect*/)
@@ -496,7 +631,7 @@ void RegisterKinectSource()
 	info.type = OBS_SOURCE_TYPE_INPUT;
 	info.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW;
 	info.get_name = [](void*) { return obs_module_text("ObsKinect.KinectSource"); };
-	info.create = kinect_source_create;
+	info.create = [](obs_data_t* settings, obs_source_t* source) { return kinect_source_create(settings, source, KinectSource::ProcessingMode::GPU); };
 	info.destroy = kinect_source_destroy;
 	info.update = kinect_source_update;
 	info.get_defaults = kinect_source_defaults;
@@ -512,6 +647,160 @@ void RegisterKinectSource()
 	obs_register_source(&info);
 }
 
+void RegisterKinectCpuSource()
+{
+	// Same source but processed on the CPU, for machines with software rendering or a weak GPU
+	// Frames are output as async video, which libobs uploads once and uses to compute the size
+	struct obs_source_info info = {};
+	info.id = "kinect_source_cpu";
+	info.type = OBS_SOURCE_TYPE_INPUT;
+	info.output_flags = OBS_SOURCE_ASYNC_VIDEO;
+	info.get_name = [](void*) { return obs_module_text("ObsKinect.KinectSourceCpu"); };
+	info.create = [](obs_data_t* settings, obs_source_t* source) { return kinect_source_create(settings, source, KinectSource::ProcessingMode::CPU); };
+	info.destroy = kinect_source_destroy;
+	info.update = kinect_source_update;
+	info.get_defaults = kinect_source_defaults;
+	info.get_properties = kinect_source_properties;
+	info.video_tick = kinect_video_tick;
+	info.show = [](void* data) { static_cast<KinectSource*>(data)->OnVisibilityUpdate(true); };
+	info.hide = [](void* data) { static_cast<KinectSource*>(data)->OnVisibilityUpdate(false); };
+	info.icon_type = OBS_ICON_TYPE_CAMERA;
+
+	obs_register_source(&info);
+}
+
+static void kinect_mask_filter_update(void* data, obs_data_t* settings)
+{
+	KinectMaskFilter* maskFilter = static_cast<KinectMaskFilter*>(data);
+
+	maskFilter->UpdateDevice(obs_data_get_string(settings, "device"));
+	maskFilter->UpdateDeviceParameters(settings);
+	maskFilter->ShouldStopOnHide(obs_data_get_bool(settings, "invisible_shutdown"));
+	maskFilter->UpdateGreenScreen(read_greenscreen_settings(settings));
+	maskFilter->UpdateVisibilityMaskFile(obs_data_get_string(settings, "greenscreen_visibilitymaskpath"));
+}
+
+static void* kinect_mask_filter_create(obs_data_t* settings, obs_source_t* source)
+{
+	KinectMaskFilter* maskFilter = new KinectMaskFilter(s_deviceRegistry, source);
+	kinect_mask_filter_update(maskFilter, settings);
+
+	maskFilter->OnVisibilityUpdate(obs_source_showing(source));
+
+	return maskFilter;
+}
+
+static void kinect_mask_filter_destroy(void* data)
+{
+	KinectMaskFilter* maskFilter = static_cast<KinectMaskFilter*>(data);
+	delete maskFilter;
+}
+
+static obs_properties_t* kinect_mask_filter_properties(void* /*data*/)
+{
+	obs_properties_t* props = obs_properties_create();
+	obs_property_t* p;
+
+	obs_properties_add_bool(props, "invisible_shutdown", obs_module_text("ObsKinect.InvisibleShutdown"));
+
+	// Device selection
+	p = obs_properties_add_list(props, "device", obs_module_text("ObsKinect.Device"), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+
+	update_device_list(p);
+
+	obs_properties_add_button(props, "device_refresh", obs_module_text("ObsKinect.RefreshDevices"), [](obs_properties_t* props, obs_property_t* /*property*/, void* /*data*/)
+	{
+		s_deviceRegistry->Refresh();
+
+		obs_property_t* deviceList = obs_properties_get(props, "device");
+		update_device_list(deviceList);
+		return true;
+	});
+
+	s_deviceRegistry->ForEachDevice([&](const std::string& /*pluginName*/, const std::string& uniqueName, const KinectDevice& device)
+	{
+		obs_properties_t* deviceProperties = device.CreateProperties();
+		if (deviceProperties)
+			obs_properties_add_group(props, ("device_properties_" + uniqueName).c_str(), device.GetUniqueName().c_str(), OBS_GROUP_NORMAL, deviceProperties);
+
+		return true;
+	});
+
+	obs_property_set_modified_callback(p, [](obs_properties_t* props, obs_property_t*, obs_data_t* s)
+	{
+		s_deviceRegistry->ForEachDevice([=](const std::string& /*pluginName*/, const std::string& uniqueName, const KinectDevice& /*device*/)
+		{
+			set_property_visibility(props, ("device_properties_" + uniqueName).c_str(), false);
+			return true;
+		});
+
+		std::string selectedDevice = obs_data_get_string(s, "device");
+		if (KinectDevice* device = s_deviceRegistry->GetDevice(selectedDevice))
+		{
+			set_property_visibility(props, ("device_properties_" + selectedDevice).c_str(), true);
+			update_greenscreen_availability(device, props, s);
+		}
+
+		update_greenscreen_visibility(props, s);
+
+		return true;
+	});
+
+	obs_properties_t* greenscreenProps = build_greenscreen_properties();
+	obs_properties_add_group(props, "greenscreen", obs_module_text("ObsKinect.GreenScreen"), OBS_GROUP_NORMAL, greenscreenProps);
+
+	return props;
+}
+
+static void kinect_mask_filter_defaults(obs_data_t* settings)
+{
+	obs_data_set_default_string(settings, "device", NoDevice);
+
+	// Set the first device of the list as the default one
+	s_deviceRegistry->ForEachDevice([=](const std::string& /*pluginName*/, const std::string& uniqueName, const KinectDevice& /*device*/)
+	{
+		obs_data_set_default_string(settings, "device", uniqueName.c_str());
+		return false; //< Stop at first device
+	});
+
+	obs_data_set_default_bool(settings, "invisible_shutdown", true);
+
+	set_greenscreen_defaults(settings);
+
+	// Register default values
+	s_deviceRegistry->ForEachDevice([=](const std::string& /*pluginName*/, const std::string& /*uniqueName*/, const KinectDevice& device)
+	{
+		device.SetDefaultValues(settings);
+		return true;
+	});
+}
+
+void RegisterKinectMaskFilter()
+{
+	struct obs_source_info info = {};
+	info.id = "kinect_mask_filter";
+	info.type = OBS_SOURCE_TYPE_FILTER;
+	info.output_flags = OBS_SOURCE_VIDEO;
+	info.get_name = [](void*) { return obs_module_text("ObsKinect.KinectMaskFilter"); };
+	info.create = kinect_mask_filter_create;
+	info.destroy = kinect_mask_filter_destroy;
+	info.update = kinect_mask_filter_update;
+	info.get_defaults = kinect_mask_filter_defaults;
+	info.get_properties = kinect_mask_filter_properties;
+	info.video_render = [](void* data, gs_effect_t* /*effect*/) { static_cast<KinectMaskFilter*>(data)->Render(); };
+	info.video_tick = [](void* data, float seconds) { static_cast<KinectMaskFilter*>(data)->Update(seconds); };
+	info.show = [](void* data) { static_cast<KinectMaskFilter*>(data)->OnVisibilityUpdate(true); };
+	info.hide = [](void* data) { static_cast<KinectMaskFilter*>(data)->OnVisibilityUpdate(false); };
+
+	obs_register_source(&info);
+}
+
+static void kinect_registry_tick(void* /*param*/, float /*seconds*/)
+{
+	// Devices plugged/unplugged are reported asynchronously by plugins, before sources tick
+	s_deviceRegistry->ProcessHotplugEvents();
+}
+
 OBSKINECT_EXPORT bool obs_module_load()
 {
 	if (obs_get_version() < MAKE_SEMANTIC_VERSION(25, 0, 0))
@@ -529,18 +818,37 @@ OBSKINECT_EXPORT bool obs_module_load()
 	s_deviceRegistry->RegisterPlugin("obs-kinect-azuresdk");
 	s_deviceRegistry->RegisterPlugin("obs-kinect-freenect");
 	s_deviceRegistry->RegisterPlugin("obs-kinect-freenect2");
+	s_deviceRegistry->RegisterPlugin("obs-kinect-net");
+	s_deviceRegistry->RegisterPlugin("obs-kinect-playback");
 	s_deviceRegistry->RegisterPlugin("obs-kinect-sdk10");
 	s_deviceRegistry->RegisterPlugin("obs-kinect-sdk20");
+	s_deviceRegistry->RegisterPlugin("obs-kinect-shm");
+	s_deviceRegistry->RegisterPlugin("obs-kinect-synthetic"); //< Only present in development builds
 
-	s_deviceRegistry->Refresh();
+	// Plugins enumerate their devices in background while OBS loads other modules, obs_module_post_load waits for them
+	// (it's only called since OBS 26)
+	if (obs_get_version() < MAKE_SEMANTIC_VERSION(26, 0, 0))
+		s_deviceRegistry->WaitForPlugins();
 
 	RegisterKinectSource();
+	RegisterKinectCpuSource();
+	RegisterKinectMaskFilter();
+
+	obs_add_tick_callback(kinect_registry_tick, nullptr);
+
 	return true;
 }
 
+OBSKINECT_EXPORT void obs_module_post_load()
+{
+	s_deviceRegistry->WaitForPlugins();
+}
+
 OBSKINECT_EXPORT void obs_module_unload()
 {
 	infolog("unloading obs-kinect");
+
+	obs_remove_tick_callback(kinect_registry_tick, nullptr);
 	s_deviceRegistry.reset();
 
 	SetTranslateFunction(nullptr);
@@ -98,6 +98,12 @@ add_requires("k4abt-headers", { optional = true })
 add_requireconfs("libusb", "*.libusb", { configs = { pic = true, shared = is_plat("windows") }})
 add_requireconfs("libfreenect2", "libfreenect2.libjpeg-turbo", { configs = { shared = not is_plat("windows") }})
 
+option("headless")
+	set_default(false)
+	set_showmenu(true)
+	set_description("Link against obs-headless (a libobs replacement recording graphics calls) instead of libobs, to run obs-kinect-pipelinetest")
+option_end()
+
 if is_plat("windows") then
 	add_requires("kinect-sdk1", "kinect-sdk2", { optional = true })
 	add_requires("kinect-sdk1-toolkit", { optional = true, configs = { background_removal = true, facetrack = false, fusion = false, interaction = false, shared = true }})
@@ -132,7 +138,9 @@ else
 	add_linkdirs(baseObsDir)
 end
 
-add_links("obs")
+if not has_config("headless") then
+	add_links("obs")
+end
 
 if is_plat("windows") then
 	add_defines("NOMINMAX", "WIN32_LEAN_AND_MEAN")
@@ -140,24 +148,50 @@ if is_plat("windows") then
 	add_cxflags("/w44062") -- Enable warning: Switch case not handled warning
 	add_cxflags("/wd4251") -- Disable warning: class needs to have dll-interface to be used by clients of class blah blah blah
 elseif is_plat("linux") then
-	add_syslinks("pthread")
+	add_syslinks("pthread", "rt")
 end
 
 -- Override default package function
 on_package(function() end)
 
+if has_config("headless") then
+	-- libobs replacement recording graphics calls into a command log, used by obs-kinect-pipelinetest, not packaged
+	target("obs-headless")
+		set_kind("shared")
+		set_group("Tests")
+
+		add_defines("OBS_HEADLESS_EXPORT")
+
+		add_headerfiles("src/obs-headless/**.hpp")
+		add_files("src/obs-headless/**.cpp")
+
+		add_includedirs("src")
+
+		if is_plat("linux") then
+			add_syslinks("dl")
+		end
+end
+
 target("obs-kinectcore")
 	set_kind("shared")
 	set_group("Core")
 
 	add_defines("OBS_KINECT_CORE_EXPORT")
 
+	if has_config("headless") then
+		add_deps("obs-headless", { public = true })
+	end
+
 	add_headerfiles("include/obs-kinect-core/**.hpp", "include/obs-kinect-core/**.inl")
 	add_headerfiles("src/obs-kinect-core/**.hpp", "src/obs-kinect-core/**.inl")
 	add_files("src/obs-kinect-core/**.cpp")
 
 	add_includedirs("src")
 
+	if is_plat("windows") then
+		add_syslinks("ws2_32")
+	end
+
 	add_rules("copy_to_obs", "package_plugin")
 
 target("obs-kinect")
@@ -266,3 +300,104 @@ target("obs-kinect-freenect2")
 	add_files("src/obs-kinect-freenect2/**.cpp")
 
 	add_rules("kinect_dynlib", "copy_to_obs", "package_backend")
+
+target("obs-kinect-playback")
+	set_kind("shared")
+	set_group("Playback")
+
+	add_deps("obs-kinectcore")
+
+	add_headerfiles("src/obs-kinect-playback/**.hpp", "src/obs-kinect-playback/**.inl")
+	add_files("src/obs-kinect-playback/**.cpp")
+
+	add_rules("kinect_dynlib", "copy_to_obs", "package_backend")
+
+-- Receives devices served by remote capture hosts
+target("obs-kinect-net")
+	set_kind("shared")
+	set_group("Network")
+
+	add_deps("obs-kinectcore")
+
+	add_headerfiles("src/obs-kinect-net/**.hpp", "src/obs-kinect-net/**.inl")
+	add_files("src/obs-kinect-net/**.cpp")
+
+	add_rules("kinect_dynlib", "copy_to_obs", "package_backend")
+
+if not is_plat("windows") then
+	-- Reads devices shared by other processes through POSIX shared memory
+	target("obs-kinect-shm")
+		set_kind("shared")
+		set_group("SharedMemory")
+
+		add_deps("obs-kinectcore")
+
+		add_headerfiles("src/obs-kinect-shm/**.hpp", "src/obs-kinect-shm/**.inl")
+		add_files("src/obs-kinect-shm/**.cpp")
+
+		add_rules("kinect_dynlib", "copy_to_obs", "package_backend")
+end
+
+-- Procedural device used for load testing, not packaged
+target("obs-kinect-synthetic")
+	set_kind("shared")
+	set_group("Synthetic")
+
+	add_deps("obs-kinectcore")
+
+	add_headerfiles("src/obs-kinect-synthetic/**.hpp", "src/obs-kinect-synthetic/**.inl")
+	add_files("src/obs-kinect-synthetic/**.cpp")
+
+	add_rules("kinect_dynlib", "copy_to_obs")
+
+-- Measures PlaneCodec ratio and throughput on recordings, not packaged
+target("obs-kinect-codecbench")
+	set_kind("binary")
+	set_group("Tools")
+
+	add_deps("obs-kinectcore")
+
+	add_files("src/obs-kinect-codecbench/**.cpp")
+
+-- Streams frames through the network sender and receiver over loopback, not packaged
+target("obs-kinect-netbench")
+	set_kind("binary")
+	set_group("Tools")
+
+	add_deps("obs-kinectcore")
+
+	add_files("src/obs-kinect-netbench/**.cpp")
+
+-- Checks core algorithms against straightforward implementations, not packaged
+target("obs-kinect-coretest")
+	set_kind("binary")
+	set_group("Tools")
+
+	add_deps("obs-kinectcore")
+
+	add_files("src/obs-kinect-coretest/**.cpp")
+
+-- Checks software shaders against golden images (src/obs-kinect-shadertest/golden) or GPU captures and measures them, not packaged
+target("obs-kinect-shadertest")
+	set_kind("binary")
+	set_group("Tools")
+
+	add_deps("obs-kinectcore")
+
+	add_files("src/obs-kinect-shadertest/**.cpp")
+
+if has_config("headless") then
+	-- Drives Kinect sources on synthetic devices through obs-headless and checks per-frame uploads, passes and allocations, not packaged
+	target("obs-kinect-pipelinetest")
+		set_kind("binary")
+		set_group("Tools")
+
+		add_deps("obs-headless")
+		add_deps("obs-kinect", "obs-kinect-synthetic", { inherit = false })
+
+		add_files("src/obs-kinect-pipelinetest/**.cpp")
+
+		add_includedirs("src")
+
+		set_runargs(path.join(os.scriptdir(), "data", "obs-plugins", "obs-kinect"))
+end